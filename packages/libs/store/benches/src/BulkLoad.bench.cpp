@@ -0,0 +1,104 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::store::NoteStore;
+using pg::store::StoreOptions;
+
+constexpr std::size_t NOTES = 100'000;
+constexpr std::size_t BATCH = 1'000;
+constexpr std::size_t VOCABULARY = 20'000;
+constexpr std::size_t WORDS = 120;
+
+auto make_corpus() -> std::vector<CreateNote> {
+    auto rng = std::mt19937 { 7 };
+    auto vocabulary = std::vector<std::string> {};
+    for (std::size_t i = 0; i < VOCABULARY; ++i) {
+        vocabulary.push_back(fmt::format("w{}x{}", i, rng() % 1000));
+    }
+    // Word frequencies fall off roughly as in natural text, so a few words are in most notes.
+    auto zipf = std::discrete_distribution<std::size_t> { VOCABULARY, 0.0, 1.0, [](double x) { return 1.0 / x; } };
+    auto corpus = std::vector<CreateNote> {};
+    corpus.reserve(NOTES);
+    for (std::size_t i = 0; i < NOTES; ++i) {
+        auto content = std::string {};
+        for (std::size_t word = 0; word < WORDS; ++word) {
+            content += vocabulary[zipf(rng)];
+            content += ' ';
+        }
+        corpus.push_back(CreateNote {
+          fmt::format("Note {} on {}", i, vocabulary[zipf(rng)]),
+          std::move(content),
+          std::vector<std::string> { fmt::format("tag-{}", rng() % 200), fmt::format("group-{}", i % 10) } });
+    }
+    return corpus;
+}
+
+/**
+ * Insert `corpus` in batches, with the indexes left to one build at the end if `bulk`.
+ * @return The milliseconds spent inserting and, separately, building the indexes
+ */
+auto load(NoteStore& store, std::span<const CreateNote> corpus, bool bulk) -> std::pair<double, double> {
+    plf::nanotimer timer;
+    timer.start();
+    if (bulk) {
+        store.begin_bulk_load();
+    }
+    for (std::size_t first = 0; first < corpus.size(); first += BATCH) {
+        (void) store.create_many(corpus.subspan(first, std::min(BATCH, corpus.size() - first)));
+    }
+    const auto inserted = timer.get_elapsed_ms();
+    if (bulk) {
+        (void) store.end_bulk_load();
+    }
+    return { inserted, timer.get_elapsed_ms() - inserted };
+}
+
+}  // namespace
+
+auto main() -> int {
+    const auto corpus = make_corpus();
+    fmt::print(
+      "{:>8} {:>12} {:>12} {:>12} {:>12} {:>8}\n", "threads", "mode", "insert ms", "index ms", "total ms", "speedup");
+    const auto cores = std::max(1U, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= cores; threads *= 2) {
+        auto incremental = 0.0;
+        for (const auto bulk : { false, true }) {
+            auto options = StoreOptions {};
+            options.write_threads = threads;
+            auto store = NoteStore { options };
+            const auto [inserted, indexed] = load(store, corpus, bulk);
+            const auto total = inserted + indexed;
+            if (!bulk) {
+                incremental = total;
+            }
+            fmt::print(
+              "{:>8} {:>12} {:>12.1f} {:>12.1f} {:>12.1f} {:>7.1f}x\n",
+              threads,
+              bulk ? "bulk" : "incremental",
+              inserted,
+              indexed,
+              total,
+              incremental / total);
+        }
+    }
+    return 0;
+}
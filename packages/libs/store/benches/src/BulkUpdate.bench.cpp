@@ -0,0 +1,88 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::store::AppendText;
+using pg::store::NoteEdit;
+using pg::store::NoteId;
+using pg::store::NoteStore;
+using pg::store::ReplaceText;
+using pg::store::StoreOptions;
+
+constexpr std::size_t NOTES = 10'000;
+constexpr std::size_t CONTENT_BYTES = 8 << 10;
+
+auto fill(NoteStore& store) -> std::vector<NoteId> {
+    auto ids = std::vector<NoteId> {};
+    ids.reserve(NOTES);
+    auto content = std::string {};
+    while (content.size() < CONTENT_BYTES) {
+        content += "the quick brown fox jumps over the lazy dog ";
+    }
+    for (std::size_t i = 0; i < NOTES; ++i) {
+        ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), content, std::nullopt }));
+    }
+    return ids;
+}
+
+auto make_edits(const std::vector<NoteId>& ids) -> std::vector<NoteEdit> {
+    auto edits = std::vector<NoteEdit> {};
+    edits.reserve(ids.size());
+    for (const auto& id : ids) {
+        edits.push_back(NoteEdit { id, {}, { ReplaceText { "lazy", "sleepy" }, AppendText { " the end" } }, {} });
+    }
+    return edits;
+}
+
+}  // namespace
+
+auto main() -> int {
+    fmt::print("{:>8} {:>12} {:>14} {:>8}\n", "threads", "ms", "edits/s", "speedup");
+    auto baseline = 0.0;
+    {
+        auto store = NoteStore {};
+        const auto edits = make_edits(fill(store));
+        plf::nanotimer timer;
+        timer.start();
+        for (const auto& edit : edits) {
+            (void) store.edit(edit);
+        }
+        baseline = timer.get_elapsed_ms();
+        fmt::print("{:>8} {:>12.1f} {:>14.0f} {:>8}\n", "edit()", baseline, NOTES / baseline * 1000, "");
+    }
+
+    const auto cores = std::max(1U, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= cores; threads *= 2) {
+        auto options = StoreOptions {};
+        options.write_threads = threads;
+        auto store = NoteStore { options };
+        const auto edits = make_edits(fill(store));
+        plf::nanotimer timer;
+        timer.start();
+        const auto batch = store.edit_many(edits);
+        const auto elapsed = timer.get_elapsed_ms();
+        if (batch.applied != edits.size()) {
+            fmt::print(stderr, "only {} of {} edits applied\n", batch.applied, edits.size());
+            return 1;
+        }
+        fmt::print(
+          "{:>8} {:>12.1f} {:>14.0f} {:>7.1f}x\n", threads, elapsed, NOTES / elapsed * 1000, baseline / elapsed);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <cstdlib>
+#include <optional>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::Checkpoint;
+using pg::store::CheckpointWriter;
+using pg::store::NoteStore;
+using pg::store::StoreOptions;
+
+constexpr std::size_t NOTES = 200'000;
+
+template <typename T>
+auto check(T result) -> T {
+    if (!result) {
+        fmt::print(stderr, "{}\n", result.error().message);
+        std::exit(1);
+    }
+    return result;
+}
+
+/// Time to a searchable store from the checkpoint in `directory`, with and without the content index.
+void measure(const std::filesystem::path& directory, bool verify, bool index_content) {
+    plf::nanotimer timer;
+    timer.start();
+    auto checkpoint = check(Checkpoint::open(directory, verify));
+    const auto mapped = timer.get_elapsed_ms();
+    auto options = StoreOptions {};
+    options.index_content = index_content;
+    auto store = check(NoteStore::load(std::move(*checkpoint), options));
+    const auto loaded = timer.get_elapsed_ms();
+    fmt::print(
+      "{:>8} {:>8} {:>12.1f} {:>12.1f} {:>10}\n",
+      verify,
+      index_content,
+      mapped,
+      loaded,
+      (*store)->version_count());
+}
+
+}  // namespace
+
+auto main() -> int {
+    const auto directory = std::filesystem::temp_directory_path() / "pg-checkpoint-bench";
+    std::filesystem::remove_all(directory);
+    {
+        auto store = NoteStore {};
+        auto ids = std::vector<pg::store::NoteId> {};
+        ids.reserve(NOTES);
+        for (std::size_t i = 0; i < NOTES; ++i) {
+            auto tags = std::vector<std::string> { "common", fmt::format("group {}", i % 100) };
+            auto content = std::string(2048, static_cast<char>('a' + i % 26));
+            ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), std::move(content), std::move(tags) }));
+        }
+        auto writer = CheckpointWriter { directory };
+        plf::nanotimer timer;
+        timer.start();
+        auto written = check(writer.write(store, store.take_dirty_chunks()));
+        fmt::print(
+          "full: {} notes, {} chunks, {} MiB, in {:.1f} ms\n",
+          written->notes,
+          written->chunks_written,
+          written->bytes >> 20,
+          timer.get_elapsed_ms());
+
+        // A burst of writes to a few hot notes only dirties their chunks.
+        for (std::size_t i = 0; i < 1000; ++i) {
+            (void) store.update(UpdateNote { ids[(i * 7919) % 64], "hot", std::nullopt, std::nullopt });
+        }
+        timer.start();
+        written = check(writer.write(store, store.take_dirty_chunks()));
+        fmt::print(
+          "incremental: {} chunks written, {} reused, {} KiB, in {:.1f} ms\n",
+          written->chunks_written,
+          written->chunks_reused,
+          written->bytes >> 10,
+          timer.get_elapsed_ms());
+    }
+
+    fmt::print("{:>8} {:>8} {:>12} {:>12} {:>10}\n", "verify", "content", "mapped ms", "loaded ms", "versions");
+    for (const auto verify : { true, false }) {
+        for (const auto index_content : { true, false }) {
+            measure(directory, verify, index_content);
+        }
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
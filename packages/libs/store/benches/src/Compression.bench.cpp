@@ -0,0 +1,116 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::data::CreateNote;
+using pg::store::NoteOrdinal;
+using pg::store::NoteStore;
+using pg::store::StoreOptions;
+
+constexpr std::size_t NOTES = 50'000;
+constexpr std::size_t READS = 200'000;
+
+constexpr auto WORDS = std::to_array<std::string_view>({
+  "meeting", "agenda",   "follow", "up",     "with",  "the",      "team",    "about",   "release", "schedule",
+  "review",  "design",   "doc",    "before", "next",  "sprint",   "budget",  "numbers", "look",    "fine",
+  "todo",    "call",     "vendor", "re",     "quote", "and",      "update",  "ticket",  "notes",   "from",
+  "standup", "blockers", "none",   "ship",   "it",    "customer", "reports", "bug",     "in",      "export",
+});
+
+auto make_body(std::mt19937& rng, std::size_t bytes) -> std::string {
+    auto body = std::string {};
+    body.reserve(bytes + 16);
+    while (body.size() < bytes) {
+        body.append(WORDS[rng() % WORDS.size()]);
+        body.push_back(rng() % 12 == 0 ? '\n' : ' ');
+    }
+    return body;
+}
+
+auto read_all(const NoteStore& store, std::mt19937& rng) -> double {
+    plf::nanotimer timer;
+    timer.start();
+    auto bytes = std::size_t { 0 };
+    for (std::size_t i = 0; i < READS; ++i) {
+        const auto snapshot = store.snapshot();
+        bytes += store.peek(static_cast<NoteOrdinal>(rng() % NOTES), snapshot)->content.size();
+    }
+    const auto elapsed = timer.get_elapsed_ns();
+    if (bytes == 0) {
+        fmt::print(stderr, "nothing read\n");
+    }
+    return elapsed / READS;
+}
+
+}  // namespace
+
+auto main() -> int {
+    fmt::print(
+      "{:>8} {:>10} {:>12} {:>12} {:>8} {:>12} {:>12} {:>12}\n",
+      "effort",
+      "block KiB",
+      "content MiB",
+      "held MiB",
+      "ratio",
+      "compress ms",
+      "hot read ns",
+      "cold read ns");
+    for (const auto effort : { 1U, 16U, 64U }) {
+        for (const auto block : { 16U, 64U }) {
+            auto store = NoteStore { StoreOptions {
+              .compaction_threshold = 0,
+              .cold_after = 1,
+              .compression_interval = 0ms,
+              .compression_block = block * 1024,
+              .compression_effort = effort,
+            } };
+            auto rng = std::mt19937 { 11 };
+            for (std::size_t i = 0; i < NOTES; ++i) {
+                (void) store.create(CreateNote { fmt::format("Note {}", i), make_body(rng, 256 + rng() % 4096), {} });
+            }
+            const auto content = store.blobs().bytes();
+            const auto hot = read_all(store, rng);
+
+            plf::nanotimer timer;
+            timer.start();
+            const auto compressed = store.compress_cold();
+            const auto compress_ms = timer.get_elapsed_ms();
+            store.collect_garbage();
+            const auto held = store.blobs().bytes() + store.packed_bytes();
+            const auto cold = read_all(store, rng);
+            if (compressed != NOTES) {
+                fmt::print(stderr, "compressed {} of {} notes\n", compressed, NOTES);
+            }
+
+            fmt::print(
+              "{:>8} {:>10} {:>12.1f} {:>12.1f} {:>7.2f}x {:>12.1f} {:>12.0f} {:>12.0f}\n",
+              effort,
+              block,
+              static_cast<double>(content) / (1 << 20),
+              static_cast<double>(held) / (1 << 20),
+              static_cast<double>(content) / static_cast<double>(held),
+              compress_ms,
+              hot,
+              cold);
+        }
+    }
+    return 0;
+}
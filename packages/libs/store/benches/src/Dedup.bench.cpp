@@ -0,0 +1,87 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::store::CheckpointWriter;
+using pg::store::NoteStore;
+
+constexpr std::size_t NOTES = 50'000;
+constexpr std::size_t TEMPLATES = 50;
+
+auto make_body(std::mt19937& rng, std::size_t bytes) -> std::string {
+    auto body = std::string {};
+    body.reserve(bytes);
+    while (body.size() < bytes) {
+        body.append(fmt::format("line {} of boilerplate\n", rng() % 100'000));
+    }
+    return body;
+}
+
+}  // namespace
+
+auto main() -> int {
+    auto rng = std::mt19937 { 7 };
+    auto templates = std::vector<std::string> {};
+    for (std::size_t i = 0; i < TEMPLATES; ++i) {
+        templates.push_back(make_body(rng, 1024 + rng() % 7168));
+    }
+
+    const auto directory = std::filesystem::temp_directory_path() / "pg-dedup-bench";
+    fmt::print(
+      "{:>10} {:>12} {:>12} {:>10} {:>10} {:>14}\n",
+      "templated",
+      "content MiB",
+      "held MiB",
+      "blobs",
+      "create ms",
+      "checkpoint MiB");
+    for (const auto percent : { 0U, 50U, 90U }) {
+        auto store = NoteStore {};
+        auto logical = std::size_t { 0 };
+        plf::nanotimer timer;
+        timer.start();
+        for (std::size_t i = 0; i < NOTES; ++i) {
+            auto body = rng() % 100 < percent ? templates[rng() % TEMPLATES] : make_body(rng, 1024 + rng() % 7168);
+            logical += body.size();
+            (void) store.create(CreateNote { fmt::format("Note {}", i), std::move(body), std::nullopt });
+        }
+        const auto create_ms = timer.get_elapsed_ms();
+
+        std::filesystem::remove_all(directory);
+        auto writer = CheckpointWriter { directory };
+        const auto written = writer.write(store, store.take_dirty_chunks());
+        if (!written) {
+            fmt::print(stderr, "{}\n", written.error().message);
+            return 1;
+        }
+        fmt::print(
+          "{:>9}% {:>12.1f} {:>12.1f} {:>10} {:>10.1f} {:>14.1f}\n",
+          percent,
+          static_cast<double>(logical) / (1 << 20),
+          static_cast<double>(store.blobs().bytes()) / (1 << 20),
+          store.blobs().size(),
+          create_ms,
+          static_cast<double>(written->bytes) / (1 << 20));
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
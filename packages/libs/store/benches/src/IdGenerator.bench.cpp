@@ -0,0 +1,92 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/IdGenerator.hpp>
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_hash.hpp>
+#include <parallel_hashmap/btree.h>
+#include <parallel_hashmap/phmap.h>
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::store::NoteId;
+
+constexpr std::size_t IDS = 1'000'000;
+
+template <typename Generate>
+auto generate(Generate&& next) -> std::vector<NoteId> {
+    auto ids = std::vector<NoteId> {};
+    ids.reserve(IDS);
+    for (std::size_t i = 0; i < IDS; ++i) {
+        ids.push_back(next());
+    }
+    return ids;
+}
+
+template <typename Hash>
+auto hash_insert_ms(const std::vector<NoteId>& ids) -> double {
+    plf::nanotimer timer;
+    timer.start();
+    auto map = phmap::flat_hash_map<NoteId, std::size_t, Hash> {};
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        map.emplace(ids[i], i);
+    }
+    auto found = std::size_t { 0 };
+    for (const auto& id : ids) {
+        found += map.count(id);
+    }
+    const auto elapsed = timer.get_elapsed_ms();
+    return found == ids.size() ? elapsed : -1.0;
+}
+
+auto ordered_insert_ms(const std::vector<NoteId>& ids) -> double {
+    plf::nanotimer timer;
+    timer.start();
+    auto set = phmap::btree_set<NoteId> {};
+    for (const auto& id : ids) {
+        set.insert(id);
+    }
+    return timer.get_elapsed_ms();
+}
+
+}  // namespace
+
+auto main() -> int {
+    plf::nanotimer timer;
+
+    timer.start();
+    auto random_generator = boost::uuids::random_generator {};
+    const auto random = generate([&] { return random_generator(); });
+    const auto random_ms = timer.get_elapsed_ms();
+
+    timer.start();
+    const auto ordered = generate([] { return pg::store::generate_note_id(); });
+    const auto ordered_ms = timer.get_elapsed_ms();
+
+    fmt::print("{} ids\n", IDS);
+    fmt::print("{:<28} {:>12} {:>12}\n", "", "random v4", "UUIDv7");
+    fmt::print("{:<28} {:>12.3f} {:>12.3f}\n", "generate ms", random_ms, ordered_ms);
+    fmt::print(
+      "{:<28} {:>12.3f} {:>12.3f}\n",
+      "flat_hash_map, boost::hash",
+      hash_insert_ms<boost::hash<NoteId>>(random),
+      hash_insert_ms<boost::hash<NoteId>>(ordered));
+    fmt::print(
+      "{:<28} {:>12.3f} {:>12.3f}\n",
+      "flat_hash_map, NoteIdHash",
+      hash_insert_ms<pg::store::NoteIdHash>(random),
+      hash_insert_ms<pg::store::NoteIdHash>(ordered));
+    fmt::print(
+      "{:<28} {:>12.3f} {:>12.3f}\n", "btree_set insert ms", ordered_insert_ms(random), ordered_insert_ms(ordered));
+    return 0;
+}
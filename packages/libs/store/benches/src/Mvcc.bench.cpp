@@ -0,0 +1,119 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::NoteField;
+using pg::store::NoteId;
+using pg::store::NoteStore;
+using pg::store::Predicate;
+using pg::store::SearchQuery;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+
+constexpr std::size_t NOTES = 20'000;
+constexpr std::size_t READS = 20'000;
+
+struct Latency {
+    double p50;
+    double p99;
+    double max;
+};
+
+auto percentiles(std::vector<double>& samples) -> Latency {
+    std::ranges::sort(samples);
+    const auto at = [&](double q) {
+        return samples[static_cast<std::size_t>(q * static_cast<double>(samples.size() - 1))];
+    };
+    return Latency { at(0.5), at(0.99), samples.back() };
+}
+
+/// Time `READS` point reads plus small tag searches while `writers` threads update random notes as fast as they can.
+auto measure(NoteStore& store, const std::vector<NoteId>& ids, std::size_t writers)
+  -> std::pair<Latency, std::size_t> {
+    auto stop = std::atomic<bool> { false };
+    auto writes = std::atomic<std::size_t> { 0 };
+    auto pool = std::vector<std::jthread> {};
+    for (std::size_t w = 0; w < writers; ++w) {
+        pool.emplace_back([&, w] {
+            auto rng = std::mt19937 { static_cast<unsigned>(w) };
+            auto pick = std::uniform_int_distribution<std::size_t> { 0, ids.size() - 1 };
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto text = fmt::format("rewritten {}", rng());
+                (void) store.update(UpdateNote { ids[pick(rng)], text, text, std::nullopt });
+                writes.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    auto rng = std::mt19937 { 42 };
+    auto pick = std::uniform_int_distribution<std::size_t> { 0, ids.size() - 1 };
+    const auto rare = SearchQuery {
+        { Predicate { NoteField::Tag, TextPredicate { TextMatchKind::Matches, "rare", true } } },
+        10,
+    };
+    auto samples = std::vector<double> {};
+    samples.reserve(READS);
+    volatile std::size_t sink = 0;
+    plf::nanotimer timer;
+    for (std::size_t i = 0; i < READS; ++i) {
+        timer.start();
+        if (i % 8 == 0) {
+            sink = sink + store.search(rare).ordinals.size();
+        } else {
+            const auto snapshot = store.snapshot();
+            const auto note = store.get(ids[pick(rng)], snapshot);
+            sink = sink + (note ? note->content.size() : 0);
+        }
+        samples.push_back(timer.get_elapsed_ns());
+    }
+    stop = true;
+    pool.clear();
+    return { percentiles(samples), writes.load() };
+}
+
+}  // namespace
+
+auto main() -> int {
+    auto store = NoteStore {};
+    auto ids = std::vector<NoteId> {};
+    ids.reserve(NOTES);
+    for (std::size_t i = 0; i < NOTES; ++i) {
+        auto tags = std::vector<std::string> { "common" };
+        if (i % 100 == 0) {
+            tags.emplace_back("rare");
+        }
+        ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), "body", std::move(tags) }));
+    }
+
+    fmt::print("{:>8} {:>10} {:>10} {:>10} {:>10}\n", "writers", "p50 ns", "p99 ns", "max ns", "writes");
+    for (std::size_t writers : { 0, 1, 2, 4 }) {
+        const auto [latency, writes] = measure(store, ids, writers);
+        fmt::print(
+          "{:>8} {:>10.0f} {:>10.0f} {:>10.0f} {:>10}\n", writers, latency.p50, latency.p99, latency.max, writes);
+    }
+    fmt::print("versions retained: {}\n", store.version_count());
+    return 0;
+}
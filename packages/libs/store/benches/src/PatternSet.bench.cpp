@@ -0,0 +1,92 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/PatternSet.hpp>
+#include <pg/util/text_search.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+constexpr std::size_t TEXT_BYTES = std::size_t { 1 } << 20;
+
+auto make_text(std::mt19937& rng) -> std::string {
+    auto text = std::string {};
+    text.reserve(TEXT_BYTES);
+    while (text.size() < TEXT_BYTES) {
+        text.append(fmt::format("word{} ", rng() % 5000));
+    }
+    return text;
+}
+
+/// One `find`/replace pass per pattern: what `apply_edits` used to do.
+auto replace_sequentially(std::string text, const std::vector<std::string>& patterns) -> std::string {
+    for (const auto& pattern : patterns) {
+        auto out = std::string {};
+        out.reserve(text.size());
+        auto from = std::size_t { 0 };
+        for (auto at = pg::util::text::find(text, pattern); at != std::string_view::npos;) {
+            out.append(text, from, at - from);
+            out.append("X");
+            from = at + pattern.size();
+            const auto next = pg::util::text::find(std::string_view { text }.substr(from), pattern);
+            at = next == std::string_view::npos ? next : from + next;
+        }
+        out.append(text, from);
+        text = std::move(out);
+    }
+    return text;
+}
+
+}  // namespace
+
+auto main() -> int {
+    auto rng = std::mt19937 { 42 };
+    const auto text = make_text(rng);
+
+    fmt::print("{:>9} {:>12} {:>12} {:>12} {:>8}\n", "patterns", "compile ms", "sequential", "one pass", "states");
+    for (const std::size_t count : { 1, 10, 100, 1000 }) {
+        auto patterns = std::vector<std::string> {};
+        for (std::size_t i = 0; i < count; ++i) {
+            patterns.push_back(fmt::format(" word{} ", rng() % 5000));
+        }
+        const auto views = std::vector<std::string_view> { patterns.begin(), patterns.end() };
+        const auto replacements = std::vector<std::string_view>(count, "X");
+
+        plf::nanotimer timer;
+        timer.start();
+        const auto set = pg::store::PatternSet::compile(views);
+        const auto compile_ms = timer.get_elapsed_ms();
+
+        timer.start();
+        const auto sequential = replace_sequentially(text, patterns);
+        const auto sequential_ms = timer.get_elapsed_ms();
+
+        timer.start();
+        const auto replaced = set->replace(text, replacements);
+        const auto one_pass_ms = timer.get_elapsed_ms();
+
+        // The results differ where matches overlap, so only sizes are printed as a sanity check.
+        fmt::print(
+          "{:>9} {:>12.3f} {:>12.3f} {:>12.3f} {:>8}   ({} vs {} bytes)\n",
+          count,
+          compile_ms,
+          sequential_ms,
+          one_pass_ms,
+          set->states(),
+          sequential.size(),
+          replaced.size());
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/TextEdit.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::store::AppendText;
+using pg::store::InsertText;
+using pg::store::RemoveTextRange;
+using pg::store::TextEdit;
+
+constexpr std::size_t NOTE_BYTES = std::size_t { 1 } << 20;
+
+/// Random inserts and range removals, with the odd append, valid against a text of `size` bytes as it evolves.
+auto make_edits(std::size_t size, std::size_t count) -> std::vector<TextEdit> {
+    auto rng = std::mt19937 { 42 };
+    auto edits = std::vector<TextEdit> {};
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto at = std::uniform_int_distribution<std::size_t> { 0, size }(rng);
+        if (i % 10 == 0) {
+            edits.emplace_back(AppendText { "appended line\n" });
+            size += 14;
+        } else if (i % 3 == 0 && at + 64 <= size) {
+            edits.emplace_back(RemoveTextRange { at, at + 64 });
+            size -= 64;
+        } else {
+            edits.emplace_back(InsertText { at, "inserted text " });
+            size += 14;
+        }
+    }
+    return edits;
+}
+
+/// Apply `edits` straight to a `std::string`, one copy of the tail per edit: what `apply_edits` used to do.
+void apply_naively(std::string& text, const std::vector<TextEdit>& edits) {
+    for (const auto& edit : edits) {
+        if (const auto* append = std::get_if<AppendText>(&edit)) {
+            text.append(append->text);
+        } else if (const auto* insert = std::get_if<InsertText>(&edit)) {
+            text.insert(insert->position, insert->text);
+        } else if (const auto* remove = std::get_if<RemoveTextRange>(&edit)) {
+            text.erase(remove->start, remove->end - remove->start);
+        }
+    }
+}
+
+}  // namespace
+
+auto main() -> int {
+    const auto note = std::string(NOTE_BYTES, 'x');
+
+    fmt::print("{:>8} {:>12} {:>12} {:>8}\n", "edits", "string ms", "pieces ms", "speedup");
+    for (const std::size_t count : { 10, 100, 500, 1000, 5000 }) {
+        const auto edits = make_edits(note.size(), count);
+
+        plf::nanotimer timer;
+        auto naive = note;
+        timer.start();
+        apply_naively(naive, edits);
+        const auto naive_ms = timer.get_elapsed_ms();
+
+        auto pieces = note;
+        timer.start();
+        if (auto applied = pg::store::apply_edits(pieces, edits); !applied) {
+            fmt::print(stderr, "{}\n", applied.error().message);
+            return 1;
+        }
+        const auto pieces_ms = timer.get_elapsed_ms();
+
+        if (pieces != naive) {
+            fmt::print(stderr, "results differ after {} edits\n", count);
+            return 1;
+        }
+        fmt::print("{:>8} {:>12.3f} {:>12.3f} {:>7.1f}x\n", count, naive_ms, pieces_ms, naive_ms / pieces_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/SqliteStore.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::store::SqliteStore;
+
+constexpr std::size_t WRITES = 50'000;
+
+}  // namespace
+
+auto main() -> int {
+    const auto directory = std::filesystem::temp_directory_path() / "pg-sqlite-bench";
+    fmt::print("{:>8} {:>12} {:>12}\n", "batch", "ms", "writes/s");
+    for (const std::size_t batch : { 1, 10, 100, 1000, 10'000 }) {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        auto store = SqliteStore::open(directory / "notes.db");
+        if (!store) {
+            fmt::print(stderr, "{}\n", store.error().message);
+            return 1;
+        }
+        auto notes = std::vector<CreateNote> {};
+        for (std::size_t i = 0; i < batch; ++i) {
+            notes.emplace_back(fmt::format("Note {}", i), std::string(256, 'x'), std::vector<std::string> { "bench" });
+        }
+        // Batches of one commit once per note; keep their run short.
+        const auto writes = batch == 1 ? WRITES / 10 : WRITES;
+
+        plf::nanotimer timer;
+        timer.start();
+        for (std::size_t written = 0; written < writes; written += batch) {
+            if (auto created = (*store)->create(notes); !created) {
+                fmt::print(stderr, "{}\n", created.error().message);
+                return 1;
+            }
+        }
+        const auto elapsed = timer.get_elapsed_ms();
+        fmt::print("{:>8} {:>12.1f} {:>12.0f}\n", batch, elapsed, static_cast<double>(writes) / elapsed * 1000);
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
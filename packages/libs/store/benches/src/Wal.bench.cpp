@@ -0,0 +1,85 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Wal.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::store::FrameKind;
+using pg::store::Timestamp;
+using pg::store::WalFrame;
+using pg::store::WalOptions;
+using pg::store::WalStats;
+using pg::store::WriteAheadLog;
+
+constexpr std::size_t COMMITS = 4'000;
+/// Roughly a serialized `UpdateNoteRequest` with a couple of edits.
+constexpr std::size_t PAYLOAD = 160;
+
+struct Run {
+    double commits_per_second;
+    WalStats stats;
+};
+
+/// Spread `COMMITS` durable commits over `committers` threads against a fresh log.
+auto measure(const std::filesystem::path& path, std::size_t committers, std::chrono::microseconds max_delay) -> Run {
+    std::filesystem::remove(path);
+    auto wal = WriteAheadLog::open(path, WalOptions { .max_delay = max_delay });
+    if (!wal) {
+        fmt::print(stderr, "{}\n", wal.error().message);
+        std::exit(1);
+    }
+    const auto payload = std::vector<std::uint8_t>(PAYLOAD, 'x');
+    plf::nanotimer timer;
+    timer.start();
+    {
+        auto pool = std::vector<std::jthread> {};
+        for (std::size_t t = 0; t < committers; ++t) {
+            pool.emplace_back([&] {
+                for (std::size_t i = 0; i < COMMITS / committers; ++i) {
+                    (void) (*wal)->commit(WalFrame { FrameKind::Update, i, Timestamp {}, payload });
+                }
+            });
+        }
+    }
+    const auto seconds = timer.get_elapsed_ns() / 1e9;
+    const auto stats = (*wal)->stats();
+    return Run { static_cast<double>(stats.commits) / seconds, stats };
+}
+
+}  // namespace
+
+auto main() -> int {
+    const auto path = std::filesystem::temp_directory_path() / "pg-wal-bench.log";
+    fmt::print("{:>10} {:>10} {:>12} {:>12} {:>10}\n", "threads", "delay us", "commits/s", "commits/sync", "largest");
+    for (const auto max_delay : { 0us, 50us, 200us, 1000us }) {
+        for (std::size_t committers : { 1, 4, 16, 64 }) {
+            const auto [rate, stats] = measure(path, committers, max_delay);
+            fmt::print(
+              "{:>10} {:>10} {:>12.0f} {:>12.1f} {:>10}\n",
+              committers,
+              max_delay.count(),
+              rate,
+              static_cast<double>(stats.commits) / static_cast<double>(stats.batches),
+              stats.largest_batch);
+        }
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief A dense set of `NoteOrdinal`s, one bit per ordinal.
+ *
+ * Bits past the end of the bitmap are treated as clear, so bitmaps of different sizes can be combined freely. This is
+ * the common currency between the indexes: every index lookup can produce one, and combining predicates is a matter
+ * of word-wise `&`, `|` and `& ~`.
+ */
+class Bitmap {
+  public:
+    using Word = std::uint64_t;
+    constexpr static std::size_t WORD_BITS = 64;
+    constexpr static NoteOrdinal npos = INVALID_ORDINAL;
+
+    Bitmap() = default;
+
+    /**
+     * @brief Create an empty bitmap with room for `bits` ordinals.
+     */
+    explicit Bitmap(std::size_t bits): words_((bits + WORD_BITS - 1) / WORD_BITS, 0) { }
+
+    /**
+     * @brief Create a bitmap with every ordinal in `[0, bits)` set.
+     */
+    [[nodiscard]] static auto filled(std::size_t bits) -> Bitmap;
+
+    /**
+     * @brief Create a bitmap from a list of ordinals, in any order.
+     */
+    [[nodiscard]] static auto from_ordinals(std::span<const NoteOrdinal> ordinals) -> Bitmap;
+
+    void set(NoteOrdinal ordinal) {
+        const auto word = ordinal / WORD_BITS;
+        if (word >= words_.size()) {
+            words_.resize(word + 1, 0);
+        }
+        words_[word] |= bit_of(ordinal);
+    }
+
+    void reset(NoteOrdinal ordinal) noexcept {
+        const auto word = ordinal / WORD_BITS;
+        if (word < words_.size()) {
+            words_[word] &= ~bit_of(ordinal);
+        }
+    }
+
+    [[nodiscard]] auto test(NoteOrdinal ordinal) const noexcept -> bool {
+        const auto word = ordinal / WORD_BITS;
+        return word < words_.size() && (words_[word] & bit_of(ordinal)) != 0;
+    }
+
+    /**
+     * @brief Number of ordinals this bitmap can address without growing.
+     */
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return words_.size() * WORD_BITS; }
+
+    /**
+     * @brief Number of set bits.
+     */
+    [[nodiscard]] auto count() const noexcept -> std::size_t;
+
+    [[nodiscard]] auto empty() const noexcept -> bool;
+
+    /**
+     * @brief Popcount of `this & other`, without building the intersection.
+     */
+    [[nodiscard]] auto intersect_count(const Bitmap& other) const noexcept -> std::size_t;
+
+    /**
+     * @brief The first set ordinal `>= from`, or `npos`.
+     */
+    [[nodiscard]] auto next(NoteOrdinal from) const noexcept -> NoteOrdinal;
+
+    [[nodiscard]] auto to_ordinals() const -> std::vector<NoteOrdinal>;
+
+    void clear() noexcept { words_.clear(); }
+
+    auto operator&=(const Bitmap& other) -> Bitmap&;
+    auto operator|=(const Bitmap& other) -> Bitmap&;
+    /**
+     * @brief Clear every bit that is set in `other` (`this & ~other`).
+     */
+    auto subtract(const Bitmap& other) -> Bitmap&;
+
+    /**
+     * @brief Call `fn(ordinal)` for every set bit, in ascending order.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (std::size_t w = 0; w < words_.size(); ++w) {
+            auto word = words_[w];
+            while (word != 0) {
+                fn(static_cast<NoteOrdinal>(w * WORD_BITS + static_cast<std::size_t>(std::countr_zero(word))));
+                word &= word - 1;
+            }
+        }
+    }
+
+    /**
+     * @brief Keep only the ordinals for which `pred(ordinal)` returns **true**.
+     */
+    template <typename Pred>
+    void retain(Pred&& pred) {
+        for (std::size_t w = 0; w < words_.size(); ++w) {
+            auto word = words_[w];
+            while (word != 0) {
+                const auto low = word & (~word + 1);
+                if (!pred(static_cast<NoteOrdinal>(w * WORD_BITS + static_cast<std::size_t>(std::countr_zero(word))))) {
+                    words_[w] &= ~low;
+                }
+                word &= word - 1;
+            }
+        }
+    }
+
+    [[nodiscard]] auto words() const noexcept -> std::span<const Word> { return words_; }
+
+    friend auto operator==(const Bitmap& lhs, const Bitmap& rhs) noexcept -> bool;
+
+  private:
+    [[nodiscard]] constexpr static auto bit_of(NoteOrdinal ordinal) noexcept -> Word {
+        return Word { 1 } << (ordinal % WORD_BITS);
+    }
+
+    std::vector<Word> words_;
+};
+
+[[nodiscard]] inline auto operator&(Bitmap lhs, const Bitmap& rhs) -> Bitmap {
+    lhs &= rhs;
+    return lhs;
+}
+
+[[nodiscard]] inline auto operator|(Bitmap lhs, const Bitmap& rhs) -> Bitmap {
+    lhs |= rhs;
+    return lhs;
+}
+
+}  // namespace pg::store
@@ -0,0 +1,103 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief A 128-bit, non-cryptographic hash of a note body.
+ */
+struct ContentHash {
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    friend auto operator==(const ContentHash&, const ContentHash&) -> bool = default;
+};
+
+/**
+ * @brief MurmurHash3 (x64, 128-bit) of `text`, with seed zero.
+ */
+[[nodiscard]] auto hash_content(std::string_view text) noexcept -> ContentHash;
+
+/**
+ * @brief One distinct note body, shared by every note version that holds those bytes.
+ */
+struct Blob {
+    ContentHash hash;
+    std::string text;
+};
+
+using BlobRef = std::shared_ptr<const Blob>;
+
+/**
+ * @brief Content-addressed, reference counted store of note bodies.
+ *
+ * `intern` hashes a body and hands back the blob already holding the same bytes, if there is one, so notes copied from
+ * the same template share a single allocation. A blob lives for as long as a `BlobRef` to it does, and leaves the
+ * store when the last one goes. Bytes are compared on every hash match, so a collision costs a missed deduplication,
+ * never a wrong body.
+ *
+ * Thread safe. Must outlive every blob it hands out.
+ */
+class BlobStore {
+  public:
+    BlobStore() = default;
+    BlobStore(const BlobStore&) = delete;
+    auto operator=(const BlobStore&) -> BlobStore& = delete;
+
+    /**
+     * @brief The blob holding `text`: an existing one if any holds the same bytes, otherwise a new one taking `text`.
+     */
+    auto intern(std::string text) -> BlobRef;
+
+    /**
+     * @brief Number of distinct bodies held.
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+    /**
+     * @brief Bytes of body text held, each distinct body counted once.
+     */
+    [[nodiscard]] auto bytes() const -> std::size_t;
+    /**
+     * @brief Calls to `intern` that found their body already held.
+     */
+    [[nodiscard]] auto hits() const -> std::size_t;
+
+  private:
+    struct HashOf {
+        auto operator()(const ContentHash& hash) const noexcept -> std::size_t {
+            return static_cast<std::size_t>(hash.low);
+        }
+    };
+
+    struct Entry {
+        /// Compared against on release, since `weak` can no longer tell which blob it pointed to.
+        const Blob* blob = nullptr;
+        std::weak_ptr<const Blob> weak;
+    };
+
+    /**
+     * @brief Deleter of every blob: forgets it unless a newer blob with the same hash has replaced it, then frees it.
+     */
+    void release(const Blob* blob) noexcept;
+
+    mutable std::mutex mutex_;
+    phmap::flat_hash_map<ContentHash, Entry, HashOf> blobs_;
+    std::size_t bytes_ = 0;
+    std::size_t hits_ = 0;
+};
+
+}  // namespace pg::store
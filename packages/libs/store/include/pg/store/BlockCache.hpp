@@ -0,0 +1,48 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <pg/store/LruCache.hpp>
+#include <pg/store/Mvcc.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief A bounded, thread safe cache of decompressed `PackedBlock`s, so reading several cold notes from one block
+ * decompresses it once. Least recently used blocks are evicted first, until the text cached fits in `capacity` bytes.
+ *
+ * Readers hold on to the text they are handed (the store has their `Snapshot` keep it), so evicting a block only drops
+ * the cache's reference to it.
+ */
+class BlockCache {
+  public:
+    explicit BlockCache(std::size_t capacity): cache_ { capacity } { }
+
+    /**
+     * @brief The decompressed text of `block`, decompressing and caching it on a miss.
+     */
+    [[nodiscard]] auto read(const PackedBlock& block) -> std::shared_ptr<const std::string>;
+
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return cache_.capacity(); }
+    /**
+     * @brief Decompressed bytes cached.
+     */
+    [[nodiscard]] auto bytes() const -> std::size_t { return cache_.weight(); }
+    [[nodiscard]] auto hits() const -> std::size_t { return cache_.hits(); }
+    [[nodiscard]] auto misses() const -> std::size_t { return cache_.misses(); }
+
+  private:
+    /// Keyed by `PackedBlock::id`, weighed in bytes.
+    LruCache<std::uint64_t, std::shared_ptr<const std::string>> cache_;
+};
+
+}  // namespace pg::store
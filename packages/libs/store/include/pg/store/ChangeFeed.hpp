@@ -0,0 +1,175 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/Wal.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief One committed mutation, exactly as it was logged.
+ */
+struct ChangeEvent {
+    /**
+     * @brief The commit version the mutation produced. Every commit is one event, so sequences have no gaps.
+     */
+    CommitVersion sequence = 0;
+    FrameKind kind = FrameKind::Create;
+    Timestamp timestamp {};
+    /**
+     * @brief The serialized request, as `FrameKind` describes it; a create always carries the id it was given.
+     */
+    std::vector<std::uint8_t> payload;
+};
+
+class ChangeSubscription;
+
+/**
+ * @brief An in-process feed of committed mutations, for any number of subscribers to follow at their own pace.
+ *
+ * The feed keeps the latest `capacity` events in a ring. Publishing never waits for a subscriber: it overwrites the
+ * oldest event whether or not everybody has read it, under a lock held just long enough to store one pointer.
+ * Subscribers pull, each with its own cursor; one that falls behind the ring catches up through its backfill (see
+ * `ChangeSubscription`), which `DurableStore` serves from its write-ahead log.
+ */
+class ChangeFeed {
+  public:
+    using Event = std::shared_ptr<const ChangeEvent>;
+
+    /**
+     * @brief Reads up to `max` events from `from` on, from wherever older events are kept.
+     */
+    using Backfill = std::function<Result<std::vector<Event>>(CommitVersion from, std::size_t max)>;
+
+    struct SubscriberStats {
+        std::uint64_t id = 0;
+        /// The sequence the subscriber reads next.
+        CommitVersion next = 0;
+        /// Events published that the subscriber has not read yet.
+        std::uint64_t lag = 0;
+    };
+
+    /**
+     * @param capacity Events kept in memory; at least one
+     * @param last The sequence of the last event before the feed started, which the first one published follows
+     */
+    ChangeFeed(std::size_t capacity, CommitVersion last);
+
+    /**
+     * @brief Add `event`, which must follow the last one published.
+     */
+    void publish(Event event);
+
+    /**
+     * @brief Follow the feed from the event after `after`.
+     * @param backfill Serves whatever the subscription asks for that has already left the ring
+     */
+    [[nodiscard]] auto subscribe(CommitVersion after, Backfill backfill) -> std::unique_ptr<ChangeSubscription>;
+
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return ring_.size(); }
+    /**
+     * @brief The sequence of the last event published.
+     */
+    [[nodiscard]] auto last() const -> CommitVersion;
+    /**
+     * @brief Every live subscription, in the order they subscribed.
+     */
+    [[nodiscard]] auto subscribers() const -> std::vector<SubscriberStats>;
+
+  private:
+    friend class ChangeSubscription;
+
+    struct Cursor {
+        std::uint64_t id = 0;
+        std::atomic<CommitVersion> next { 0 };
+    };
+
+    struct Read {
+        std::vector<Event> events;
+        /// `from` has already left the ring.
+        bool lagged = false;
+    };
+
+    [[nodiscard]] auto read(CommitVersion from, std::size_t max) const -> Read;
+    /**
+     * @brief Block until the event at `from` is published, `timeout` passes or `stop` is requested.
+     * @return Whether the event is there
+     */
+    auto wait(CommitVersion from, std::chrono::milliseconds timeout, std::stop_token stop) const -> bool;
+    void unsubscribe(const Cursor& cursor);
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable_any published_;
+    /// The event with sequence `s` lives at `ring_[s % ring_.size()]`.
+    std::vector<Event> ring_;
+    CommitVersion last_;
+    std::size_t size_ = 0;
+    std::uint64_t next_subscriber_ = 0;
+    std::vector<std::shared_ptr<Cursor>> cursors_;
+};
+
+/**
+ * @brief One subscriber's position in a `ChangeFeed`. Must not outlive the feed.
+ */
+class ChangeSubscription {
+  public:
+    ChangeSubscription(const ChangeSubscription&) = delete;
+    auto operator=(const ChangeSubscription&) -> ChangeSubscription& = delete;
+    ~ChangeSubscription();
+
+    /**
+     * @brief The next events, up to `max`, in sequence order, and moves past them. Empty when there is nothing new.
+     *
+     * Served from the feed's ring, or from its backfill once the subscription has fallen behind the ring.
+     * @return The events, or why the backfill failed, e.g. `ErrorCode::FailedPrecondition` if the events asked for are
+     * no longer kept anywhere
+     */
+    auto poll(std::size_t max = 256) -> Result<std::vector<ChangeFeed::Event>>;
+
+    /**
+     * @brief Block until there is something to `poll`, `timeout` passes or `stop` is requested.
+     */
+    auto wait(std::chrono::milliseconds timeout, std::stop_token stop = {}) const -> bool;
+
+    [[nodiscard]] auto id() const noexcept -> std::uint64_t { return cursor_->id; }
+    /**
+     * @brief The sequence `poll` returns next.
+     */
+    [[nodiscard]] auto next() const noexcept -> CommitVersion {
+        return cursor_->next.load(std::memory_order_relaxed);
+    }
+    /**
+     * @brief Events published that `poll` has not returned yet.
+     */
+    [[nodiscard]] auto lag() const -> std::uint64_t;
+
+  private:
+    friend class ChangeFeed;
+
+    ChangeSubscription(ChangeFeed& feed, std::shared_ptr<ChangeFeed::Cursor> cursor, ChangeFeed::Backfill backfill)
+        : feed_ { &feed }, cursor_ { std::move(cursor) }, backfill_ { std::move(backfill) } { }
+
+    ChangeFeed* feed_;
+    std::shared_ptr<ChangeFeed::Cursor> cursor_;
+    ChangeFeed::Backfill backfill_;
+};
+
+}  // namespace pg::store
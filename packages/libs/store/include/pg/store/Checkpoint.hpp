@@ -0,0 +1,199 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/NoteStore.hpp>
+
+namespace pg::gen {
+struct NoteObject;
+}  // namespace pg::gen
+
+namespace pg::store {
+
+/**
+ * @brief One chunk of a checkpoint, as listed in its manifest.
+ */
+struct CheckpointChunk {
+    /**
+     * @brief The chunk holds the notes at ordinals `[index * Checkpoint::CHUNK_NOTES, (index + 1) *
+     * Checkpoint::CHUNK_NOTES)`.
+     */
+    std::uint64_t index = 0;
+    /**
+     * @brief The commit version the chunk was written at, which also names its file.
+     */
+    CommitVersion version = 0;
+    std::uint64_t notes = 0;
+
+    friend auto operator==(const CheckpointChunk&, const CheckpointChunk&) -> bool = default;
+};
+
+struct CheckpointStats {
+    /**
+     * @brief Notes in the checkpoint, including those in chunks carried over from the previous one.
+     */
+    std::size_t notes = 0;
+    std::size_t chunks_written = 0;
+    std::size_t chunks_reused = 0;
+    /**
+     * @brief Bytes written, manifest included.
+     */
+    std::uint64_t bytes = 0;
+};
+
+/**
+ * @brief A checkpoint of a `NoteStore`, mapped read-only.
+ *
+ * A checkpoint is a directory holding a manifest and one file per chunk of `CHUNK_NOTES` ordinals. The manifest
+ * (magic, commit version, chunk count, then index, version and note count for each chunk, then a CRC32C of all that;
+ * little-endian) is the only file ever replaced: chunk files are immutable and named after the chunk and the version
+ * they were written at, so a checkpoint can carry over every chunk nothing has written to since the previous one.
+ *
+ * A chunk file is a 24 byte header (magic, version, note count) followed by segments, each a size-prefixed
+ * `pg.gen.NoteStorage` flatbuffer padded to 8 bytes. Splitting the notes over segments keeps each flatbuffer well below
+ * the format's 2 GiB limit and bounds what the writer has to build in memory at once.
+ *
+ * Nothing is unpacked on open: notes are served straight out of the mappings as `NoteView`s, so the only per-note
+ * work is locating each `NoteObject` and parsing its id. The `i`th note of chunk `c` is loaded at slot
+ * `c * CHUNK_NOTES + i`, which keeps every note in the chunk it was written to across restarts; the remaining slots of
+ * a chunk are left empty.
+ */
+class Checkpoint {
+  public:
+    constexpr static std::array<std::uint8_t, 8> MANIFEST_MAGIC { 'P', 'G', 'M', 'A', 'N', 'I', 0, 1 };
+    constexpr static std::array<std::uint8_t, 8> CHUNK_MAGIC { 'P', 'G', 'C', 'K', 'P', 'T', 0, 1 };
+    constexpr static std::string_view MANIFEST_FILE = "MANIFEST";
+    constexpr static std::size_t HEADER = 24;
+    /**
+     * @brief Ordinals per chunk: the unit an incremental checkpoint rewrites.
+     */
+    constexpr static std::size_t CHUNK_NOTES = 4096;
+    /**
+     * @brief Notes are split into a new segment once the current one grows past this many bytes.
+     */
+    constexpr static std::size_t SEGMENT_BYTES = std::size_t { 64 } << 20;
+
+    /**
+     * @brief Map the checkpoint in `directory`.
+     * @param verify Run the flatbuffer verifier over every segment before trusting any offset in it. This reads every
+     * chunk once; only skip it for a checkpoint this process wrote
+     * @return `ErrorCode::DataLoss` if the manifest or a chunk it lists is missing, truncated or fails verification, or
+     * a chunk holds a note without a valid id
+     */
+    static auto open(const std::filesystem::path& directory, bool verify = true)
+      -> Result<std::shared_ptr<const Checkpoint>>;
+
+    /**
+     * @brief Whether `directory` holds a manifest.
+     */
+    [[nodiscard]] static auto exists(const std::filesystem::path& directory) -> bool;
+
+    /**
+     * @brief The file `chunk` is stored in.
+     */
+    [[nodiscard]] static auto chunk_path(const std::filesystem::path& directory, const CheckpointChunk& chunk)
+      -> std::filesystem::path;
+
+    Checkpoint(const Checkpoint&) = delete;
+    auto operator=(const Checkpoint&) -> Checkpoint& = delete;
+
+    /**
+     * @brief The commit version of the store the checkpoint was taken from.
+     */
+    [[nodiscard]] auto version() const noexcept -> CommitVersion { return version_; }
+    /**
+     * @brief Number of slots, including the empty ones.
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return notes_.size(); }
+    [[nodiscard]] auto note_count() const noexcept -> std::size_t { return note_count_; }
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path& { return directory_; }
+    [[nodiscard]] auto chunks() const noexcept -> std::span<const CheckpointChunk> { return chunks_; }
+
+    /**
+     * @brief Whether slot `index` holds a note.
+     */
+    [[nodiscard]] auto contains(std::size_t index) const noexcept -> bool { return notes_[index] != nullptr; }
+    [[nodiscard]] auto id(std::size_t index) const noexcept -> NoteId { return ids_[index]; }
+
+    /**
+     * @brief The note in slot `index`, which must hold one, read from the mapping. Valid for as long as the checkpoint
+     * is.
+     */
+    [[nodiscard]] auto note(std::size_t index) const noexcept -> NoteView;
+
+  private:
+    Checkpoint() = default;
+
+    auto map_chunk(const CheckpointChunk& chunk, bool verify) -> Result<void>;
+
+    std::filesystem::path directory_;
+    CommitVersion version_ = 0;
+    std::vector<CheckpointChunk> chunks_;
+    std::vector<MappedFile> files_;
+    /// Indexed by slot; **nullptr** for an empty one.
+    std::vector<const gen::NoteObject*> notes_;
+    std::vector<NoteId> ids_;
+    std::size_t note_count_ = 0;
+};
+
+/**
+ * @brief Writes incremental checkpoints of one store into one directory.
+ *
+ * Each `write` rewrites only the chunks written to since the last successful one, plus any past the end of the previous
+ * manifest, and carries the rest over from it. It reads nothing but the `NoteStore::DirtyChunks` snapshot, so writers
+ * carry on meanwhile: a note they modify gets a new version and the snapshot keeps reading the old one, which amounts
+ * to copy-on-write at note granularity.
+ */
+class CheckpointWriter {
+  public:
+    /**
+     * @param directory Where to write, created if needed
+     * @param loaded The checkpoint the store was loaded from, if it was. Its chunks are carried over only if it lives
+     * in `directory`; otherwise, or without one, the first `write` rewrites every chunk
+     */
+    explicit CheckpointWriter(std::filesystem::path directory, const Checkpoint* loaded = nullptr);
+
+    /**
+     * @brief Write the chunks `dirty` marks, plus those still pending from a failed write, and replace the manifest.
+     *
+     * Chunk files are synced before the manifest is renamed over the old one, so the directory always holds a
+     * complete checkpoint. Afterwards, chunk files the new manifest no longer lists are removed; one that is still
+     * mapped and cannot be removed is retried next time.
+     */
+    auto write(const NoteStore& store, NoteStore::DirtyChunks dirty) -> Result<CheckpointStats>;
+
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path& { return directory_; }
+    /**
+     * @brief The chunks of the latest manifest written or loaded.
+     */
+    [[nodiscard]] auto chunks() const noexcept -> std::span<const CheckpointChunk> { return manifest_; }
+
+  private:
+    void remove_stale_files() const;
+
+    std::filesystem::path directory_;
+    std::vector<CheckpointChunk> manifest_;
+    /// Chunks marked dirty by an earlier call that failed.
+    Bitmap pending_;
+};
+
+}  // namespace pg::store
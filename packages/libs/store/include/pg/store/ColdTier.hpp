@@ -0,0 +1,70 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Error.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/NoteRecord.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Where `NoteStore` spills notes nobody has touched in a long while, so that only their id and timestamps stay
+ * on the heap.
+ *
+ * Each `spill` writes one append-only segment file of records (a note's title, content and tags) to the tier's
+ * directory, maps it read-only and removes the file again: the OS pages records in as they are read and drops them
+ * under memory pressure, and nothing is left behind if the process dies. Segments are never unmapped while the tier
+ * exists, so a record stays valid however long the version pointing at it lives; records of notes that were promoted
+ * back or rewritten are not reclaimed.
+ */
+class ColdTier {
+  public:
+    /**
+     * @brief What a record holds. Views into the tier's mapping.
+     */
+    struct Record {
+        std::string_view title;
+        std::string_view content;
+        TagList tags;
+    };
+
+    explicit ColdTier(std::filesystem::path directory): directory_ { std::move(directory) } { }
+
+    /**
+     * @brief Write `notes` to a new segment and map it. Not thread safe: `NoteStore` only calls it from
+     * `spill_cold`.
+     * @return The record of each note, in order, or `ErrorCode::Internal` if the segment cannot be written or mapped
+     */
+    auto spill(std::span<const NoteView> notes) -> Result<std::vector<const std::uint8_t*>>;
+
+    /**
+     * @brief Decode a record `spill` returned.
+     */
+    [[nodiscard]] static auto read(const std::uint8_t* record) noexcept -> Record;
+
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path& { return directory_; }
+    /**
+     * @brief Bytes mapped, live records and dead ones alike.
+     */
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t { return bytes_.load(std::memory_order_relaxed); }
+
+  private:
+    std::filesystem::path directory_;
+    std::vector<MappedFile> segments_;
+    std::atomic<std::size_t> bytes_ { 0 };
+};
+
+}  // namespace pg::store
@@ -0,0 +1,39 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace pg::store {
+
+/**
+ * @brief Dense, store-local number assigned to every note when it is inserted.
+ *
+ * Indexes refer to notes by ordinal rather than by id so that candidate sets can be kept as bitmaps.
+ */
+using NoteOrdinal = std::uint32_t;
+
+/**
+ * @brief Marker for "no note".
+ */
+constexpr inline NoteOrdinal INVALID_ORDINAL = std::numeric_limits<NoteOrdinal>::max();
+
+/**
+ * @brief Creation/update time of a note. Nanosecond resolution to match `pg.gen.Timestamp`.
+ */
+using Timestamp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
+
+/**
+ * @brief `std::chrono::system_clock::now()` as a `Timestamp`: the clock of every store not given one.
+ */
+inline auto system_now() -> Timestamp {
+    return std::chrono::time_point_cast<Timestamp::duration>(std::chrono::system_clock::now());
+}
+
+}  // namespace pg::store
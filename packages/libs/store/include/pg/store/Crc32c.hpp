@@ -0,0 +1,33 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace pg::store {
+
+/**
+ * @brief CRC-32C (Castagnoli) of `bytes`, continuing from `crc` (the result of a previous call, or zero).
+ *
+ * Uses the SSE4.2 `crc32` instruction when the CPU has it and a slicing-by-8 table otherwise; both give identical
+ * results.
+ */
+[[nodiscard]] auto crc32c(std::span<const std::uint8_t> bytes, std::uint32_t crc = 0) noexcept -> std::uint32_t;
+
+/**
+ * @brief `crc32c` computed with the table whatever the CPU has, to check the instruction against.
+ */
+[[nodiscard]] auto crc32c_software(std::span<const std::uint8_t> bytes, std::uint32_t crc = 0) noexcept
+  -> std::uint32_t;
+
+/**
+ * @brief Whether `crc32c` uses the SSE4.2 `crc32` instruction on this CPU.
+ */
+[[nodiscard]] auto crc32c_hardware() noexcept -> bool;
+
+}  // namespace pg::store
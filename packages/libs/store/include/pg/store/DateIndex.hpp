@@ -0,0 +1,158 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/Common.hpp>
+
+#include <parallel_hashmap/btree.h>
+
+namespace pg::store {
+
+/**
+ * @brief Ordered index of one timestamp column (`created` or `updated`), keyed by `(timestamp, ordinal)`.
+ *
+ * Backs `NoteCreatedSearch` and `NoteUpdatedSearch`: every `DateSearchKind` is one or two range scans. Ranges can be
+ * consumed as a sorted stream (ascending timestamp, ties broken by ordinal) or collapsed into a `Bitmap`.
+ */
+class DateIndex {
+  public:
+    using Key = std::pair<Timestamp, NoteOrdinal>;
+    using Tree = phmap::btree_set<Key>;
+    using Iterator = Tree::const_iterator;
+
+    /**
+     * @brief A half-open `[begin, end)` slice of the index.
+     */
+    class Range {
+      public:
+        Range(Iterator begin, Iterator end): begin_ { begin }, end_ { end } { }
+
+        [[nodiscard]] auto begin() const noexcept -> Iterator { return begin_; }
+        [[nodiscard]] auto end() const noexcept -> Iterator { return end_; }
+        [[nodiscard]] auto empty() const noexcept -> bool { return begin_ == end_; }
+
+        /**
+         * @brief Call `fn(ordinal)` for every note in the range, oldest first. Returning **false** stops the scan.
+         */
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            for (auto it = begin_; it != end_; ++it) {
+                if (!fn(it->second)) {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Number of notes in the range. Linear in the size of the range.
+         */
+        [[nodiscard]] auto count() const -> std::size_t;
+
+        /**
+         * @brief Set the bit of every note in the range on `out`.
+         */
+        void collect(Bitmap& out) const;
+
+        [[nodiscard]] auto to_bitmap() const -> Bitmap {
+            auto out = Bitmap {};
+            collect(out);
+            return out;
+        }
+
+      private:
+        Iterator begin_;
+        Iterator end_;
+    };
+
+    /**
+     * @brief The index of `keys`, which must hold each ordinal at most once. The keys are sorted first, so the tree is
+     * filled by a sequence of appends.
+     */
+    [[nodiscard]] static auto build(std::vector<Key> keys) -> DateIndex;
+
+    void insert(NoteOrdinal ordinal, Timestamp timestamp);
+    void erase(NoteOrdinal ordinal);
+
+    /**
+     * @brief Move `ordinal` to `timestamp`.
+     *
+     * The old key is rebuilt from the ordinal's remembered timestamp and erased, which searches the tree once,
+     * O(log n). Updates nearly always move a note to "now", i.e. past every existing key, so the new key is then
+     * appended with an end hint rather than searched for.
+     */
+    void update(NoteOrdinal ordinal, Timestamp timestamp);
+
+    /**
+     * @brief Apply many updates at once. Entries are sorted first so the re-inserts are a sequence of appends.
+     */
+    void update(std::span<const std::pair<NoteOrdinal, Timestamp>> updates);
+
+    [[nodiscard]] auto timestamp_of(NoteOrdinal ordinal) const -> std::optional<Timestamp>;
+
+    /**
+     * @brief Notes with `timestamp < date` (`BeforeDateQuery`).
+     */
+    [[nodiscard]] auto before(Timestamp date) const -> Range;
+    /**
+     * @brief Notes with `timestamp > date` (`AfterDateQuery`).
+     */
+    [[nodiscard]] auto after(Timestamp date) const -> Range;
+    /**
+     * @brief Notes with `start <= timestamp <= end` (`InDateRangeQuery`).
+     */
+    [[nodiscard]] auto between(Timestamp start, Timestamp end) const -> Range;
+    /**
+     * @brief Notes with `timestamp < start || timestamp > end` (`NotInDateRangeQuery`), as the two ranges either
+     * side of `between(start, end)`.
+     */
+    [[nodiscard]] auto not_between(Timestamp start, Timestamp end) const -> std::pair<Range, Range>;
+
+    /**
+     * @brief Every note, oldest first.
+     */
+    [[nodiscard]] auto all() const -> Range { return Range { tree_.begin(), tree_.end() }; }
+
+    /**
+     * @brief Every note at or after `key`. Used to resume an ordered scan.
+     */
+    [[nodiscard]] auto from(const Key& key) const -> Range { return Range { tree_.lower_bound(key), tree_.end() }; }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return tree_.size(); }
+    [[nodiscard]] auto empty() const noexcept -> bool { return tree_.empty(); }
+
+    /**
+     * @brief The oldest and newest timestamps in the index, if any.
+     */
+    [[nodiscard]] auto bounds() const -> std::optional<std::pair<Timestamp, Timestamp>>;
+
+    /**
+     * @brief Estimated number of notes with `start <= timestamp <= end`, interpolated linearly between `bounds()`.
+     *
+     * Constant time, so the query planner can rank date predicates without walking the tree. Assumes timestamps are
+     * spread evenly between the oldest and newest note.
+     */
+    [[nodiscard]] auto estimate(Timestamp start, Timestamp end) const -> std::size_t;
+
+  private:
+    [[nodiscard]] auto indexed(NoteOrdinal ordinal) const noexcept -> bool { return present_.test(ordinal); }
+
+    Tree tree_;
+    /// Current timestamp per ordinal, so updates never have to search for the old key. Meaningless unless `present_`
+    /// has the ordinal: every timestamp is a valid key, `Timestamp::min()` included.
+    std::vector<Timestamp> timestamps_;
+    /// The ordinals indexed.
+    Bitmap present_;
+};
+
+}  // namespace pg::store
@@ -0,0 +1,204 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <pg/store/ChangeFeed.hpp>
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/Wal.hpp>
+
+namespace pg::store {
+
+struct DurableOptions {
+    /**
+     * @brief Options for the in-memory store. `clock` stamps new mutations; replayed ones keep their logged time.
+     */
+    StoreOptions store;
+    WalOptions wal;
+    /**
+     * @brief Write an incremental checkpoint this often in the background. Zero only checkpoints on `checkpoint()`.
+     */
+    std::chrono::seconds checkpoint_interval { 0 };
+    /**
+     * @brief Verify the checkpoint on open. See `Checkpoint::open`.
+     */
+    bool verify_checkpoint = true;
+    /**
+     * @brief Committed mutations the change feed keeps in memory, for subscribers to read without touching the log.
+     * Zero disables the feed.
+     */
+    std::size_t change_feed_capacity = 4096;
+};
+
+/**
+ * @brief A `NoteStore` whose mutations are logged to a `WriteAheadLog` before they are acknowledged, and periodically
+ * checkpointed.
+ *
+ * Mutations arrive as the serialized flatbuffer requests and are logged as such, so the log is exactly what clients
+ * sent, plus the id assigned to new notes. Each one is applied to the store and appended to the log under one lock,
+ * which keeps the log in commit order, and then waits for its batch to be synced outside that lock, so concurrent
+ * committers share a sync. Reads go straight to `store()`; they can see a mutation slightly before it is durable,
+ * the same as with any group-committed log.
+ *
+ * The log is a sequence of numbered files. Each checkpoint switches to a new file at the same instant as it takes its
+ * snapshot, and once the checkpoint is durable the files before that one are deleted, so what a restart replays is
+ * bounded by what was logged since the last checkpoint. Checkpoints are incremental (see `CheckpointWriter`): they
+ * rewrite only the chunks written to since the previous one, while writers carry on.
+ *
+ * On open, the latest checkpoint is mapped and served in place, and only the mutations logged after it are replayed.
+ *
+ * Every mutation committed after open is also published to a `ChangeFeed`, in commit order, for downstream indexers
+ * and replicas to `subscribe` to. A subscriber that falls behind the feed's ring is served from the log files instead,
+ * for as long as they still hold what it asks for: the files a checkpoint covers are deleted.
+ */
+class DurableStore {
+  public:
+    /**
+     * @brief Log files are named after their sequence number, zero-padded, plus this extension.
+     */
+    constexpr static std::string_view WAL_EXTENSION = ".wal";
+    constexpr static std::string_view CHECKPOINT_DIRECTORY = "checkpoint";
+
+    /**
+     * @brief Load the store kept in `directory`, creating the directory if needed, then open its log for appending.
+     * @return `ErrorCode::DataLoss` if the checkpoint is corrupt, or a logged mutation no longer applies or lands on
+     * a different version than it did originally
+     */
+    static auto open(const std::filesystem::path& directory, DurableOptions options = {})
+      -> Result<std::unique_ptr<DurableStore>>;
+
+    DurableStore(const DurableStore&) = delete;
+    auto operator=(const DurableStore&) -> DurableStore& = delete;
+    ~DurableStore() = default;
+
+    /**
+     * @brief Apply and log a serialized `CreateNoteRequest`.
+     * @return The new note's id once the mutation is durable, or why it was rejected. If the log fails, the mutation
+     * stays applied in memory but the error is returned: it may not survive a restart.
+     */
+    auto create(std::span<const std::uint8_t> request) -> Result<NoteId>;
+
+    /**
+     * @brief Apply and log a serialized `UpdateNoteRequest`.
+     */
+    auto update(std::span<const std::uint8_t> request) -> Result<void>;
+
+    /**
+     * @brief Apply a serialized `UpdateNotesRequest` as one batch (see `NoteStore::edit_many`) and log it as one frame.
+     * @return One result per target, a target that fails to decode included, once the batch is durable; or why the
+     * whole request was rejected: it is not a valid request, or logging failed
+     */
+    auto update_many(std::span<const std::uint8_t> request) -> Result<NoteStore::BatchResult>;
+
+    /**
+     * @brief Apply and log a serialized `DeleteNoteRequest`.
+     */
+    auto remove(std::span<const std::uint8_t> request) -> Result<void>;
+
+    /**
+     * @brief Apply a serialized `DeleteNotesRequest` as one batch (see `NoteStore::remove_many`) and log it as one
+     * frame.
+     * @return One result per target, as for `update_many`; `BatchResult::applied` is the response's `deleted_count`
+     */
+    auto remove_many(std::span<const std::uint8_t> request) -> Result<NoteStore::BatchResult>;
+
+    /**
+     * @brief Checkpoint the latest commit and start a new log file, then delete the log files the checkpoint covers.
+     * Writers carry on meanwhile, apart from the switch between log files; concurrent calls are serialised.
+     */
+    auto checkpoint() -> Result<CheckpointStats>;
+
+    /**
+     * @brief Follow the mutations committed after version `after`, starting with any still in the log.
+     * @return `ErrorCode::FailedPrecondition` if `DurableOptions::change_feed_capacity` is zero
+     */
+    auto subscribe(CommitVersion after) -> Result<std::unique_ptr<ChangeSubscription>>;
+
+    [[nodiscard]] auto store() const noexcept -> const NoteStore& { return *store_; }
+    /**
+     * @brief The change feed, for its subscribers' lag, or **nullptr** if it is disabled.
+     */
+    [[nodiscard]] auto changes() const noexcept -> const ChangeFeed* { return changes_.get(); }
+    /**
+     * @brief The log file currently appended to.
+     */
+    [[nodiscard]] auto log() const -> std::shared_ptr<const WriteAheadLog>;
+    /**
+     * @brief The log files in the directory, oldest first.
+     */
+    [[nodiscard]] auto log_files() const -> std::vector<std::filesystem::path>;
+    /**
+     * @brief What `open` replayed, over every log file. Frames already covered by the checkpoint are counted but not
+     * applied.
+     */
+    [[nodiscard]] auto replayed() const noexcept -> const ReplayStats& { return replayed_; }
+    /**
+     * @brief Why the last background checkpoint failed, if it did.
+     */
+    [[nodiscard]] auto checkpoint_failure() const -> std::optional<StoreError>;
+
+  private:
+    DurableStore(std::filesystem::path directory, DurableOptions options);
+
+    auto replay(const WalFrame& frame) -> Result<void>;
+    /**
+     * @brief Log a mutation that has just been applied, then release `lock` (on `mutex_`) and wait for it to be
+     * durable.
+     */
+    auto commit(std::unique_lock<std::mutex>& lock, FrameKind kind, std::span<const std::uint8_t> payload)
+      -> Result<void>;
+    [[nodiscard]] auto log_path(std::uint64_t sequence) const -> std::filesystem::path;
+    /**
+     * @brief Backfill for change subscriptions: up to `max` logged mutations from version `from` on.
+     * @return `ErrorCode::FailedPrecondition` if the log files holding `from` have been deleted
+     */
+    [[nodiscard]] auto read_log(CommitVersion from, std::size_t max) const -> Result<std::vector<ChangeFeed::Event>>;
+    void run_checkpoints(std::stop_token stop);
+
+    std::filesystem::path directory_;
+    DurableOptions options_;
+    std::function<Timestamp()> clock_;
+    /// The time the store's clock reports: the current mutation's, live or replayed. Guarded by `mutex_`.
+    Timestamp stamp_ {};
+    mutable std::mutex mutex_;
+    std::unique_ptr<NoteStore> store_;
+    /// Swapped by `checkpoint`; committers hold on to the one they appended to until their frame is durable.
+    std::shared_ptr<WriteAheadLog> wal_;
+    /// Published to under `mutex_`, right after appending to the log, which keeps it in commit order.
+    std::unique_ptr<ChangeFeed> changes_;
+    ReplayStats replayed_;
+
+    /// Serialises checkpoints, and guards everything up to `checkpoint_state_mutex_`.
+    std::mutex checkpoint_mutex_;
+    std::unique_ptr<CheckpointWriter> checkpoints_;
+    /// The sequence number of the log file `wal_` writes to.
+    std::uint64_t log_sequence_ = 0;
+    /// Guards `checkpoint_failure_`; the background checkpointer sleeps on `checkpoint_cv_` with it.
+    mutable std::mutex checkpoint_state_mutex_;
+    std::optional<StoreError> checkpoint_failure_;
+    std::condition_variable_any checkpoint_cv_;
+    /// Destroyed first, which stops it before anything it uses goes away.
+    std::jthread checkpointer_;
+};
+
+}  // namespace pg::store
@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pg::store {
+
+/**
+ * @brief Write the low `bytes` bytes of `value` to `out`, least significant first: the byte order of every integer in
+ * the store's files.
+ */
+inline void store_le(std::uint8_t* out, std::uint64_t value, std::size_t bytes = 8) noexcept {
+    for (std::size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Read a `bytes` byte integer written by `store_le`.
+ */
+inline auto load_le(const std::uint8_t* in, std::size_t bytes = 8) noexcept -> std::uint64_t {
+    auto value = std::uint64_t { 0 };
+    for (std::size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+}  // namespace pg::store
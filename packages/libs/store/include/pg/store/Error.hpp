@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <pg/util/result.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Error codes reported by the store. The values follow the canonical RPC status codes so they can be copied
+ * straight into `pg.gen.ResponseError::code`.
+ */
+enum class ErrorCode : std::uint32_t {
+    InvalidArgument = 3,
+    NotFound = 5,
+    AlreadyExists = 6,
+    ResourceExhausted = 8,
+    FailedPrecondition = 9,
+    Internal = 13,
+    DataLoss = 15,
+};
+
+struct StoreError {
+    ErrorCode code = ErrorCode::Internal;
+    std::string message;
+};
+
+template <typename T>
+using Result = cpp::result<T, StoreError>;
+
+/**
+ * @brief Shorthand for `cpp::fail(StoreError { code, message })`.
+ */
+[[nodiscard]] inline auto fail(ErrorCode code, std::string message) {
+    return cpp::fail(StoreError { code, std::move(message) });
+}
+
+}  // namespace pg::store
@@ -0,0 +1,84 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/NoteStore.hpp>
+
+namespace pg::store {
+
+enum class ExportFormat {
+    /**
+     * @brief One object per line with string fields `id`, `title` and `content`, an array of strings `tags`, and
+     * integer fields `created` and `updated` in nanoseconds since the epoch. `import_json_lines` reads the titles,
+     * contents and tags back, as new notes: it ignores `id`, `created` and `updated`, so the store gives them new ones.
+     */
+    JsonLines,
+    /**
+     * @brief A stream of size-prefixed `pg.gen.NoteStorage` flatbuffers, one per chunk, each holding its notes as
+     * `NoteObject`s; `messages::decode_note_storage` reads them back one at a time.
+     */
+    NoteObjects,
+};
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::JsonLines;
+    /**
+     * @brief Note bytes (titles and contents) per chunk. Each chunk is read, encoded and written in one go, so an
+     * export holds about this much per output whatever the size of the store.
+     */
+    std::size_t chunk_bytes = 1024 * 1024;
+};
+
+struct ExportStats {
+    /**
+     * @brief The commit the export is consistent as of.
+     */
+    CommitVersion version = 0;
+    std::size_t notes = 0;
+    /**
+     * @brief Bytes written, across every output.
+     */
+    std::uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed {};
+
+    [[nodiscard]] auto bytes_per_second() const noexcept -> double {
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        return seconds > 0 ? static_cast<double>(bytes) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Write every note of `store`, as of one snapshot, to `out` in ordinal order.
+ *
+ * Nothing is materialized: the notes are read a chunk at a time, each through a snapshot of its own at the version of
+ * the first, which is let go of (and every compressed block it decompressed with it) once the chunk is written. Writers
+ * carry on meanwhile. `out` is written to at its current position and not synced; it can be a pipe or standard output
+ * through `File::adopt`.
+ *
+ * @return The totals, or whatever writing to `out` failed with; what was written before stays written
+ */
+auto export_notes(const NoteStore& store, File& out, const ExportOptions& options = {}) -> Result<ExportStats>;
+
+/**
+ * @brief `export_notes` into several outputs at once, one thread each: the ordinals visible at the snapshot are split
+ * into as many contiguous ranges as there are outputs, in order, so that concatenating the outputs gives what a single
+ * output would hold. Every output is as of the same commit.
+ *
+ * @return The totals, or the first error an output failed with, after the others have stopped
+ */
+auto export_notes(const NoteStore& store, std::span<File> outputs, const ExportOptions& options = {})
+  -> Result<ExportStats>;
+
+}  // namespace pg::store
@@ -0,0 +1,139 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+#include <pg/store/Error.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief A thin, move-only wrapper over an OS file descriptor with the handful of operations the store's on-disk
+ * structures need. Every failure is reported as `ErrorCode::Internal`, naming the file and the OS error.
+ */
+class File {
+  public:
+    enum class Mode {
+        /// Read only; the file must exist.
+        Read,
+        /// Writes go to the end; the file is created if missing.
+        Append,
+        /// Read and write; the file is created if missing and emptied if not.
+        Truncate,
+    };
+
+    static auto open(const std::filesystem::path& path, Mode mode) -> Result<File>;
+
+    /**
+     * @brief Take ownership of `fd`, already open (a pipe or standard output, say). `name` only labels errors.
+     */
+    static auto adopt(int fd, std::filesystem::path name) -> File { return File { fd, std::move(name) }; }
+
+    File() = default;
+    File(File&& other) noexcept: fd_ { std::exchange(other.fd_, -1) }, path_ { std::move(other.path_) } { }
+    auto operator=(File&& other) noexcept -> File& {
+        if (this != &other) {
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            path_ = std::move(other.path_);
+        }
+        return *this;
+    }
+    File(const File&) = delete;
+    auto operator=(const File&) -> File& = delete;
+    ~File() { close(); }
+
+    [[nodiscard]] auto is_open() const noexcept -> bool { return fd_ >= 0; }
+    [[nodiscard]] auto path() const noexcept -> const std::filesystem::path& { return path_; }
+    [[nodiscard]] auto descriptor() const noexcept -> int { return fd_; }
+
+    [[nodiscard]] auto size() const -> Result<std::uint64_t>;
+
+    /**
+     * @brief Read up to `out.size()` bytes starting at `offset`.
+     * @return The number of bytes read, short only at the end of the file
+     */
+    auto read_at(std::uint64_t offset, std::span<std::uint8_t> out) const -> Result<std::size_t>;
+
+    /**
+     * @brief Write all of `bytes`, retrying short writes.
+     */
+    auto write(std::span<const std::uint8_t> bytes) -> Result<void>;
+
+    /**
+     * @brief Write all of `bytes` at `offset`, without moving the position `write` appends at. Not for `Mode::Append`.
+     */
+    auto write_at(std::uint64_t offset, std::span<const std::uint8_t> bytes) -> Result<void>;
+
+    /**
+     * @brief Flush written data (not necessarily metadata such as timestamps) to stable storage.
+     */
+    auto sync() -> Result<void>;
+
+    auto truncate(std::uint64_t size) -> Result<void>;
+
+    void close() noexcept;
+
+  private:
+    File(int fd, std::filesystem::path path): fd_ { fd }, path_ { std::move(path) } { }
+
+    int fd_ = -1;
+    std::filesystem::path path_;
+};
+
+/**
+ * @brief A read-only mapping of a whole file. Nothing is read up front: the OS pages the file in as it is touched, and
+ * can drop clean pages again under memory pressure. The mapping stays valid after the file is renamed over or removed.
+ */
+class MappedFile {
+  public:
+    static auto open(const std::filesystem::path& path) -> Result<MappedFile>;
+
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept
+        : data_ { std::exchange(other.data_, nullptr) },
+          size_ { std::exchange(other.size_, 0) },
+          path_ { std::move(other.path_) } { }
+    auto operator=(MappedFile&& other) noexcept -> MappedFile& {
+        if (this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            path_ = std::move(other.path_);
+        }
+        return *this;
+    }
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+    ~MappedFile() { unmap(); }
+
+    [[nodiscard]] auto bytes() const noexcept -> std::span<const std::uint8_t> { return { data_, size_ }; }
+    [[nodiscard]] auto path() const noexcept -> const std::filesystem::path& { return path_; }
+
+  private:
+    MappedFile(const std::uint8_t* data, std::size_t size, std::filesystem::path path)
+        : data_ { data }, size_ { size }, path_ { std::move(path) } { }
+
+    void unmap() noexcept;
+
+    const std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::filesystem::path path_;
+};
+
+/**
+ * @brief Flush the directory entry of `path` to stable storage, so that a file just created in (or renamed into) its
+ * directory survives a crash. A no-op where the platform has no such notion.
+ */
+auto sync_directory(const std::filesystem::path& path) -> Result<void>;
+
+}  // namespace pg::store
@@ -0,0 +1,87 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <pg/store/NoteRecord.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Generates time-ordered UUIDv7 note ids (RFC 9562): a 48-bit Unix timestamp in milliseconds, a 12-bit
+ * sequence number, then 62 random bits.
+ *
+ * Ids from one generator compare in the order they were generated, as bytes and as strings alike, so ordered indexes
+ * keyed on them only ever append. Within a millisecond the sequence number counts up from a random start; should it
+ * run out, or the clock go back, the generator borrows the next millisecond rather than break the order.
+ *
+ * Cheap to construct and to call, but not thread safe: use one per thread, or `generate_note_id`.
+ */
+class IdGenerator {
+  public:
+    using Clock = std::chrono::system_clock;
+
+    /**
+     * @brief A generator seeded from `std::random_device`.
+     */
+    IdGenerator();
+    explicit IdGenerator(std::uint64_t seed) noexcept;
+
+    auto operator()() -> NoteId { return (*this)(Clock::now()); }
+    /**
+     * @brief An id stamped with `now`, or just after the previous id if that is later.
+     */
+    auto operator()(Clock::time_point now) noexcept -> NoteId;
+
+    /**
+     * @brief The millisecond timestamp a UUIDv7 carries.
+     */
+    [[nodiscard]] static auto time_of(const NoteId& id) noexcept -> Clock::time_point;
+
+  private:
+    auto next_random() noexcept -> std::uint64_t;
+
+    /// xoroshiro128++ state.
+    std::array<std::uint64_t, 2> state_ {};
+    std::uint64_t millis_ = 0;
+    std::uint64_t sequence_ = 0;
+};
+
+/**
+ * @brief A new id from the calling thread's own `IdGenerator`.
+ */
+[[nodiscard]] auto generate_note_id() -> NoteId;
+
+/**
+ * @brief Hash for `NoteId` keys, reading the id as two words and mixing them rather than hashing it byte by byte.
+ *
+ * Both halves go into the hash: a UUIDv7's first half is mostly timestamp, which ids created in the same millisecond
+ * share.
+ */
+struct NoteIdHash {
+    auto operator()(const NoteId& id) const noexcept -> std::size_t {
+        auto high = std::uint64_t { 0 };
+        auto low = std::uint64_t { 0 };
+        std::memcpy(&high, id.begin(), sizeof(high));
+        std::memcpy(&low, id.begin() + sizeof(high), sizeof(low));
+        // MurmurHash3's 64-bit finaliser over the two words folded together.
+        auto hash = high ^ (low * 0x9E3779B97F4A7C15ULL);
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 33;
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+}  // namespace pg::store
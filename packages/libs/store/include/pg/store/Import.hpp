@@ -0,0 +1,115 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+#include <pg/store/Error.hpp>
+#include <pg/store/NoteStore.hpp>
+
+namespace pg::store {
+
+struct ImportOptions {
+    /**
+     * @brief Threads parsing the input. Zero means `std::thread::hardware_concurrency()`.
+     */
+    std::size_t threads = 0;
+    /**
+     * @brief Input bytes per chunk, rounded up to the end of a line. Each chunk is parsed by one thread and inserted as
+     * one `NoteStore::create_many` batch.
+     */
+    std::size_t chunk_bytes = 4 * 1024 * 1024;
+    /**
+     * @brief Where to checkpoint the store and record how far the import got, so that it can resume after a crash.
+     * Empty (the default) imports without checkpoints, and always from the start of the input.
+     */
+    std::filesystem::path checkpoint_directory;
+    /**
+     * @brief Input bytes to insert between checkpoints. There is always one more when the import ends or stops.
+     */
+    std::uint64_t checkpoint_bytes = 256 * 1024 * 1024;
+    /**
+     * @brief Skip (and count) lines that are not a valid note rather than stop at the first one.
+     */
+    bool skip_invalid = false;
+    /**
+     * @brief Insert in the store's bulk load mode, building every index once at the end instead of note by note; see
+     * `NoteStore::begin_bulk_load`. Has no effect if the store is already bulk loading, which is then left to whoever
+     * began the load to end.
+     */
+    bool defer_indexes = true;
+};
+
+struct ImportStats {
+    /**
+     * @brief The input offset the import started at: zero, or where a previous run was last checkpointed.
+     */
+    std::uint64_t resumed_from = 0;
+    /**
+     * @brief The input offset up to which every line has been inserted.
+     */
+    std::uint64_t offset = 0;
+    std::size_t notes = 0;
+    /**
+     * @brief Invalid lines skipped, with `ImportOptions::skip_invalid`.
+     */
+    std::size_t skipped = 0;
+    std::size_t checkpoints = 0;
+    std::chrono::nanoseconds elapsed {};
+    /**
+     * @brief The part of `elapsed` spent building the indexes at the end, with `ImportOptions::defer_indexes`.
+     */
+    std::chrono::nanoseconds indexing {};
+
+    [[nodiscard]] auto notes_per_second() const noexcept -> double {
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        return seconds > 0 ? static_cast<double>(notes) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Called after each batch is inserted, with the totals so far.
+ */
+using ImportProgress = std::function<void(const ImportStats&)>;
+
+/**
+ * @brief Name of the file in `ImportOptions::checkpoint_directory` recording how far imports got.
+ */
+constexpr inline std::string_view IMPORT_PROGRESS_FILE = "import.progress";
+
+/**
+ * @brief Insert every note in the JSON lines file at `input` into `store`: one object per line, shaped like
+ * `data::CreateNote`, with string fields `title` and `content` and an array of strings `tags`. Any of them may be
+ * missing or null; other fields are ignored, and so are blank lines.
+ *
+ * The file is mapped and split into chunks on line boundaries, which the parsing threads claim in order and parse
+ * straight off the mapping with RapidJSON's SAX reader, building no document. Parsed chunks are inserted in input
+ * order, one `NoteStore::create_many` batch each, while the threads parse ahead, up to two chunks each. The indexes are
+ * built once the last batch is in, or the import stops, unless `ImportOptions::defer_indexes` is off.
+ *
+ * With a checkpoint directory, every `ImportOptions::checkpoint_bytes` the store is checkpointed into it, after
+ * recording the store version and input offset the checkpoint will hold in `IMPORT_PROGRESS_FILE`. To resume after a
+ * crash, load the store from that checkpoint and import the same input with the same options: the import carries on
+ * from the offset recorded for the store's version. Nothing else should write to the store while it imports.
+ *
+ * @return The totals, or why the import stopped: `ErrorCode::InvalidArgument` for an invalid line (naming its offset)
+ * unless they are skipped, `ErrorCode::FailedPrecondition` if `store` is not at a version the progress file records, or
+ * whatever reading the input or checkpointing failed with. The lines before the error stay inserted, and are
+ * checkpointed if there is a checkpoint directory, so that a run after an invalid line is fixed resumes at that line.
+ */
+auto import_json_lines(
+  NoteStore& store,
+  const std::filesystem::path& input,
+  const ImportOptions& options = {},
+  const ImportProgress& progress = {}) -> Result<ImportStats>;
+
+}  // namespace pg::store
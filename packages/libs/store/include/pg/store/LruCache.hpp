@@ -0,0 +1,138 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief A bounded, thread safe map that evicts its least recently used entries first: the bookkeeping shared by the
+ * caches of values that are expensive to build, such as `PatternCache` and `BlockCache`.
+ *
+ * Every entry has a weight, and the weights of the entries cached add up to at most `capacity`; a value heavier than
+ * that on its own is never cached. Each call takes the lock once, so that a caller can build a missing value between
+ * `find` and `insert` without holding it. Two threads missing on the same key then both build it, and `insert` hands
+ * the second one the first one's value. `Value` should be cheap to copy, such as a `std::shared_ptr`.
+ */
+template <typename Key, typename Value>
+class LruCache {
+  public:
+    explicit LruCache(std::size_t capacity): capacity_ { capacity } { }
+
+    /**
+     * @brief The value cached under `key`, which becomes the most recently used, or `std::nullopt`.
+     */
+    [[nodiscard]] auto find(const Key& key) -> std::optional<Value> {
+        auto lock = std::scoped_lock { mutex_ };
+        const auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->value;
+    }
+
+    /**
+     * @brief Cache `value` under `key`, evicting the least recently used entries until `weight` fits.
+     * @return The value cached under `key` by another thread in the meantime, if one was, or `value`
+     */
+    auto insert(Key key, Value value, std::size_t weight = 1) -> Value {
+        auto lock = std::scoped_lock { mutex_ };
+        if (const auto it = index_.find(key); it != index_.end()) {
+            order_.splice(order_.begin(), order_, it->second);
+            return it->second->value;
+        }
+        if (weight > capacity_) {
+            return value;
+        }
+        evict(weight);
+        order_.push_front(Node { key, value, weight });
+        index_.emplace(std::move(key), order_.begin());
+        weight_ += weight;
+        return value;
+    }
+
+    /**
+     * @brief Cache `value` under `key`, replacing whatever was, evicting the least recently used entries until `weight`
+     * fits.
+     */
+    void assign(Key key, Value value, std::size_t weight = 1) {
+        auto lock = std::scoped_lock { mutex_ };
+        if (const auto it = index_.find(key); it != index_.end()) {
+            weight_ -= it->second->weight;
+            order_.erase(it->second);
+            index_.erase(it);
+        }
+        if (weight > capacity_) {
+            return;
+        }
+        evict(weight);
+        order_.push_front(Node { key, std::move(value), weight });
+        index_.emplace(std::move(key), order_.begin());
+        weight_ += weight;
+    }
+
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return capacity_; }
+    [[nodiscard]] auto size() const -> std::size_t {
+        auto lock = std::scoped_lock { mutex_ };
+        return index_.size();
+    }
+    /**
+     * @brief Total weight of the entries cached.
+     */
+    [[nodiscard]] auto weight() const -> std::size_t {
+        auto lock = std::scoped_lock { mutex_ };
+        return weight_;
+    }
+    [[nodiscard]] auto hits() const -> std::size_t {
+        auto lock = std::scoped_lock { mutex_ };
+        return hits_;
+    }
+    [[nodiscard]] auto misses() const -> std::size_t {
+        auto lock = std::scoped_lock { mutex_ };
+        return misses_;
+    }
+
+  private:
+    struct Node {
+        Key key;
+        Value value;
+        std::size_t weight;
+    };
+
+    /**
+     * @brief Drop the least recently used entries until `weight` more fits. The caller holds the lock.
+     */
+    void evict(std::size_t weight) {
+        while (weight_ + weight > capacity_) {
+            const auto& oldest = order_.back();
+            weight_ -= oldest.weight;
+            index_.erase(oldest.key);
+            order_.pop_back();
+        }
+    }
+
+    std::size_t capacity_;
+    mutable std::mutex mutex_;
+    /// Most recently used first.
+    std::list<Node> order_;
+    phmap::flat_hash_map<Key, typename std::list<Node>::iterator> index_;
+    std::size_t weight_ = 0;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+}  // namespace pg::store
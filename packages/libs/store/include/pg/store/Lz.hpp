@@ -0,0 +1,44 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief A small LZ77 codec in the LZ4 block format, used to compress cold note content in memory.
+ *
+ * Each sequence is a token (literal run length in the high nibble, match length minus four in the low one, either
+ * extended by bytes of 255 when it reaches 15), the literals, and a 16-bit little-endian offset back into the output;
+ * the last sequence has literals only. Matches are found greedily, through hash chains of 4-byte prefixes searched
+ * as deep as the caller asks.
+ */
+namespace pg::store::lz {
+
+/**
+ * @brief Upper bound on the size of `compress(text)` for any `text` of `size` bytes.
+ */
+[[nodiscard]] constexpr auto bound(std::size_t size) noexcept -> std::size_t {
+    return size + size / 255 + 16;
+}
+
+/**
+ * @brief Compress `text` into one block.
+ * @param effort How many earlier positions sharing a match's first four bytes are tried, newest first, for the longest
+ * match. One is as fast as LZ4; more compresses better, at the cost of compression (but not decompression) speed.
+ */
+[[nodiscard]] auto compress(std::string_view text, unsigned effort = 1) -> std::string;
+
+/**
+ * @brief The `size` bytes `packed` was compressed from.
+ * @return `std::nullopt` if `packed` is not a valid block of exactly `size` bytes
+ */
+[[nodiscard]] auto decompress(std::string_view packed, std::size_t size) -> std::optional<std::string>;
+
+}  // namespace pg::store::lz
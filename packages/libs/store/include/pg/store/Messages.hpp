@@ -0,0 +1,146 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <pg/data/NoteDto.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/Query.hpp>
+#include <pg/store/QueryPlan.hpp>
+#include <pg/store/TextEdit.hpp>
+
+namespace pg::gen {
+struct ListNotesRequest;
+struct SearchNoteRequest;
+struct Timestamp;
+}  // namespace pg::gen
+
+/**
+ * @brief Conversions between the `pg.gen` flatbuffer messages and the store's own types.
+ *
+ * Kept separate from the rest of the store so that, besides `Checkpoint`, only this translation unit depends on the
+ * generated code.
+ */
+namespace pg::store::messages {
+
+[[nodiscard]] auto to_timestamp(const gen::Timestamp& timestamp) -> Timestamp;
+
+/**
+ * @brief Decode the predicates, page size and page token of a `SearchNoteRequest`.
+ * @return The query, or `ErrorCode::InvalidArgument` if a search is missing its kind or text, or the page token is
+ * invalid for these predicates
+ */
+[[nodiscard]] auto to_query(const gen::SearchNoteRequest& request) -> Result<SearchQuery>;
+
+/**
+ * @brief Decode the page size and page token of a `ListNotesRequest`.
+ */
+[[nodiscard]] auto to_query(const gen::ListNotesRequest& request) -> Result<ListQuery>;
+
+/**
+ * @brief The `next_page_token` to return for `result`; empty on the last page.
+ */
+[[nodiscard]] auto next_page_token(const SearchQuery& query, const SearchResult& result) -> std::string;
+[[nodiscard]] auto next_page_token(const ListResult& result) -> std::string;
+
+/**
+ * @brief A decoded `pg.gen.CreateNoteRequest`.
+ */
+struct CreateRequest {
+    data::CreateNote note;
+    /**
+     * @brief The id the client asked for, if any.
+     */
+    std::optional<NoteId> id;
+};
+
+/**
+ * @brief Verify and decode a serialized `CreateNoteRequest`.
+ * @return `ErrorCode::InvalidArgument` if the buffer is not a valid request or `id` is not a UUID
+ */
+[[nodiscard]] auto decode_create_request(std::span<const std::uint8_t> buffer) -> Result<CreateRequest>;
+
+/**
+ * @brief Verify and decode a serialized `UpdateNoteRequest`.
+ * @return `ErrorCode::InvalidArgument` if the buffer is not a valid request, the target id is missing or not a UUID,
+ * or a modification is missing its kind
+ */
+[[nodiscard]] auto decode_update_request(std::span<const std::uint8_t> buffer) -> Result<NoteEdit>;
+
+/**
+ * @brief Verify and decode a serialized `UpdateNotesRequest`.
+ * @return One edit per target, in order, each failing as `decode_update_request` would on its own, or
+ * `ErrorCode::InvalidArgument` if the buffer is not a valid request
+ */
+[[nodiscard]] auto decode_update_notes_request(std::span<const std::uint8_t> buffer)
+  -> Result<std::vector<Result<NoteEdit>>>;
+
+/**
+ * @brief Verify and decode a serialized `DeleteNoteRequest`.
+ */
+[[nodiscard]] auto decode_delete_request(std::span<const std::uint8_t> buffer) -> Result<NoteId>;
+
+/**
+ * @brief Verify and decode a serialized `DeleteNotesRequest`.
+ * @return One id per target, in order, each failing as `decode_delete_request` would on its own, or
+ * `ErrorCode::InvalidArgument` if the buffer is not a valid request
+ */
+[[nodiscard]] auto decode_delete_notes_request(std::span<const std::uint8_t> buffer)
+  -> Result<std::vector<Result<NoteId>>>;
+
+/**
+ * @brief Verify and decode a serialized `GetNoteRequest`.
+ * @return The id of the note asked for, or `ErrorCode::InvalidArgument`
+ */
+[[nodiscard]] auto decode_get_request(std::span<const std::uint8_t> buffer) -> Result<NoteId>;
+
+/**
+ * @brief Verify and decode a serialized `GetNoteResponse`.
+ * @return The note it holds, the error it holds, or `ErrorCode::InvalidArgument` if the buffer is not a valid response
+ */
+[[nodiscard]] auto decode_get_response(std::span<const std::uint8_t> buffer) -> Result<NoteRecord>;
+
+/**
+ * @brief Serialize `request` as a `CreateNoteRequest`; `decode_create_request` gives it back unchanged.
+ */
+[[nodiscard]] auto encode_create_request(const CreateRequest& request) -> std::vector<std::uint8_t>;
+[[nodiscard]] auto encode_update_request(const NoteEdit& edit) -> std::vector<std::uint8_t>;
+[[nodiscard]] auto encode_update_notes_request(std::span<const NoteEdit> edits) -> std::vector<std::uint8_t>;
+[[nodiscard]] auto encode_delete_request(NoteId id) -> std::vector<std::uint8_t>;
+[[nodiscard]] auto encode_delete_notes_request(std::span<const NoteId> ids) -> std::vector<std::uint8_t>;
+[[nodiscard]] auto encode_get_request(NoteId id) -> std::vector<std::uint8_t>;
+
+/**
+ * @brief Serialize a `GetNoteResponse` holding `note`; `decode_get_response` gives it back unchanged.
+ */
+[[nodiscard]] auto encode_get_response(const NoteView& note) -> std::vector<std::uint8_t>;
+/**
+ * @brief Serialize a `GetNoteResponse` holding `error`.
+ */
+[[nodiscard]] auto encode_get_response(const StoreError& error) -> std::vector<std::uint8_t>;
+
+/**
+ * @brief Serialize `notes` as one size-prefixed `NoteStorage`: its first four bytes are the little-endian length of
+ * the rest, so that a stream of them can be read back one at a time.
+ */
+[[nodiscard]] auto encode_note_storage(std::span<const NoteView> notes) -> std::vector<std::uint8_t>;
+
+/**
+ * @brief Verify and decode one size-prefixed `NoteStorage`, as written by `encode_note_storage`.
+ * @return Its notes, in order, or `ErrorCode::InvalidArgument` if the buffer is not a valid one or a note id is not a
+ * UUID
+ */
+[[nodiscard]] auto decode_note_storage(std::span<const std::uint8_t> buffer) -> Result<std::vector<NoteRecord>>;
+
+}  // namespace pg::store::messages
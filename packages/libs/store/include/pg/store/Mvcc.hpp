@@ -0,0 +1,294 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <pg/store/BlobStore.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/NoteRecord.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief Commit version. Every write to the store is assigned the next one; version 0 is the empty store.
+ */
+using CommitVersion = std::uint64_t;
+
+/**
+ * @brief The content of cold notes, compressed together a block at a time. See `NoteStore::compress_cold`.
+ */
+struct PackedBlock {
+    /// Never reused, so a cache keyed by it cannot mistake a new block for a freed one.
+    std::uint64_t id = 0;
+    std::string data;
+    /// The number of bytes `data` decompresses to.
+    std::size_t size = 0;
+};
+
+/**
+ * @brief One committed state of a note. Immutable once published, except for `older`, which garbage collection cuts
+ * once no snapshot can reach past this version, and `touched`.
+ */
+struct NoteVersion {
+    NoteRecord note;
+    /**
+     * @brief The note's content, when it is held in the store's `BlobStore` rather than in `note.content` (which is
+     * then left empty). Shared with every version, of any note, holding the same bytes.
+     */
+    BlobRef body;
+    /**
+     * @brief The note's content once it has gone cold: `packed_length` bytes from `packed_offset` of the block,
+     * decompressed. `body` and `note.content` are then empty.
+     */
+    std::shared_ptr<const PackedBlock> packed;
+    std::uint32_t packed_offset = 0;
+    std::uint32_t packed_length = 0;
+    /**
+     * @brief The note's title, content and tags once it has been spilled to the store's `ColdTier`: a record in one of
+     * its segments. `note` then holds only the id and timestamps.
+     */
+    const std::uint8_t* spilled = nullptr;
+    /**
+     * @brief The `NoteStore::compress_cold` pass during which this version was last written or read.
+     */
+    mutable std::atomic<std::uint32_t> touched { 0 };
+    /**
+     * @brief The commit that produced this state. It is visible to snapshots at or after `begin`, until the next
+     * newer version.
+     */
+    CommitVersion begin = 0;
+    /**
+     * @brief This version records the deletion of the note.
+     */
+    bool deleted = false;
+    /**
+     * @brief Stands for "the note as loaded from the store's checkpoint", whose state is read from the checkpoint
+     * rather than from `note`. One such version is shared by every loaded note, ends their chains and is never freed.
+     */
+    bool base = false;
+    std::atomic<NoteVersion*> older { nullptr };
+};
+
+/**
+ * @brief Free `chain` and every version older than it, stopping at a base version.
+ * @return The number of versions freed
+ */
+auto free_chain(NoteVersion* chain) noexcept -> std::size_t;
+
+/**
+ * @brief The newest version of every note, indexed by ordinal.
+ *
+ * Slots live in fixed size segments that are never moved or freed while the table exists, so readers can index it
+ * without locking while the (single) writer appends. Slot heads are published with release semantics.
+ */
+class VersionTable {
+  public:
+    constexpr static std::size_t SEGMENT_BITS = 14;
+    constexpr static std::size_t SEGMENT_SIZE = std::size_t { 1 } << SEGMENT_BITS;
+    constexpr static std::size_t MAX_SEGMENTS = (std::size_t { INVALID_ORDINAL } + SEGMENT_SIZE) / SEGMENT_SIZE;
+
+    VersionTable();
+    ~VersionTable();
+    VersionTable(const VersionTable&) = delete;
+    auto operator=(const VersionTable&) -> VersionTable& = delete;
+
+    /**
+     * @brief Number of slots ever appended, i.e. one past the highest ordinal.
+     */
+    [[nodiscard]] auto size() const noexcept -> NoteOrdinal { return size_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] auto head(NoteOrdinal ordinal) const noexcept -> NoteVersion*;
+
+    /**
+     * @brief The state of `ordinal` as of `snapshot`, or **nullptr** if the note did not exist then.
+     */
+    [[nodiscard]] auto visible(NoteOrdinal ordinal, CommitVersion snapshot) const noexcept -> const NoteVersion*;
+
+    /**
+     * @brief Add a slot for the next ordinal with `head` as its only version. Writer only.
+     */
+    void append(NoteVersion* head);
+
+    /**
+     * @brief Replace the head of `ordinal`. Writer only; the previous head must be reachable from `head` or retired.
+     */
+    void publish(NoteOrdinal ordinal, NoteVersion* head) noexcept;
+
+  private:
+    struct Segment {
+        std::array<std::atomic<NoteVersion*>, SEGMENT_SIZE> slots {};
+    };
+
+    [[nodiscard]] auto slot(NoteOrdinal ordinal) const noexcept -> std::atomic<NoteVersion*>&;
+
+    std::unique_ptr<std::atomic<Segment*>[]> segments_;
+    std::atomic<NoteOrdinal> size_ { 0 };
+};
+
+/**
+ * @brief Epoch-based reclamation keyed by commit version.
+ *
+ * A reader pins the commit version it reads at in one of a fixed number of cache-line sized slots (a single CAS, no
+ * lock). Writers cut version chains below the oldest pinned version and hand the cut-off tails to `retire`, tagged
+ * with the commit version current at the time. A tail is freed once every pin is newer than its tag: any reader that
+ * could have seen the tail before it was cut has gone.
+ */
+class EpochManager {
+  public:
+    constexpr static std::size_t SLOTS = 128;
+    constexpr static CommitVersion IDLE = std::numeric_limits<CommitVersion>::max();
+
+    /**
+     * @brief A pinned commit version. Unpins on destruction.
+     */
+    class Pin {
+      public:
+        Pin() = default;
+        Pin(Pin&& other) noexcept
+            : slot_ { std::exchange(other.slot_, nullptr) }, version_ { other.version_ } { }
+        auto operator=(Pin&& other) noexcept -> Pin& {
+            if (this != &other) {
+                release();
+                slot_ = std::exchange(other.slot_, nullptr);
+                version_ = other.version_;
+            }
+            return *this;
+        }
+        Pin(const Pin&) = delete;
+        auto operator=(const Pin&) -> Pin& = delete;
+        ~Pin() { release(); }
+
+        [[nodiscard]] auto version() const noexcept -> CommitVersion { return version_; }
+        [[nodiscard]] auto pinned() const noexcept -> bool { return slot_ != nullptr; }
+
+      private:
+        friend class EpochManager;
+
+        Pin(std::atomic<CommitVersion>* slot, CommitVersion version): slot_ { slot }, version_ { version } { }
+        void release() noexcept {
+            if (slot_ != nullptr) {
+                slot_->store(IDLE, std::memory_order_release);
+                slot_ = nullptr;
+            }
+        }
+
+        std::atomic<CommitVersion>* slot_ = nullptr;
+        CommitVersion version_ = 0;
+    };
+
+    EpochManager() = default;
+    ~EpochManager();
+    EpochManager(const EpochManager&) = delete;
+    auto operator=(const EpochManager&) -> EpochManager& = delete;
+
+    /**
+     * @brief Pin the latest commit version. Lock-free; only spins if every slot is taken.
+     */
+    [[nodiscard]] auto pin(const std::atomic<CommitVersion>& committed) -> Pin;
+
+    /**
+     * @brief Pin `version` again. Only safe while another pin holds it, so that nothing it needs can have been cut.
+     */
+    [[nodiscard]] auto pin_at(CommitVersion version) -> Pin;
+
+    /**
+     * @brief The oldest pinned version, or `IDLE` if nothing is pinned.
+     */
+    [[nodiscard]] auto oldest_pin() const noexcept -> CommitVersion;
+
+    /**
+     * @brief Hand over a cut-off chain of versions, to be freed once no pin is at or before `tag`. Writer only.
+     */
+    void retire(NoteVersion* chain, CommitVersion tag);
+
+    /**
+     * @brief Hand over a single version that has been replaced by a copy, to be freed like a retired chain but
+     * without the versions older than it, which the copy still links to. Writer only.
+     */
+    void retire_one(NoteVersion* version, CommitVersion tag);
+
+    /**
+     * @brief Free every retired chain whose grace period has passed. Writer only.
+     * @return The number of versions freed
+     */
+    auto reclaim() -> std::size_t;
+
+    [[nodiscard]] auto retired() const noexcept -> std::size_t { return limbo_.size(); }
+
+  private:
+    struct alignas(64) Slot {
+        std::atomic<CommitVersion> pinned { IDLE };
+    };
+
+    struct Retired {
+        CommitVersion tag = 0;
+        NoteVersion* chain = nullptr;
+        /// Free `chain` alone rather than everything older than it too.
+        bool alone = false;
+    };
+
+    std::array<Slot, SLOTS> slots_ {};
+    std::vector<Retired> limbo_;
+};
+
+/**
+ * @brief A consistent, read-only view of the store as of one commit version.
+ *
+ * Holding a snapshot keeps every note version it can see alive; writers carry on regardless. Snapshots are cheap to
+ * take but should not be held indefinitely, as they hold back garbage collection, and keep every compressed block
+ * decompressed through them in memory.
+ */
+class Snapshot {
+  public:
+    Snapshot() = default;
+    Snapshot(Snapshot&& other) noexcept
+        : pin_ { std::move(other.pin_) }, held_ { other.held_.exchange(nullptr, std::memory_order_relaxed) } { }
+    auto operator=(Snapshot&& other) noexcept -> Snapshot&;
+    Snapshot(const Snapshot&) = delete;
+    auto operator=(const Snapshot&) -> Snapshot& = delete;
+    ~Snapshot();
+
+    [[nodiscard]] auto version() const noexcept -> CommitVersion { return pin_.version(); }
+
+  private:
+    friend class NoteStore;
+
+    /**
+     * @brief Decompressed content views read through this snapshot borrow from.
+     */
+    struct Held {
+        std::mutex mutex;
+        /// Each block once, however many of its notes were read and in whatever order.
+        phmap::flat_hash_set<std::shared_ptr<const std::string>> texts;
+    };
+
+    explicit Snapshot(EpochManager::Pin pin): pin_ { std::move(pin) } { }
+
+    /**
+     * @brief Keep `text` alive for as long as the snapshot is. Safe to call from several threads sharing the snapshot.
+     */
+    auto hold(std::shared_ptr<const std::string> text) const -> std::string_view;
+
+    EpochManager::Pin pin_;
+    /// Allocated by the first `hold`.
+    mutable std::atomic<Held*> held_ { nullptr };
+};
+
+}  // namespace pg::store
@@ -0,0 +1,122 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+
+#include <boost/uuid/uuid.hpp>
+
+namespace pg::store {
+
+using NoteId = boost::uuids::uuid;
+
+/**
+ * @brief Read-only view of a note's tags, wherever they are stored: in a `NoteRecord`, or in a mapped checkpoint.
+ */
+class TagList {
+  public:
+    /**
+     * @brief Reads the `index`th tag out of `source`.
+     */
+    using Accessor = std::string_view (*)(const void* source, std::size_t index) noexcept;
+
+    class Iterator {
+      public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const TagList* list, std::size_t index) noexcept: list_ { list }, index_ { index } { }
+
+        auto operator*() const noexcept -> std::string_view { return (*list_)[index_]; }
+        auto operator++() noexcept -> Iterator& {
+            ++index_;
+            return *this;
+        }
+        auto operator++(int) noexcept -> Iterator {
+            auto before = *this;
+            ++index_;
+            return before;
+        }
+        auto operator==(const Iterator& other) const noexcept -> bool { return index_ == other.index_; }
+
+      private:
+        const TagList* list_ = nullptr;
+        std::size_t index_ = 0;
+    };
+
+    TagList() = default;
+    TagList(std::span<const std::string> tags) noexcept;
+    TagList(const std::vector<std::string>& tags) noexcept: TagList { std::span { tags } } { }
+    TagList(const void* source, std::size_t size, Accessor accessor) noexcept
+        : source_ { source }, size_ { size }, accessor_ { accessor } { }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    [[nodiscard]] auto empty() const noexcept -> bool { return size_ == 0; }
+    [[nodiscard]] auto operator[](std::size_t index) const noexcept -> std::string_view {
+        return accessor_(source_, index);
+    }
+    [[nodiscard]] auto front() const noexcept -> std::string_view { return (*this)[0]; }
+    [[nodiscard]] auto begin() const noexcept -> Iterator { return Iterator { this, 0 }; }
+    [[nodiscard]] auto end() const noexcept -> Iterator { return Iterator { this, size_ }; }
+
+    [[nodiscard]] auto to_vector() const -> std::vector<std::string>;
+
+    friend auto operator==(const TagList& lhs, const TagList& rhs) noexcept -> bool;
+
+  private:
+    const void* source_ = nullptr;
+    std::size_t size_ = 0;
+    Accessor accessor_ = nullptr;
+};
+
+struct NoteRecord;
+
+/**
+ * @brief A note as readers see it. Borrows from wherever the store holds the note, so it is only valid for as long as
+ * that storage is: the snapshot it was read at.
+ */
+struct NoteView {
+    NoteId id;
+    std::string_view title;
+    std::string_view content;
+    TagList tags;
+    Timestamp created;
+    Timestamp updated;
+
+    /**
+     * @brief An owning copy.
+     */
+    [[nodiscard]] auto to_record() const -> NoteRecord;
+};
+
+/**
+ * @brief A note as held by the store. Mirrors `pg.gen.NoteObject`.
+ */
+struct NoteRecord {
+    NoteId id;
+    std::string title;
+    std::string content;
+    std::vector<std::string> tags;
+    Timestamp created;
+    Timestamp updated;
+
+    [[nodiscard]] auto view() const noexcept -> NoteView {
+        return NoteView { id, title, content, TagList { tags }, created, updated };
+    }
+};
+
+}  // namespace pg::store
@@ -0,0 +1,683 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <pg/data/NoteDto.hpp>
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/BlobStore.hpp>
+#include <pg/store/BlockCache.hpp>
+#include <pg/store/ColdTier.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/DateIndex.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/IdGenerator.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/Query.hpp>
+#include <pg/store/QueryPlan.hpp>
+#include <pg/store/RankingCache.hpp>
+#include <pg/store/TagIndex.hpp>
+#include <pg/store/TermIndex.hpp>
+#include <pg/store/TextEdit.hpp>
+#include <pg/store/TrigramIndex.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+class Checkpoint;
+
+struct StoreOptions {
+    /**
+     * @brief Keep a trigram index over note content. Without it, content predicates are answered by scanning.
+     */
+    bool index_content = true;
+    /**
+     * @brief Keep a `TermIndex` over titles and content, which `SearchOrder::Relevance` ranks matches with. Without
+     * it, such searches return their matches in ordinal order.
+     */
+    bool index_terms = true;
+    /**
+     * @brief How `SearchOrder::Relevance` scores a match.
+     */
+    Bm25 ranking {};
+    /**
+     * @brief Threads used by scans that no index can narrow down. Zero means `std::thread::hardware_concurrency()`.
+     */
+    std::size_t scan_threads = 0;
+    /**
+     * @brief Threads `edit_many` applies a batch's edits on. Zero means `std::thread::hardware_concurrency()`.
+     */
+    std::size_t write_threads = 0;
+    /**
+     * @brief Tombstones that wake the background compactor. Zero disables it, leaving compaction to `compact` calls.
+     */
+    std::size_t compaction_threshold = 4096;
+    /**
+     * @brief Index entries (posting lists or date keys) `compact` purges per exclusive hold of the index lock.
+     */
+    std::size_t compaction_slice = 256;
+    /**
+     * @brief How long `compact` waits between slices, leaving the index lock to searches and writers.
+     */
+    std::chrono::microseconds compaction_pause { 200 };
+    /**
+     * @brief `compress_cold` passes a note has to go through unread and unwritten before its content is compressed.
+     * Zero disables compression.
+     */
+    std::uint32_t cold_after = 2;
+    /**
+     * @brief How often the background maintenance thread runs `compress_cold` (and `spill_cold`). Zero leaves it to
+     * `compress_cold` calls.
+     */
+    std::chrono::milliseconds compression_interval { 60'000 };
+    /**
+     * @brief Content shorter than this is never compressed.
+     */
+    std::size_t compression_min_bytes = 64;
+    /**
+     * @brief Uncompressed bytes per compressed block. Larger blocks compress better, but every read of a note that is
+     * not cached decompresses its whole block.
+     */
+    std::size_t compression_block = 64 * 1024;
+    /**
+     * @brief Match candidates `lz::compress` tries per position. Higher packs cold notes tighter, at the cost of
+     * `compress_cold` time; reads are no slower.
+     */
+    unsigned compression_effort = 16;
+    /**
+     * @brief Decompressed bytes the block cache keeps. Zero decompresses on every read.
+     */
+    std::size_t block_cache_bytes = 8 * 1024 * 1024;
+    /**
+     * @brief Directory `spill_cold` writes the notes it spills to. Empty (the default) keeps every note in memory.
+     */
+    std::filesystem::path spill_directory;
+    /**
+     * @brief `compress_cold` passes a note has to go through unread and unwritten before `spill_cold` moves its title,
+     * content and tags out of memory. Meant to be well above `cold_after`, so notes are compressed first and only
+     * spilled if they stay cold.
+     */
+    std::uint32_t spill_after = 8;
+    /**
+     * @brief Source of `created`/`updated` timestamps. Defaults to `std::chrono::system_clock`.
+     */
+    std::function<Timestamp()> clock;
+    /**
+     * @brief Called with the id of every note updated, edited or removed, once the write has committed and the writer
+     * lock is released, e.g. to drop it from a `ResponseCache`. It may write to this store, which calls it again for
+     * that write; under a `DurableStore`, which holds its own lock across the write, it must not.
+     */
+    std::function<void(NoteId)> on_change;
+};
+
+/**
+ * @brief In-memory note store: the notes themselves plus every index `SearchNoteRequest` can use.
+ *
+ * Each note is assigned a `NoteOrdinal` on creation; ordinals are never reused, so removing a note leaves a hole.
+ *
+ * Notes are multi-versioned. Every write is assigned the next commit version and, rather than modifying a note in
+ * place, links a new immutable `NoteVersion` in front of the old one. Readers take a `Snapshot` (lock-free) and see
+ * each note as of that version, however long they hold it, so writers never wait for a scan and never tear a read.
+ * Writers are serialised among themselves. The indexes only describe the latest version; they are guarded by a
+ * reader-writer lock that writers hold just long enough to apply one write (or one `edit_many` batch), and that
+ * searches hold only while turning index lookups into candidate bitmaps, before filtering the candidates against their
+ * snapshot without any lock.
+ *
+ * Versions no snapshot can see any more are cut from their chains and freed by epoch-based reclamation, every
+ * `GC_INTERVAL` writes or on `collect_garbage`.
+ *
+ * Removing a note does not touch the indexes: its ordinal is only marked as a tombstone, which searches and listings
+ * mask out. A background compactor purges tombstoned notes from the indexes once enough of them pile up, a slice at a
+ * time so that it never holds the index lock for long.
+ *
+ * Note bodies are content-addressed: each version points at a blob in the store's `BlobStore`, shared with every other
+ * version holding the same bytes, so notes copied from a template cost their content once. A new version shares its
+ * predecessor's blob, and only copies the text out of it when an edit actually changes the content.
+ *
+ * Every read and write marks the version it touches with the current compression pass. Every
+ * `StoreOptions::compression_interval`, `compress_cold` packs the content of notes left untouched for
+ * `StoreOptions::cold_after` passes into LZ-compressed blocks, swapping each note's latest version for a copy pointing
+ * into its block. Reads decompress a block at a time through a small `BlockCache`, and editing a cold note's content
+ * gives it its own uncompressed copy again.
+ *
+ * With a `StoreOptions::spill_directory`, notes left untouched for `StoreOptions::spill_after` passes are moved out of
+ * memory altogether: `spill_cold` writes their title, content and tags to the store's `ColdTier`, keeping only the id
+ * and timestamps (and the notes' index entries) on the heap. Reading a spilled note serves it from the tier's mapping
+ * and asks the maintenance thread to `promote` it back to the heap; writing to one copies it back as any write does.
+ *
+ * A store loaded from a `Checkpoint` serves the loaded notes straight out of the checkpoint's mapping; a note is only
+ * copied to the heap when it is first modified.
+ */
+class NoteStore {
+  public:
+    /**
+     * @brief Writes between automatic garbage collection passes.
+     */
+    constexpr static std::size_t GC_INTERVAL = 64;
+
+    /**
+     * @brief Batches with fewer distinct notes than this are applied on the calling thread alone.
+     */
+    constexpr static std::size_t PARALLEL_BATCH = 64;
+
+    /**
+     * @brief Bytes of notes `spill_cold` writes to one cold tier segment.
+     */
+    constexpr static std::size_t SPILL_SEGMENT = 64 * 1024 * 1024;
+
+    /**
+     * @brief What `edit_many` returns.
+     */
+    struct BatchResult {
+        /**
+         * @brief One per edit, in order.
+         */
+        std::vector<Result<void>> results;
+        std::size_t applied = 0;
+        /**
+         * @brief The version the batch committed at: the store's version afterwards, changed only if `applied` is
+         * nonzero.
+         */
+        CommitVersion version = 0;
+    };
+
+    /**
+     * @brief What `facets` returns.
+     */
+    struct FacetCounts {
+        /// Notes matching the query.
+        std::size_t matches = 0;
+        /// Most common first, ties by tag.
+        std::vector<TagFacet> tags;
+    };
+
+    /**
+     * @brief What `take_dirty_chunks` returns.
+     */
+    struct DirtyChunks {
+        Snapshot snapshot;
+        /**
+         * @brief Indexes of the checkpoint chunks (`Checkpoint::CHUNK_NOTES` ordinals each) written to before
+         * `snapshot` and since the previous call.
+         */
+        Bitmap chunks;
+    };
+
+    explicit NoteStore(StoreOptions options = {});
+
+    /**
+     * @brief A store holding the notes in `checkpoint`, at its commit version and in its slots, so each note keeps its
+     * chunk. Indexes are built from the mapping, as by `end_bulk_load`; nothing else is copied out of it.
+     * @return `ErrorCode::DataLoss` if the checkpoint holds the same id twice
+     */
+    static auto load(std::shared_ptr<const Checkpoint> checkpoint, StoreOptions options = {})
+      -> Result<std::unique_ptr<NoteStore>>;
+
+    /**
+     * @brief Insert a new note, stamping `created` and `updated` with the current time.
+     * @param note The note data; missing fields are stored empty
+     * @param id The id to use, or `std::nullopt` to generate one
+     * @return The id of the new note, or `ErrorCode::AlreadyExists` if `id` is taken
+     */
+    auto create(const data::CreateNote& note, std::optional<NoteId> id = std::nullopt) -> Result<NoteId>;
+
+    /**
+     * @brief Insert a batch of new notes as one commit, each with a generated id and the same `created` time, for bulk
+     * loads.
+     *
+     * As with `edit_many`, the notes are sealed and their index entries worked out on `StoreOptions::write_threads`
+     * before the indexes are locked once for the whole batch, which readers wait on.
+     * @return The ids of the new notes, in order, or `ErrorCode::ResourceExhausted` if the batch would run out of
+     * ordinals, in which case nothing is inserted
+     */
+    auto create_many(std::span<const data::CreateNote> notes) -> Result<std::vector<NoteId>>;
+
+    /**
+     * @brief Stop maintaining the indexes on every write, for a large load, until `end_bulk_load` builds them all at
+     * once. Meanwhile searches and listings go by the indexes as they were when the load began: they miss the notes
+     * created since, and find edited notes by what they held before, though never a removed one. Reading a note by id
+     * or ordinal is unaffected. Does nothing if a bulk load is already under way.
+     */
+    void begin_bulk_load();
+
+    /**
+     * @brief Build every index afresh from the latest version of every note, swap them in, and maintain them on every
+     * write again.
+     *
+     * The notes are read on `StoreOptions::write_threads` threads, each over its own range of ordinals, into builders
+     * that only collect index entries. The indexes are then built side by side from those entries by sorting them,
+     * the trigram and term indexes in shards on as many threads again, and swapped in together under one exclusive
+     * hold of the index lock, with tombstoned notes left out. Searches carry on with the old indexes until then;
+     * writers wait for the build. Does nothing unless a bulk load is under way.
+     * @return The number of notes indexed
+     */
+    auto end_bulk_load() -> std::size_t;
+
+    /**
+     * @brief Whether writes are leaving the indexes to `end_bulk_load`.
+     */
+    [[nodiscard]] auto bulk_loading() const noexcept -> bool { return bulk_loading_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Replace the fields `update` carries and bump `updated`.
+     * @return `ErrorCode::NotFound` if no note has `update.id()`
+     */
+    auto update(const data::UpdateNote& update) -> Result<void>;
+
+    /**
+     * @brief Apply the edits in `edit` to the latest version of its note and bump `updated`.
+     * @return `ErrorCode::NotFound` if no note has `edit.id`, or `ErrorCode::InvalidArgument` if an edit does not fit
+     * the note, in which case nothing is changed
+     */
+    auto edit(const NoteEdit& edit) -> Result<void>;
+
+    /**
+     * @brief Apply a batch of edits as one commit: every note it modifies gets its new version at the same commit
+     * version, so readers see all of the batch or none of it.
+     *
+     * An edit that fails (see `edit`) is reported in its slot of the result and skipped; the rest of the batch still
+     * applies. Edits to the same note apply in order, each on top of the previous one. The edits themselves, and the
+     * trigram changes they imply, are worked out in parallel on `StoreOptions::write_threads`, one note at a time per
+     * thread, before the indexes are locked once for the whole batch.
+     */
+    auto edit_many(std::span<const NoteEdit> edits) -> BatchResult;
+
+    /**
+     * @return `ErrorCode::NotFound` if no note has `id`
+     */
+    auto remove(NoteId id) -> Result<void>;
+
+    /**
+     * @brief Remove a batch of notes as one commit. `BatchResult::applied` is the number of notes removed.
+     *
+     * An id with no note, or one already removed earlier in the batch, fails with `ErrorCode::NotFound` in its slot of
+     * the result; the rest of the batch still applies. Removal costs the same however large the notes are, since their
+     * index entries are left for `compact`.
+     */
+    auto remove_many(std::span<const NoteId> ids) -> BatchResult;
+
+    /**
+     * @brief A consistent view of the store as of the latest commit. Never blocks.
+     */
+    [[nodiscard]] auto snapshot() const -> Snapshot;
+
+    /**
+     * @brief Another view as of the same commit as `at`, holding none of what has been read through it. A long scan
+     * can read through a series of these, letting go of each in turn, rather than keep every compressed block it
+     * passes over decompressed in `at`.
+     */
+    [[nodiscard]] auto snapshot(const Snapshot& at) const -> Snapshot;
+
+    /**
+     * @brief A copy of the latest version of the note with `id`, if there is one.
+     */
+    [[nodiscard]] auto get(NoteId id) const -> std::optional<NoteRecord>;
+
+    /**
+     * @brief The note with `id` as of `snapshot`, if there was one. Valid for as long as `snapshot` is held.
+     */
+    [[nodiscard]] auto get(NoteId id, const Snapshot& snapshot) const -> std::optional<NoteView>;
+
+    /**
+     * @brief The note at `ordinal` as of `snapshot`, if there was one. Valid for as long as `snapshot` is held. Never
+     * blocks.
+     */
+    [[nodiscard]] auto at(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<NoteView>;
+
+    /**
+     * @brief `at`, without counting as a read of the note, so that scans and checkpoints do not keep every note they
+     * pass over from going cold.
+     */
+    [[nodiscard]] auto peek(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<NoteView>;
+
+    /**
+     * @brief The commit that produced the state of the note at `ordinal` as of `snapshot`, if there was one. Changes
+     * with every write to the note, and only then: compressing or spilling it leaves it alone.
+     */
+    [[nodiscard]] auto revision(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<CommitVersion>;
+
+    /**
+     * @brief The ordinal of the current note with `id`, or `INVALID_ORDINAL`.
+     */
+    [[nodiscard]] auto ordinal_of(NoteId id) const -> NoteOrdinal;
+
+    /**
+     * @brief Run a search through the cost-based `QueryPlanner`.
+     */
+    [[nodiscard]] auto search(const SearchQuery& query) const -> SearchResult;
+
+    /**
+     * @brief Number of notes matching `query`, ignoring its limit and cursor. Reads no note unless the plan has to
+     * filter.
+     */
+    [[nodiscard]] auto count(const SearchQuery& query) const -> std::size_t;
+
+    /**
+     * @brief The `limit` tags most common among the notes matching `query` (its limit and cursor ignored), with how
+     * many of them carry each, counted by `TagIndex::facets` on `StoreOptions::scan_threads`.
+     *
+     * The matches are found first, then counted against the tags under a second hold of the index lock, so a write
+     * falling in between can skew a count by the notes it touched.
+     */
+    [[nodiscard]] auto facets(const SearchQuery& query, std::size_t limit) const -> FacetCounts;
+
+    /**
+     * @brief One page of notes, oldest `created` first.
+     */
+    [[nodiscard]] auto list(const ListQuery& query) const -> ListResult;
+
+    /**
+     * @brief The latest commit version, incremented by every successful write.
+     */
+    [[nodiscard]] auto version() const noexcept -> CommitVersion { return committed_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Number of notes currently stored.
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief One past the highest ordinal ever handed out.
+     */
+    [[nodiscard]] auto end_ordinal() const noexcept -> NoteOrdinal { return versions_.size(); }
+
+    /**
+     * @brief Note versions currently allocated, including superseded ones still awaiting reclamation.
+     */
+    [[nodiscard]] auto version_count() const noexcept -> std::size_t {
+        return version_count_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief A snapshot of the latest commit, together with the chunks written to since the last call (or since the
+     * store was created or loaded). Taken under the writer lock, so no write falls between the two.
+     */
+    auto take_dirty_chunks() -> DirtyChunks;
+
+    /**
+     * @brief Cut every version no snapshot can see from its chain, and free whatever has been retired long enough.
+     * @return The number of versions freed
+     */
+    auto collect_garbage() -> std::size_t;
+
+    /**
+     * @brief Purge every tombstoned note from the indexes.
+     *
+     * Runs in slices of `StoreOptions::compaction_slice` index entries, each under its own exclusive hold of the index
+     * lock, pausing for `StoreOptions::compaction_pause` after each. Gives up between slices once `stop` is requested,
+     * leaving the tombstones for the next pass. The background compactor calls this; concurrent calls run one after
+     * the other.
+     * @return The number of notes purged
+     */
+    auto compact(std::stop_token stop = {}) -> std::size_t;
+
+    /**
+     * @brief Compress the content of every note neither read nor written during the last `StoreOptions::cold_after`
+     * passes (this one included), packing it into blocks of `StoreOptions::compression_block` bytes.
+     *
+     * The blocks are compressed without any lock; the notes are then swapped for their compressed copies under the
+     * writer lock, skipping any written to or read in the meantime. That is not a write: the commit version does not
+     * change, and snapshots already reading a note's old version keep it until they are released. Gives up before the
+     * swap once `stop` is requested. The background maintenance thread calls this; concurrent calls run one after the
+     * other.
+     * @return The number of notes compressed
+     */
+    auto compress_cold(std::stop_token stop = {}) -> std::size_t;
+
+    /**
+     * @brief Spill every note neither read nor written during the last `StoreOptions::spill_after` passes to the cold
+     * tier, a segment of up to `SPILL_SEGMENT` bytes at a time.
+     *
+     * Each segment is written without any lock, then its notes are swapped for copies pointing into it under the writer
+     * lock, as in `compress_cold`. Gives up between segments once `stop` is requested. Does not start a pass of its
+     * own; the background maintenance thread calls it right after `compress_cold`.
+     * @return The number of notes spilled, or `ErrorCode::Internal` if a segment cannot be written, in which case the
+     * notes of the segments before it stay spilled
+     */
+    auto spill_cold(std::stop_token stop = {}) -> Result<std::size_t>;
+
+    /**
+     * @brief Copy every spilled note read since the last call back to the heap. The maintenance thread calls this as
+     * soon as such a read asks for it.
+     * @return The number of notes promoted
+     */
+    auto promote() -> std::size_t;
+
+    /**
+     * @brief Number of removed notes whose index entries are still awaiting `compact`.
+     */
+    [[nodiscard]] auto tombstone_count() const noexcept -> std::size_t {
+        return tombstone_count_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto options() const noexcept -> const StoreOptions& { return options_; }
+
+    /**
+     * @brief The deduplicated note bodies.
+     */
+    [[nodiscard]] auto blobs() const noexcept -> const BlobStore& { return blobs_; }
+
+    /**
+     * @brief Compressed bytes held by blocks some version still points into.
+     */
+    [[nodiscard]] auto packed_bytes() const noexcept -> std::size_t {
+        return packed_bytes_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief The cache compressed content is read through.
+     */
+    [[nodiscard]] auto block_cache() const noexcept -> const BlockCache& { return blocks_; }
+
+    /**
+     * @brief The rankings of the ranked searches being paged through, which `QueryPlanner` resumes later pages from.
+     * Thread safe, hence handed out from a const store.
+     */
+    [[nodiscard]] auto rankings() const noexcept -> RankingCache& { return rankings_; }
+
+    /**
+     * @brief The tier spilled notes are read from, or **nullptr** without a `StoreOptions::spill_directory`.
+     */
+    [[nodiscard]] auto cold_tier() const noexcept -> const ColdTier* { return cold_ ? &*cold_ : nullptr; }
+
+    /**
+     * @brief The checkpoint the store was loaded from, or **nullptr**.
+     */
+    [[nodiscard]] auto checkpoint() const noexcept -> const Checkpoint* { return checkpoint_.get(); }
+
+    /**
+     * @brief Shared access to the indexes. Hold it for any call below, and take a snapshot under it to see exactly
+     * the version the indexes describe.
+     */
+    [[nodiscard]] auto read_lock() const -> std::shared_lock<std::shared_mutex> {
+        return std::shared_lock { index_mutex_ };
+    }
+
+    /**
+     * @brief The first ordinal created after `version`; every note visible at `version` has a lower ordinal.
+     */
+    [[nodiscard]] auto ordinal_horizon(CommitVersion version) const -> NoteOrdinal;
+
+    /**
+     * @brief The ordinals of every stored note.
+     */
+    [[nodiscard]] auto live() const noexcept -> const Bitmap& { return live_; }
+    /**
+     * @brief The ordinals of removed notes the indexes below may still hold. Mask them out of any lookup.
+     */
+    [[nodiscard]] auto tombstones() const noexcept -> const Bitmap& { return tombstones_; }
+    [[nodiscard]] auto titles() const noexcept -> const TrigramIndex& { return titles_; }
+    /**
+     * @brief The content trigram index, or **nullptr** if `StoreOptions::index_content` is off.
+     */
+    [[nodiscard]] auto contents() const noexcept -> const TrigramIndex* { return contents_ ? &*contents_ : nullptr; }
+    /**
+     * @brief The term index, or **nullptr** if `StoreOptions::index_terms` is off.
+     */
+    [[nodiscard]] auto terms() const noexcept -> const TermIndex* { return terms_ ? &*terms_ : nullptr; }
+    [[nodiscard]] auto tags() const noexcept -> const TagIndex& { return tags_; }
+    [[nodiscard]] auto created() const noexcept -> const DateIndex& { return created_; }
+    [[nodiscard]] auto updated() const noexcept -> const DateIndex& { return updated_; }
+
+  private:
+    [[nodiscard]] auto now() const -> Timestamp;
+    /**
+     * @brief `ordinal_of` for the writer, which needs no lock to read what only it modifies.
+     */
+    [[nodiscard]] auto current_ordinal(NoteId id) const -> NoteOrdinal;
+    /**
+     * @brief Apply `edit` to `record`, which is left unchanged if any of it fails.
+     */
+    static auto apply_edit(NoteRecord& record, const NoteEdit& edit) -> Result<void>;
+    /**
+     * @brief The state `version` of `ordinal` holds, reading base versions from the checkpoint. The content of a
+     * compressed version is left empty unless `reading` is given, which then keeps it alive.
+     */
+    [[nodiscard]] auto view_of(NoteOrdinal ordinal, const NoteVersion& version, const Snapshot* reading = nullptr) const
+      -> NoteView;
+    /**
+     * @brief Give `version` its own copy of its content, ready to be edited.
+     */
+    void unshare(NoteVersion& version) const;
+    /**
+     * @brief A copy of the latest version of `ordinal`, to be modified and passed to `supersede`.
+     */
+    [[nodiscard]] auto successor(NoteOrdinal ordinal) const -> std::unique_ptr<NoteVersion>;
+    void supersede(NoteOrdinal ordinal, std::unique_ptr<NoteVersion> next);
+    /**
+     * @brief Move `version`'s content into the blob store, unless it already points at a blob or block, and mark it
+     * touched by the current compression pass.
+     */
+    void seal(NoteVersion& version);
+    /**
+     * @brief Swap `head`, the latest version of `ordinal`, for `copy`, which holds the same note stored differently.
+     * Not a write: `copy` takes over `head`'s commit version and chain, and `head` is retired for any reader still on
+     * it. Writer only.
+     */
+    void replace_head(NoteOrdinal ordinal, NoteVersion* head, std::unique_ptr<NoteVersion> copy);
+    /**
+     * @brief Queue `ordinal`, just read while spilled, for `promote`, and wake the maintenance thread.
+     */
+    void request_promotion(NoteOrdinal ordinal) const;
+    /**
+     * @brief A tombstone to link in front of `ordinal`'s latest version at the next commit.
+     */
+    [[nodiscard]] auto tombstone(NoteOrdinal ordinal, NoteId id) const -> std::unique_ptr<NoteVersion>;
+    /**
+     * @brief Publish `tombstone` and mask `ordinal` out of the indexes. Call with the index lock held.
+     */
+    void bury(NoteOrdinal ordinal, std::unique_ptr<NoteVersion> tombstone);
+    /**
+     * @brief Count `count` new tombstones, waking the maintenance thread if that crosses the
+     * compaction threshold.
+     */
+    void buried(std::size_t count);
+    /**
+     * @brief Body of the maintenance thread: promotes spilled notes as soon as they are read, compacts once enough
+     * tombstones pile up, and compresses and spills cold notes every `StoreOptions::compression_interval`.
+     */
+    void maintain(std::stop_token stop);
+    /**
+     * @brief Bookkeeping after a write that linked a new version in front of `ordinal`'s previous one.
+     */
+    void chained(NoteOrdinal ordinal);
+    /**
+     * @brief Replace every index by one built from the latest version of every live note, as `end_bulk_load`
+     * describes. Call with the writer lock held, or before anything else can see the store.
+     * @return The number of notes indexed
+     */
+    auto build_indexes() -> std::size_t;
+    /**
+     * @brief Bookkeeping after any write to `ordinal`.
+     */
+    void after_write(NoteOrdinal ordinal);
+    /**
+     * @brief Tell `StoreOptions::on_change` that the note with `id` changed. Call without the writer lock.
+     */
+    void changed(NoteId id) const;
+    auto collect() -> std::size_t;
+
+    StoreOptions options_;
+    std::shared_ptr<const Checkpoint> checkpoint_;
+    /// The base version every note loaded from `checkpoint_` starts out with.
+    NoteVersion base_;
+    /// Declared ahead of every version, which may hold a blob until it is destroyed.
+    BlobStore blobs_;
+    /// Counted down as each compressed block is freed, so likewise declared ahead of every version.
+    std::atomic<std::size_t> packed_bytes_ { 0 };
+    /// Spilled versions point into its mappings, so likewise declared ahead of every version.
+    std::optional<ColdTier> cold_;
+
+    std::mutex write_mutex_;
+    std::atomic<CommitVersion> committed_ { 0 };
+    VersionTable versions_;
+    mutable EpochManager epochs_;
+    mutable BlockCache blocks_;
+    mutable RankingCache rankings_;
+    std::atomic<std::size_t> size_ { 0 };
+    std::atomic<std::size_t> version_count_ { 0 };
+    /// Ordinals with more than one version, the only ones garbage collection has to look at. Writer only.
+    std::vector<NoteOrdinal> chains_;
+    Bitmap chained_;
+    std::size_t writes_since_collect_ = 0;
+    /// Chunks written to since the last `take_dirty_chunks`. Writer only.
+    Bitmap dirty_chunks_;
+    std::atomic<std::size_t> tombstone_count_ { 0 };
+    /// Written under the writer lock, which every write reads it under.
+    std::atomic<bool> bulk_loading_ { false };
+    /// Serialises `compact` calls.
+    std::mutex compact_mutex_;
+    /// Mutable so that reads can wake the maintenance thread for `promote`.
+    mutable std::mutex maintenance_mutex_;
+    mutable std::condition_variable_any maintenance_wake_;
+    /// The current `compress_cold` pass.
+    std::atomic<std::uint32_t> pass_ { 0 };
+    /// Serialises `compress_cold` and `spill_cold` calls, and guards `next_block_` and `cold_`'s segments.
+    std::mutex compress_mutex_;
+    std::uint64_t next_block_ = 0;
+    /// Spilled notes read since the last `promote`.
+    mutable std::mutex promotion_mutex_;
+    mutable phmap::flat_hash_set<NoteOrdinal> promotions_;
+    mutable std::atomic<bool> promotions_due_ { false };
+
+    // Everything below is guarded by `index_mutex_`.
+    mutable std::shared_mutex index_mutex_;
+    /// Also maps removed notes until their versions are collected, so older snapshots can still find them by id.
+    phmap::flat_hash_map<NoteId, NoteOrdinal, NoteIdHash> ids_;
+    Bitmap live_;
+    Bitmap tombstones_;
+    /// The version each ordinal was created at. Non-decreasing, since ordinals are handed out in order.
+    std::vector<CommitVersion> birth_versions_;
+    TrigramIndex titles_;
+    std::optional<TrigramIndex> contents_;
+    std::optional<TermIndex> terms_;
+    TagIndex tags_;
+    DateIndex created_;
+    DateIndex updated_;
+
+    /// Declared last, so that it is stopped and joined before anything it uses is destroyed.
+    std::jthread maintenance_;
+};
+
+}  // namespace pg::store
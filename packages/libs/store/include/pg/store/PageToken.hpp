@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <pg/store/Error.hpp>
+#include <pg/store/Query.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Which request a page token was issued for. A token is only accepted by the same kind of request.
+ */
+enum class PageKind : std::uint8_t { Search = 1, List = 2 };
+
+/**
+ * @brief Encode `cursor` as an opaque `page_token`.
+ *
+ * The token is a handful of varints (base64url, no padding), 12 to 35 characters, and a few more per query word for
+ * a ranked search, which carries its `RankingStats`. `fingerprint` ties a search token to the predicates it was issued
+ * for; see `fingerprint_of`.
+ */
+[[nodiscard]] auto encode_page_token(PageKind kind, const Cursor& cursor, std::uint32_t fingerprint = 0)
+  -> std::string;
+
+/**
+ * @brief Decode a token made by `encode_page_token`.
+ * @return The cursor, or `ErrorCode::InvalidArgument` if the token is malformed or was issued for another kind of
+ * request or another query
+ */
+[[nodiscard]] auto decode_page_token(std::string_view token, PageKind kind, std::uint32_t fingerprint = 0)
+  -> Result<Cursor>;
+
+/**
+ * @brief A hash of the predicates and order of `query`, so a token cannot be replayed against a different search.
+ */
+[[nodiscard]] auto fingerprint_of(const SearchQuery& query) -> std::uint32_t;
+
+}  // namespace pg::store
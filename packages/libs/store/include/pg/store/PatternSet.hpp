@@ -0,0 +1,149 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Error.hpp>
+#include <pg/store/LruCache.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief A set of search strings compiled into an Aho-Corasick automaton, for finding all of them in one pass.
+ *
+ * Matches are leftmost-longest and never overlap: scanning left to right, the match starting earliest wins, the
+ * longest one among those starting at the same byte, and scanning resumes after it. When the same string is listed
+ * twice, its first index is reported. Matching is case sensitive.
+ *
+ * The automaton is a full transition table over byte classes (the bytes that occur in some pattern, each its own
+ * class, plus one class for every other byte), so each byte of text costs one lookup.
+ */
+class PatternSet {
+  public:
+    struct Match {
+        std::size_t start = 0;
+        std::size_t length = 0;
+        /// Index of the pattern in the list it was compiled from.
+        std::size_t pattern = 0;
+
+        friend auto operator==(const Match&, const Match&) -> bool = default;
+    };
+
+    /**
+     * @return `ErrorCode::InvalidArgument` if a pattern is empty
+     */
+    static auto compile(std::span<const std::string_view> patterns) -> Result<PatternSet>;
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return lengths_.size(); }
+    /**
+     * @brief Number of states in the automaton.
+     */
+    [[nodiscard]] auto states() const noexcept -> std::size_t { return states_.size(); }
+
+    /**
+     * @brief Call `fn(match)` for every match in `text`, in order.
+     */
+    template <typename Fn>
+    void for_each_match(std::string_view text, Fn&& fn) const;
+
+    [[nodiscard]] auto matches(std::string_view text) const -> std::vector<Match>;
+
+    /**
+     * @brief `text` with every match of pattern `i` replaced by `replacements[i]`. Replacements are not scanned again.
+     * @param replacements One per pattern
+     */
+    [[nodiscard]] auto replace(std::string_view text, std::span<const std::string_view> replacements) const
+      -> std::string;
+
+  private:
+    using State = std::uint32_t;
+    constexpr static State ROOT = 0;
+    constexpr static std::uint32_t NONE = ~std::uint32_t { 0 };
+
+    struct StateInfo {
+        /// Length of the string spelled by the path to this state.
+        std::uint32_t depth = 0;
+        /// The longest pattern that is a suffix of that string, or `NONE`.
+        std::uint32_t output = NONE;
+    };
+
+    PatternSet() = default;
+
+    [[nodiscard]] auto next(State state, unsigned char byte) const noexcept -> State {
+        return transitions_[static_cast<std::size_t>(state) * classes_ + classes_of_[byte]];
+    }
+
+    std::array<std::uint16_t, 256> classes_of_ {};
+    std::size_t classes_ = 1;
+    std::vector<State> transitions_;
+    std::vector<StateInfo> states_;
+    std::vector<std::uint32_t> lengths_;
+};
+
+template <typename Fn>
+void PatternSet::for_each_match(std::string_view text, Fn&& fn) const {
+    // The best candidate seen so far is final once no match yet to be found could start at or before it: every such
+    // match is a pattern whose prefix is a suffix of the text read so far, so it starts at least `depth` bytes back.
+    auto best = Match {};
+    auto found = false;
+    auto state = ROOT;
+    auto at = std::size_t { 0 };
+    while (at < text.size() || found) {
+        if (at < text.size()) {
+            state = next(state, static_cast<unsigned char>(text[at]));
+            ++at;
+            const auto& info = states_[state];
+            if (info.output != NONE) {
+                const auto length = std::size_t { lengths_[info.output] };
+                const auto start = at - length;
+                if (!found || start < best.start || (start == best.start && length > best.length)) {
+                    best = Match { start, length, info.output };
+                    found = true;
+                }
+            }
+            if (!found || best.start + info.depth >= at) {
+                continue;
+            }
+        }
+        fn(best);
+        // Resume right after the match: anything overlapping it is dropped.
+        at = best.start + best.length;
+        state = ROOT;
+        found = false;
+    }
+}
+
+/**
+ * @brief A bounded, thread safe cache of compiled `PatternSet`s, keyed by their pattern lists, so bulk updates that
+ * repeat the same multi-pattern edit compile it once. Least recently used sets are evicted first.
+ */
+class PatternCache {
+  public:
+    explicit PatternCache(std::size_t capacity = 64): cache_(capacity) { }
+
+    /**
+     * @brief The set compiled from `patterns`, compiling and caching it on a miss.
+     * @return `ErrorCode::InvalidArgument` if a pattern is empty
+     */
+    auto get(std::span<const std::string_view> patterns) -> Result<std::shared_ptr<const PatternSet>>;
+
+    [[nodiscard]] auto size() const -> std::size_t { return cache_.size(); }
+    [[nodiscard]] auto hits() const -> std::size_t { return cache_.hits(); }
+
+  private:
+    LruCache<std::string, std::shared_ptr<const PatternSet>> cache_;
+};
+
+}  // namespace pg::store
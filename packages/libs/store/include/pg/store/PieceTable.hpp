@@ -0,0 +1,103 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pg::store {
+
+/**
+ * @brief A piece table: text held as a sequence of pieces, each a span of either the original text or an append-only
+ * buffer of everything inserted since.
+ *
+ * The pieces are kept in an implicit treap ordered by position, each node caching the byte length of its subtree, so
+ * locating a position, inserting and erasing are all O(log pieces) however long the text is. Nothing is copied until
+ * `str` flattens the pieces, once, into a string.
+ *
+ * The original text is only viewed, not copied, and must outlive the table (or its next `assign`).
+ */
+class PieceTable {
+  public:
+    explicit PieceTable(std::string_view original = {});
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    [[nodiscard]] auto empty() const noexcept -> bool { return size() == 0; }
+    /**
+     * @brief Number of pieces the text is currently split into.
+     */
+    [[nodiscard]] auto pieces() const noexcept -> std::size_t;
+
+    /**
+     * @brief Insert `text` before byte `position`, which must be at most `size()`.
+     */
+    void insert(std::size_t position, std::string_view text);
+    void append(std::string_view text) { insert(size(), text); }
+    void prepend(std::string_view text) { insert(0, text); }
+
+    /**
+     * @brief Erase the bytes in `[start, end)`, which must lie within `[0, size()]`.
+     */
+    void erase(std::size_t start, std::size_t end);
+
+    /**
+     * @brief Replace the whole text with `text`, which the table takes ownership of, dropping every piece.
+     */
+    void assign(std::string text);
+
+    /**
+     * @brief The text, flattened.
+     */
+    [[nodiscard]] auto str() const -> std::string;
+
+  private:
+    using Index = std::uint32_t;
+    constexpr static Index NIL = ~Index { 0 };
+
+    enum class Buffer : std::uint8_t { Original, Added };
+
+    struct Node {
+        Buffer buffer;
+        std::size_t offset;
+        std::size_t length;
+        /// Bytes in this node's subtree, itself included.
+        std::size_t total;
+        /// Pieces in this node's subtree, itself included.
+        std::size_t count;
+        std::uint32_t priority;
+        Index left = NIL;
+        Index right = NIL;
+    };
+
+    [[nodiscard]] auto total(Index node) const noexcept -> std::size_t { return node == NIL ? 0 : nodes_[node].total; }
+    [[nodiscard]] auto text_of(const Node& node) const noexcept -> std::string_view;
+
+    auto make(Buffer buffer, std::size_t offset, std::size_t length, std::uint32_t priority) -> Index;
+    auto next_priority() noexcept -> std::uint32_t;
+    void update(Index node) noexcept;
+    /**
+     * @brief Split `node` into the pieces before byte `position` and those from it on, cutting a piece in two if the
+     * position falls inside it.
+     */
+    void split(Index node, std::size_t position, Index& left, Index& right);
+    auto merge(Index left, Index right) -> Index;
+
+    std::string_view original_;
+    /// Holds the original text instead of `original_` after an `assign`.
+    std::string owned_;
+    bool owns_ = false;
+    std::string added_;
+    /// Node pool. Erased pieces are unlinked but not reclaimed until the next `assign`.
+    std::vector<Node> nodes_;
+    Index root_ = NIL;
+    std::uint32_t seed_ = 0x9E3779B9;
+};
+
+}  // namespace pg::store
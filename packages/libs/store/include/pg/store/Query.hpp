@@ -0,0 +1,188 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/NoteRecord.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Page size used when a request leaves `page_size` at zero.
+ */
+constexpr inline std::size_t DEFAULT_PAGE_SIZE = 50;
+/**
+ * @brief Largest page a single request may ask for.
+ */
+constexpr inline std::size_t MAX_PAGE_SIZE = 1000;
+
+/**
+ * @brief The note column a predicate applies to. One per `pg.gen.SearchNoteData` member.
+ */
+enum class NoteField : std::uint8_t { Title, Content, Tag, Created, Updated };
+
+/**
+ * @brief One per `pg.gen.TextSearchKind` member.
+ */
+enum class TextMatchKind : std::uint8_t { Matches, Contains, StartsWith, EndsWith };
+
+/**
+ * @brief One per `pg.gen.DateSearchKind` member.
+ */
+enum class DateMatchKind : std::uint8_t { Before, After, InRange, NotInRange };
+
+/**
+ * @brief The order a search returns its matches in.
+ */
+enum class SearchOrder : std::uint8_t {
+    /// By ordinal, i.e. oldest note first.
+    Ordinal,
+    /// Best match first, scored with BM25 against the text of the query's title and content predicates; ties, and
+    /// matches using none of its words, follow in ordinal order.
+    Relevance,
+};
+
+struct TextPredicate {
+    TextMatchKind kind;
+    std::string text;
+    bool case_sensitive;
+
+    /**
+     * @brief Whether `value` satisfies this predicate.
+     */
+    [[nodiscard]] auto test(std::string_view value) const -> bool;
+};
+
+struct DatePredicate {
+    DateMatchKind kind;
+    /**
+     * @brief The date for `Before`/`After`, the first bound for the range kinds.
+     */
+    Timestamp start;
+    /**
+     * @brief The second bound for the range kinds, unused otherwise.
+     */
+    Timestamp end;
+
+    [[nodiscard]] auto test(Timestamp value) const -> bool;
+};
+
+/**
+ * @brief A single search condition, the store-side equivalent of one `pg.gen.SearchNoteData`.
+ *
+ * Title and content predicates test the field's text; a tag predicate holds if *any* of the note's tags satisfies
+ * it; created and updated predicates test the corresponding timestamp.
+ */
+struct Predicate {
+    NoteField field;
+    std::variant<TextPredicate, DatePredicate> match;
+
+    [[nodiscard]] auto test(const NoteView& note) const -> bool;
+
+    [[nodiscard]] auto text() const -> const TextPredicate& { return std::get<TextPredicate>(match); }
+    [[nodiscard]] auto date() const -> const DatePredicate& { return std::get<DatePredicate>(match); }
+
+    /**
+     * @brief Human readable form, e.g. `title contains "meet"`. Used by `QueryPlan::explain`.
+     */
+    [[nodiscard]] auto describe() const -> std::string;
+};
+
+/**
+ * @brief The collection statistics BM25 scores a query's matches against, as they stood when a ranked search read its
+ * first page.
+ */
+struct RankingStats {
+    /// Notes indexed.
+    std::uint64_t notes = 0;
+    /// Words in every indexed title, and in every indexed content.
+    std::uint64_t title_words = 0;
+    std::uint64_t content_words = 0;
+    /// How many notes use each term of the query, in the order `TermIndex::terms_of` lists them.
+    std::vector<std::uint64_t> frequencies;
+
+    friend auto operator==(const RankingStats&, const RankingStats&) -> bool = default;
+};
+
+/**
+ * @brief Where the previous page ended: the decoded form of a `page_token`.
+ *
+ * Pages resume strictly after `(sort_key, ordinal)` instead of skipping an offset, so fetching any page costs the
+ * same as the first. `version` is the commit version the first page was read at; notes created after it are left out
+ * of later pages so that pagination sees one consistent set of notes.
+ */
+struct Cursor {
+    CommitVersion version = 0;
+    /**
+     * @brief The sort column of the last note returned: `created`, in nanoseconds, for `ListQuery`, and the bits of
+     * the note's score for `SearchOrder::Relevance`. Searches in ordinal order leave this at zero.
+     */
+    std::int64_t sort_key = 0;
+    /**
+     * @brief The last note returned.
+     */
+    NoteOrdinal ordinal = INVALID_ORDINAL;
+    /**
+     * @brief For `SearchOrder::Relevance`, what the first page was scored against, so that every later page scores
+     * each note the same way however many notes were written in between.
+     */
+    std::optional<RankingStats> ranking;
+
+    friend auto operator==(const Cursor&, const Cursor&) -> bool = default;
+};
+
+/**
+ * @brief A decoded `pg.gen.SearchNoteRequest`: all `predicates` must hold (an empty list matches every note).
+ */
+struct SearchQuery {
+    std::vector<Predicate> predicates;
+    /**
+     * @brief Maximum number of notes to return; zero means no limit.
+     */
+    std::size_t limit = DEFAULT_PAGE_SIZE;
+    /**
+     * @brief Resume after this point, or start from the first note.
+     */
+    std::optional<Cursor> cursor;
+    SearchOrder order = SearchOrder::Ordinal;
+};
+
+/**
+ * @brief A decoded `pg.gen.ListNotesRequest`. Notes are listed oldest first by `created`.
+ */
+struct ListQuery {
+    std::size_t limit = DEFAULT_PAGE_SIZE;
+    std::optional<Cursor> cursor;
+};
+
+struct ListResult {
+    std::vector<NoteOrdinal> ordinals;
+    /**
+     * @brief Where the next page starts, if there is one.
+     */
+    std::optional<Cursor> next;
+    /**
+     * @brief The snapshot the page was read at. Read the notes through it so that they match the listing.
+     */
+    Snapshot snapshot;
+};
+
+[[nodiscard]] auto to_string(NoteField field) -> std::string_view;
+[[nodiscard]] auto to_string(TextMatchKind kind) -> std::string_view;
+[[nodiscard]] auto to_string(SearchOrder order) -> std::string_view;
+[[nodiscard]] auto to_string(DateMatchKind kind) -> std::string_view;
+
+}  // namespace pg::store
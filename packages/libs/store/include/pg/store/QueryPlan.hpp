@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+#include <pg/store/Query.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Where a plan step gets its notes from.
+ */
+enum class AccessPath : std::uint8_t { TagIndex, TitleTrigrams, ContentTrigrams, CreatedIndex, UpdatedIndex, Scan };
+
+/**
+ * @brief How a plan step combines with the steps before it.
+ */
+enum class StepMode : std::uint8_t {
+    /// Produce the initial candidate bitmap from an index.
+    Drive,
+    /// And an index bitmap into the candidates.
+    Intersect,
+    /// Test each candidate against the note itself, stopping once the page is full.
+    Filter,
+};
+
+struct PlanStep {
+    /**
+     * @brief Index of the predicate in `SearchQuery::predicates`.
+     */
+    std::size_t predicate;
+    StepMode mode;
+    AccessPath path;
+    /**
+     * @brief Estimated number of matching notes, from index statistics (or a default selectivity when no index
+     * applies).
+     */
+    std::size_t estimate;
+    /**
+     * @brief The step re-checks a predicate whose index lookup only produced a superset of the matches.
+     */
+    bool recheck = false;
+    std::string label;
+
+    // Filled in during execution.
+    std::size_t rows_in = 0;
+    std::size_t rows_out = 0;
+    std::chrono::nanoseconds elapsed {};
+};
+
+/**
+ * @brief The plan chosen for a `SearchQuery`, annotated with per-step row counts and timings once executed.
+ */
+struct QueryPlan {
+    std::vector<PlanStep> steps;
+    /**
+     * @brief Number of live notes when the plan was made.
+     */
+    std::size_t universe = 0;
+    std::size_t limit = 0;
+    /**
+     * @brief No predicate could use an index, so every note is tested by a (possibly parallel) scan.
+     */
+    bool parallel_scan = false;
+    std::size_t threads = 1;
+    /**
+     * @brief Matches are ranked by relevance through the term index, rather than returned in ordinal order.
+     */
+    bool ranked = false;
+    /**
+     * @brief Notes the ranking scored in full, out of all those using the query's words.
+     */
+    std::size_t scored = 0;
+    /**
+     * @brief Execution stopped before every candidate had been examined because the page was full.
+     */
+    bool stopped_early = false;
+    std::size_t returned = 0;
+    std::chrono::nanoseconds planning {};
+    std::chrono::nanoseconds execution {};
+
+    /**
+     * @brief A multi-line, human readable rendering of the plan and, if it has run, its per-step statistics.
+     */
+    [[nodiscard]] auto explain() const -> std::string;
+};
+
+/**
+ * @brief Notes matching a `SearchQuery`, in the order it asked for, together with the plan that found them.
+ */
+struct SearchResult {
+    std::vector<NoteOrdinal> ordinals;
+    /**
+     * @brief The relevance score of each note in `ordinals`, if the plan ranked them; empty otherwise.
+     */
+    std::vector<double> scores;
+    /**
+     * @brief More notes match than `SearchQuery::limit` allowed to return.
+     */
+    bool truncated = false;
+    /**
+     * @brief Where the next page starts, set whenever `truncated` is.
+     */
+    std::optional<Cursor> next;
+    /**
+     * @brief The snapshot the search was evaluated at. Read the notes through it so that they match the predicates.
+     */
+    Snapshot snapshot;
+    QueryPlan plan;
+};
+
+[[nodiscard]] auto to_string(AccessPath path) -> std::string_view;
+[[nodiscard]] auto to_string(StepMode mode) -> std::string_view;
+
+}  // namespace pg::store
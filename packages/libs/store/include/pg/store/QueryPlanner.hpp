@@ -0,0 +1,133 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/Query.hpp>
+#include <pg/store/QueryPlan.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Cost-based planner and executor for `SearchQuery`.
+ *
+ * Planning ranks every predicate by its estimated match count, taken from index statistics (tag counts, the rarest
+ * trigram's posting length, date ranges interpolated over the index bounds). The most selective indexed predicate
+ * drives the query; each further indexed predicate is intersected in only when building its bitmap is cheaper than
+ * testing the remaining candidates directly, otherwise it becomes a filter. Filters run cheapest-per-rejected-row
+ * first over small batches of candidates, so execution stops as soon as the page is full. Only when no predicate can
+ * use an index is every note scanned, split across `StoreOptions::scan_threads`.
+ *
+ * Both planning and the index lookups hold `NoteStore::read_lock`; filtering and scanning read notes through a
+ * snapshot taken under it and run without any lock, so writers are only held up while candidate bitmaps are built.
+ *
+ * A `SearchOrder::Relevance` query with title or content predicates is ranked instead: `TermIndex::top` walks the
+ * posting lists of the predicates' words and keeps the best `limit + 1` notes in a heap, only scoring a note in full,
+ * and only running the filters on it, once it could still make the page. Matches using none of the words follow in
+ * ordinal order. Ranking reads the term index as it goes, so it holds the lock throughout.
+ *
+ * Every page of a ranked search scores notes against the collection statistics its first page did, which the cursor
+ * carries, so writes in between cannot move a note from one page to another. The best matches found are kept in the
+ * store's `RankingCache`, where later pages resume from instead of scoring every note ranked before the cursor again.
+ */
+class QueryPlanner {
+  public:
+    /**
+     * @brief Candidates are filtered in batches of this many notes, which bounds the overshoot past a full page.
+     */
+    constexpr static std::size_t BATCH_SIZE = 256;
+    /**
+     * @brief Notes per unit of work handed to a scan thread.
+     */
+    constexpr static std::size_t SCAN_CHUNK = 8192;
+
+    explicit QueryPlanner(const NoteStore& store): store_ { store } { }
+
+    [[nodiscard]] auto plan(const SearchQuery& query) const -> QueryPlan;
+
+    /**
+     * @brief Run `plan` (which must have been made for `query` against the same store), as of the latest commit.
+     *
+     * Results come back in ordinal order, so a page resumes at the ordinal after `SearchQuery::cursor` without
+     * revisiting earlier matches. Notes created after the cursor's version are skipped.
+     * @return The matching notes together with the plan, annotated with per-step row counts and timings
+     */
+    [[nodiscard]] auto execute(const SearchQuery& query, QueryPlan plan) const -> SearchResult;
+
+    /**
+     * @brief Every note matching `query` (made into `plan`) as of the latest commit, ignoring its limit, cursor and
+     * order, and annotating `plan` as `execute` does.
+     *
+     * A plan of index steps alone is answered from the indexes' bitmaps without reading a single note. Filters read
+     * each remaining candidate through a snapshot, in place, copying nothing.
+     */
+    [[nodiscard]] auto matches(const SearchQuery& query, QueryPlan& plan) const -> Bitmap;
+
+  private:
+    struct StepStats {
+        std::size_t rows_in = 0;
+        std::size_t rows_out = 0;
+        std::chrono::nanoseconds elapsed {};
+    };
+
+    /**
+     * @brief The part of the ordinal space a page is taken from, and how many matches to collect.
+     */
+    struct Window {
+        NoteOrdinal begin;
+        NoteOrdinal end;
+        std::size_t want;
+    };
+
+    /**
+     * @brief The candidates the index steps of `plan` leave, recording their row counts. Call with the index lock
+     * held.
+     */
+    [[nodiscard]] auto lookup(const SearchQuery& query, QueryPlan& plan) const -> Bitmap;
+    [[nodiscard]] auto index_lookup(const Predicate& predicate) const -> Bitmap;
+
+    void filter(
+      const SearchQuery& query,
+      const Snapshot& snapshot,
+      std::span<const PlanStep* const> filters,
+      std::vector<NoteOrdinal>& batch,
+      std::span<StepStats> stats) const;
+    void stream(
+      const SearchQuery& query,
+      const Snapshot& snapshot,
+      QueryPlan& plan,
+      const Bitmap& candidates,
+      Window window,
+      std::vector<NoteOrdinal>& out) const;
+    void scan(
+      const SearchQuery& query,
+      const Snapshot& snapshot,
+      QueryPlan& plan,
+      const Bitmap& candidates,
+      Window window,
+      std::vector<NoteOrdinal>& out) const;
+    /**
+     * @brief Rank the candidates that pass the filters, best first, into `result`. Call with the index lock held.
+     * @return What the notes were scored against, for the next page's cursor to carry
+     */
+    [[nodiscard]] auto rank(
+      const SearchQuery& query,
+      QueryPlan& plan,
+      const Bitmap& candidates,
+      Window window,
+      SearchResult& result) const -> RankingStats;
+
+    const NoteStore& store_;
+};
+
+}  // namespace pg::store
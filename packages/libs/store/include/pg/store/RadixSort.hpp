@@ -0,0 +1,57 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pg::store {
+
+/**
+ * @brief Sort `items` by the lowest `bits` bits of `key(item)`, least significant digit first, keeping items with equal
+ * keys in the order they were in.
+ *
+ * Index builders sort millions of postings that already come in ordinal order, so sorting them stably by term alone
+ * leaves every posting list in order too, in a few linear passes rather than a comparison sort. Digits every item
+ * shares are skipped.
+ */
+template <typename T, typename Key>
+void radix_sort(std::vector<T>& items, Key key, unsigned bits) {
+    // As few passes as digits of up to 16 bits allow, each digit as narrow as that many passes allow.
+    const auto passes = (bits + 15) / 16;
+    const auto digit_bits = passes != 0 ? (bits + passes - 1) / passes : 0;
+    auto scratch = std::vector<T> {};
+    auto counts = std::vector<std::size_t>(std::size_t { 1 } << digit_bits);
+    for (auto shift = 0U; shift < bits; shift += digit_bits) {
+        // The last digit may be narrower, so that no bit above `bits` counts.
+        const auto mask = (std::uint64_t { 1 } << std::min(digit_bits, bits - shift)) - 1;
+        const auto digit = [&](const T& item) {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(key(item)) >> shift) & mask);
+        };
+        std::ranges::fill(counts, 0);
+        for (const auto& item : items) {
+            ++counts[digit(item)];
+        }
+        if (items.empty() || counts[digit(items.front())] == items.size()) {
+            continue;
+        }
+        auto offset = std::size_t { 0 };
+        for (auto& count : counts) {
+            offset += std::exchange(count, offset);
+        }
+        scratch.resize(items.size());
+        for (auto& item : items) {
+            scratch[counts[digit(item)]++] = std::move(item);
+        }
+        items.swap(scratch);
+    }
+}
+
+}  // namespace pg::store
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/LruCache.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/TermIndex.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief The best matches of the ranked searches being paged through, so that a later page is sliced out of the
+ * ranking an earlier page already worked out instead of scoring every note before it again.
+ *
+ * A ranking is kept for a query (the text of its predicates) as of the commit version its first page was read at,
+ * which is what every later page's cursor carries; pages of the same query started at another version never share
+ * one. Holds up to `capacity` rankings in an `LruCache`, evicting the least recently used. Thread safe.
+ */
+class RankingCache {
+  public:
+    constexpr static std::size_t DEFAULT_CAPACITY = 64;
+
+    struct Ranking {
+        /// Best first, as `TermIndex::top` returns them, every one of them having passed the query's filters when it
+        /// was ranked. Notes written to since may not anymore, so each is tested again before it is returned.
+        std::vector<ScoredNote> notes;
+        /// Whether `notes` holds every match that scores at all, not only the best of them.
+        bool complete = false;
+    };
+
+    using Entry = std::shared_ptr<const Ranking>;
+
+    explicit RankingCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief The ranking cached for `query` as of `version`, or **nullptr**.
+     */
+    [[nodiscard]] auto find(std::string_view query, CommitVersion version) -> Entry;
+
+    /**
+     * @brief Cache `ranking` for `query` as of `version`, replacing whatever was.
+     */
+    void insert(std::string_view query, CommitVersion version, Entry ranking);
+
+    /**
+     * @brief Number of rankings cached.
+     */
+    [[nodiscard]] auto size() const -> std::size_t { return cache_.size(); }
+
+  private:
+    [[nodiscard]] static auto key_of(std::string_view query, CommitVersion version) -> std::string;
+
+    LruCache<std::string, Entry> cache_;
+};
+
+}  // namespace pg::store
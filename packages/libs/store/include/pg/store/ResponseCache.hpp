@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <pg/store/IdGenerator.hpp>
+#include <pg/store/Mvcc.hpp>
+#include <pg/store/NoteRecord.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+class NoteStore;
+
+/**
+ * @brief A bounded, thread safe cache of encoded `GetNoteResponse`s, keyed by note id and the commit version that
+ * produced the note's state, so a response is only ever served for exactly the state it was encoded from.
+ *
+ * Split into shards by id, each with its own lock and an equal share of the capacity, and evicting with the CLOCK
+ * algorithm: a hit only sets an entry's reference bit, and the hand sweeps past (and clears) referenced entries until
+ * it finds one that was not used since its last sweep. Responses are handed out as shared, immutable buffers, so a hit
+ * copies nothing and evicting an entry only drops the cache's reference to it.
+ *
+ * Pass `erase` to the store as `StoreOptions::on_change` so a note's response is dropped as soon as the note is
+ * written to. Otherwise a stale response is never served (its version no longer matches) but stays cached, taking up
+ * room, until it is replaced or evicted.
+ */
+class ResponseCache {
+  public:
+    using Buffer = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    constexpr static std::size_t DEFAULT_SHARDS = 16;
+
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        /// Encoded bytes cached.
+        std::size_t bytes = 0;
+        std::size_t entries = 0;
+
+        [[nodiscard]] auto hit_rate() const noexcept -> double {
+            const auto lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+        }
+    };
+
+    /**
+     * @param capacity Encoded bytes to keep, split evenly between the shards
+     * @param shards Number of shards; at least one
+     */
+    explicit ResponseCache(std::size_t capacity, std::size_t shards = DEFAULT_SHARDS);
+
+    /**
+     * @brief The response encoded for note `id` at `version`, or **nullptr** if it is not cached (or was cached for
+     * another version).
+     */
+    [[nodiscard]] auto find(NoteId id, CommitVersion version) -> Buffer;
+
+    /**
+     * @brief Cache `response` as the one for note `id` at `version`, replacing any cached for another version. A
+     * response larger than a shard's capacity is not cached.
+     */
+    void insert(NoteId id, CommitVersion version, Buffer response);
+
+    /**
+     * @brief Drop whatever is cached for note `id`.
+     */
+    void erase(NoteId id);
+
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return shard_capacity_ * shards_.size(); }
+    /**
+     * @brief Totals over every shard, each read under its own lock.
+     */
+    [[nodiscard]] auto stats() const -> Stats;
+
+  private:
+    struct Slot {
+        NoteId id {};
+        CommitVersion version = 0;
+        Buffer response;
+        bool referenced = false;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        /// The slot of each cached id.
+        phmap::flat_hash_map<NoteId, std::size_t, NoteIdHash> slots_of;
+        std::vector<Slot> slots;
+        std::size_t hand = 0;
+        std::size_t bytes = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+    [[nodiscard]] auto shard_of(const NoteId& id) -> Shard&;
+    /**
+     * @brief Drop `slot`, moving the last slot into its place. Call with the shard's lock held.
+     */
+    static void remove(Shard& shard, std::size_t slot);
+
+    std::size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+/**
+ * @brief Answer a serialized `GetNoteRequest` against the latest commit of `store`, serving the encoded
+ * `GetNoteResponse` out of `cache` when the note has not changed since it was encoded.
+ *
+ * Errors (a malformed request, or no note with the id) are encoded as a `ResponseError` and never cached; a note found
+ * missing is dropped from the cache. Cache hits do not count as reads of the note for `NoteStore::compress_cold`, since
+ * the cache holds the response anyway.
+ */
+[[nodiscard]] auto serve_get_note(const NoteStore& store, ResponseCache& cache, std::span<const std::uint8_t> request)
+  -> ResponseCache::Buffer;
+
+}  // namespace pg::store
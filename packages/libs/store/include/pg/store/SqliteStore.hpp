@@ -0,0 +1,106 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <pg/data/NoteDto.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/Query.hpp>
+
+namespace pg::store {
+
+struct SqliteOptions {
+    /**
+     * @brief Sync on every commit (`synchronous = FULL`). Off, commits are durable once SQLite checkpoints its WAL
+     * (`synchronous = NORMAL`), which survives a crash of the process but not of the machine.
+     */
+    bool sync = false;
+    /**
+     * @brief Source of `created`/`updated` timestamps. Defaults to `std::chrono::system_clock`.
+     */
+    std::function<Timestamp()> clock;
+};
+
+/**
+ * @brief Notes persisted in an SQLite database through `sqlite_orm`: an embedded, durable alternative to
+ * `DurableStore` for stores that need not fit in memory.
+ *
+ * The database holds a `notes` table keyed by id, with indexes on `(created, id)` and `(updated, id)`, and a
+ * `note_tags` table of `(note_id, position, tag)` rows indexed by tag. It runs in WAL journal mode, and every statement but `search`'s
+ * batched tag lookup is prepared once, on open, and rebound for each use.
+ *
+ * Writes take a span of mutations and apply them in one transaction, so a batch costs one commit however many notes
+ * it touches; a batch is all-or-nothing. One connection is shared by every call, behind a mutex.
+ *
+ * `search` pushes the first predicate it can down to an index (an exact, case-sensitive tag match, or a created or
+ * updated range) and tests the rest against the rows that come back; without such a predicate it scans the table. It
+ * reads a batch of rows at a time, with the tags of the whole batch in one query, and stops once it has `limit` notes.
+ */
+class SqliteStore {
+  public:
+    /**
+     * @brief Open the database at `path`, creating it and its schema if needed.
+     * @return `ErrorCode::Internal` if SQLite fails
+     */
+    static auto open(const std::filesystem::path& path, SqliteOptions options = {})
+      -> Result<std::unique_ptr<SqliteStore>>;
+
+    SqliteStore(const SqliteStore&) = delete;
+    auto operator=(const SqliteStore&) -> SqliteStore& = delete;
+    ~SqliteStore();
+
+    /**
+     * @brief Insert new notes, stamping `created` and `updated` with the current time.
+     * @return The ids generated for them, in order
+     */
+    auto create(std::span<const data::CreateNote> notes) -> Result<std::vector<NoteId>>;
+
+    /**
+     * @brief Replace the fields each update carries and bump `updated`.
+     * @return `ErrorCode::NotFound` if an update names no note, in which case none is applied
+     */
+    auto update(std::span<const data::UpdateNote> updates) -> Result<void>;
+
+    /**
+     * @return `ErrorCode::NotFound` if an id names no note, in which case none is removed
+     */
+    auto remove(std::span<const NoteId> ids) -> Result<void>;
+
+    [[nodiscard]] auto get(NoteId id) const -> Result<std::optional<NoteRecord>>;
+
+    /**
+     * @brief The notes matching every predicate of `query`, oldest `created` first (oldest `updated` first when an
+     * updated range is what reaches the index), up to `query.limit`.
+     * @return `ErrorCode::InvalidArgument` if `query` has a cursor, which this store does not support
+     */
+    [[nodiscard]] auto search(const SearchQuery& query) const -> Result<std::vector<NoteRecord>>;
+
+    [[nodiscard]] auto size() const -> Result<std::size_t>;
+
+  private:
+    struct Database;
+
+    SqliteStore(std::unique_ptr<Database> database, SqliteOptions options);
+
+    [[nodiscard]] auto now() const -> Timestamp;
+
+    SqliteOptions options_;
+    mutable std::mutex mutex_;
+    std::unique_ptr<Database> database_;
+};
+
+}  // namespace pg::store
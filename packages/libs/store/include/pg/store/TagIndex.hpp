@@ -0,0 +1,131 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/NoteRecord.hpp>
+#include <pg/store/Query.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief A tag and the number of notes in some set carrying it, from `TagIndex::facets`.
+ */
+struct TagFacet {
+    std::string tag;
+    std::size_t count = 0;
+
+    friend auto operator==(const TagFacet&, const TagFacet&) -> bool = default;
+};
+
+/**
+ * @brief Map from every distinct tag to the bitmap of notes carrying it.
+ *
+ * Tags are few and short compared to notes, so `NoteTagSearch` predicates other than a case sensitive exact match
+ * are answered by testing every distinct tag and or-ing the bitmaps of the ones that match.
+ */
+class TagIndex {
+  public:
+    /**
+     * @brief Tags a `facets` thread claims at a time.
+     */
+    constexpr static std::size_t FACET_CHUNK = 64;
+
+    /**
+     * @brief Collects the tags of many notes for `build`. Each thread reading notes fills a builder of its own.
+     */
+    class Builder {
+      public:
+        /**
+         * @brief Collect the tags of `ordinal`, which no builder passed to the same `build` may hold too.
+         */
+        void add(NoteOrdinal ordinal, const TagList& tags);
+
+      private:
+        friend class TagIndex;
+
+        /// The notes carrying each tag, in the order they were added.
+        phmap::flat_hash_map<std::string, std::vector<NoteOrdinal>> tags_;
+    };
+
+    /**
+     * @brief The index of every note collected in `parts`, which are left empty. Each tag's notes are gathered from
+     * every part and sorted, then set on its bitmap in one pass.
+     */
+    [[nodiscard]] static auto build(std::span<Builder> parts) -> TagIndex;
+
+    void add(NoteOrdinal ordinal, const TagList& tags);
+    void remove(NoteOrdinal ordinal, const TagList& tags);
+    void update(NoteOrdinal ordinal, const TagList& before, const TagList& after);
+
+    /**
+     * @brief Drop the notes in `dead` from every tag, erasing tags left without notes.
+     */
+    void purge(const Bitmap& dead);
+
+    /**
+     * @brief Notes with at least one tag satisfying `predicate`.
+     */
+    [[nodiscard]] auto lookup(const TextPredicate& predicate) const -> Bitmap;
+
+    /**
+     * @brief Upper bound on `lookup(predicate).count()`, computed from per-tag counts without touching any bitmap.
+     */
+    [[nodiscard]] auto estimate(const TextPredicate& predicate) const -> std::size_t;
+
+    /**
+     * @brief The `limit` tags carried by the most notes in `notes`, most first and ties by tag, leaving out tags none
+     * of them carry.
+     *
+     * Each count is the popcount of `notes` and-ed with the tag's bitmap, which builds no intersection. Tags are
+     * counted most used first, since a tag's note count bounds its facet count: once it falls below the `limit`th best
+     * count found so far, neither it nor any tag after it can make the cut, and counting stops. With `threads` above
+     * one, the tags are split into chunks of `FACET_CHUNK` that the threads claim in that order, each keeping its own
+     * best `limit`, and sharing the highest `limit`th best count any of them has found to stop by.
+     */
+    [[nodiscard]] auto facets(const Bitmap& notes, std::size_t limit, std::size_t threads = 1) const
+      -> std::vector<TagFacet>;
+
+    /**
+     * @brief The notes tagged exactly `tag`, or **nullptr** if no note is.
+     */
+    [[nodiscard]] auto notes_with(std::string_view tag) const -> const Bitmap*;
+
+    /**
+     * @brief Number of distinct tags.
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return tags_.size(); }
+
+    /**
+     * @brief Call `fn(tag, notes, count)` for every distinct tag, in no particular order.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& [tag, posting] : tags_) {
+            fn(std::string_view { tag }, posting.notes, posting.count);
+        }
+    }
+
+  private:
+    struct Posting {
+        Bitmap notes;
+        std::size_t count = 0;
+    };
+
+    phmap::flat_hash_map<std::string, Posting> tags_;
+};
+
+}  // namespace pg::store
@@ -0,0 +1,252 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/store/Query.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief Okapi BM25 parameters, applied to titles and content separately and summed.
+ */
+struct Bm25 {
+    /// How quickly repeating a term stops adding to a note's score.
+    double k1 = 1.2;
+    /// How much a field longer than average is penalised, from 0 (not at all) to 1 (in proportion).
+    double b = 0.75;
+    /// Weight of a title's score against its content's.
+    double title_boost = 2.0;
+};
+
+/**
+ * @brief One note and its score against a query, from `TermIndex::top`.
+ */
+struct ScoredNote {
+    NoteOrdinal ordinal;
+    double score;
+};
+
+/**
+ * @brief Inverted index from every word of the titles and content to the notes using it, with how often they do, for
+ * ranking matches by relevance.
+ *
+ * A word is a run of ASCII letters and digits, or of non-ASCII bytes (so UTF-8 characters stay inside their word),
+ * with ASCII letters folded; it is indexed by a 64-bit hash of its bytes. Each posting holds the number of times the
+ * word appears in the note's title and in its content, and the index keeps every note's field lengths in words,
+ * which are all BM25 needs. Each word also keeps the highest count any note ever had in each field, which bounds what
+ * the word can add to a score and lets `top` skip notes that could not make it in.
+ *
+ * The store keeps one of these unless `StoreOptions::index_terms` is off.
+ */
+class TermIndex {
+  public:
+    using Term = std::uint64_t;
+
+    enum class Field : std::uint8_t { Title, Content };
+
+    /**
+     * @brief A term and how many times a text uses it.
+     */
+    struct TermCount {
+        Term term;
+        std::uint32_t count;
+    };
+
+    /**
+     * @brief What re-indexing one field of a note changes, computed apart from the index so that writers can work it
+     * out before taking the index lock.
+     */
+    struct Delta {
+        Field field = Field::Title;
+        /// The new count of every term whose count changed, zero for terms the field no longer uses.
+        std::vector<TermCount> counts;
+        /// Words in the new text.
+        std::uint32_t length = 0;
+    };
+
+    /**
+     * @brief What `top` found.
+     */
+    struct Ranking {
+        /// Best first, ties broken by ordinal.
+        std::vector<ScoredNote> notes;
+        /// Notes whose score was computed in full. The rest were skipped on their upper bound alone.
+        std::size_t scored = 0;
+        /// Of those, notes handed to `accept`.
+        std::size_t tested = 0;
+    };
+
+    /**
+     * @brief Collects the terms of many notes for `build`, as `TrigramIndex::Builder` does their trigrams. Each thread
+     * reading notes fills a builder of its own.
+     */
+    class Builder {
+      public:
+        /**
+         * @param shards How many parts `build` splits the terms into, to sort on separate threads
+         */
+        explicit Builder(std::size_t shards = 1);
+
+        /**
+         * @brief Collect the fields of `ordinal`, which no builder passed to the same `build` may hold too.
+         */
+        void add(NoteOrdinal ordinal, std::string_view title, std::string_view content);
+
+      private:
+        friend class TermIndex;
+
+        struct Entry {
+            Term term;
+            NoteOrdinal ordinal;
+            std::uint16_t title;
+            std::uint16_t content;
+        };
+
+        /// Every word of every note, counted once in the field it is in, split by `term % shards`. `build` adds up the
+        /// entries of each note and term, which the sort brings together.
+        std::vector<std::vector<Entry>> shards_;
+        std::vector<std::pair<NoteOrdinal, std::pair<std::uint32_t, std::uint32_t>>> lengths_;
+    };
+
+    /**
+     * @brief The index of every note collected in `parts`, which are left empty. Each shard radix sorts its postings
+     * by term, as `TrigramIndex::build` does, and lays out each posting list (and its highest counts) in one pass over
+     * a run of them; the shards are claimed by up to `threads` threads. All parts must have been made with the same
+     * number of shards.
+     */
+    [[nodiscard]] static auto build(std::span<Builder> parts, std::size_t threads) -> TermIndex;
+
+    /**
+     * @brief The distinct terms of `text`, sorted ascending, with their counts.
+     */
+    [[nodiscard]] static auto terms_of(std::string_view text) -> std::vector<TermCount>;
+
+    void add(NoteOrdinal ordinal, std::string_view title, std::string_view content);
+
+    /**
+     * @brief Re-index `field` of a note whose text changed from `before` to `after`.
+     */
+    void update(NoteOrdinal ordinal, Field field, std::string_view before, std::string_view after);
+
+    /**
+     * @brief The changes `update(ordinal, field, before, after)` would make. Touches no index.
+     */
+    [[nodiscard]] static auto diff(Field field, std::string_view before, std::string_view after) -> Delta;
+
+    /**
+     * @brief Re-index a note by a `Delta` from `diff`.
+     */
+    void apply(NoteOrdinal ordinal, const Delta& delta);
+
+    /**
+     * @brief Every term with a posting list, in no particular order.
+     */
+    [[nodiscard]] auto terms() const -> std::vector<Term>;
+
+    /**
+     * @brief Drop the notes in `dead` from the posting lists of `terms`, erasing lists left empty. As with
+     * `TrigramIndex::purge`, `forget(dead)` finishes the job once every list has been purged.
+     */
+    void purge(std::span<const Term> terms, const Bitmap& dead);
+
+    /**
+     * @brief Stop counting the notes in `dead` as indexed, and their words towards the average field lengths.
+     */
+    void forget(const Bitmap& dead);
+
+    /**
+     * @brief The `k` best scoring notes for `query`, the distinct terms of a query as from `terms_of`, found with the
+     * WAND algorithm.
+     *
+     * Postings are walked in ordinal order, one cursor per distinct query term. A note is only scored in full once the
+     * upper bounds of the terms it could contain add up to more than the `k`th best score found so far; every note
+     * before it is skipped. Each note that would make it into the top `k` is passed to `accept` first, which can still
+     * turn it down (for the predicates a search has besides its text). Notes that use none of the terms are never
+     * seen.
+     * @param accept Called with each candidate and its score; returns whether it counts
+     */
+    [[nodiscard]] auto top(
+      std::span<const TermCount> query,
+      std::size_t k,
+      const Bm25& parameters,
+      const std::function<bool(const ScoredNote&)>& accept) const -> Ranking;
+
+    /**
+     * @brief `top`, scoring against `stats` (as from `stats(query)`, possibly long ago) rather than the index as it
+     * stands, so that a note scores the same as it did then for as long as it is not rewritten.
+     */
+    [[nodiscard]] auto top(
+      std::span<const TermCount> query,
+      std::size_t k,
+      const Bm25& parameters,
+      const RankingStats& stats,
+      const std::function<bool(const ScoredNote&)>& accept) const -> Ranking;
+
+    /**
+     * @brief What `top` scores `query` against as of now.
+     */
+    [[nodiscard]] auto stats(std::span<const TermCount> query) const -> RankingStats;
+
+    /**
+     * @brief Whether the note at `ordinal` uses any of `terms`, i.e. whether `top` would give it a score.
+     */
+    [[nodiscard]] auto contains_any(NoteOrdinal ordinal, std::span<const TermCount> terms) const -> bool;
+
+    /**
+     * @brief Every note that has been added (and not forgotten).
+     */
+    [[nodiscard]] auto indexed() const noexcept -> const Bitmap& { return indexed_; }
+
+    /**
+     * @brief Number of distinct terms currently indexed.
+     */
+    [[nodiscard]] auto term_count() const noexcept -> std::size_t { return postings_.size(); }
+
+  private:
+    struct Posting {
+        NoteOrdinal ordinal;
+        std::uint16_t title;
+        std::uint16_t content;
+    };
+
+    struct Postings {
+        /// Sorted by ordinal.
+        std::vector<Posting> list;
+        /// The highest counts any note was ever added with. Never lowered, so only ever an upper bound.
+        std::uint16_t max_title = 0;
+        std::uint16_t max_content = 0;
+    };
+
+    struct Lengths {
+        std::uint32_t title = 0;
+        std::uint32_t content = 0;
+    };
+
+    void set_count(Term term, NoteOrdinal ordinal, Field field, std::uint32_t count);
+    void set_length(NoteOrdinal ordinal, Field field, std::uint32_t length);
+
+    phmap::flat_hash_map<Term, Postings> postings_;
+    std::vector<Lengths> lengths_;
+    /// Sums of `lengths_`, for the average field lengths.
+    std::uint64_t title_words_ = 0;
+    std::uint64_t content_words_ = 0;
+    Bitmap indexed_;
+};
+
+}  // namespace pg::store
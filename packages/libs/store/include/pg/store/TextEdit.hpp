@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <pg/store/Error.hpp>
+#include <pg/store/NoteRecord.hpp>
+
+namespace pg::store {
+
+class PatternCache;
+
+struct AppendText {
+    std::string text;
+};
+
+struct PrependText {
+    std::string text;
+};
+
+struct InsertText {
+    std::size_t position = 0;
+    std::string text;
+};
+
+/**
+ * @brief Remove the half-open range `[start, end)`.
+ */
+struct RemoveTextRange {
+    std::size_t start = 0;
+    std::size_t end = 0;
+};
+
+/**
+ * @brief Replace every occurrence of `search`, scanning left to right without overlaps.
+ */
+struct ReplaceText {
+    std::string search;
+    std::string replace;
+};
+
+/**
+ * @brief Replace every occurrence of each pair's `search`, all in one left to right scan: where matches overlap, the
+ * one starting first wins, then the longest, and replacements are never matched again. A search listed twice uses its
+ * first replacement.
+ */
+struct ReplaceTextMultiple {
+    std::vector<ReplaceText> pairs;
+};
+
+/**
+ * @brief Remove every occurrence of `removal`.
+ */
+struct RemoveText {
+    std::string removal;
+};
+
+/**
+ * @brief Remove every occurrence of each of `removals`, matched like `ReplaceTextMultiple`.
+ */
+struct RemoveTextMultiple {
+    std::vector<std::string> removals;
+};
+
+/**
+ * @brief A decoded `pg.gen.TextModificationKind`.
+ */
+using TextEdit = std::variant<
+  AppendText,
+  PrependText,
+  InsertText,
+  RemoveTextRange,
+  ReplaceText,
+  ReplaceTextMultiple,
+  RemoveText,
+  RemoveTextMultiple>;
+
+/**
+ * @brief A decoded `pg.gen.UpdateNoteData`: edits to apply, in order, to each field of one note. A field without
+ * edits is left alone.
+ */
+struct NoteEdit {
+    NoteId id;
+    std::vector<TextEdit> title;
+    std::vector<TextEdit> content;
+    std::vector<TextEdit> tags;
+};
+
+/**
+ * @brief Apply `edits` to `text` in order. Positions are byte offsets.
+ *
+ * The edits are applied to a `PieceTable` over `text`, which is only flattened back into `text` once they all have,
+ * so a positional edit costs O(log edits) rather than a copy of the tail of the text. Replacements and removals scan
+ * the whole text regardless, and flatten it first; the multi-pattern ones match all their patterns in one scan, with
+ * a `PatternSet` compiled once per pattern list and kept in `pattern_cache()`.
+ * @return `ErrorCode::InvalidArgument` if a position or range lies outside the text or a search string is empty, in
+ * which case `text` is left unchanged
+ */
+auto apply_edits(std::string& text, std::span<const TextEdit> edits) -> Result<void>;
+
+/**
+ * @brief Apply `edits` to a tag list, treating each tag as one element: appending, prepending and inserting add a tag
+ * (at the end, the front, or before index `position`), a range removes the tags at `[start, end)`, a replacement
+ * renames every tag equal to `search` (to the first matching pair's `replace`, for multiple ones), and a removal drops
+ * every tag equal to it.
+ * @return `ErrorCode::InvalidArgument` under the same conditions as `apply_edits`
+ */
+auto apply_tag_edits(std::vector<std::string>& tags, std::span<const TextEdit> edits) -> Result<void>;
+
+/**
+ * @brief The process-wide cache of the automata `apply_edits` compiles for `ReplaceTextMultiple` and
+ * `RemoveTextMultiple`.
+ */
+auto pattern_cache() -> PatternCache&;
+
+}  // namespace pg::store
@@ -0,0 +1,208 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <pg/store/Bitmap.hpp>
+#include <pg/store/Common.hpp>
+#include <pg/util/text_search.hpp>
+
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+
+/**
+ * @brief A scored result of `TrigramIndex::fuzzy`.
+ */
+struct FuzzyMatch {
+    NoteOrdinal ordinal;
+    /**
+     * @brief Jaccard similarity of the query and note trigram sets, in `(0, 1]`.
+     */
+    double score;
+};
+
+/**
+ * @brief Inverted index from every 3-byte window of a text to the notes containing it.
+ *
+ * Any substring of at least three bytes can only occur in a note that contains all of its trigrams, so a lookup
+ * narrows `TextContainsQuery` (and starts/ends-with) down to a small candidate set even when the fragment falls in the
+ * middle of a word. Candidates are then verified with the `pg::util::text` kernels. Texts are indexed with ASCII
+ * letters folded, so the same index serves case sensitive and insensitive queries.
+ *
+ * The store keeps one of these for titles and, optionally, one for content.
+ */
+class TrigramIndex {
+  public:
+    using Trigram = std::uint32_t;
+
+    /**
+     * @brief What `update` changes for one note, computed apart from the index so that writers can work it out
+     * before taking the index lock.
+     */
+    struct Delta {
+        std::vector<Trigram> removed;
+        std::vector<Trigram> added;
+        /// Distinct trigrams of the new text.
+        std::size_t count = 0;
+    };
+
+    /**
+     * @brief Collects the trigrams of many notes for `build`, which sorts them into a whole index at once, far faster
+     * than adding the notes one at a time. Each thread reading notes fills a builder of its own.
+     */
+    class Builder {
+      public:
+        /**
+         * @param shards How many parts `build` splits the trigrams into, to sort on separate threads
+         */
+        explicit Builder(std::size_t shards = 1);
+
+        /**
+         * @brief Collect `text` as the text of `ordinal`, which no builder passed to the same `build` may hold too.
+         */
+        void add(NoteOrdinal ordinal, std::string_view text);
+
+      private:
+        friend class TrigramIndex;
+
+        /// `trigram << 32 | ordinal` of every posting, split by `trigram % shards`.
+        std::vector<std::vector<std::uint64_t>> shards_;
+        /// Distinct trigrams per note added.
+        std::vector<std::pair<NoteOrdinal, std::uint32_t>> counts_;
+        /// One bit per trigram, set for those of the note being added, so that a note's trigrams are told apart without
+        /// sorting them. Allocated by the first `add`.
+        std::vector<std::uint64_t> seen_;
+        /// The trigrams of the note being added, to clear from `seen_` once it is.
+        std::vector<Trigram> note_;
+    };
+
+    /**
+     * @brief The index of every note collected in `parts`, which are left empty.
+     *
+     * Each shard gathers its postings from every part and radix sorts them by trigram, so that each posting list is
+     * laid out by one pass over a run of the sorted keys. The sort is stable: with each part's notes added in ordinal
+     * order, and the parts in ordinal order too, every run is already in ordinal order; otherwise the runs are sorted
+     * as well. The shards are claimed by up to `threads` threads. All parts must have been made with the same number of
+     * shards.
+     */
+    [[nodiscard]] static auto build(std::span<Builder> parts, std::size_t threads) -> TrigramIndex;
+
+    /**
+     * @brief The distinct, case-folded trigrams of `text`, sorted ascending.
+     */
+    [[nodiscard]] static auto trigrams_of(std::string_view text) -> std::vector<Trigram>;
+
+    void add(NoteOrdinal ordinal, std::string_view text);
+    void remove(NoteOrdinal ordinal, std::string_view text);
+
+    /**
+     * @brief Re-index a note whose text changed from `before` to `after`, touching only the trigrams that differ.
+     *
+     * This is the path taken when `UpdateNoteData::title_mods` are applied, where most edits only change a handful
+     * of trigrams.
+     */
+    void update(NoteOrdinal ordinal, std::string_view before, std::string_view after);
+
+    /**
+     * @brief The trigrams `update(ordinal, before, after)` would remove and add. Touches no index.
+     */
+    [[nodiscard]] static auto diff(std::string_view before, std::string_view after) -> Delta;
+
+    /**
+     * @brief Re-index a note by a `Delta` from `diff`.
+     */
+    void apply(NoteOrdinal ordinal, const Delta& delta);
+
+    /**
+     * @brief Every trigram with a posting list, in no particular order.
+     */
+    [[nodiscard]] auto trigrams() const -> std::vector<Trigram>;
+
+    /**
+     * @brief Drop the notes in `dead` from the posting lists of `trigrams`, erasing lists left empty.
+     *
+     * Lets a large purge be split into batches of trigrams, each short enough not to hold up readers for long. Once
+     * every list has been purged, `forget(dead)` finishes the job.
+     */
+    void purge(std::span<const Trigram> trigrams, const Bitmap& dead);
+
+    /**
+     * @brief Stop counting the notes in `dead` as indexed.
+     */
+    void forget(const Bitmap& dead);
+
+    /**
+     * @brief Notes that contain every trigram of `fragment`: a superset of the notes containing `fragment`.
+     * @return The candidate bitmap, or `std::nullopt` if `fragment` is too short to narrow anything down (in which
+     * case every indexed note is a candidate).
+     */
+    [[nodiscard]] auto candidates(std::string_view fragment) const -> std::optional<Bitmap>;
+
+    /**
+     * @brief Upper bound on the size of `candidates(fragment)`: the length of its rarest trigram's posting list.
+     * @return The bound, or `std::nullopt` if `fragment` is too short to use the index.
+     */
+    [[nodiscard]] auto estimate(std::string_view fragment) const -> std::optional<std::size_t>;
+
+    /**
+     * @brief Notes whose text contains `fragment`, using the index for candidates and `text_of(ordinal)` to verify.
+     * @param fragment The text to look for
+     * @param case_sensitive Whether ASCII letters must match case
+     * @param text_of Callable returning the indexed text (as something convertible to `std::string_view`) of a note
+     */
+    template <typename TextOf>
+    [[nodiscard]] auto find(std::string_view fragment, bool case_sensitive, TextOf&& text_of) const -> Bitmap {
+        auto result = candidates(fragment).value_or(indexed_);
+        result.retain([&](NoteOrdinal ordinal) {
+            return pg::util::text::contains(std::string_view { text_of(ordinal) }, fragment, case_sensitive);
+        });
+        return result;
+    }
+
+    /**
+     * @brief Typo tolerant search: notes ranked by how many trigrams they share with `query`.
+     * @param query The (possibly misspelled) text to look for
+     * @param min_score Matches scoring below this are dropped
+     * @param limit Maximum number of matches to return
+     * @return Matches sorted by descending score, ties broken by ordinal
+     */
+    [[nodiscard]] auto fuzzy(std::string_view query, double min_score = 0.3, std::size_t limit = 10) const
+      -> std::vector<FuzzyMatch>;
+
+    /**
+     * @brief Every note that has been added (and not removed).
+     */
+    [[nodiscard]] auto indexed() const noexcept -> const Bitmap& { return indexed_; }
+
+    /**
+     * @brief Number of distinct trigrams currently indexed.
+     */
+    [[nodiscard]] auto trigram_count() const noexcept -> std::size_t { return postings_.size(); }
+
+  private:
+    using Postings = std::vector<NoteOrdinal>;
+
+    void insert_posting(Trigram trigram, NoteOrdinal ordinal);
+    void erase_posting(Trigram trigram, NoteOrdinal ordinal);
+    void set_trigram_count(NoteOrdinal ordinal, std::size_t count);
+
+    /// Sorted ordinals per trigram. Ordinals are handed out in increasing order, so inserts are almost always appends.
+    phmap::flat_hash_map<Trigram, Postings> postings_;
+    /// Number of distinct trigrams per note, needed to normalise fuzzy scores.
+    std::vector<std::uint32_t> trigram_counts_;
+    Bitmap indexed_;
+};
+
+}  // namespace pg::store
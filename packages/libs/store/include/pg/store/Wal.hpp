@@ -0,0 +1,196 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <pg/store/Common.hpp>
+#include <pg/store/Error.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/Mvcc.hpp>
+
+namespace pg::store {
+
+/**
+ * @brief Which request a log frame carries.
+ */
+enum class FrameKind : std::uint8_t {
+    /// A serialized `pg.gen.CreateNoteRequest`, always with its `id` set.
+    Create = 1,
+    /// A serialized `pg.gen.UpdateNoteRequest`.
+    Update = 2,
+    /// A serialized `pg.gen.DeleteNoteRequest`.
+    Delete = 3,
+    /// A serialized `pg.gen.UpdateNotesRequest`, applied as one batch.
+    UpdateMany = 4,
+    /// A serialized `pg.gen.DeleteNotesRequest`, applied as one batch.
+    DeleteMany = 5,
+};
+
+struct WalFrame {
+    FrameKind kind = FrameKind::Create;
+    /**
+     * @brief The store's commit version once the frame has been applied.
+     */
+    CommitVersion version = 0;
+    /**
+     * @brief The time the mutation was stamped with, so that replay reproduces `created` and `updated` exactly.
+     */
+    Timestamp timestamp {};
+    std::span<const std::uint8_t> payload;
+};
+
+struct WalOptions {
+    /**
+     * @brief How long a batch stays open for more commits after the first one arrives; the most group commit adds to
+     * a commit's latency. Zero syncs whatever is pending immediately, which still batches everything that arrives
+     * while the previous sync is running.
+     */
+    std::chrono::microseconds max_delay { 200 };
+    /**
+     * @brief Close the batch early once this many commits are waiting.
+     */
+    std::size_t max_batch_commits = 256;
+    /**
+     * @brief Close the batch early once this many bytes are waiting.
+     */
+    std::size_t max_batch_bytes = std::size_t { 4 } << 20;
+    /**
+     * @brief `fdatasync` every batch. Only worth turning off to measure batching itself.
+     */
+    bool sync = true;
+};
+
+struct WalStats {
+    std::uint64_t commits = 0;
+    std::uint64_t batches = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t largest_batch = 0;
+};
+
+struct ReplayStats {
+    std::size_t frames = 0;
+    /**
+     * @brief Length of the intact prefix of the log.
+     */
+    std::uint64_t valid_bytes = 0;
+    /**
+     * @brief Bytes of torn or corrupt frames cut off the end.
+     */
+    std::uint64_t discarded_bytes = 0;
+};
+
+/**
+ * @brief Log sequence number: the offset in the log just past a frame.
+ */
+using Lsn = std::uint64_t;
+
+/**
+ * @brief Append-only, group-committed write-ahead log.
+ *
+ * The file starts with an 8 byte magic, followed by frames of
+ *
+ *     u32 length | u32 crc32c | u8 kind | u64 version | i64 timestamp (ns) | payload
+ *
+ * all little-endian, where `length` counts everything after the checksum and the checksum covers the same bytes.
+ *
+ * `append` only copies a frame into the open batch. A background thread writes each batch with a single `write` and
+ * `fdatasync`, after waiting up to `WalOptions::max_delay` for more commits to join; `wait` blocks a committer until
+ * its frame is durable. While one batch is being synced the next one fills up, so under load every sync carries many
+ * commits. If a write or sync fails, that and every later commit fails: the log's tail is unknown.
+ */
+class WriteAheadLog {
+  public:
+    constexpr static std::array<std::uint8_t, 8> MAGIC { 'P', 'G', 'W', 'A', 'L', 0, 0, 1 };
+    constexpr static std::size_t FRAME_HEADER = 4 + 4 + 1 + 8 + 8;
+
+    /**
+     * @brief Open the log at `path` for appending, creating it if needed. An existing log should be replayed first,
+     * which also cuts off any torn tail.
+     */
+    static auto open(const std::filesystem::path& path, WalOptions options = {})
+      -> Result<std::unique_ptr<WriteAheadLog>>;
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    auto operator=(const WriteAheadLog&) -> WriteAheadLog& = delete;
+    /**
+     * @brief Makes everything appended so far durable.
+     */
+    ~WriteAheadLog();
+
+    /**
+     * @brief Add `frame` to the open batch. Never waits for IO; frames reach the file in the order they are appended.
+     */
+    auto append(const WalFrame& frame) -> Lsn;
+
+    /**
+     * @brief Block until every frame up to `lsn` is durable.
+     */
+    auto wait(Lsn lsn) -> Result<void>;
+
+    auto commit(const WalFrame& frame) -> Result<void> { return wait(append(frame)); }
+
+    [[nodiscard]] auto stats() const -> WalStats;
+    [[nodiscard]] auto path() const noexcept -> const std::filesystem::path& { return file_.path(); }
+
+  private:
+    WriteAheadLog(File file, Lsn end, WalOptions options);
+
+    void run(std::stop_token stop);
+
+    File file_;
+    WalOptions options_;
+
+    mutable std::mutex mutex_;
+    /// Wakes the flusher when a batch opens or fills up.
+    std::condition_variable_any work_;
+    /// Wakes committers when a batch becomes durable.
+    std::condition_variable durable_cv_;
+    std::vector<std::uint8_t> batch_;
+    std::size_t batch_commits_ = 0;
+    std::chrono::steady_clock::time_point batch_opened_;
+    Lsn appended_;
+    Lsn durable_;
+    std::optional<StoreError> failure_;
+    WalStats stats_;
+
+    std::jthread flusher_;
+};
+
+/**
+ * @brief Hand the intact frames of the log at `path` to `visit`, in order, until it returns **false**. Read only, so
+ * safe on a log that is still being appended to: a frame not completely written yet ends the log, as a torn one
+ * would.
+ * @return What was read, the first error `visit` returned, or `ErrorCode::DataLoss` if the file is not a log.
+ * `discarded_bytes` counts what follows the intact frames, unless `visit` stopped early
+ */
+auto read_wal(const std::filesystem::path& path, const std::function<Result<bool>(const WalFrame&)>& visit)
+  -> Result<ReplayStats>;
+
+/**
+ * @brief Hand every intact frame of the log at `path` to `apply`, in order.
+ *
+ * A frame that is cut short or fails its checksum ends the log: that is what a crash in the middle of a write leaves
+ * behind. Everything from there on is cut off the file so that appending can resume. A missing file is an empty log.
+ * @return What was replayed, the first error `apply` returned, or `ErrorCode::DataLoss` if the file is not a log
+ */
+auto replay_wal(const std::filesystem::path& path, const std::function<Result<void>(const WalFrame&)>& apply)
+  -> Result<ReplayStats>;
+
+}  // namespace pg::store
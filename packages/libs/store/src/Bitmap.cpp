@@ -0,0 +1,114 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+
+#include <pg/store/Bitmap.hpp>
+
+namespace pg::store {
+
+auto Bitmap::filled(std::size_t bits) -> Bitmap {
+    auto out = Bitmap { bits };
+    std::ranges::fill(out.words_, ~Word { 0 });
+    if (const auto tail = bits % WORD_BITS; tail != 0) {
+        out.words_.back() = (Word { 1 } << tail) - 1;
+    }
+    return out;
+}
+
+auto Bitmap::from_ordinals(std::span<const NoteOrdinal> ordinals) -> Bitmap {
+    auto out = Bitmap {};
+    if (!ordinals.empty()) {
+        out.words_.resize(*std::ranges::max_element(ordinals) / WORD_BITS + 1, 0);
+    }
+    for (auto ordinal : ordinals) {
+        out.words_[ordinal / WORD_BITS] |= bit_of(ordinal);
+    }
+    return out;
+}
+
+auto Bitmap::count() const noexcept -> std::size_t {
+    std::size_t total = 0;
+    for (auto word : words_) {
+        total += static_cast<std::size_t>(std::popcount(word));
+    }
+    return total;
+}
+
+auto Bitmap::empty() const noexcept -> bool {
+    return std::ranges::all_of(words_, [](Word word) { return word == 0; });
+}
+
+auto Bitmap::intersect_count(const Bitmap& other) const noexcept -> std::size_t {
+    const auto len = std::min(words_.size(), other.words_.size());
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < len; ++i) {
+        total += static_cast<std::size_t>(std::popcount(words_[i] & other.words_[i]));
+    }
+    return total;
+}
+
+auto Bitmap::next(NoteOrdinal from) const noexcept -> NoteOrdinal {
+    auto w = static_cast<std::size_t>(from) / WORD_BITS;
+    if (w >= words_.size()) {
+        return npos;
+    }
+    auto word = words_[w] & (~Word { 0 } << (from % WORD_BITS));
+    while (true) {
+        if (word != 0) {
+            return static_cast<NoteOrdinal>(w * WORD_BITS + static_cast<std::size_t>(std::countr_zero(word)));
+        }
+        if (++w >= words_.size()) {
+            return npos;
+        }
+        word = words_[w];
+    }
+}
+
+auto Bitmap::to_ordinals() const -> std::vector<NoteOrdinal> {
+    auto out = std::vector<NoteOrdinal> {};
+    out.reserve(count());
+    for_each([&](NoteOrdinal ordinal) { out.push_back(ordinal); });
+    return out;
+}
+
+auto Bitmap::operator&=(const Bitmap& other) -> Bitmap& {
+    const auto len = std::min(words_.size(), other.words_.size());
+    for (std::size_t i = 0; i < len; ++i) {
+        words_[i] &= other.words_[i];
+    }
+    words_.resize(len);
+    return *this;
+}
+
+auto Bitmap::operator|=(const Bitmap& other) -> Bitmap& {
+    if (other.words_.size() > words_.size()) {
+        words_.resize(other.words_.size(), 0);
+    }
+    for (std::size_t i = 0; i < other.words_.size(); ++i) {
+        words_[i] |= other.words_[i];
+    }
+    return *this;
+}
+
+auto Bitmap::subtract(const Bitmap& other) -> Bitmap& {
+    const auto len = std::min(words_.size(), other.words_.size());
+    for (std::size_t i = 0; i < len; ++i) {
+        words_[i] &= ~other.words_[i];
+    }
+    return *this;
+}
+
+auto operator==(const Bitmap& lhs, const Bitmap& rhs) noexcept -> bool {
+    const auto& shorter = lhs.words_.size() < rhs.words_.size() ? lhs.words_ : rhs.words_;
+    const auto& longer = lhs.words_.size() < rhs.words_.size() ? rhs.words_ : lhs.words_;
+    return std::equal(shorter.begin(), shorter.end(), longer.begin())
+        && std::all_of(longer.begin() + static_cast<std::ptrdiff_t>(shorter.size()), longer.end(), [](auto word) {
+               return word == 0;
+           });
+}
+
+}  // namespace pg::store
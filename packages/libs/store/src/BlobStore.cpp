@@ -0,0 +1,143 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#include <pg/store/BlobStore.hpp>
+
+namespace pg::store {
+
+namespace {
+    constexpr std::uint64_t C1 = 0x87C37B91114253D5ULL;
+    constexpr std::uint64_t C2 = 0x4CF5AD432745937FULL;
+
+    auto load64(const char* bytes) noexcept -> std::uint64_t {
+        auto value = std::uint64_t { 0 };
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    auto fmix64(std::uint64_t k) noexcept -> std::uint64_t {
+        k ^= k >> 33;
+        k *= 0xFF51AFD7ED558CCDULL;
+        k ^= k >> 33;
+        k *= 0xC4CEB9FE1A85EC53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    auto mix_k1(std::uint64_t k1) noexcept -> std::uint64_t {
+        return std::rotl(k1 * C1, 31) * C2;
+    }
+
+    auto mix_k2(std::uint64_t k2) noexcept -> std::uint64_t {
+        return std::rotl(k2 * C2, 33) * C1;
+    }
+}  // namespace
+
+auto hash_content(std::string_view text) noexcept -> ContentHash {
+    const auto* data = text.data();
+    const auto length = text.size();
+    const auto blocks = length / 16;
+    auto h1 = std::uint64_t { 0 };
+    auto h2 = std::uint64_t { 0 };
+
+    for (std::size_t i = 0; i < blocks; ++i) {
+        h1 ^= mix_k1(load64(data + i * 16));
+        h1 = std::rotl(h1, 27) + h2;
+        h1 = h1 * 5 + 0x52DCE729;
+        h2 ^= mix_k2(load64(data + i * 16 + 8));
+        h2 = std::rotl(h2, 31) + h1;
+        h2 = h2 * 5 + 0x38495AB5;
+    }
+
+    // The last `length % 16` bytes, little-endian: the first eight into k1, the rest into k2.
+    const auto* tail = reinterpret_cast<const unsigned char*>(data + blocks * 16);
+    const auto rest = length % 16;
+    auto k1 = std::uint64_t { 0 };
+    auto k2 = std::uint64_t { 0 };
+    for (auto i = rest; i > 8; --i) {
+        k2 |= std::uint64_t { tail[i - 1] } << ((i - 9) * 8);
+    }
+    for (auto i = std::min<std::size_t>(rest, 8); i > 0; --i) {
+        k1 |= std::uint64_t { tail[i - 1] } << ((i - 1) * 8);
+    }
+    if (rest > 8) {
+        h2 ^= mix_k2(k2);
+    }
+    if (rest > 0) {
+        h1 ^= mix_k1(k1);
+    }
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return ContentHash { h1, h2 };
+}
+
+auto BlobStore::intern(std::string text) -> BlobRef {
+    const auto hash = hash_content(text);
+    // Declared before the lock so that, should it turn out to be the last reference, the blob is released after the
+    // mutex is.
+    auto existing = BlobRef {};
+    auto lock = std::unique_lock { mutex_ };
+    auto [it, inserted] = blobs_.try_emplace(hash);
+    existing = it->second.weak.lock();
+    if (existing && existing->text == text) {
+        ++hits_;
+        return existing;
+    }
+
+    auto blob = BlobRef { new Blob { hash, std::move(text) }, [this](const Blob* released) { release(released); } };
+    if (existing) {
+        // A collision: the new body stays out of the store rather than evict the one already there.
+        return blob;
+    }
+    if (!inserted) {
+        // The entry's blob is only waiting for its `release`, which will find this one in its place and leave it be.
+        bytes_ -= it->second.blob->text.size();
+    }
+    it->second = Entry { blob.get(), blob };
+    bytes_ += blob->text.size();
+    return blob;
+}
+
+void BlobStore::release(const Blob* blob) noexcept {
+    {
+        auto lock = std::scoped_lock { mutex_ };
+        auto it = blobs_.find(blob->hash);
+        if (it != blobs_.end() && it->second.blob == blob) {
+            bytes_ -= blob->text.size();
+            blobs_.erase(it);
+        }
+    }
+    delete blob;
+}
+
+auto BlobStore::size() const -> std::size_t {
+    auto lock = std::scoped_lock { mutex_ };
+    return blobs_.size();
+}
+
+auto BlobStore::bytes() const -> std::size_t {
+    auto lock = std::scoped_lock { mutex_ };
+    return bytes_;
+}
+
+auto BlobStore::hits() const -> std::size_t {
+    auto lock = std::scoped_lock { mutex_ };
+    return hits_;
+}
+
+}  // namespace pg::store
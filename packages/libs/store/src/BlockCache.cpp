@@ -0,0 +1,27 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cassert>
+#include <utility>
+
+#include <pg/store/BlockCache.hpp>
+#include <pg/store/Lz.hpp>
+
+namespace pg::store {
+
+auto BlockCache::read(const PackedBlock& block) -> std::shared_ptr<const std::string> {
+    if (auto cached = cache_.find(block.id)) {
+        return std::move(*cached);
+    }
+    auto decompressed = lz::decompress(block.data, block.size);
+    // Blocks never leave memory, so one that fails to decompress is a bug.
+    assert(decompressed.has_value());
+    auto text = std::make_shared<const std::string>(std::move(decompressed).value_or(std::string {}));
+    const auto size = text->size();
+    return cache_.insert(block.id, std::move(text), size);
+}
+
+}  // namespace pg::store
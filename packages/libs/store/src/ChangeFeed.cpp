@@ -0,0 +1,115 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include <pg/store/ChangeFeed.hpp>
+
+namespace pg::store {
+
+ChangeFeed::ChangeFeed(std::size_t capacity, CommitVersion last)
+    : ring_(std::max<std::size_t>(capacity, 1)), last_ { last } { }
+
+void ChangeFeed::publish(Event event) {
+    {
+        auto lock = std::scoped_lock { mutex_ };
+        assert(event->sequence == last_ + 1);
+        last_ = event->sequence;
+        ring_[last_ % ring_.size()] = std::move(event);
+        size_ = std::min(size_ + 1, ring_.size());
+    }
+    published_.notify_all();
+}
+
+auto ChangeFeed::subscribe(CommitVersion after, Backfill backfill) -> std::unique_ptr<ChangeSubscription> {
+    auto cursor = std::make_shared<Cursor>();
+    cursor->next.store(after + 1, std::memory_order_relaxed);
+    {
+        auto lock = std::scoped_lock { mutex_ };
+        cursor->id = next_subscriber_++;
+        cursors_.push_back(cursor);
+    }
+    return std::unique_ptr<ChangeSubscription> { new ChangeSubscription { *this, cursor, std::move(backfill) } };
+}
+
+auto ChangeFeed::last() const -> CommitVersion {
+    auto lock = std::scoped_lock { mutex_ };
+    return last_;
+}
+
+auto ChangeFeed::subscribers() const -> std::vector<SubscriberStats> {
+    auto lock = std::scoped_lock { mutex_ };
+    auto stats = std::vector<SubscriberStats> {};
+    stats.reserve(cursors_.size());
+    for (const auto& cursor : cursors_) {
+        const auto next = cursor->next.load(std::memory_order_relaxed);
+        stats.push_back(SubscriberStats { cursor->id, next, next <= last_ ? last_ - next + 1 : 0 });
+    }
+    return stats;
+}
+
+auto ChangeFeed::read(CommitVersion from, std::size_t max) const -> Read {
+    auto read = Read {};
+    auto lock = std::scoped_lock { mutex_ };
+    if (from > last_) {
+        return read;
+    }
+    // Also true of an empty ring, whose next event is `last_ + 1`.
+    if (from + size_ <= last_) {
+        read.lagged = true;
+        return read;
+    }
+    const auto count = std::min<CommitVersion>(last_ - from + 1, max);
+    read.events.reserve(count);
+    for (auto sequence = from; sequence < from + count; ++sequence) {
+        read.events.push_back(ring_[sequence % ring_.size()]);
+    }
+    return read;
+}
+
+auto ChangeFeed::wait(CommitVersion from, std::chrono::milliseconds timeout, std::stop_token stop) const -> bool {
+    auto lock = std::unique_lock { mutex_ };
+    return published_.wait_for(lock, stop, timeout, [&] { return last_ >= from; });
+}
+
+void ChangeFeed::unsubscribe(const Cursor& cursor) {
+    auto lock = std::scoped_lock { mutex_ };
+    std::erase_if(cursors_, [&](const auto& one) { return one.get() == &cursor; });
+}
+
+ChangeSubscription::~ChangeSubscription() {
+    feed_->unsubscribe(*cursor_);
+}
+
+auto ChangeSubscription::poll(std::size_t max) -> Result<std::vector<ChangeFeed::Event>> {
+    const auto next = cursor_->next.load(std::memory_order_relaxed);
+    auto read = feed_->read(next, max);
+    if (read.lagged) {
+        auto backfilled = backfill_(next, max);
+        if (!backfilled) {
+            return cpp::fail(std::move(backfilled).error());
+        }
+        read.events = std::move(*backfilled);
+    }
+    if (!read.events.empty()) {
+        cursor_->next.store(read.events.back()->sequence + 1, std::memory_order_relaxed);
+    }
+    return std::move(read.events);
+}
+
+auto ChangeSubscription::wait(std::chrono::milliseconds timeout, std::stop_token stop) const -> bool {
+    return feed_->wait(next(), timeout, std::move(stop));
+}
+
+auto ChangeSubscription::lag() const -> std::uint64_t {
+    const auto last = feed_->last();
+    const auto from = next();
+    return from <= last ? last - from + 1 : 0;
+}
+
+}  // namespace pg::store
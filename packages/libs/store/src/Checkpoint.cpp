@@ -0,0 +1,427 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/gen/note.gen.hpp>
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/Crc32c.hpp>
+#include <pg/store/Endian.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <flatbuffers/flatbuffers.h>
+#include <parallel_hashmap/phmap.h>
+
+namespace pg::store {
+namespace {
+
+using StringVector = flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>;
+
+constexpr std::size_t SEGMENT_ALIGNMENT = 8;
+/// Bytes of one manifest entry: index, version and note count.
+constexpr std::size_t MANIFEST_ENTRY = 24;
+constexpr std::string_view CHUNK_PREFIX = "chunk-";
+constexpr std::string_view TEMPORARY_SUFFIX = ".tmp";
+
+auto padding(std::size_t size) noexcept -> std::size_t {
+    return (SEGMENT_ALIGNMENT - size % SEGMENT_ALIGNMENT) % SEGMENT_ALIGNMENT;
+}
+
+auto view_of(const flatbuffers::String* text) noexcept -> std::string_view {
+    return text != nullptr ? std::string_view { text->c_str(), text->size() } : std::string_view {};
+}
+
+auto mapped_tag(const void* source, std::size_t index) noexcept -> std::string_view {
+    return view_of(static_cast<const StringVector*>(source)->Get(static_cast<flatbuffers::uoffset_t>(index)));
+}
+
+auto to_timestamp(const gen::Timestamp* timestamp) noexcept -> Timestamp {
+    if (timestamp == nullptr) {
+        return Timestamp {};
+    }
+    return Timestamp {
+        std::chrono::seconds { timestamp->seconds() } + std::chrono::nanoseconds { timestamp->nanos() },
+    };
+}
+
+auto encode_timestamp(flatbuffers::FlatBufferBuilder& builder, Timestamp timestamp) {
+    const auto since_epoch = timestamp.time_since_epoch();
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(since_epoch);
+    return gen::CreateTimestamp(builder, seconds.count(), static_cast<std::int32_t>((since_epoch - seconds).count()));
+}
+
+auto corrupt(const std::filesystem::path& path, std::string_view what) {
+    return fail(ErrorCode::DataLoss, fmt::format("{} is not a valid checkpoint: {}", path.string(), what));
+}
+
+auto manifest_path(const std::filesystem::path& directory) -> std::filesystem::path {
+    return directory / Checkpoint::MANIFEST_FILE;
+}
+
+auto temporary_path(std::filesystem::path path) -> std::filesystem::path {
+    path += TEMPORARY_SUFFIX;
+    return path;
+}
+
+auto replace_file(const std::filesystem::path& from, const std::filesystem::path& to) -> Result<void> {
+    auto error = std::error_code {};
+    std::filesystem::rename(from, to, error);
+    if (error) {
+        return fail(
+          ErrorCode::Internal,
+          fmt::format("cannot rename {} to {}: {}", from.string(), to.string(), error.message()));
+    }
+    return {};
+}
+
+/**
+ * @brief Write every note of `chunk` visible at `snapshot` to `path`, fill in `chunk.notes` and sync the file.
+ * @return The bytes written
+ */
+auto write_chunk(
+  const NoteStore& store,
+  const Snapshot& snapshot,
+  NoteOrdinal end,
+  CheckpointChunk& chunk,
+  const std::filesystem::path& path) -> Result<std::uint64_t> {
+    auto file = File::open(path, File::Mode::Truncate);
+    if (!file) {
+        return cpp::fail(std::move(file).error());
+    }
+    auto header = std::array<std::uint8_t, Checkpoint::HEADER> {};
+    std::copy(Checkpoint::CHUNK_MAGIC.begin(), Checkpoint::CHUNK_MAGIC.end(), header.begin());
+    store_le(header.data() + 8, chunk.version);
+    // The note count is filled in once it is known.
+    if (auto written = file->write(header); !written) {
+        return cpp::fail(std::move(written).error());
+    }
+
+    auto bytes = std::uint64_t { header.size() };
+    auto builder = flatbuffers::FlatBufferBuilder { 1 << 20 };
+    auto notes = std::vector<flatbuffers::Offset<gen::NoteObject>> {};
+    // Notes holding the same body hold the same blob, so where it starts and how long it is are enough to store each
+    // body once per segment. Its address alone is not: an empty body packed into a block starts where the next does.
+    using Body = std::pair<const char*, std::size_t>;
+    auto bodies = phmap::flat_hash_map<Body, flatbuffers::Offset<flatbuffers::String>> {};
+    const auto flush = [&]() -> Result<void> {
+        builder.FinishSizePrefixed(gen::CreateNoteStorage(builder, builder.CreateVector(notes)));
+        const auto size = builder.GetSize();
+        constexpr auto zeros = std::array<std::uint8_t, SEGMENT_ALIGNMENT> {};
+        if (auto written = file->write({ builder.GetBufferPointer(), size }); !written) {
+            return written;
+        }
+        if (auto written = file->write(std::span { zeros }.first(padding(size))); !written) {
+            return written;
+        }
+        bytes += size + padding(size);
+        notes.clear();
+        bodies.clear();
+        builder.Clear();
+        return {};
+    };
+
+    const auto first = static_cast<NoteOrdinal>(chunk.index * Checkpoint::CHUNK_NOTES);
+    const auto last = static_cast<NoteOrdinal>(std::min<std::uint64_t>(first + Checkpoint::CHUNK_NOTES, end));
+    chunk.notes = 0;
+    for (auto ordinal = first; ordinal < last; ++ordinal) {
+        const auto note = store.peek(ordinal, snapshot);
+        if (!note) {
+            continue;
+        }
+        const auto id = builder.CreateString(boost::uuids::to_string(note->id));
+        const auto title = builder.CreateString(note->title.data(), note->title.size());
+        auto [body, added] = bodies.try_emplace(Body { note->content.data(), note->content.size() });
+        if (added) {
+            body->second = builder.CreateString(note->content.data(), note->content.size());
+        }
+        const auto content = body->second;
+        auto tag_offsets = std::vector<flatbuffers::Offset<flatbuffers::String>> {};
+        tag_offsets.reserve(note->tags.size());
+        for (const auto tag : note->tags) {
+            tag_offsets.push_back(builder.CreateString(tag.data(), tag.size()));
+        }
+        const auto tags = builder.CreateVector(tag_offsets);
+        const auto created = encode_timestamp(builder, note->created);
+        const auto updated = encode_timestamp(builder, note->updated);
+        notes.push_back(gen::CreateNoteObject(builder, id, title, content, tags, created, updated));
+        ++chunk.notes;
+        if (builder.GetSize() >= Checkpoint::SEGMENT_BYTES) {
+            if (auto flushed = flush(); !flushed) {
+                return cpp::fail(std::move(flushed).error());
+            }
+        }
+    }
+    if (!notes.empty()) {
+        if (auto flushed = flush(); !flushed) {
+            return cpp::fail(std::move(flushed).error());
+        }
+    }
+
+    store_le(header.data() + 16, chunk.notes);
+    if (auto written = file->write_at(0, header); !written) {
+        return cpp::fail(std::move(written).error());
+    }
+    if (auto synced = file->sync(); !synced) {
+        return cpp::fail(std::move(synced).error());
+    }
+    return bytes;
+}
+
+auto encode_manifest(CommitVersion version, std::span<const CheckpointChunk> chunks) -> std::vector<std::uint8_t> {
+    auto bytes = std::vector<std::uint8_t>(Checkpoint::HEADER + chunks.size() * MANIFEST_ENTRY + 4);
+    std::copy(Checkpoint::MANIFEST_MAGIC.begin(), Checkpoint::MANIFEST_MAGIC.end(), bytes.begin());
+    store_le(bytes.data() + 8, version);
+    store_le(bytes.data() + 16, chunks.size());
+    auto* out = bytes.data() + Checkpoint::HEADER;
+    for (const auto& chunk : chunks) {
+        store_le(out, chunk.index);
+        store_le(out + 8, chunk.version);
+        store_le(out + 16, chunk.notes);
+        out += MANIFEST_ENTRY;
+    }
+    store_le(out, crc32c(std::span { bytes }.first(bytes.size() - 4)), 4);
+    return bytes;
+}
+
+}  // namespace
+
+auto Checkpoint::open(const std::filesystem::path& directory, bool verify)
+  -> Result<std::shared_ptr<const Checkpoint>> {
+    const auto path = manifest_path(directory);
+    auto manifest = MappedFile::open(path);
+    if (!manifest) {
+        return cpp::fail(std::move(manifest).error());
+    }
+    const auto bytes = manifest->bytes();
+    if (bytes.size() < HEADER + 4 || !std::equal(MANIFEST_MAGIC.begin(), MANIFEST_MAGIC.end(), bytes.begin())) {
+        return corrupt(path, "bad header");
+    }
+    const auto count = load_le(bytes.data() + 16);
+    if (count > (bytes.size() - HEADER - 4) / MANIFEST_ENTRY || bytes.size() != HEADER + count * MANIFEST_ENTRY + 4) {
+        return corrupt(path, fmt::format("{} bytes cannot hold {} chunks", bytes.size(), count));
+    }
+    if (crc32c(bytes.first(bytes.size() - 4)) != load_le(bytes.data() + bytes.size() - 4, 4)) {
+        return corrupt(path, "checksum mismatch");
+    }
+    if (count * CHUNK_NOTES >= INVALID_ORDINAL) {
+        return corrupt(path, fmt::format("implausible chunk count {}", count));
+    }
+
+    auto checkpoint = std::shared_ptr<Checkpoint> { new Checkpoint {} };
+    checkpoint->directory_ = directory;
+    checkpoint->version_ = load_le(bytes.data() + 8);
+    checkpoint->chunks_.reserve(static_cast<std::size_t>(count));
+    checkpoint->files_.reserve(static_cast<std::size_t>(count));
+    for (std::uint64_t i = 0; i < count; ++i) {
+        const auto* entry = bytes.data() + HEADER + i * MANIFEST_ENTRY;
+        const auto chunk = CheckpointChunk { load_le(entry), load_le(entry + 8), load_le(entry + 16) };
+        if (chunk.index != i || chunk.version > checkpoint->version_ || chunk.notes > CHUNK_NOTES) {
+            return corrupt(path, fmt::format("bad entry for chunk {}", i));
+        }
+        checkpoint->chunks_.push_back(chunk);
+        if (auto mapped = checkpoint->map_chunk(chunk, verify); !mapped) {
+            return cpp::fail(std::move(mapped).error());
+        }
+    }
+    return checkpoint;
+}
+
+auto Checkpoint::exists(const std::filesystem::path& directory) -> bool {
+    return std::filesystem::exists(manifest_path(directory));
+}
+
+auto Checkpoint::chunk_path(const std::filesystem::path& directory, const CheckpointChunk& chunk)
+  -> std::filesystem::path {
+    return directory / fmt::format("{}{:08}-{:020}", CHUNK_PREFIX, chunk.index, chunk.version);
+}
+
+auto Checkpoint::map_chunk(const CheckpointChunk& chunk, bool verify) -> Result<void> {
+    const auto path = chunk_path(directory_, chunk);
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return corrupt(path, file.error().message);
+    }
+    const auto bytes = file->bytes();
+    if (bytes.size() < HEADER || !std::equal(CHUNK_MAGIC.begin(), CHUNK_MAGIC.end(), bytes.begin())) {
+        return corrupt(path, "bad header");
+    }
+    if (load_le(bytes.data() + 8) != chunk.version || load_le(bytes.data() + 16) != chunk.notes) {
+        return corrupt(path, "header does not match the manifest");
+    }
+
+    // Slots up to the chunk's first are the unused tail of the previous one.
+    const auto first = static_cast<std::size_t>(chunk.index * CHUNK_NOTES);
+    notes_.resize(first, nullptr);
+    ids_.resize(first);
+    auto parse_id = boost::uuids::string_generator {};
+    auto offset = HEADER;
+    while (offset < bytes.size()) {
+        if (bytes.size() - offset < sizeof(flatbuffers::uoffset_t)) {
+            return corrupt(path, fmt::format("truncated segment at offset {}", offset));
+        }
+        const auto length = sizeof(flatbuffers::uoffset_t)
+                            + flatbuffers::ReadScalar<flatbuffers::uoffset_t>(bytes.data() + offset);
+        if (length > bytes.size() - offset) {
+            return corrupt(path, fmt::format("truncated segment at offset {}", offset));
+        }
+        const auto* segment = bytes.data() + offset;
+        if (verify) {
+            auto verifier = flatbuffers::Verifier { segment, length };
+            if (!verifier.VerifySizePrefixedBuffer<gen::NoteStorage>(nullptr)) {
+                return corrupt(path, fmt::format("segment at offset {} fails verification", offset));
+            }
+        }
+        const auto* notes = flatbuffers::GetSizePrefixedRoot<gen::NoteStorage>(segment)->notes();
+        if (notes != nullptr) {
+            if (notes_.size() - first + notes->size() > chunk.notes) {
+                return corrupt(path, fmt::format("holds more than {} notes", chunk.notes));
+            }
+            for (const auto* note : *notes) {
+                const auto id = view_of(note->id());
+                try {
+                    ids_.push_back(parse_id(id.begin(), id.end()));
+                } catch (const std::runtime_error&) {
+                    return corrupt(path, fmt::format("'{}' is not a note id", id));
+                }
+                notes_.push_back(note);
+            }
+        }
+        offset += length + padding(length);
+    }
+    if (notes_.size() - first != chunk.notes) {
+        return corrupt(path, fmt::format("holds {} notes, expected {}", notes_.size() - first, chunk.notes));
+    }
+    note_count_ += chunk.notes;
+    files_.push_back(std::move(*file));
+    return {};
+}
+
+auto Checkpoint::note(std::size_t index) const noexcept -> NoteView {
+    const auto* note = notes_[index];
+    const auto* tags = note->tags();
+    return NoteView {
+        .id = ids_[index],
+        .title = view_of(note->title()),
+        .content = view_of(note->content()),
+        .tags = tags != nullptr ? TagList { tags, tags->size(), &mapped_tag } : TagList {},
+        .created = to_timestamp(note->created()),
+        .updated = to_timestamp(note->updated()),
+    };
+}
+
+CheckpointWriter::CheckpointWriter(std::filesystem::path directory, const Checkpoint* loaded)
+    : directory_ { std::move(directory) } {
+    // A manifest loaded from elsewhere names chunk files this directory does not hold, so start from scratch then.
+    auto error = std::error_code {};
+    if (loaded != nullptr && std::filesystem::equivalent(loaded->directory(), directory_, error)) {
+        manifest_.assign(loaded->chunks().begin(), loaded->chunks().end());
+    }
+}
+
+auto CheckpointWriter::write(const NoteStore& store, NoteStore::DirtyChunks dirty) -> Result<CheckpointStats> {
+    auto error = std::error_code {};
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        return fail(ErrorCode::Internal, fmt::format("cannot create {}: {}", directory_.string(), error.message()));
+    }
+    // Until the manifest is replaced, the chunks marked now still have to be written, whatever happens below.
+    pending_ |= dirty.chunks;
+    const auto& snapshot = dirty.snapshot;
+    auto end = NoteOrdinal { 0 };
+    {
+        auto lock = store.read_lock();
+        end = store.ordinal_horizon(snapshot.version());
+    }
+
+    auto stats = CheckpointStats {};
+    const auto count = (std::uint64_t { end } + Checkpoint::CHUNK_NOTES - 1) / Checkpoint::CHUNK_NOTES;
+    auto manifest = std::vector<CheckpointChunk> {};
+    manifest.reserve(static_cast<std::size_t>(count));
+    for (std::uint64_t index = 0; index < count; ++index) {
+        if (index < manifest_.size() && !pending_.test(static_cast<NoteOrdinal>(index))) {
+            manifest.push_back(manifest_[index]);
+            stats.notes += manifest_[index].notes;
+            ++stats.chunks_reused;
+            continue;
+        }
+        auto chunk = CheckpointChunk { index, snapshot.version(), 0 };
+        auto written = write_chunk(store, snapshot, end, chunk, Checkpoint::chunk_path(directory_, chunk));
+        if (!written) {
+            return cpp::fail(std::move(written).error());
+        }
+        manifest.push_back(chunk);
+        stats.notes += chunk.notes;
+        stats.bytes += *written;
+        ++stats.chunks_written;
+    }
+
+    const auto path = manifest_path(directory_);
+    const auto temporary = temporary_path(path);
+    const auto bytes = encode_manifest(snapshot.version(), manifest);
+    auto file = File::open(temporary, File::Mode::Truncate);
+    if (!file) {
+        return cpp::fail(std::move(file).error());
+    }
+    if (auto written = file->write(bytes); !written) {
+        return cpp::fail(std::move(written).error());
+    }
+    if (auto synced = file->sync(); !synced) {
+        return cpp::fail(std::move(synced).error());
+    }
+    file->close();
+    // The new chunk files have to be there before any manifest that lists them is.
+    if (auto synced = sync_directory(path); !synced) {
+        return cpp::fail(std::move(synced).error());
+    }
+    if (auto renamed = replace_file(temporary, path); !renamed) {
+        return cpp::fail(std::move(renamed).error());
+    }
+    if (auto synced = sync_directory(path); !synced) {
+        return cpp::fail(std::move(synced).error());
+    }
+    stats.bytes += bytes.size();
+
+    manifest_ = std::move(manifest);
+    pending_.clear();
+    remove_stale_files();
+    return stats;
+}
+
+void CheckpointWriter::remove_stale_files() const {
+    auto live = std::vector<std::string> {};
+    live.reserve(manifest_.size());
+    for (const auto& chunk : manifest_) {
+        live.push_back(Checkpoint::chunk_path(directory_, chunk).filename().string());
+    }
+    std::ranges::sort(live);
+
+    auto error = std::error_code {};
+    auto stale = std::vector<std::filesystem::path> {};
+    for (const auto& entry : std::filesystem::directory_iterator { directory_, error }) {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with(CHUNK_PREFIX) && !std::ranges::binary_search(live, name)) {
+            stale.push_back(entry.path());
+        }
+    }
+    for (const auto& path : stale) {
+        // Fails where a file that is still mapped cannot be removed; the next checkpoint tries again.
+        std::filesystem::remove(path, error);
+    }
+}
+
+}  // namespace pg::store
@@ -0,0 +1,130 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <pg/store/ColdTier.hpp>
+#include <pg/store/IdGenerator.hpp>
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace pg::store {
+
+namespace {
+    // A record is three `std::uint32_t`s (title size, content size, tag count), the end offset of each tag within the
+    // tag bytes, then the title, content and tag bytes. Records start on a word boundary.
+    constexpr std::size_t HEADER_WORDS = 3;
+    constexpr std::size_t ALIGNMENT = sizeof(std::uint32_t);
+
+    auto word_at(const std::uint8_t* at, std::size_t index) noexcept -> std::uint32_t {
+        auto value = std::uint32_t { 0 };
+        std::memcpy(&value, at + index * sizeof(value), sizeof(value));
+        return value;
+    }
+
+    void put_word(std::vector<std::uint8_t>& out, std::size_t value) {
+        const auto word = static_cast<std::uint32_t>(value);
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(&word);
+        out.insert(out.end(), bytes, bytes + sizeof(word));
+    }
+
+    void put_text(std::vector<std::uint8_t>& out, std::string_view text) {
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(text.data());
+        out.insert(out.end(), bytes, bytes + text.size());
+    }
+
+    auto tag_bytes(const std::uint8_t* record) noexcept -> const char* {
+        const auto words = HEADER_WORDS + word_at(record, 2);
+        return reinterpret_cast<const char*>(record) + words * sizeof(std::uint32_t) + word_at(record, 0)
+             + word_at(record, 1);
+    }
+
+    auto spilled_tag(const void* source, std::size_t index) noexcept -> std::string_view {
+        const auto* record = static_cast<const std::uint8_t*>(source);
+        const auto begin = index == 0 ? 0 : word_at(record, HEADER_WORDS + index - 1);
+        const auto end = word_at(record, HEADER_WORDS + index);
+        return { tag_bytes(record) + begin, end - begin };
+    }
+}  // namespace
+
+auto ColdTier::spill(std::span<const NoteView> notes) -> Result<std::vector<const std::uint8_t*>> {
+    if (notes.empty()) {
+        return std::vector<const std::uint8_t*> {};
+    }
+    auto error = std::error_code {};
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        return fail(ErrorCode::Internal, fmt::format("cannot create {}: {}", directory_.string(), error.message()));
+    }
+
+    auto buffer = std::vector<std::uint8_t> {};
+    auto offsets = std::vector<std::size_t> {};
+    offsets.reserve(notes.size());
+    for (const auto& note : notes) {
+        buffer.resize((buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+        offsets.push_back(buffer.size());
+        put_word(buffer, note.title.size());
+        put_word(buffer, note.content.size());
+        put_word(buffer, note.tags.size());
+        auto end = std::size_t { 0 };
+        for (const auto tag : note.tags) {
+            end += tag.size();
+            put_word(buffer, end);
+        }
+        put_text(buffer, note.title);
+        put_text(buffer, note.content);
+        for (const auto tag : note.tags) {
+            put_text(buffer, tag);
+        }
+    }
+
+    // Named uniquely, so that stores sharing a directory never collide.
+    const auto path = directory_ / fmt::format("{}.cold", boost::uuids::to_string(generate_note_id()));
+    {
+        auto file = File::open(path, File::Mode::Truncate);
+        if (!file) {
+            return cpp::fail(std::move(file).error());
+        }
+        if (auto written = file->write(buffer); !written) {
+            std::filesystem::remove(path, error);
+            return cpp::fail(std::move(written).error());
+        }
+    }
+    auto mapped = MappedFile::open(path);
+    // The mapping outlives the file; where the platform refuses to remove a mapped file, it is left behind.
+    std::filesystem::remove(path, error);
+    if (!mapped) {
+        return cpp::fail(std::move(mapped).error());
+    }
+
+    const auto* data = mapped->bytes().data();
+    auto records = std::vector<const std::uint8_t*> {};
+    records.reserve(offsets.size());
+    for (const auto offset : offsets) {
+        records.push_back(data + offset);
+    }
+    bytes_.fetch_add(buffer.size(), std::memory_order_relaxed);
+    segments_.push_back(std::move(*mapped));
+    return records;
+}
+
+auto ColdTier::read(const std::uint8_t* record) noexcept -> Record {
+    const auto title_size = word_at(record, 0);
+    const auto content_size = word_at(record, 1);
+    const auto tag_count = word_at(record, 2);
+    const auto* text = reinterpret_cast<const char*>(record) + (HEADER_WORDS + tag_count) * sizeof(std::uint32_t);
+    return Record {
+        .title = { text, title_size },
+        .content = { text + title_size, content_size },
+        .tags = TagList { record, tag_count, &spilled_tag },
+    };
+}
+
+}  // namespace pg::store
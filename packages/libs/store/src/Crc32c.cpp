@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include <pg/store/Crc32c.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define PG_CRC32C_X86 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#        define PG_TARGET(isa)
+#    else
+#        define PG_TARGET(isa) __attribute__((target(isa)))
+#    endif
+#endif
+
+namespace pg::store {
+namespace {
+
+constexpr std::uint32_t POLYNOMIAL = 0x82F63B78U;  // reflected 0x1EDC6F41
+
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr auto make_tables() -> Tables {
+    auto tables = Tables {};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        auto crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1U) != 0 ? POLYNOMIAL : 0U);
+        }
+        tables[0][i] = crc;
+    }
+    for (std::size_t t = 1; t < tables.size(); ++t) {
+        for (std::size_t i = 0; i < 256; ++i) {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr Tables TABLES = make_tables();
+
+/// Slicing-by-8. The word loads assume a little-endian host.
+auto crc32c_table(const std::uint8_t* data, std::size_t size, std::uint32_t crc) noexcept -> std::uint32_t {
+    while (size >= 8) {
+        auto low = std::uint32_t {};
+        auto high = std::uint32_t {};
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = TABLES[7][low & 0xFF] ^ TABLES[6][(low >> 8) & 0xFF] ^ TABLES[5][(low >> 16) & 0xFF]
+              ^ TABLES[4][low >> 24] ^ TABLES[3][high & 0xFF] ^ TABLES[2][(high >> 8) & 0xFF]
+              ^ TABLES[1][(high >> 16) & 0xFF] ^ TABLES[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ TABLES[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef PG_CRC32C_X86
+/// SSE4.2 on its own: the text search kernels settle for less, so their tier says nothing about it.
+auto has_sse42() noexcept -> bool {
+#    if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#    else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+#    endif
+}
+
+PG_TARGET("sse4.2")
+auto crc32c_sse42(const std::uint8_t* data, std::size_t size, std::uint32_t crc) noexcept -> std::uint32_t {
+    auto wide = static_cast<std::uint64_t>(crc);
+    while (size >= 8) {
+        auto word = std::uint64_t {};
+        std::memcpy(&word, data, 8);
+        wide = _mm_crc32_u64(wide, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<std::uint32_t>(wide);
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+}  // namespace
+
+auto crc32c(std::span<const std::uint8_t> bytes, std::uint32_t crc) noexcept -> std::uint32_t {
+#ifdef PG_CRC32C_X86
+    if (crc32c_hardware()) {
+        return ~crc32c_sse42(bytes.data(), bytes.size(), ~crc);
+    }
+#endif
+    return crc32c_software(bytes, crc);
+}
+
+auto crc32c_software(std::span<const std::uint8_t> bytes, std::uint32_t crc) noexcept -> std::uint32_t {
+    return ~crc32c_table(bytes.data(), bytes.size(), ~crc);
+}
+
+auto crc32c_hardware() noexcept -> bool {
+#ifdef PG_CRC32C_X86
+    static const bool hardware = has_sse42();
+    return hardware;
+#else
+    return false;
+#endif
+}
+
+}  // namespace pg::store
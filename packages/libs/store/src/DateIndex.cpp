@@ -0,0 +1,151 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include <pg/store/DateIndex.hpp>
+
+namespace pg::store {
+namespace {
+
+/**
+ * @brief `to - from` in ticks, for `from <= to`. Unsigned, since the span of two extreme timestamps overflows the
+ * signed representation.
+ */
+auto span(Timestamp from, Timestamp to) noexcept -> std::uint64_t {
+    return static_cast<std::uint64_t>(to.time_since_epoch().count())
+         - static_cast<std::uint64_t>(from.time_since_epoch().count());
+}
+
+}  // namespace
+
+auto DateIndex::Range::count() const -> std::size_t {
+    return static_cast<std::size_t>(std::distance(begin_, end_));
+}
+
+void DateIndex::Range::collect(Bitmap& out) const {
+    for (auto it = begin_; it != end_; ++it) {
+        out.set(it->second);
+    }
+}
+
+auto DateIndex::build(std::vector<Key> keys) -> DateIndex {
+    std::ranges::sort(keys);
+    auto index = DateIndex {};
+    auto end = NoteOrdinal { 0 };
+    for (const auto& [timestamp, ordinal] : keys) {
+        end = std::max(end, ordinal + 1);
+    }
+    index.timestamps_.resize(end);
+    for (const auto& key : keys) {
+        index.timestamps_[key.second] = key.first;
+        index.present_.set(key.second);
+        index.tree_.emplace_hint(index.tree_.end(), key);
+    }
+    return index;
+}
+
+void DateIndex::insert(NoteOrdinal ordinal, Timestamp timestamp) {
+    if (indexed(ordinal)) {
+        update(ordinal, timestamp);
+        return;
+    }
+    if (ordinal >= timestamps_.size()) {
+        timestamps_.resize(static_cast<std::size_t>(ordinal) + 1);
+    }
+    timestamps_[ordinal] = timestamp;
+    present_.set(ordinal);
+    const auto key = Key { timestamp, ordinal };
+    if (tree_.empty() || *std::prev(tree_.end()) < key) {
+        tree_.emplace_hint(tree_.end(), key);
+    } else {
+        tree_.insert(key);
+    }
+}
+
+void DateIndex::erase(NoteOrdinal ordinal) {
+    if (!indexed(ordinal)) {
+        return;
+    }
+    tree_.erase(Key { timestamps_[ordinal], ordinal });
+    present_.reset(ordinal);
+}
+
+void DateIndex::update(NoteOrdinal ordinal, Timestamp timestamp) {
+    if (indexed(ordinal) && timestamps_[ordinal] == timestamp) {
+        return;
+    }
+    erase(ordinal);
+    insert(ordinal, timestamp);
+}
+
+void DateIndex::update(std::span<const std::pair<NoteOrdinal, Timestamp>> updates) {
+    auto sorted = std::vector<std::pair<NoteOrdinal, Timestamp>> { updates.begin(), updates.end() };
+    std::ranges::sort(sorted, [](const auto& lhs, const auto& rhs) {
+        return Key { lhs.second, lhs.first } < Key { rhs.second, rhs.first };
+    });
+    for (const auto& [ordinal, timestamp] : sorted) {
+        update(ordinal, timestamp);
+    }
+}
+
+auto DateIndex::timestamp_of(NoteOrdinal ordinal) const -> std::optional<Timestamp> {
+    if (!indexed(ordinal)) {
+        return std::nullopt;
+    }
+    return timestamps_[ordinal];
+}
+
+auto DateIndex::before(Timestamp date) const -> Range {
+    return Range { tree_.begin(), tree_.lower_bound(Key { date, 0 }) };
+}
+
+auto DateIndex::after(Timestamp date) const -> Range {
+    return Range { tree_.upper_bound(Key { date, INVALID_ORDINAL }), tree_.end() };
+}
+
+auto DateIndex::between(Timestamp start, Timestamp end) const -> Range {
+    if (end < start) {
+        return Range { tree_.end(), tree_.end() };
+    }
+    return Range { tree_.lower_bound(Key { start, 0 }), tree_.upper_bound(Key { end, INVALID_ORDINAL }) };
+}
+
+auto DateIndex::not_between(Timestamp start, Timestamp end) const -> std::pair<Range, Range> {
+    if (end < start) {
+        return { all(), Range { tree_.end(), tree_.end() } };
+    }
+    return { before(start), after(end) };
+}
+
+auto DateIndex::bounds() const -> std::optional<std::pair<Timestamp, Timestamp>> {
+    if (tree_.empty()) {
+        return std::nullopt;
+    }
+    return std::pair { tree_.begin()->first, std::prev(tree_.end())->first };
+}
+
+auto DateIndex::estimate(Timestamp start, Timestamp end) const -> std::size_t {
+    const auto range = bounds();
+    if (!range || end < start) {
+        return 0;
+    }
+    const auto [oldest, newest] = *range;
+    const auto low = std::max(start, oldest);
+    const auto high = std::min(end, newest);
+    if (high < low) {
+        return 0;
+    }
+    if (newest == oldest) {
+        return tree_.size();
+    }
+    const auto covered = static_cast<double>(span(low, high)) / static_cast<double>(span(oldest, newest));
+    return std::max<std::size_t>(1, static_cast<std::size_t>(covered * static_cast<double>(tree_.size())));
+}
+
+}  // namespace pg::store
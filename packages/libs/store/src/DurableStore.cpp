@@ -0,0 +1,443 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/DurableStore.hpp>
+#include <pg/store/Messages.hpp>
+
+namespace pg::store {
+namespace {
+
+/**
+ * @brief The sequence number in the name of log file `path`, or zero if it is not one.
+ */
+auto log_sequence(const std::filesystem::path& path) -> std::uint64_t {
+    if (path.extension() != DurableStore::WAL_EXTENSION) {
+        return 0;
+    }
+    const auto stem = path.stem().string();
+    auto sequence = std::uint64_t { 0 };
+    const auto [end, error] = std::from_chars(stem.data(), stem.data() + stem.size(), sequence);
+    return error == std::errc {} && end == stem.data() + stem.size() ? sequence : 0;
+}
+
+}  // namespace
+
+auto DurableStore::open(const std::filesystem::path& directory, DurableOptions options)
+  -> Result<std::unique_ptr<DurableStore>> {
+    auto error = std::error_code {};
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return fail(ErrorCode::Internal, fmt::format("cannot create {}: {}", directory.string(), error.message()));
+    }
+    auto durable = std::unique_ptr<DurableStore> { new DurableStore { directory, std::move(options) } };
+    auto store_options = durable->options_.store;
+    store_options.clock = [raw = durable.get()] { return raw->stamp_; };
+
+    const auto checkpoint_directory = directory / CHECKPOINT_DIRECTORY;
+    if (Checkpoint::exists(checkpoint_directory)) {
+        auto checkpoint = Checkpoint::open(checkpoint_directory, durable->options_.verify_checkpoint);
+        if (!checkpoint) {
+            return cpp::fail(std::move(checkpoint).error());
+        }
+        auto store = NoteStore::load(std::move(*checkpoint), std::move(store_options));
+        if (!store) {
+            return cpp::fail(std::move(store).error());
+        }
+        durable->store_ = std::move(*store);
+    } else {
+        durable->store_ = std::make_unique<NoteStore>(std::move(store_options));
+    }
+    durable->checkpoints_ =
+      std::make_unique<CheckpointWriter>(checkpoint_directory, durable->store_->checkpoint());
+
+    for (const auto& path : durable->log_files()) {
+        auto replayed = replay_wal(path, [&](const WalFrame& frame) { return durable->replay(frame); });
+        if (!replayed) {
+            return cpp::fail(std::move(replayed).error());
+        }
+        durable->replayed_.frames += replayed->frames;
+        durable->replayed_.valid_bytes += replayed->valid_bytes;
+        durable->replayed_.discarded_bytes += replayed->discarded_bytes;
+        durable->log_sequence_ = log_sequence(path);
+    }
+
+    // Start a new file rather than append to the last one, which may have just had a torn tail cut off.
+    auto wal = WriteAheadLog::open(durable->log_path(++durable->log_sequence_), durable->options_.wal);
+    if (!wal) {
+        return cpp::fail(std::move(wal).error());
+    }
+    durable->wal_ = std::move(*wal);
+    if (durable->options_.change_feed_capacity != 0) {
+        durable->changes_ =
+          std::make_unique<ChangeFeed>(durable->options_.change_feed_capacity, durable->store_->version());
+    }
+    if (durable->options_.checkpoint_interval.count() > 0) {
+        durable->checkpointer_ = std::jthread { [raw = durable.get()](std::stop_token stop) {
+            raw->run_checkpoints(std::move(stop));
+        } };
+    }
+    return durable;
+}
+
+DurableStore::DurableStore(std::filesystem::path directory, DurableOptions options)
+    : directory_ { std::move(directory) }, options_ { std::move(options) }, clock_ { options_.store.clock } {
+    if (!clock_) {
+        clock_ = system_now;
+    }
+}
+
+auto DurableStore::create(std::span<const std::uint8_t> request) -> Result<NoteId> {
+    auto decoded = messages::decode_create_request(request);
+    if (!decoded) {
+        return cpp::fail(std::move(decoded).error());
+    }
+
+    auto lock = std::unique_lock { mutex_ };
+    stamp_ = clock_();
+    auto id = store_->create(decoded->note, decoded->id);
+    if (!id) {
+        return id;
+    }
+    auto committed = Result<void> {};
+    if (decoded->id) {
+        committed = commit(lock, FrameKind::Create, request);
+    } else {
+        // Log the id that was assigned, so that replay recreates the same note.
+        decoded->id = *id;
+        committed = commit(lock, FrameKind::Create, messages::encode_create_request(*decoded));
+    }
+    if (!committed) {
+        return cpp::fail(std::move(committed).error());
+    }
+    return id;
+}
+
+auto DurableStore::update(std::span<const std::uint8_t> request) -> Result<void> {
+    auto edit = messages::decode_update_request(request);
+    if (!edit) {
+        return cpp::fail(std::move(edit).error());
+    }
+
+    auto lock = std::unique_lock { mutex_ };
+    stamp_ = clock_();
+    if (auto applied = store_->edit(*edit); !applied) {
+        return applied;
+    }
+    return commit(lock, FrameKind::Update, request);
+}
+
+auto DurableStore::update_many(std::span<const std::uint8_t> request) -> Result<NoteStore::BatchResult> {
+    auto decoded = messages::decode_update_notes_request(request);
+    if (!decoded) {
+        return cpp::fail(std::move(decoded).error());
+    }
+    auto result = NoteStore::BatchResult {};
+    result.results.resize(decoded->size());
+    auto edits = std::vector<NoteEdit> {};
+    auto slots = std::vector<std::size_t> {};
+    for (std::size_t i = 0; i < decoded->size(); ++i) {
+        if (auto& edit = (*decoded)[i]) {
+            edits.push_back(std::move(*edit));
+            slots.push_back(i);
+        } else {
+            result.results[i] = cpp::fail(std::move(edit).error());
+        }
+    }
+
+    auto lock = std::unique_lock { mutex_ };
+    stamp_ = clock_();
+    auto batch = store_->edit_many(edits);
+    for (std::size_t j = 0; j < slots.size(); ++j) {
+        result.results[slots[j]] = std::move(batch.results[j]);
+    }
+    result.applied = batch.applied;
+    result.version = batch.version;
+    if (batch.applied == 0) {
+        // Nothing changed, so there is nothing to replay.
+        return result;
+    }
+    if (auto committed = commit(lock, FrameKind::UpdateMany, request); !committed) {
+        return cpp::fail(std::move(committed).error());
+    }
+    return result;
+}
+
+auto DurableStore::remove(std::span<const std::uint8_t> request) -> Result<void> {
+    auto id = messages::decode_delete_request(request);
+    if (!id) {
+        return cpp::fail(std::move(id).error());
+    }
+
+    auto lock = std::unique_lock { mutex_ };
+    stamp_ = clock_();
+    if (auto applied = store_->remove(*id); !applied) {
+        return applied;
+    }
+    return commit(lock, FrameKind::Delete, request);
+}
+
+auto DurableStore::remove_many(std::span<const std::uint8_t> request) -> Result<NoteStore::BatchResult> {
+    auto decoded = messages::decode_delete_notes_request(request);
+    if (!decoded) {
+        return cpp::fail(std::move(decoded).error());
+    }
+    auto result = NoteStore::BatchResult {};
+    result.results.resize(decoded->size());
+    auto ids = std::vector<NoteId> {};
+    auto slots = std::vector<std::size_t> {};
+    for (std::size_t i = 0; i < decoded->size(); ++i) {
+        if (auto& id = (*decoded)[i]) {
+            ids.push_back(*id);
+            slots.push_back(i);
+        } else {
+            result.results[i] = cpp::fail(std::move(id).error());
+        }
+    }
+
+    auto lock = std::unique_lock { mutex_ };
+    stamp_ = clock_();
+    auto batch = store_->remove_many(ids);
+    for (std::size_t j = 0; j < slots.size(); ++j) {
+        result.results[slots[j]] = std::move(batch.results[j]);
+    }
+    result.applied = batch.applied;
+    result.version = batch.version;
+    if (batch.applied == 0) {
+        return result;
+    }
+    if (auto committed = commit(lock, FrameKind::DeleteMany, request); !committed) {
+        return cpp::fail(std::move(committed).error());
+    }
+    return result;
+}
+
+auto DurableStore::checkpoint() -> Result<CheckpointStats> {
+    auto lock = std::scoped_lock { checkpoint_mutex_ };
+    // Opened up front, so that writers only wait for the switch itself.
+    auto next = WriteAheadLog::open(log_path(log_sequence_ + 1), options_.wal);
+    if (!next) {
+        return cpp::fail(std::move(next).error());
+    }
+    auto dirty = NoteStore::DirtyChunks {};
+    {
+        auto writer = std::scoped_lock { mutex_ };
+        // With no mutation in between, the snapshot holds exactly what was logged before the new file, which is then
+        // exactly what replay has to apply on top of the checkpoint.
+        dirty = store_->take_dirty_chunks();
+        wal_ = std::move(*next);
+    }
+    const auto first_kept = ++log_sequence_;
+
+    auto written = checkpoints_->write(*store_, std::move(dirty));
+    if (!written) {
+        // The earlier log files stay until a checkpoint succeeds.
+        return written;
+    }
+    auto error = std::error_code {};
+    for (const auto& path : log_files()) {
+        if (log_sequence(path) < first_kept) {
+            // A file that cannot be removed yet is only replayed for nothing; the next checkpoint tries again.
+            std::filesystem::remove(path, error);
+        }
+    }
+    return written;
+}
+
+auto DurableStore::subscribe(CommitVersion after) -> Result<std::unique_ptr<ChangeSubscription>> {
+    if (!changes_) {
+        return fail(ErrorCode::FailedPrecondition, "the change feed is disabled");
+    }
+    return changes_->subscribe(after, [this](CommitVersion from, std::size_t max) { return read_log(from, max); });
+}
+
+auto DurableStore::log() const -> std::shared_ptr<const WriteAheadLog> {
+    auto lock = std::scoped_lock { mutex_ };
+    return wal_;
+}
+
+auto DurableStore::log_files() const -> std::vector<std::filesystem::path> {
+    auto files = std::vector<std::filesystem::path> {};
+    auto error = std::error_code {};
+    for (const auto& entry : std::filesystem::directory_iterator { directory_, error }) {
+        if (log_sequence(entry.path()) != 0) {
+            files.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(files, {}, [](const std::filesystem::path& path) { return log_sequence(path); });
+    return files;
+}
+
+auto DurableStore::checkpoint_failure() const -> std::optional<StoreError> {
+    auto lock = std::scoped_lock { checkpoint_state_mutex_ };
+    return checkpoint_failure_;
+}
+
+void DurableStore::run_checkpoints(std::stop_token stop) {
+    auto last = store_->version();
+    auto lock = std::unique_lock { checkpoint_state_mutex_ };
+    const auto stopping = [&] { return stop.stop_requested(); };
+    while (!checkpoint_cv_.wait_for(lock, stop, options_.checkpoint_interval, stopping)) {
+        const auto version = store_->version();
+        if (version == last) {
+            continue;
+        }
+        lock.unlock();
+        auto written = checkpoint();
+        lock.lock();
+        // A failed checkpoint is retried on the next tick, whether or not anything is written meanwhile.
+        if (written) {
+            last = version;
+        }
+        checkpoint_failure_ = written ? std::nullopt : std::optional { written.error() };
+    }
+}
+
+auto DurableStore::commit(std::unique_lock<std::mutex>& lock, FrameKind kind, std::span<const std::uint8_t> payload)
+  -> Result<void> {
+    const auto wal = wal_;
+    const auto version = store_->version();
+    const auto lsn = wal->append(WalFrame { kind, version, stamp_, payload });
+    if (changes_) {
+        changes_->publish(std::make_shared<const ChangeEvent>(
+          ChangeEvent { version, kind, stamp_, std::vector<std::uint8_t> { payload.begin(), payload.end() } }));
+    }
+    lock.unlock();
+    return wal->wait(lsn);
+}
+
+auto DurableStore::log_path(std::uint64_t sequence) const -> std::filesystem::path {
+    return directory_ / fmt::format("{:020}{}", sequence, WAL_EXTENSION);
+}
+
+auto DurableStore::read_log(CommitVersion from, std::size_t max) const -> Result<std::vector<ChangeFeed::Event>> {
+    auto events = std::vector<ChangeFeed::Event> {};
+    const auto visit = [&](const WalFrame& frame) -> Result<bool> {
+        const auto expected = events.empty() ? from : events.back()->sequence + 1;
+        // Frames a checkpoint already covered are left in the first file after it.
+        if (frame.version < expected) {
+            return true;
+        }
+        if (frame.version > expected) {
+            return fail(
+              ErrorCode::FailedPrecondition,
+              fmt::format("version {} is no longer in the write-ahead log", expected));
+        }
+        events.push_back(std::make_shared<const ChangeEvent>(ChangeEvent {
+          frame.version,
+          frame.kind,
+          frame.timestamp,
+          std::vector<std::uint8_t> { frame.payload.begin(), frame.payload.end() },
+        }));
+        return events.size() < max;
+    };
+    for (const auto& path : log_files()) {
+        if (events.size() >= max) {
+            break;
+        }
+        auto read = read_wal(path, visit);
+        // A file a checkpoint removed since it was listed held nothing the next one does not start after.
+        if (!read && read.error().code != ErrorCode::FailedPrecondition && !std::filesystem::exists(path)) {
+            continue;
+        }
+        if (!read) {
+            return cpp::fail(std::move(read).error());
+        }
+    }
+    // Whatever is still being written to the last file is read by the next call; the feed holds it meanwhile.
+    return events;
+}
+
+auto DurableStore::replay(const WalFrame& frame) -> Result<void> {
+    if (frame.version <= store_->version()) {
+        // Already in the checkpoint.
+        return {};
+    }
+    const auto corrupt = [&](const StoreError& error) {
+        return fail(
+          ErrorCode::DataLoss,
+          fmt::format("replaying the write-ahead log to version {}: {}", frame.version, error.message));
+    };
+
+    stamp_ = frame.timestamp;
+    auto applied = Result<void> {};
+    switch (frame.kind) {
+        case FrameKind::Create: {
+            auto decoded = messages::decode_create_request(frame.payload);
+            if (!decoded) {
+                return corrupt(decoded.error());
+            }
+            if (auto created = store_->create(decoded->note, decoded->id); !created) {
+                applied = cpp::fail(std::move(created).error());
+            }
+            break;
+        }
+        case FrameKind::Update: {
+            auto edit = messages::decode_update_request(frame.payload);
+            if (!edit) {
+                return corrupt(edit.error());
+            }
+            applied = store_->edit(*edit);
+            break;
+        }
+        case FrameKind::UpdateMany: {
+            auto decoded = messages::decode_update_notes_request(frame.payload);
+            if (!decoded) {
+                return corrupt(decoded.error());
+            }
+            // Targets that failed the first time fail again the same way; only the version check below matters.
+            auto edits = std::vector<NoteEdit> {};
+            for (auto& edit : *decoded) {
+                if (edit) {
+                    edits.push_back(std::move(*edit));
+                }
+            }
+            (void) store_->edit_many(edits);
+            break;
+        }
+        case FrameKind::Delete: {
+            auto id = messages::decode_delete_request(frame.payload);
+            if (!id) {
+                return corrupt(id.error());
+            }
+            applied = store_->remove(*id);
+            break;
+        }
+        case FrameKind::DeleteMany: {
+            auto decoded = messages::decode_delete_notes_request(frame.payload);
+            if (!decoded) {
+                return corrupt(decoded.error());
+            }
+            auto ids = std::vector<NoteId> {};
+            for (auto& id : *decoded) {
+                if (id) {
+                    ids.push_back(*id);
+                }
+            }
+            (void) store_->remove_many(ids);
+            break;
+        }
+    }
+    if (!applied) {
+        return corrupt(applied.error());
+    }
+    if (store_->version() != frame.version) {
+        return corrupt(StoreError {
+          ErrorCode::DataLoss,
+          fmt::format("the store is at version {}", store_->version()),
+        });
+    }
+    return {};
+}
+
+}  // namespace pg::store
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pg/store/Export.hpp>
+#include <pg/store/Messages.hpp>
+
+#include <boost/uuid/uuid_io.hpp>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace pg::store {
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Totals {
+        std::atomic<std::size_t> notes { 0 };
+        std::atomic<std::uint64_t> bytes { 0 };
+        /// Set when any output fails, so that the others stop at their next chunk.
+        std::atomic<bool> failed { false };
+    };
+
+    auto nanoseconds_of(Timestamp timestamp) -> std::int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    }
+
+    /**
+     * Append one line per note of `notes` to `buffer`.
+     */
+    void encode_json_lines(std::span<const NoteView> notes, rapidjson::StringBuffer& buffer) {
+        auto writer = rapidjson::Writer<rapidjson::StringBuffer> { buffer };
+        for (const auto& note : notes) {
+            writer.Reset(buffer);
+            const auto id = boost::uuids::to_string(note.id);
+            writer.StartObject();
+            writer.Key("id");
+            writer.String(id.data(), static_cast<rapidjson::SizeType>(id.size()));
+            writer.Key("title");
+            writer.String(note.title.data(), static_cast<rapidjson::SizeType>(note.title.size()));
+            writer.Key("content");
+            writer.String(note.content.data(), static_cast<rapidjson::SizeType>(note.content.size()));
+            writer.Key("tags");
+            writer.StartArray();
+            for (const auto tag : note.tags) {
+                writer.String(tag.data(), static_cast<rapidjson::SizeType>(tag.size()));
+            }
+            writer.EndArray();
+            writer.Key("created");
+            writer.Int64(nanoseconds_of(note.created));
+            writer.Key("updated");
+            writer.Int64(nanoseconds_of(note.updated));
+            writer.EndObject();
+            buffer.Put('\n');
+        }
+    }
+
+    /**
+     * Write the notes of `[first, last)` visible at `snapshot` to `out`, a chunk at a time.
+     */
+    auto export_range(
+      const NoteStore& store,
+      const Snapshot& snapshot,
+      NoteOrdinal first,
+      NoteOrdinal last,
+      File& out,
+      const ExportOptions& options,
+      Totals& totals) -> Result<void> {
+        auto notes = std::vector<NoteView> {};
+        auto json = rapidjson::StringBuffer {};
+        for (auto ordinal = first; ordinal < last && !totals.failed.load(std::memory_order_relaxed);) {
+            // Views into compressed blocks live as long as the snapshot they were read through: this one chunk.
+            const auto chunk = store.snapshot(snapshot);
+            auto chunk_bytes = std::size_t { 0 };
+            notes.clear();
+            for (; ordinal < last && chunk_bytes < std::max<std::size_t>(options.chunk_bytes, 1); ++ordinal) {
+                if (const auto note = store.peek(ordinal, chunk)) {
+                    chunk_bytes += note->title.size() + note->content.size();
+                    notes.push_back(*note);
+                }
+            }
+            if (notes.empty()) {
+                continue;
+            }
+
+            auto written = Result<void> {};
+            auto bytes = std::size_t { 0 };
+            if (options.format == ExportFormat::JsonLines) {
+                json.Clear();
+                encode_json_lines(notes, json);
+                bytes = json.GetSize();
+                written = out.write({ reinterpret_cast<const std::uint8_t*>(json.GetString()), bytes });
+            } else {
+                const auto encoded = messages::encode_note_storage(notes);
+                bytes = encoded.size();
+                written = out.write(encoded);
+            }
+            if (!written) {
+                totals.failed.store(true, std::memory_order_relaxed);
+                return written;
+            }
+            totals.notes.fetch_add(notes.size(), std::memory_order_relaxed);
+            totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        return {};
+    }
+}  // namespace
+
+auto export_notes(const NoteStore& store, File& out, const ExportOptions& options) -> Result<ExportStats> {
+    return export_notes(store, std::span { &out, 1 }, options);
+}
+
+auto export_notes(const NoteStore& store, std::span<File> outputs, const ExportOptions& options)
+  -> Result<ExportStats> {
+    const auto started = Clock::now();
+    const auto snapshot = store.snapshot();
+    auto end = NoteOrdinal { 0 };
+    {
+        auto lock = store.read_lock();
+        end = store.ordinal_horizon(snapshot.version());
+    }
+
+    auto totals = Totals {};
+    const auto shards = std::max<std::size_t>(outputs.size(), 1);
+    const auto bound = [&](std::size_t shard) {
+        return static_cast<NoteOrdinal>(std::uint64_t { end } * shard / shards);
+    };
+    auto failure = std::optional<StoreError> {};
+    if (outputs.size() == 1) {
+        if (auto exported = export_range(store, snapshot, 0, end, outputs.front(), options, totals); !exported) {
+            failure = std::move(exported).error();
+        }
+    } else {
+        auto mutex = std::mutex {};
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(outputs.size());
+        for (std::size_t shard = 0; shard < outputs.size(); ++shard) {
+            pool.emplace_back([&, shard] {
+                auto exported = export_range(
+                  store, snapshot, bound(shard), bound(shard + 1), outputs[shard], options, totals);
+                if (!exported) {
+                    auto lock = std::scoped_lock { mutex };
+                    if (!failure) {
+                        failure = std::move(exported).error();
+                    }
+                }
+            });
+        }
+    }
+    if (failure) {
+        return cpp::fail(std::move(*failure));
+    }
+    return ExportStats {
+        .version = snapshot.version(),
+        .notes = totals.notes.load(),
+        .bytes = totals.bytes.load(),
+        .elapsed = Clock::now() - started,
+    };
+}
+
+}  // namespace pg::store
@@ -0,0 +1,267 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include <pg/store/File.hpp>
+
+#ifdef _WIN32
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <fcntl.h>
+#    include <io.h>
+#    include <sys/stat.h>
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace pg::store {
+namespace {
+
+auto os_error(const std::filesystem::path& path, std::string_view what, int error = errno) {
+    return fail(
+      ErrorCode::Internal,
+      fmt::format("{} {}: {}", what, path.string(), std::system_category().message(error)));
+}
+
+}  // namespace
+
+auto File::open(const std::filesystem::path& path, Mode mode) -> Result<File> {
+#ifdef _WIN32
+    auto flags = _O_BINARY | _O_NOINHERIT;
+    switch (mode) {
+        case Mode::Read: flags |= _O_RDONLY; break;
+        case Mode::Append: flags |= _O_WRONLY | _O_CREAT | _O_APPEND; break;
+        case Mode::Truncate: flags |= _O_RDWR | _O_CREAT | _O_TRUNC; break;
+    }
+    const auto fd = ::_wopen(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    auto flags = O_CLOEXEC;
+    switch (mode) {
+        case Mode::Read: flags |= O_RDONLY; break;
+        case Mode::Append: flags |= O_WRONLY | O_CREAT | O_APPEND; break;
+        case Mode::Truncate: flags |= O_RDWR | O_CREAT | O_TRUNC; break;
+    }
+    auto fd = 0;
+    do {
+        fd = ::open(path.c_str(), flags, 0644);
+    } while (fd < 0 && errno == EINTR);
+#endif
+    if (fd < 0) {
+        return os_error(path, "cannot open");
+    }
+    return File { fd, path };
+}
+
+auto File::size() const -> Result<std::uint64_t> {
+#ifdef _WIN32
+    struct _stat64 info {};
+    if (::_fstat64(fd_, &info) != 0) {
+        return os_error(path_, "cannot stat");
+    }
+#else
+    struct stat info {};
+    if (::fstat(fd_, &info) != 0) {
+        return os_error(path_, "cannot stat");
+    }
+#endif
+    return static_cast<std::uint64_t>(info.st_size);
+}
+
+auto File::read_at(std::uint64_t offset, std::span<std::uint8_t> out) const -> Result<std::size_t> {
+    auto total = std::size_t { 0 };
+    while (total < out.size()) {
+#ifdef _WIN32
+        if (::_lseeki64(fd_, static_cast<__int64>(offset + total), SEEK_SET) < 0) {
+            return os_error(path_, "cannot seek");
+        }
+        const auto chunk = static_cast<unsigned>(std::min<std::size_t>(out.size() - total, 1U << 30));
+        const auto got = ::_read(fd_, out.data() + total, chunk);
+#else
+        const auto got = ::pread(fd_, out.data() + total, out.size() - total, static_cast<off_t>(offset + total));
+#endif
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return os_error(path_, "cannot read");
+        }
+        if (got == 0) {
+            break;
+        }
+        total += static_cast<std::size_t>(got);
+    }
+    return total;
+}
+
+auto File::write(std::span<const std::uint8_t> bytes) -> Result<void> {
+    while (!bytes.empty()) {
+#ifdef _WIN32
+        const auto chunk = static_cast<unsigned>(std::min<std::size_t>(bytes.size(), 1U << 30));
+        const auto wrote = ::_write(fd_, bytes.data(), chunk);
+#else
+        const auto wrote = ::write(fd_, bytes.data(), bytes.size());
+#endif
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return os_error(path_, "cannot write");
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(wrote));
+    }
+    return {};
+}
+
+auto File::write_at(std::uint64_t offset, std::span<const std::uint8_t> bytes) -> Result<void> {
+#ifdef _WIN32
+    const auto resume = ::_telli64(fd_);
+    if (resume < 0 || ::_lseeki64(fd_, static_cast<__int64>(offset), SEEK_SET) < 0) {
+        return os_error(path_, "cannot seek");
+    }
+    auto written = write(bytes);
+    if (::_lseeki64(fd_, resume, SEEK_SET) < 0 && written) {
+        return os_error(path_, "cannot seek");
+    }
+    return written;
+#else
+    while (!bytes.empty()) {
+        const auto wrote = ::pwrite(fd_, bytes.data(), bytes.size(), static_cast<off_t>(offset));
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return os_error(path_, "cannot write");
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(wrote));
+        offset += static_cast<std::uint64_t>(wrote);
+    }
+    return {};
+#endif
+}
+
+auto File::sync() -> Result<void> {
+#ifdef _WIN32
+    const auto synced = ::_commit(fd_);
+#elif defined(__APPLE__)
+    const auto synced = ::fsync(fd_);
+#else
+    const auto synced = ::fdatasync(fd_);
+#endif
+    if (synced != 0) {
+        return os_error(path_, "cannot sync");
+    }
+    return {};
+}
+
+auto File::truncate(std::uint64_t size) -> Result<void> {
+#ifdef _WIN32
+    const auto truncated = ::_chsize_s(fd_, static_cast<__int64>(size));
+#else
+    const auto truncated = ::ftruncate(fd_, static_cast<off_t>(size));
+#endif
+    if (truncated != 0) {
+        return os_error(path_, "cannot truncate");
+    }
+    return {};
+}
+
+void File::close() noexcept {
+    if (fd_ >= 0) {
+#ifdef _WIN32
+        ::_close(fd_);
+#else
+        ::close(fd_);
+#endif
+        fd_ = -1;
+    }
+}
+
+auto MappedFile::open(const std::filesystem::path& path) -> Result<MappedFile> {
+    auto file = File::open(path, File::Mode::Read);
+    if (!file) {
+        return cpp::fail(std::move(file).error());
+    }
+    auto size = file->size();
+    if (!size) {
+        return cpp::fail(std::move(size).error());
+    }
+    if (*size == 0) {
+        return MappedFile { nullptr, 0, path };
+    }
+    if (*size > std::numeric_limits<std::size_t>::max()) {
+        return fail(ErrorCode::ResourceExhausted, fmt::format("{} is too large to map", path.string()));
+    }
+    const auto length = static_cast<std::size_t>(*size);
+#ifdef _WIN32
+    auto* handle = reinterpret_cast<HANDLE>(::_get_osfhandle(file->descriptor()));
+    auto* mapping = ::CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        return os_error(path, "cannot map", static_cast<int>(::GetLastError()));
+    }
+    // The view keeps the mapping alive on its own.
+    auto* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+    const auto error = ::GetLastError();
+    ::CloseHandle(mapping);
+    if (data == nullptr) {
+        return os_error(path, "cannot map", static_cast<int>(error));
+    }
+#else
+    auto* data = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file->descriptor(), 0);
+    if (data == MAP_FAILED) {
+        return os_error(path, "cannot map");
+    }
+#endif
+    // The mapping outlives the descriptor.
+    return MappedFile { static_cast<const std::uint8_t*>(data), length, path };
+}
+
+void MappedFile::unmap() noexcept {
+    if (data_ != nullptr) {
+#ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<std::uint8_t*>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+auto sync_directory(const std::filesystem::path& path) -> Result<void> {
+#ifdef _WIN32
+    (void) path;
+    return {};
+#else
+    const auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path { "." };
+    const auto fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return os_error(directory, "cannot open directory");
+    }
+    const auto synced = ::fsync(fd);
+    const auto error = errno;
+    ::close(fd);
+    if (synced != 0) {
+        return os_error(directory, "cannot sync directory", error);
+    }
+    return {};
+#endif
+}
+
+}  // namespace pg::store
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <bit>
+#include <random>
+
+#include <pg/store/IdGenerator.hpp>
+
+namespace pg::store {
+
+namespace {
+    constexpr std::uint64_t TIMESTAMP_MASK = (std::uint64_t { 1 } << 48) - 1;
+    constexpr std::uint64_t SEQUENCE_MAX = 0xFFF;
+    /// A new millisecond starts its sequence below this, leaving at least half the range to count up through.
+    constexpr std::uint64_t SEQUENCE_START_MASK = 0x7FF;
+    constexpr std::uint64_t VERSION = 0x7000;
+    constexpr std::uint64_t VARIANT = std::uint64_t { 0b10 } << 62;
+
+    auto splitmix64(std::uint64_t& state) noexcept -> std::uint64_t {
+        auto z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    void store_big_endian(std::uint8_t* out, std::uint64_t value) noexcept {
+        for (int i = 7; i >= 0; --i) {
+            out[i] = static_cast<std::uint8_t>(value);
+            value >>= 8;
+        }
+    }
+
+    auto load_big_endian(const std::uint8_t* in) noexcept -> std::uint64_t {
+        auto value = std::uint64_t { 0 };
+        for (int i = 0; i < 8; ++i) {
+            value = (value << 8) | in[i];
+        }
+        return value;
+    }
+}  // namespace
+
+IdGenerator::IdGenerator()
+    : IdGenerator { [] {
+        auto device = std::random_device {};
+        return (std::uint64_t { device() } << 32) | device();
+    }() } { }
+
+IdGenerator::IdGenerator(std::uint64_t seed) noexcept {
+    state_[0] = splitmix64(seed);
+    state_[1] = splitmix64(seed);
+}
+
+auto IdGenerator::operator()(Clock::time_point now) noexcept -> NoteId {
+    const auto millis = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count());
+    if (millis > millis_) {
+        millis_ = millis;
+        sequence_ = next_random() & SEQUENCE_START_MASK;
+    } else if (++sequence_ > SEQUENCE_MAX) {
+        ++millis_;
+        sequence_ = 0;
+    }
+
+    auto id = NoteId {};
+    store_big_endian(id.begin(), ((millis_ & TIMESTAMP_MASK) << 16) | VERSION | sequence_);
+    store_big_endian(id.begin() + 8, (next_random() >> 2) | VARIANT);
+    return id;
+}
+
+auto IdGenerator::time_of(const NoteId& id) noexcept -> Clock::time_point {
+    const auto millis = load_big_endian(id.begin()) >> 16;
+    return Clock::time_point { std::chrono::duration_cast<Clock::duration>(
+      std::chrono::milliseconds { static_cast<std::chrono::milliseconds::rep>(millis) }) };
+}
+
+auto IdGenerator::next_random() noexcept -> std::uint64_t {
+    const auto s0 = state_[0];
+    auto s1 = state_[1];
+    const auto result = std::rotl(s0 + s1, 17) + s0;
+    s1 ^= s0;
+    state_[0] = std::rotl(s0, 49) ^ s1 ^ (s1 << 21);
+    state_[1] = std::rotl(s1, 28);
+    return result;
+}
+
+auto generate_note_id() -> NoteId {
+    thread_local auto generator = IdGenerator {};
+    return generator();
+}
+
+}  // namespace pg::store
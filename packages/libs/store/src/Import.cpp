@@ -0,0 +1,489 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/data/NoteDto.hpp>
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/Import.hpp>
+
+#include <rapidjson/error/en.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+
+namespace pg::store {
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * SAX handler building the `data::CreateNote` of one line.
+     */
+    class NoteHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, NoteHandler> {
+      public:
+        auto String(const char* text, rapidjson::SizeType length, bool /*copy*/) -> bool {
+            switch (position()) {
+                case Position::Root: return reject("not a JSON object");
+                case Position::Field:
+                    if (field_ == Field::Tags) {
+                        return reject("`tags` is not an array");
+                    }
+                    (field_ == Field::Title ? note_.title : note_.content) = std::string { text, length };
+                    return true;
+                case Position::Tag: note_.tags->emplace_back(text, length); return true;
+                case Position::Ignored: return true;
+            }
+            return true;
+        }
+
+        auto Null() -> bool {
+            const auto at = position();
+            return at == Position::Root || at == Position::Tag ? Default() : true;
+        }
+
+        /**
+         * Every other scalar.
+         */
+        auto Default() -> bool {
+            switch (position()) {
+                case Position::Root: return reject("not a JSON object");
+                case Position::Field: return reject(fmt::format("`{}` is not a string", name()));
+                case Position::Tag: return reject("`tags` holds a value that is not a string");
+                case Position::Ignored: return true;
+            }
+            return true;
+        }
+
+        auto StartObject() -> bool {
+            if (depth_ > 0 && position() != Position::Ignored) {
+                return Default();
+            }
+            ++depth_;
+            return true;
+        }
+
+        auto Key(const char* text, rapidjson::SizeType length, bool /*copy*/) -> bool {
+            if (depth_ == 1) {
+                const auto key = std::string_view { text, length };
+                field_ = key == "title" ? Field::Title
+                       : key == "content" ? Field::Content
+                       : key == "tags" ? Field::Tags
+                                       : Field::None;
+            }
+            return true;
+        }
+
+        auto EndObject(rapidjson::SizeType /*members*/) -> bool {
+            --depth_;
+            return true;
+        }
+
+        auto StartArray() -> bool {
+            const auto at = position();
+            if (at == Position::Field && field_ == Field::Tags) {
+                note_.tags.emplace();
+                in_tags_ = true;
+            } else if (at != Position::Ignored) {
+                return Default();
+            }
+            ++depth_;
+            return true;
+        }
+
+        auto EndArray(rapidjson::SizeType /*elements*/) -> bool {
+            if (--depth_ == 1) {
+                in_tags_ = false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] auto take() -> data::CreateNote { return std::exchange(note_, data::CreateNote {}); }
+        [[nodiscard]] auto error() const noexcept -> const std::string& { return error_; }
+
+        void reset() {
+            note_ = {};
+            error_.clear();
+            depth_ = 0;
+            field_ = Field::None;
+            in_tags_ = false;
+        }
+
+      private:
+        enum class Field { None, Title, Content, Tags };
+
+        /// Where the next value goes.
+        enum class Position { Root, Field, Tag, Ignored };
+
+        [[nodiscard]] auto position() const noexcept -> Position {
+            if (depth_ == 0) {
+                return Position::Root;
+            }
+            if (depth_ == 1 && field_ != Field::None) {
+                return Position::Field;
+            }
+            return depth_ == 2 && in_tags_ ? Position::Tag : Position::Ignored;
+        }
+
+        [[nodiscard]] auto name() const noexcept -> std::string_view {
+            return field_ == Field::Title ? "title" : field_ == Field::Content ? "content" : "tags";
+        }
+
+        auto reject(std::string why) -> bool {
+            error_ = std::move(why);
+            return false;
+        }
+
+        data::CreateNote note_;
+        std::string error_;
+        std::size_t depth_ = 0;
+        Field field_ = Field::None;
+        bool in_tags_ = false;
+    };
+
+    struct Parsed {
+        std::vector<data::CreateNote> notes;
+        std::size_t skipped = 0;
+        std::optional<StoreError> error;
+        /// The input offset parsing stopped at: the end of the chunk, or the start of the invalid line.
+        std::uint64_t end = 0;
+    };
+
+    auto is_blank(std::string_view line) -> bool {
+        return std::ranges::all_of(line, [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
+    }
+
+    /**
+     * Parse the lines of `chunk`, which starts at input offset `base`.
+     */
+    auto parse_chunk(std::string_view chunk, std::uint64_t base, bool skip_invalid) -> Parsed {
+        auto parsed = Parsed {};
+        parsed.end = base + chunk.size();
+        auto reader = rapidjson::Reader {};
+        auto handler = NoteHandler {};
+        for (std::size_t start = 0; start < chunk.size();) {
+            const auto newline = chunk.find('\n', start);
+            const auto end = newline == std::string_view::npos ? chunk.size() : newline;
+            const auto line = chunk.substr(start, end - start);
+            const auto offset = base + start;
+            start = end + 1;
+            if (is_blank(line)) {
+                continue;
+            }
+
+            handler.reset();
+            auto stream = rapidjson::MemoryStream { line.data(), line.size() };
+            const auto result = reader.Parse<rapidjson::kParseValidateEncodingFlag>(stream, handler);
+            if (!result.IsError()) {
+                parsed.notes.push_back(handler.take());
+                continue;
+            }
+            if (skip_invalid) {
+                ++parsed.skipped;
+                continue;
+            }
+            const auto why = handler.error().empty() ? std::string { rapidjson::GetParseError_En(result.Code()) }
+                                                     : handler.error();
+            parsed.error = StoreError {
+                ErrorCode::InvalidArgument,
+                fmt::format("line at offset {}: {}", offset, why),
+            };
+            parsed.end = offset;
+            break;
+        }
+        return parsed;
+    }
+
+    /**
+     * Where each chunk of `[from, input.size())` ends: `chunk_bytes` on, just past the next newline.
+     */
+    auto split(std::string_view input, std::uint64_t from, std::size_t chunk_bytes) -> std::vector<std::uint64_t> {
+        auto ends = std::vector<std::uint64_t> {};
+        const auto step = std::max<std::size_t>(chunk_bytes, 1);
+        for (auto start = static_cast<std::size_t>(from); start < input.size();) {
+            const auto target = std::min(input.size(), start + step) - 1;
+            const auto newline = input.find('\n', target);
+            start = newline == std::string_view::npos ? input.size() : newline + 1;
+            ends.push_back(start);
+        }
+        return ends;
+    }
+
+    template <typename Fn>
+    struct OnExit {
+        Fn fn;
+
+        ~OnExit() { fn(); }
+    };
+
+    struct ProgressEntry {
+        CommitVersion version = 0;
+        std::uint64_t offset = 0;
+    };
+
+    /**
+     * Every entry of the progress file at `path`, oldest first; none if there is no such file.
+     */
+    auto read_progress(const std::filesystem::path& path) -> Result<std::vector<ProgressEntry>> {
+        auto entries = std::vector<ProgressEntry> {};
+        auto error = std::error_code {};
+        if (!std::filesystem::exists(path, error)) {
+            return entries;
+        }
+        auto file = File::open(path, File::Mode::Read);
+        if (!file) {
+            return cpp::fail(std::move(file).error());
+        }
+        auto size = file->size();
+        if (!size) {
+            return cpp::fail(std::move(size).error());
+        }
+        auto bytes = std::string(static_cast<std::size_t>(*size), '\0');
+        auto read = file->read_at(0, { reinterpret_cast<std::uint8_t*>(bytes.data()), bytes.size() });
+        if (!read) {
+            return cpp::fail(std::move(read).error());
+        }
+        bytes.resize(*read);
+
+        auto text = std::string_view { bytes };
+        while (!text.empty()) {
+            const auto newline = text.find('\n');
+            // A line the last run did not finish writing never had its checkpoint written either.
+            if (newline == std::string_view::npos) {
+                break;
+            }
+            const auto line = text.substr(0, newline);
+            text.remove_prefix(newline + 1);
+            auto entry = ProgressEntry {};
+            const auto space = line.find(' ');
+            const auto* const first = line.data();
+            const auto* const last = line.data() + line.size();
+            const auto version = std::from_chars(first, first + std::min(space, line.size()), entry.version);
+            const auto offset = space == std::string_view::npos
+                                ? std::from_chars_result { first, std::errc::invalid_argument }
+                                : std::from_chars(first + space + 1, last, entry.offset);
+            if (version.ec != std::errc {} || offset.ec != std::errc {} || offset.ptr != last) {
+                return fail(ErrorCode::DataLoss, fmt::format("{} holds an invalid entry: {}", path.string(), line));
+            }
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    auto append_progress(const std::filesystem::path& path, ProgressEntry entry) -> Result<void> {
+        auto error = std::error_code {};
+        const auto existed = std::filesystem::exists(path, error);
+        auto file = File::open(path, File::Mode::Append);
+        if (!file) {
+            return cpp::fail(std::move(file).error());
+        }
+        const auto line = fmt::format("{} {}\n", entry.version, entry.offset);
+        const auto line_bytes = std::span { reinterpret_cast<const std::uint8_t*>(line.data()), line.size() };
+        if (auto written = file->write(line_bytes); !written) {
+            return cpp::fail(std::move(written).error());
+        }
+        if (auto synced = file->sync(); !synced) {
+            return cpp::fail(std::move(synced).error());
+        }
+        if (!existed) {
+            return sync_directory(path);
+        }
+        return {};
+    }
+}  // namespace
+
+auto import_json_lines(
+  NoteStore& store,
+  const std::filesystem::path& input,
+  const ImportOptions& options,
+  const ImportProgress& progress) -> Result<ImportStats> {
+    const auto started = Clock::now();
+    auto stats = ImportStats {};
+    auto mapped = MappedFile::open(input);
+    if (!mapped) {
+        return cpp::fail(std::move(mapped).error());
+    }
+    const auto bytes = mapped->bytes();
+    const auto text = std::string_view { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+
+    const auto checkpointed = !options.checkpoint_directory.empty();
+    const auto progress_path = options.checkpoint_directory / IMPORT_PROGRESS_FILE;
+    auto checkpoints = std::optional<CheckpointWriter> {};
+    if (checkpointed) {
+        auto error = std::error_code {};
+        std::filesystem::create_directories(options.checkpoint_directory, error);
+        if (error) {
+            return fail(
+              ErrorCode::Internal,
+              fmt::format("cannot create {}: {}", options.checkpoint_directory.string(), error.message()));
+        }
+        auto entries = read_progress(progress_path);
+        if (!entries) {
+            return cpp::fail(std::move(entries).error());
+        }
+        if (entries->empty()) {
+            if (auto recorded = append_progress(progress_path, { store.version(), 0 }); !recorded) {
+                return cpp::fail(std::move(recorded).error());
+            }
+        } else {
+            const auto found = std::find_if(entries->rbegin(), entries->rend(), [&](const ProgressEntry& entry) {
+                return entry.version == store.version();
+            });
+            if (found == entries->rend()) {
+                return fail(
+                  ErrorCode::FailedPrecondition,
+                  fmt::format(
+                    "the store is at version {}, which {} has no entry for; load it from the checkpoint there first",
+                    store.version(),
+                    progress_path.string()));
+            }
+            stats.resumed_from = std::min<std::uint64_t>(found->offset, text.size());
+        }
+        checkpoints.emplace(options.checkpoint_directory, store.checkpoint());
+    }
+    stats.offset = stats.resumed_from;
+    const auto deferring = options.defer_indexes && !store.bulk_loading();
+    if (deferring) {
+        store.begin_bulk_load();
+    }
+
+    auto checkpointed_at = stats.offset;
+    const auto checkpoint = [&]() -> Result<void> {
+        auto dirty = store.take_dirty_chunks();
+        if (auto recorded = append_progress(progress_path, { store.version(), stats.offset }); !recorded) {
+            return cpp::fail(std::move(recorded).error());
+        }
+        if (auto written = checkpoints->write(store, std::move(dirty)); !written) {
+            return cpp::fail(std::move(written).error());
+        }
+        ++stats.checkpoints;
+        checkpointed_at = stats.offset;
+        return {};
+    };
+
+    const auto ends = split(text, stats.offset, options.chunk_bytes);
+    const auto begin_of = [&](std::size_t chunk) { return chunk == 0 ? stats.resumed_from : ends[chunk - 1]; };
+    const auto configured = options.threads != 0 ? options.threads
+                                                 : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    const auto threads = std::clamp<std::size_t>(configured, 1, std::max<std::size_t>(ends.size(), 1));
+    // Chunk `i` is parsed into `parsed[i % window]`, which is free once chunk `i - window` has been inserted.
+    const auto window = threads * 2;
+
+    auto mutex = std::mutex {};
+    auto ready = std::condition_variable {};
+    auto room = std::condition_variable {};
+    auto parsed = std::vector<std::optional<Parsed>>(window);
+    std::size_t claimed = 0;
+    std::size_t inserted = 0;
+    auto stopping = false;
+
+    const auto parser = [&] {
+        while (true) {
+            auto lock = std::unique_lock { mutex };
+            room.wait(lock, [&] { return stopping || claimed >= ends.size() || claimed < inserted + window; });
+            if (stopping || claimed >= ends.size()) {
+                return;
+            }
+            const auto chunk = claimed++;
+            lock.unlock();
+
+            const auto begin = begin_of(chunk);
+            auto result = parse_chunk(text.substr(begin, ends[chunk] - begin), begin, options.skip_invalid);
+            lock.lock();
+            parsed[chunk % window] = std::move(result);
+            lock.unlock();
+            ready.notify_all();
+        }
+    };
+
+    auto failure = std::optional<StoreError> {};
+    // Whether what got in before a failure can still be checkpointed.
+    auto can_checkpoint = checkpointed;
+    {
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(threads);
+        for (std::size_t i = 0; i < threads && !ends.empty(); ++i) {
+            pool.emplace_back(parser);
+        }
+        // Declared after the pool, so the parsers are told to stop before it joins them, however this scope is left.
+        const auto stop = OnExit { [&] {
+            {
+                auto lock = std::scoped_lock { mutex };
+                stopping = true;
+            }
+            room.notify_all();
+        } };
+
+        for (std::size_t chunk = 0; chunk < ends.size(); ++chunk) {
+            auto batch = Parsed {};
+            {
+                auto lock = std::unique_lock { mutex };
+                auto& slot = parsed[chunk % window];
+                ready.wait(lock, [&] { return slot.has_value(); });
+                batch = std::move(*slot);
+                slot.reset();
+                inserted = chunk + 1;
+            }
+            room.notify_all();
+
+            if (auto created = store.create_many(batch.notes); !created) {
+                failure = std::move(created).error();
+                break;
+            }
+            stats.notes += batch.notes.size();
+            stats.skipped += batch.skipped;
+            // Up to the invalid line, if there is one, so that a run after it is fixed starts there.
+            stats.offset = batch.end;
+            if (batch.error) {
+                failure = std::move(batch.error);
+                break;
+            }
+            if (checkpointed && stats.offset - checkpointed_at >= options.checkpoint_bytes) {
+                if (auto written = checkpoint(); !written) {
+                    failure = std::move(written).error();
+                    can_checkpoint = false;
+                    break;
+                }
+            }
+            stats.elapsed = Clock::now() - started;
+            if (progress) {
+                progress(stats);
+            }
+        }
+    }
+    if (deferring) {
+        // Whatever got in before a failure is indexed too.
+        const auto indexing = Clock::now();
+        store.end_bulk_load();
+        stats.indexing = Clock::now() - indexing;
+    }
+    if (can_checkpoint && stats.offset != checkpointed_at) {
+        if (auto written = checkpoint(); !written && !failure) {
+            failure = std::move(written).error();
+        }
+    }
+    if (failure) {
+        return cpp::fail(std::move(*failure));
+    }
+    stats.elapsed = Clock::now() - started;
+    return stats;
+}
+
+}  // namespace pg::store
@@ -0,0 +1,191 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <pg/store/Lz.hpp>
+
+namespace pg::store::lz {
+
+namespace {
+    constexpr std::size_t MIN_MATCH = 4;
+    /// The last match must start this far before the end, and the last bytes are always literals, as in LZ4.
+    constexpr std::size_t MATCH_LIMIT = 12;
+    constexpr std::size_t LAST_LITERALS = 5;
+    constexpr std::size_t MAX_OFFSET = 0xFFFF;
+    constexpr unsigned HASH_BITS = 16;
+    /// Output slack, so short copies can be done a word at a time without checking where they end.
+    constexpr std::size_t WILD_COPY = 16;
+    constexpr std::uint32_t NONE = ~std::uint32_t { 0 };
+
+    auto read32(const char* at) noexcept -> std::uint32_t {
+        auto value = std::uint32_t { 0 };
+        std::memcpy(&value, at, sizeof(value));
+        return value;
+    }
+
+    auto hash(std::uint32_t sequence) noexcept -> std::uint32_t {
+        return (sequence * 2654435761U) >> (32 - HASH_BITS);
+    }
+
+    void put_length(std::string& out, std::size_t length) {
+        for (; length >= 255; length -= 255) {
+            out.push_back(static_cast<char>(255));
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+    void put_sequence(std::string& out, std::string_view literals, std::size_t offset, std::size_t match) {
+        const auto literal_nibble = std::min<std::size_t>(literals.size(), 15);
+        const auto match_nibble = match == 0 ? 0 : std::min<std::size_t>(match - MIN_MATCH, 15);
+        out.push_back(static_cast<char>((literal_nibble << 4) | match_nibble));
+        if (literal_nibble == 15) {
+            put_length(out, literals.size() - 15);
+        }
+        out.append(literals);
+        if (match == 0) {
+            return;
+        }
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_nibble == 15) {
+            put_length(out, match - MIN_MATCH - 15);
+        }
+    }
+
+    /**
+     * @brief Read a length extension starting at `at`, adding it to `length`.
+     * @return **false** if the input ends first
+     */
+    auto get_length(std::string_view packed, std::size_t& at, std::size_t& length) noexcept -> bool {
+        for (;;) {
+            if (at >= packed.size()) {
+                return false;
+            }
+            const auto byte = static_cast<unsigned char>(packed[at++]);
+            length += byte;
+            if (byte != 255) {
+                return true;
+            }
+        }
+    }
+}  // namespace
+
+auto compress(std::string_view text, unsigned effort) -> std::string {
+    auto out = std::string {};
+    out.reserve(bound(text.size()));
+    const auto* data = text.data();
+    const auto size = text.size();
+    auto anchor = std::size_t { 0 };
+
+    if (size > MATCH_LIMIT) {
+        // `heads` holds the latest position with each hash, `chain` the one before each position with the same hash.
+        auto heads = std::vector<std::uint32_t>(std::size_t { 1 } << HASH_BITS, NONE);
+        auto chain = std::vector<std::uint32_t>(size, NONE);
+        const auto insert = [&](std::size_t at) {
+            auto& head = heads[hash(read32(data + at))];
+            chain[at] = head;
+            head = static_cast<std::uint32_t>(at);
+        };
+        const auto limit = size - MATCH_LIMIT;
+        const auto attempts = std::max(effort, 1U);
+        auto at = std::size_t { 0 };
+        while (at < limit) {
+            auto length = std::size_t { 0 };
+            auto offset = std::size_t { 0 };
+            auto candidate = heads[hash(read32(data + at))];
+            for (unsigned attempt = 0; attempt < attempts && candidate != NONE && at - candidate <= MAX_OFFSET;
+                 ++attempt, candidate = chain[candidate]) {
+                auto matched = std::size_t { 0 };
+                while (at + matched < size - LAST_LITERALS && data[candidate + matched] == data[at + matched]) {
+                    ++matched;
+                }
+                if (matched > length) {
+                    length = matched;
+                    offset = at - candidate;
+                }
+            }
+            if (length < MIN_MATCH) {
+                insert(at++);
+                continue;
+            }
+            put_sequence(out, text.substr(anchor, at - anchor), offset, length);
+            const auto next = at + length;
+            // Positions inside the match are chained too, so later matches can start anywhere in it.
+            for (const auto end = std::min(next, limit); at < end; ++at) {
+                insert(at);
+            }
+            at = anchor = next;
+        }
+    }
+    put_sequence(out, text.substr(anchor), 0, 0);
+    return out;
+}
+
+auto decompress(std::string_view packed, std::size_t size) -> std::optional<std::string> {
+    auto out = std::string(size + WILD_COPY, '\0');
+    auto at = std::size_t { 0 };
+    auto written = std::size_t { 0 };
+    while (at < packed.size()) {
+        const auto token = static_cast<unsigned char>(packed[at++]);
+        auto literals = static_cast<std::size_t>(token >> 4U);
+        if (literals == 15 && !get_length(packed, at, literals)) {
+            return std::nullopt;
+        }
+        if (literals > packed.size() - at || literals > size - written) {
+            return std::nullopt;
+        }
+        if (literals <= WILD_COPY && packed.size() - at >= WILD_COPY) {
+            std::memcpy(out.data() + written, packed.data() + at, WILD_COPY);
+        } else {
+            std::memcpy(out.data() + written, packed.data() + at, literals);
+        }
+        at += literals;
+        written += literals;
+        if (at == packed.size()) {
+            break;
+        }
+
+        if (packed.size() - at < 2) {
+            return std::nullopt;
+        }
+        const auto offset = static_cast<std::size_t>(static_cast<unsigned char>(packed[at]))
+                          | (static_cast<std::size_t>(static_cast<unsigned char>(packed[at + 1])) << 8);
+        at += 2;
+        auto match = static_cast<std::size_t>(token & 15U);
+        if (match == 15 && !get_length(packed, at, match)) {
+            return std::nullopt;
+        }
+        match += MIN_MATCH;
+        if (offset == 0 || offset > written || match > size - written) {
+            return std::nullopt;
+        }
+        auto* dest = out.data() + written;
+        const auto* source = dest - offset;
+        if (offset >= 8) {
+            // Eight bytes at a time, each word of the source written before it is read, overrunning into the slack.
+            for (std::size_t i = 0; i < match; i += 8) {
+                std::memcpy(dest + i, source + i, 8);
+            }
+        } else {
+            // The match repeats the last `offset` bytes, so it has to be copied forwards a byte at a time.
+            for (std::size_t i = 0; i < match; ++i) {
+                dest[i] = source[i];
+            }
+        }
+        written += match;
+    }
+    if (written != size) {
+        return std::nullopt;
+    }
+    out.resize(size);
+    return out;
+}
+
+}  // namespace pg::store::lz
@@ -0,0 +1,652 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <fmt/format.h>
+
+#include <pg/gen/note.gen.hpp>
+#include <pg/store/Messages.hpp>
+#include <pg/store/PageToken.hpp>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <flatbuffers/flatbuffers.h>
+
+namespace pg::store::messages {
+namespace {
+
+template <typename Query>
+auto text_of(const Query* query, TextMatchKind kind) -> std::optional<TextPredicate> {
+    if (query == nullptr || query->text() == nullptr) {
+        return std::nullopt;
+    }
+    return TextPredicate { kind, query->text()->str(), query->case_sensitive() };
+}
+
+auto to_text(const gen::TextSearchKind* search) -> std::optional<TextPredicate> {
+    if (search == nullptr) {
+        return std::nullopt;
+    }
+    using Kind = gen::TextSearchKind_::KindUnion;
+    switch (search->kind_type()) {
+        case Kind::pg_gen_TextMatchesQuery:
+            return text_of(search->kind_as_pg_gen_TextMatchesQuery(), TextMatchKind::Matches);
+        case Kind::pg_gen_TextContainsQuery:
+            return text_of(search->kind_as_pg_gen_TextContainsQuery(), TextMatchKind::Contains);
+        case Kind::pg_gen_TextStartsWithQuery:
+            return text_of(search->kind_as_pg_gen_TextStartsWithQuery(), TextMatchKind::StartsWith);
+        case Kind::pg_gen_TextEndsWithQuery:
+            return text_of(search->kind_as_pg_gen_TextEndsWithQuery(), TextMatchKind::EndsWith);
+        case Kind::NONE: break;
+    }
+    return std::nullopt;
+}
+
+auto to_date(const gen::DateSearchKind* search) -> std::optional<DatePredicate> {
+    if (search == nullptr) {
+        return std::nullopt;
+    }
+    const auto single = [](const auto* query, DateMatchKind kind) -> std::optional<DatePredicate> {
+        if (query == nullptr || query->date() == nullptr) {
+            return std::nullopt;
+        }
+        const auto date = to_timestamp(*query->date());
+        return DatePredicate { kind, date, date };
+    };
+    const auto range = [](const auto* query, DateMatchKind kind) -> std::optional<DatePredicate> {
+        if (query == nullptr || query->start() == nullptr || query->end() == nullptr) {
+            return std::nullopt;
+        }
+        return DatePredicate { kind, to_timestamp(*query->start()), to_timestamp(*query->end()) };
+    };
+    using Kind = gen::DateSearchKind_::KindUnion;
+    switch (search->kind_type()) {
+        case Kind::pg_gen_BeforeDateQuery:
+            return single(search->kind_as_pg_gen_BeforeDateQuery(), DateMatchKind::Before);
+        case Kind::pg_gen_AfterDateQuery: return single(search->kind_as_pg_gen_AfterDateQuery(), DateMatchKind::After);
+        case Kind::pg_gen_InDateRangeQuery:
+            return range(search->kind_as_pg_gen_InDateRangeQuery(), DateMatchKind::InRange);
+        case Kind::pg_gen_NotInDateRangeQuery:
+            return range(search->kind_as_pg_gen_NotInDateRangeQuery(), DateMatchKind::NotInRange);
+        case Kind::NONE: break;
+    }
+    return std::nullopt;
+}
+
+auto to_predicate(const gen::SearchNoteData& data) -> std::optional<Predicate> {
+    const auto text = [](NoteField field, std::optional<TextPredicate> match) -> std::optional<Predicate> {
+        return match ? std::optional { Predicate { field, std::move(*match) } } : std::nullopt;
+    };
+    const auto date = [](NoteField field, std::optional<DatePredicate> match) -> std::optional<Predicate> {
+        return match ? std::optional { Predicate { field, *match } } : std::nullopt;
+    };
+    using Kind = gen::SearchNoteData_::KindUnion;
+    switch (data.kind_type()) {
+        case Kind::pg_gen_NoteTitleSearch: {
+            const auto* search = data.kind_as_pg_gen_NoteTitleSearch();
+            return text(NoteField::Title, to_text(search != nullptr ? search->title_search() : nullptr));
+        }
+        case Kind::pg_gen_NoteContentSearch: {
+            const auto* search = data.kind_as_pg_gen_NoteContentSearch();
+            return text(NoteField::Content, to_text(search != nullptr ? search->content_search() : nullptr));
+        }
+        case Kind::pg_gen_NoteTagSearch: {
+            const auto* search = data.kind_as_pg_gen_NoteTagSearch();
+            return text(NoteField::Tag, to_text(search != nullptr ? search->tag_search() : nullptr));
+        }
+        case Kind::pg_gen_NoteCreatedSearch: {
+            const auto* search = data.kind_as_pg_gen_NoteCreatedSearch();
+            return date(NoteField::Created, to_date(search != nullptr ? search->created_search() : nullptr));
+        }
+        case Kind::pg_gen_NoteUpdatedSearch: {
+            const auto* search = data.kind_as_pg_gen_NoteUpdatedSearch();
+            return date(NoteField::Updated, to_date(search != nullptr ? search->updated_search() : nullptr));
+        }
+        case Kind::NONE: break;
+    }
+    return std::nullopt;
+}
+
+auto view_of(const flatbuffers::String& text) -> std::string_view {
+    return std::string_view { text.c_str(), text.size() };
+}
+
+auto page_size(std::uint32_t requested) -> std::size_t {
+    return requested == 0 ? DEFAULT_PAGE_SIZE : std::min<std::size_t>(requested, MAX_PAGE_SIZE);
+}
+
+template <typename Table>
+auto root_of(std::span<const std::uint8_t> buffer, std::string_view name) -> Result<const Table*> {
+    auto verifier = flatbuffers::Verifier { buffer.data(), buffer.size() };
+    if (buffer.empty() || !verifier.VerifyBuffer<Table>(nullptr)) {
+        return fail(ErrorCode::InvalidArgument, fmt::format("not a valid {}", name));
+    }
+    return flatbuffers::GetRoot<Table>(buffer.data());
+}
+
+using StringOffset = flatbuffers::Offset<flatbuffers::String>;
+using StringVector = flatbuffers::Vector<StringOffset>;
+
+auto string_of(const flatbuffers::String* text) -> std::string {
+    return text != nullptr ? text->str() : std::string {};
+}
+
+auto strings_of(const StringVector* texts) -> std::vector<std::string> {
+    auto out = std::vector<std::string> {};
+    if (texts != nullptr) {
+        out.reserve(texts->size());
+        for (const auto* text : *texts) {
+            out.push_back(string_of(text));
+        }
+    }
+    return out;
+}
+
+auto parse_id(const flatbuffers::String* text) -> Result<NoteId> {
+    if (text == nullptr || text->size() == 0) {
+        return fail(ErrorCode::InvalidArgument, "missing note id");
+    }
+    try {
+        return boost::uuids::string_generator {}(text->begin(), text->end());
+    } catch (const std::runtime_error&) {
+        return fail(ErrorCode::InvalidArgument, fmt::format("'{}' is not a note id", view_of(*text)));
+    }
+}
+
+auto to_edit(const gen::TextModificationKind& modification) -> std::optional<TextEdit> {
+    using Kind = gen::TextModificationKind_::KindUnion;
+    switch (modification.kind_type()) {
+        case Kind::pg_gen_AppendTextOp: {
+            const auto* op = modification.kind_as_pg_gen_AppendTextOp();
+            return op != nullptr ? std::optional<TextEdit> { AppendText { string_of(op->text()) } } : std::nullopt;
+        }
+        case Kind::pg_gen_InsertTextOp: {
+            const auto* op = modification.kind_as_pg_gen_InsertTextOp();
+            return op != nullptr ? std::optional<TextEdit> { InsertText { op->position(), string_of(op->text()) } }
+                                 : std::nullopt;
+        }
+        case Kind::pg_gen_PrependTextOp: {
+            const auto* op = modification.kind_as_pg_gen_PrependTextOp();
+            return op != nullptr ? std::optional<TextEdit> { PrependText { string_of(op->text()) } } : std::nullopt;
+        }
+        case Kind::pg_gen_RemoveTextRangeOp: {
+            const auto* op = modification.kind_as_pg_gen_RemoveTextRangeOp();
+            return op != nullptr ? std::optional<TextEdit> { RemoveTextRange { op->start(), op->end() } }
+                                 : std::nullopt;
+        }
+        case Kind::pg_gen_ReplaceTextOp: {
+            const auto* op = modification.kind_as_pg_gen_ReplaceTextOp();
+            if (op == nullptr || op->input() == nullptr) {
+                return std::nullopt;
+            }
+            return ReplaceText { string_of(op->input()->search()), string_of(op->input()->replace()) };
+        }
+        case Kind::pg_gen_ReplaceTextMultipleOp: {
+            const auto* op = modification.kind_as_pg_gen_ReplaceTextMultipleOp();
+            if (op == nullptr) {
+                return std::nullopt;
+            }
+            auto replace = ReplaceTextMultiple {};
+            if (op->pairs() != nullptr) {
+                for (const auto* pair : *op->pairs()) {
+                    replace.pairs.push_back(ReplaceText { string_of(pair->search()), string_of(pair->replace()) });
+                }
+            }
+            return replace;
+        }
+        case Kind::pg_gen_RemoveTextOp: {
+            const auto* op = modification.kind_as_pg_gen_RemoveTextOp();
+            return op != nullptr ? std::optional<TextEdit> { RemoveText { string_of(op->removal()) } } : std::nullopt;
+        }
+        case Kind::pg_gen_RemoveTextMultipleOp: {
+            const auto* op = modification.kind_as_pg_gen_RemoveTextMultipleOp();
+            return op != nullptr ? std::optional<TextEdit> { RemoveTextMultiple { strings_of(op->removals()) } }
+                                 : std::nullopt;
+        }
+        case Kind::NONE: break;
+    }
+    return std::nullopt;
+}
+
+auto to_edits(
+  const flatbuffers::Vector<flatbuffers::Offset<gen::TextModificationKind>>* modifications,
+  std::string_view field) -> Result<std::vector<TextEdit>> {
+    auto edits = std::vector<TextEdit> {};
+    if (modifications == nullptr) {
+        return edits;
+    }
+    edits.reserve(modifications->size());
+    for (flatbuffers::uoffset_t i = 0; i < modifications->size(); ++i) {
+        const auto* modification = modifications->Get(i);
+        auto edit = modification != nullptr ? to_edit(*modification) : std::nullopt;
+        if (!edit) {
+            return fail(ErrorCode::InvalidArgument, fmt::format("{} modification #{} is missing its kind", field, i));
+        }
+        edits.push_back(std::move(*edit));
+    }
+    return edits;
+}
+
+auto encode_edit(flatbuffers::FlatBufferBuilder& builder, const TextEdit& edit)
+  -> flatbuffers::Offset<gen::TextModificationKind> {
+    using Kind = gen::TextModificationKind_::KindUnion;
+    const auto wrap = [&](Kind kind, auto op) { return gen::CreateTextModificationKind(builder, kind, op.Union()); };
+    const auto pair = [&](const ReplaceText& replace) {
+        const auto search = builder.CreateString(replace.search);
+        const auto replacement = builder.CreateString(replace.replace);
+        return gen::CreateReplaceTextPair(builder, search, replacement);
+    };
+    return std::visit(
+      [&](const auto& op) {
+          using Op = std::decay_t<decltype(op)>;
+          if constexpr (std::is_same_v<Op, AppendText>) {
+              const auto text = builder.CreateString(op.text);
+              return wrap(Kind::pg_gen_AppendTextOp, gen::CreateAppendTextOp(builder, text));
+          } else if constexpr (std::is_same_v<Op, PrependText>) {
+              const auto text = builder.CreateString(op.text);
+              return wrap(Kind::pg_gen_PrependTextOp, gen::CreatePrependTextOp(builder, text));
+          } else if constexpr (std::is_same_v<Op, InsertText>) {
+              const auto text = builder.CreateString(op.text);
+              const auto position = static_cast<std::uint32_t>(op.position);
+              return wrap(Kind::pg_gen_InsertTextOp, gen::CreateInsertTextOp(builder, text, position));
+          } else if constexpr (std::is_same_v<Op, RemoveTextRange>) {
+              const auto start = static_cast<std::uint32_t>(op.start);
+              const auto end = static_cast<std::uint32_t>(op.end);
+              return wrap(Kind::pg_gen_RemoveTextRangeOp, gen::CreateRemoveTextRangeOp(builder, start, end));
+          } else if constexpr (std::is_same_v<Op, ReplaceText>) {
+              const auto input = pair(op);
+              return wrap(Kind::pg_gen_ReplaceTextOp, gen::CreateReplaceTextOp(builder, input));
+          } else if constexpr (std::is_same_v<Op, ReplaceTextMultiple>) {
+              auto pairs = std::vector<flatbuffers::Offset<gen::ReplaceTextPair>> {};
+              pairs.reserve(op.pairs.size());
+              for (const auto& replace : op.pairs) {
+                  pairs.push_back(pair(replace));
+              }
+              const auto vector = builder.CreateVector(pairs);
+              return wrap(Kind::pg_gen_ReplaceTextMultipleOp, gen::CreateReplaceTextMultipleOp(builder, vector));
+          } else if constexpr (std::is_same_v<Op, RemoveText>) {
+              const auto removal = builder.CreateString(op.removal);
+              return wrap(Kind::pg_gen_RemoveTextOp, gen::CreateRemoveTextOp(builder, removal));
+          } else {
+              const auto removals = builder.CreateVectorOfStrings(op.removals);
+              return wrap(Kind::pg_gen_RemoveTextMultipleOp, gen::CreateRemoveTextMultipleOp(builder, removals));
+          }
+      },
+      edit);
+}
+
+auto to_note_edit(const gen::UpdateNoteData& target) -> Result<NoteEdit> {
+    auto id = parse_id(target.id());
+    auto title = to_edits(target.title_mods(), "title");
+    auto content = to_edits(target.content_mods(), "content");
+    auto tags = to_edits(target.tag_mods(), "tag");
+    if (!id) {
+        return cpp::fail(std::move(id).error());
+    }
+    if (!title) {
+        return cpp::fail(std::move(title).error());
+    }
+    if (!content) {
+        return cpp::fail(std::move(content).error());
+    }
+    if (!tags) {
+        return cpp::fail(std::move(tags).error());
+    }
+    return NoteEdit { *id, std::move(*title), std::move(*content), std::move(*tags) };
+}
+
+auto encode_note_edit(flatbuffers::FlatBufferBuilder& builder, const NoteEdit& edit)
+  -> flatbuffers::Offset<gen::UpdateNoteData> {
+    const auto modifications = [&](const std::vector<TextEdit>& edits) {
+        auto offsets = std::vector<flatbuffers::Offset<gen::TextModificationKind>> {};
+        offsets.reserve(edits.size());
+        for (const auto& one : edits) {
+            offsets.push_back(encode_edit(builder, one));
+        }
+        return builder.CreateVector(offsets);
+    };
+    const auto id = builder.CreateString(boost::uuids::to_string(edit.id));
+    const auto title = modifications(edit.title);
+    const auto content = modifications(edit.content);
+    const auto tags = modifications(edit.tags);
+    return gen::CreateUpdateNoteData(builder, id, title, content, tags);
+}
+
+auto encode_timestamp(flatbuffers::FlatBufferBuilder& builder, Timestamp timestamp) {
+    const auto since_epoch = timestamp.time_since_epoch();
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(since_epoch);
+    return gen::CreateTimestamp(builder, seconds.count(), static_cast<std::int32_t>((since_epoch - seconds).count()));
+}
+
+auto bytes_of(const flatbuffers::FlatBufferBuilder& builder) -> std::vector<std::uint8_t> {
+    const auto* data = builder.GetBufferPointer();
+    return std::vector<std::uint8_t> { data, data + builder.GetSize() };
+}
+
+auto encode_note(flatbuffers::FlatBufferBuilder& builder, const NoteView& note)
+  -> flatbuffers::Offset<gen::NoteObject> {
+    const auto id = builder.CreateString(boost::uuids::to_string(note.id));
+    const auto title = builder.CreateString(note.title.data(), note.title.size());
+    const auto content = builder.CreateString(note.content.data(), note.content.size());
+    auto tag_offsets = std::vector<StringOffset> {};
+    tag_offsets.reserve(note.tags.size());
+    for (const auto tag : note.tags) {
+        tag_offsets.push_back(builder.CreateString(tag.data(), tag.size()));
+    }
+    const auto tags = builder.CreateVector(tag_offsets);
+    const auto created = encode_timestamp(builder, note.created);
+    const auto updated = encode_timestamp(builder, note.updated);
+    return gen::CreateNoteObject(builder, id, title, content, tags, created, updated);
+}
+
+auto to_record(const gen::NoteObject& note) -> Result<NoteRecord> {
+    auto id = parse_id(note.id());
+    if (!id) {
+        return cpp::fail(std::move(id).error());
+    }
+    return NoteRecord {
+        .id = *id,
+        .title = string_of(note.title()),
+        .content = string_of(note.content()),
+        .tags = strings_of(note.tags()),
+        .created = note.created() != nullptr ? to_timestamp(*note.created()) : Timestamp {},
+        .updated = note.updated() != nullptr ? to_timestamp(*note.updated()) : Timestamp {},
+    };
+}
+
+}  // namespace
+
+auto to_timestamp(const gen::Timestamp& timestamp) -> Timestamp {
+    return Timestamp { std::chrono::seconds { timestamp.seconds() } + std::chrono::nanoseconds { timestamp.nanos() } };
+}
+
+auto to_query(const gen::SearchNoteRequest& request) -> Result<SearchQuery> {
+    auto query = SearchQuery {};
+    query.limit = page_size(request.page_size());
+    // Best matches first; the request has no field to ask for anything else.
+    query.order = SearchOrder::Relevance;
+    if (request.searches() != nullptr) {
+        query.predicates.reserve(request.searches()->size());
+        for (flatbuffers::uoffset_t i = 0; i < request.searches()->size(); ++i) {
+            const auto* data = request.searches()->Get(i);
+            auto predicate = data != nullptr ? to_predicate(*data) : std::nullopt;
+            if (!predicate) {
+                return fail(ErrorCode::InvalidArgument, fmt::format("search #{} is missing its kind or its query", i));
+            }
+            query.predicates.push_back(std::move(*predicate));
+        }
+    }
+    if (request.page_token() != nullptr && request.page_token()->size() != 0) {
+        auto cursor = decode_page_token(view_of(*request.page_token()), PageKind::Search, fingerprint_of(query));
+        if (!cursor) {
+            return cpp::fail(std::move(cursor).error());
+        }
+        query.cursor = *cursor;
+    }
+    return query;
+}
+
+auto to_query(const gen::ListNotesRequest& request) -> Result<ListQuery> {
+    if (request.page_size() < 0) {
+        return fail(ErrorCode::InvalidArgument, "page_size must not be negative");
+    }
+    auto query = ListQuery {};
+    query.limit = page_size(static_cast<std::uint32_t>(request.page_size()));
+    if (request.page_token() != nullptr && request.page_token()->size() != 0) {
+        auto cursor = decode_page_token(view_of(*request.page_token()), PageKind::List);
+        if (!cursor) {
+            return cpp::fail(std::move(cursor).error());
+        }
+        query.cursor = *cursor;
+    }
+    return query;
+}
+
+auto next_page_token(const SearchQuery& query, const SearchResult& result) -> std::string {
+    return result.next ? encode_page_token(PageKind::Search, *result.next, fingerprint_of(query)) : std::string {};
+}
+
+auto next_page_token(const ListResult& result) -> std::string {
+    return result.next ? encode_page_token(PageKind::List, *result.next) : std::string {};
+}
+
+auto decode_create_request(std::span<const std::uint8_t> buffer) -> Result<CreateRequest> {
+    auto root = root_of<gen::CreateNoteRequest>(buffer, "CreateNoteRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    const auto& request = **root;
+    auto decoded = CreateRequest {};
+    if (const auto* note = request.note()) {
+        if (note->title() != nullptr) {
+            decoded.note.title = note->title()->str();
+        }
+        if (note->content() != nullptr) {
+            decoded.note.content = note->content()->str();
+        }
+        if (note->tags() != nullptr) {
+            decoded.note.tags = strings_of(note->tags());
+        }
+    }
+    if (request.id() != nullptr && request.id()->size() != 0) {
+        auto id = parse_id(request.id());
+        if (!id) {
+            return cpp::fail(std::move(id).error());
+        }
+        decoded.id = *id;
+    }
+    return decoded;
+}
+
+auto decode_update_request(std::span<const std::uint8_t> buffer) -> Result<NoteEdit> {
+    auto root = root_of<gen::UpdateNoteRequest>(buffer, "UpdateNoteRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    const auto* target = (*root)->target();
+    if (target == nullptr) {
+        return fail(ErrorCode::InvalidArgument, "missing update target");
+    }
+    return to_note_edit(*target);
+}
+
+auto decode_update_notes_request(std::span<const std::uint8_t> buffer) -> Result<std::vector<Result<NoteEdit>>> {
+    auto root = root_of<gen::UpdateNotesRequest>(buffer, "UpdateNotesRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    auto edits = std::vector<Result<NoteEdit>> {};
+    if (const auto* targets = (*root)->targets()) {
+        edits.reserve(targets->size());
+        for (const auto* target : *targets) {
+            if (target == nullptr) {
+                edits.emplace_back(fail(ErrorCode::InvalidArgument, "missing update target"));
+            } else {
+                edits.push_back(to_note_edit(*target));
+            }
+        }
+    }
+    return edits;
+}
+
+auto decode_delete_request(std::span<const std::uint8_t> buffer) -> Result<NoteId> {
+    auto root = root_of<gen::DeleteNoteRequest>(buffer, "DeleteNoteRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    const auto* target = (*root)->target();
+    if (target == nullptr) {
+        return fail(ErrorCode::InvalidArgument, "missing delete target");
+    }
+    return parse_id(target->id());
+}
+
+auto decode_delete_notes_request(std::span<const std::uint8_t> buffer) -> Result<std::vector<Result<NoteId>>> {
+    auto root = root_of<gen::DeleteNotesRequest>(buffer, "DeleteNotesRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    auto ids = std::vector<Result<NoteId>> {};
+    if (const auto* targets = (*root)->targets()) {
+        ids.reserve(targets->size());
+        for (const auto* target : *targets) {
+            if (target == nullptr) {
+                ids.emplace_back(fail(ErrorCode::InvalidArgument, "missing delete target"));
+            } else {
+                ids.push_back(parse_id(target->id()));
+            }
+        }
+    }
+    return ids;
+}
+
+auto encode_create_request(const CreateRequest& request) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    const auto& note = request.note;
+    const auto title = note.title ? builder.CreateString(*note.title) : StringOffset {};
+    const auto content = note.content ? builder.CreateString(*note.content) : StringOffset {};
+    const auto tags = note.tags ? builder.CreateVectorOfStrings(*note.tags) : flatbuffers::Offset<StringVector> {};
+    const auto data = gen::CreateCreateNoteData(builder, title, content, tags);
+    const auto id = request.id ? builder.CreateString(boost::uuids::to_string(*request.id)) : StringOffset {};
+    builder.Finish(gen::CreateCreateNoteRequest(builder, 0, data, id));
+    return bytes_of(builder);
+}
+
+auto encode_update_request(const NoteEdit& edit) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    const auto target = encode_note_edit(builder, edit);
+    builder.Finish(gen::CreateUpdateNoteRequest(builder, target));
+    return bytes_of(builder);
+}
+
+auto encode_update_notes_request(std::span<const NoteEdit> edits) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    auto targets = std::vector<flatbuffers::Offset<gen::UpdateNoteData>> {};
+    targets.reserve(edits.size());
+    for (const auto& edit : edits) {
+        targets.push_back(encode_note_edit(builder, edit));
+    }
+    const auto vector = builder.CreateVector(targets);
+    builder.Finish(gen::CreateUpdateNotesRequest(builder, vector));
+    return bytes_of(builder);
+}
+
+auto encode_delete_request(NoteId id) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    const auto text = builder.CreateString(boost::uuids::to_string(id));
+    const auto target = gen::CreateDeleteNoteData(builder, text);
+    builder.Finish(gen::CreateDeleteNoteRequest(builder, target));
+    return bytes_of(builder);
+}
+
+auto encode_delete_notes_request(std::span<const NoteId> ids) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    auto targets = std::vector<flatbuffers::Offset<gen::DeleteNoteData>> {};
+    targets.reserve(ids.size());
+    for (const auto id : ids) {
+        const auto text = builder.CreateString(boost::uuids::to_string(id));
+        targets.push_back(gen::CreateDeleteNoteData(builder, text));
+    }
+    const auto vector = builder.CreateVector(targets);
+    builder.Finish(gen::CreateDeleteNotesRequest(builder, vector));
+    return bytes_of(builder);
+}
+
+auto decode_get_request(std::span<const std::uint8_t> buffer) -> Result<NoteId> {
+    auto root = root_of<gen::GetNoteRequest>(buffer, "GetNoteRequest");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    return parse_id((*root)->id());
+}
+
+auto decode_get_response(std::span<const std::uint8_t> buffer) -> Result<NoteRecord> {
+    auto root = root_of<gen::GetNoteResponse>(buffer, "GetNoteResponse");
+    if (!root) {
+        return cpp::fail(std::move(root).error());
+    }
+    if (const auto* error = (*root)->resp_as_pg_gen_ResponseError()) {
+        return fail(static_cast<ErrorCode>(error->code()), string_of(error->message()));
+    }
+    const auto* note = (*root)->resp_as_pg_gen_NoteObject();
+    if (note == nullptr) {
+        return fail(ErrorCode::InvalidArgument, "missing note");
+    }
+    return to_record(*note);
+}
+
+auto encode_get_request(NoteId id) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    const auto text = builder.CreateString(boost::uuids::to_string(id));
+    builder.Finish(gen::CreateGetNoteRequest(builder, text));
+    return bytes_of(builder);
+}
+
+auto encode_get_response(const NoteView& note) -> std::vector<std::uint8_t> {
+    // Sized up front, so the builder never has to grow (and copy) its buffer for a large note.
+    auto builder = flatbuffers::FlatBufferBuilder { note.title.size() + note.content.size() + 256 };
+    const auto object = encode_note(builder, note);
+    builder.Finish(
+      gen::CreateGetNoteResponse(builder, gen::GetNoteResponse_::RespUnion::pg_gen_NoteObject, object.Union()));
+    return bytes_of(builder);
+}
+
+auto encode_get_response(const StoreError& error) -> std::vector<std::uint8_t> {
+    auto builder = flatbuffers::FlatBufferBuilder {};
+    const auto message = builder.CreateString(error.message);
+    const auto object = gen::CreateResponseError(builder, static_cast<std::uint32_t>(error.code), message);
+    builder.Finish(
+      gen::CreateGetNoteResponse(builder, gen::GetNoteResponse_::RespUnion::pg_gen_ResponseError, object.Union()));
+    return bytes_of(builder);
+}
+
+auto encode_note_storage(std::span<const NoteView> notes) -> std::vector<std::uint8_t> {
+    auto bytes = std::size_t { 256 };
+    for (const auto& note : notes) {
+        bytes += note.title.size() + note.content.size() + 128;
+    }
+    auto builder = flatbuffers::FlatBufferBuilder { bytes };
+    auto objects = std::vector<flatbuffers::Offset<gen::NoteObject>> {};
+    objects.reserve(notes.size());
+    for (const auto& note : notes) {
+        objects.push_back(encode_note(builder, note));
+    }
+    builder.FinishSizePrefixed(gen::CreateNoteStorage(builder, builder.CreateVector(objects)));
+    return bytes_of(builder);
+}
+
+auto decode_note_storage(std::span<const std::uint8_t> buffer) -> Result<std::vector<NoteRecord>> {
+    auto verifier = flatbuffers::Verifier { buffer.data(), buffer.size() };
+    if (buffer.size() < sizeof(flatbuffers::uoffset_t)
+        || !verifier.VerifySizePrefixedBuffer<gen::NoteStorage>(nullptr)) {
+        return fail(ErrorCode::InvalidArgument, "not a valid NoteStorage");
+    }
+    const auto* notes = flatbuffers::GetSizePrefixedRoot<gen::NoteStorage>(buffer.data())->notes();
+    auto out = std::vector<NoteRecord> {};
+    if (notes != nullptr) {
+        out.reserve(notes->size());
+        for (const auto* note : *notes) {
+            auto record = to_record(*note);
+            if (!record) {
+                return cpp::fail(std::move(record).error());
+            }
+            out.push_back(std::move(*record));
+        }
+    }
+    return out;
+}
+
+}  // namespace pg::store::messages
@@ -0,0 +1,185 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include <pg/store/Mvcc.hpp>
+
+namespace pg::store {
+
+auto free_chain(NoteVersion* chain) noexcept -> std::size_t {
+    auto freed = std::size_t { 0 };
+    while (chain != nullptr && !chain->base) {
+        auto* older = chain->older.load(std::memory_order_relaxed);
+        delete chain;
+        chain = older;
+        ++freed;
+    }
+    return freed;
+}
+
+VersionTable::VersionTable(): segments_ { std::make_unique<std::atomic<Segment*>[]>(MAX_SEGMENTS) } { }
+
+VersionTable::~VersionTable() {
+    const auto size = size_.load(std::memory_order_relaxed);
+    for (NoteOrdinal ordinal = 0; ordinal < size; ++ordinal) {
+        free_chain(slot(ordinal).load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i < MAX_SEGMENTS; ++i) {
+        delete segments_[i].load(std::memory_order_relaxed);
+    }
+}
+
+auto VersionTable::head(NoteOrdinal ordinal) const noexcept -> NoteVersion* {
+    if (ordinal >= size()) {
+        return nullptr;
+    }
+    return slot(ordinal).load(std::memory_order_acquire);
+}
+
+auto VersionTable::visible(NoteOrdinal ordinal, CommitVersion snapshot) const noexcept -> const NoteVersion* {
+    // Versions are linked newest first, so the first one committed at or before the snapshot is the one it sees.
+    // Garbage collection never cuts a chain above a version some pinned snapshot can see, so this walk never reaches a
+    // cut-off tail.
+    const auto* version = head(ordinal);
+    while (version != nullptr && version->begin > snapshot) {
+        version = version->older.load(std::memory_order_acquire);
+    }
+    return version != nullptr && !version->deleted ? version : nullptr;
+}
+
+void VersionTable::append(NoteVersion* head) {
+    const auto ordinal = size_.load(std::memory_order_relaxed);
+    auto& segment = segments_[ordinal >> SEGMENT_BITS];
+    if (segment.load(std::memory_order_relaxed) == nullptr) {
+        segment.store(new Segment {}, std::memory_order_release);
+    }
+    slot(ordinal).store(head, std::memory_order_release);
+    size_.store(ordinal + 1, std::memory_order_release);
+}
+
+void VersionTable::publish(NoteOrdinal ordinal, NoteVersion* head) noexcept {
+    slot(ordinal).store(head, std::memory_order_seq_cst);
+}
+
+auto VersionTable::slot(NoteOrdinal ordinal) const noexcept -> std::atomic<NoteVersion*>& {
+    auto* segment = segments_[ordinal >> SEGMENT_BITS].load(std::memory_order_acquire);
+    return segment->slots[ordinal & (SEGMENT_SIZE - 1)];
+}
+
+EpochManager::~EpochManager() {
+    for (const auto& retired : limbo_) {
+        if (retired.alone) {
+            delete retired.chain;
+        } else {
+            free_chain(retired.chain);
+        }
+    }
+}
+
+auto EpochManager::pin(const std::atomic<CommitVersion>& committed) -> Pin {
+    // Start probing at a per-thread offset so concurrent readers rarely contend for the same slot.
+    const auto start = std::hash<std::thread::id> {}(std::this_thread::get_id());
+    for (std::size_t attempt = 0;; ++attempt) {
+        auto& slot = slots_[(start + attempt) % SLOTS].pinned;
+        auto expected = IDLE;
+        const auto announced = committed.load(std::memory_order_seq_cst);
+        if (slot.compare_exchange_strong(expected, announced, std::memory_order_seq_cst)) {
+            // Re-read after announcing: a collector that scanned the slots before our announcement read the commit
+            // version before this load, so it cannot have cut anything this snapshot needs. The announcement may be
+            // older than the snapshot, which only makes collection more conservative.
+            return Pin { &slot, committed.load(std::memory_order_seq_cst) };
+        }
+        if (attempt % SLOTS == SLOTS - 1) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+auto EpochManager::pin_at(CommitVersion version) -> Pin {
+    const auto start = std::hash<std::thread::id> {}(std::this_thread::get_id());
+    for (std::size_t attempt = 0;; ++attempt) {
+        auto& slot = slots_[(start + attempt) % SLOTS].pinned;
+        auto expected = IDLE;
+        if (slot.compare_exchange_strong(expected, version, std::memory_order_seq_cst)) {
+            return Pin { &slot, version };
+        }
+        if (attempt % SLOTS == SLOTS - 1) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+auto EpochManager::oldest_pin() const noexcept -> CommitVersion {
+    auto oldest = IDLE;
+    for (const auto& slot : slots_) {
+        oldest = std::min(oldest, slot.pinned.load(std::memory_order_seq_cst));
+    }
+    return oldest;
+}
+
+void EpochManager::retire(NoteVersion* chain, CommitVersion tag) {
+    if (chain != nullptr && !chain->base) {
+        limbo_.push_back(Retired { tag, chain, false });
+    }
+}
+
+void EpochManager::retire_one(NoteVersion* version, CommitVersion tag) {
+    if (version != nullptr && !version->base) {
+        limbo_.push_back(Retired { tag, version, true });
+    }
+}
+
+auto EpochManager::reclaim() -> std::size_t {
+    if (limbo_.empty()) {
+        return 0;
+    }
+    const auto oldest = oldest_pin();
+    auto freed = std::size_t { 0 };
+    std::erase_if(limbo_, [&](const Retired& retired) {
+        if (retired.tag >= oldest) {
+            return false;
+        }
+        if (retired.alone) {
+            delete retired.chain;
+            ++freed;
+        } else {
+            freed += free_chain(retired.chain);
+        }
+        return true;
+    });
+    return freed;
+}
+
+auto Snapshot::operator=(Snapshot&& other) noexcept -> Snapshot& {
+    if (this != &other) {
+        delete held_.exchange(other.held_.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+        pin_ = std::move(other.pin_);
+    }
+    return *this;
+}
+
+Snapshot::~Snapshot() {
+    delete held_.load(std::memory_order_relaxed);
+}
+
+auto Snapshot::hold(std::shared_ptr<const std::string> text) const -> std::string_view {
+    const auto view = std::string_view { *text };
+    auto* held = held_.load(std::memory_order_acquire);
+    if (held == nullptr) {
+        auto fresh = std::make_unique<Held>();
+        if (held_.compare_exchange_strong(held, fresh.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+            held = fresh.release();
+        }
+    }
+    auto lock = std::scoped_lock { held->mutex };
+    held->texts.insert(std::move(text));
+    return view;
+}
+
+}  // namespace pg::store
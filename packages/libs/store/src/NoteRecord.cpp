@@ -0,0 +1,40 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+
+#include <pg/store/NoteRecord.hpp>
+
+namespace pg::store {
+namespace {
+
+auto string_at(const void* source, std::size_t index) noexcept -> std::string_view {
+    return static_cast<const std::string*>(source)[index];
+}
+
+}  // namespace
+
+TagList::TagList(std::span<const std::string> tags) noexcept
+    : source_ { tags.data() }, size_ { tags.size() }, accessor_ { &string_at } { }
+
+auto TagList::to_vector() const -> std::vector<std::string> {
+    auto tags = std::vector<std::string> {};
+    tags.reserve(size_);
+    for (const auto tag : *this) {
+        tags.emplace_back(tag);
+    }
+    return tags;
+}
+
+auto operator==(const TagList& lhs, const TagList& rhs) noexcept -> bool {
+    return lhs.size() == rhs.size() && std::ranges::equal(lhs, rhs);
+}
+
+auto NoteView::to_record() const -> NoteRecord {
+    return NoteRecord { id, std::string { title }, std::string { content }, tags.to_vector(), created, updated };
+}
+
+}  // namespace pg::store
@@ -0,0 +1,1332 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/Lz.hpp>
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/QueryPlanner.hpp>
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace pg::store {
+
+namespace {
+    /**
+     * @brief Whether `next`, viewed as `after`, changed the content of `previous`, viewed as `before`.
+     */
+    auto content_changed(
+      const NoteVersion& next, const NoteVersion& previous, const NoteView& after, const NoteView& before) noexcept
+      -> bool {
+        // Equal bodies intern to the same blob, so content an edit left alone is recognised without comparing it; a
+        // cold note's content stays in its block until an edit to it calls for `unshare`.
+        if (next.packed != nullptr) {
+            return false;
+        }
+        return (next.body == nullptr || next.body != previous.body) && after.content != before.content;
+    }
+}  // namespace
+
+NoteStore::NoteStore(StoreOptions options)
+    : options_ { std::move(options) }, blocks_ { options_.block_cache_bytes } {
+    if (options_.index_content) {
+        contents_.emplace();
+    }
+    if (options_.index_terms) {
+        terms_.emplace();
+    }
+    if (!options_.spill_directory.empty()) {
+        cold_.emplace(options_.spill_directory);
+    }
+    // Spilled notes are promoted by the maintenance thread, so spilling always needs it.
+    const auto compressing = options_.cold_after != 0 && options_.compression_interval.count() != 0;
+    if (options_.compaction_threshold != 0 || compressing || cold_) {
+        maintenance_ = std::jthread { [this](std::stop_token stop) { maintain(std::move(stop)); } };
+    }
+}
+
+auto NoteStore::load(std::shared_ptr<const Checkpoint> checkpoint, StoreOptions options)
+  -> Result<std::unique_ptr<NoteStore>> {
+    auto store = std::make_unique<NoteStore>(std::move(options));
+    const auto slots = checkpoint->size();
+    const auto commit = checkpoint->version();
+    store->base_.begin = commit;
+    store->base_.base = true;
+    store->ids_.reserve(checkpoint->note_count());
+    store->birth_versions_.assign(slots, commit);
+    // Nothing else can see the store yet, so there is nothing to lock.
+    for (std::size_t i = 0; i < slots; ++i) {
+        const auto ordinal = static_cast<NoteOrdinal>(i);
+        if (!checkpoint->contains(i)) {
+            store->versions_.append(nullptr);
+            continue;
+        }
+        const auto note = checkpoint->note(i);
+        if (!store->ids_.emplace(note.id, ordinal).second) {
+            return fail(
+              ErrorCode::DataLoss,
+              fmt::format(
+                "{} holds note {} twice", checkpoint->directory().string(), boost::uuids::to_string(note.id)));
+        }
+        store->versions_.append(&store->base_);
+        store->live_.set(ordinal);
+    }
+    store->size_.store(checkpoint->note_count(), std::memory_order_relaxed);
+    store->committed_.store(commit, std::memory_order_release);
+    store->checkpoint_ = std::move(checkpoint);
+    store->build_indexes();
+    return store;
+}
+
+auto NoteStore::create(const data::CreateNote& note, std::optional<NoteId> id) -> Result<NoteId> {
+    auto writer = std::scoped_lock { write_mutex_ };
+    if (end_ordinal() == INVALID_ORDINAL) {
+        return fail(ErrorCode::ResourceExhausted, "note ordinals exhausted");
+    }
+    const auto note_id = id ? *id : generate_note_id();
+    if (current_ordinal(note_id) != INVALID_ORDINAL) {
+        return fail(ErrorCode::AlreadyExists, fmt::format("note {} already exists", boost::uuids::to_string(note_id)));
+    }
+
+    const auto commit = version() + 1;
+    const auto timestamp = now();
+    auto next = std::make_unique<NoteVersion>();
+    next->begin = commit;
+    next->note = NoteRecord {
+        .id = note_id,
+        .title = note.title.value_or(std::string {}),
+        .content = note.content.value_or(std::string {}),
+        .tags = note.tags.value_or(std::vector<std::string> {}),
+        .created = timestamp,
+        .updated = timestamp,
+    };
+    seal(*next);
+    const auto ordinal = end_ordinal();
+    const auto record = view_of(ordinal, *next);
+
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        versions_.append(next.get());
+        next.release();
+        ids_.insert_or_assign(note_id, ordinal);
+        live_.set(ordinal);
+        birth_versions_.push_back(commit);
+
+        // Left to `end_bulk_load` during a bulk load, as are the index entries of every other write.
+        if (!bulk_loading()) {
+            titles_.add(ordinal, record.title);
+            if (contents_) {
+                contents_->add(ordinal, record.content);
+            }
+            if (terms_) {
+                terms_->add(ordinal, record.title, record.content);
+            }
+            tags_.add(ordinal, record.tags);
+            created_.insert(ordinal, timestamp);
+            updated_.insert(ordinal, timestamp);
+        }
+        committed_.store(commit, std::memory_order_release);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    after_write(ordinal);
+    return note_id;
+}
+
+auto NoteStore::create_many(std::span<const data::CreateNote> notes) -> Result<std::vector<NoteId>> {
+    struct Pending {
+        std::unique_ptr<NoteVersion> next;
+        std::optional<TrigramIndex::Delta> title;
+        std::optional<TrigramIndex::Delta> content;
+        std::optional<TermIndex::Delta> title_terms;
+        std::optional<TermIndex::Delta> content_terms;
+    };
+
+    auto writer = std::scoped_lock { write_mutex_ };
+    const auto first = end_ordinal();
+    if (notes.size() >= static_cast<std::size_t>(INVALID_ORDINAL - first)) {
+        return fail(ErrorCode::ResourceExhausted, "note ordinals exhausted");
+    }
+    if (notes.empty()) {
+        return std::vector<NoteId> {};
+    }
+
+    auto ids = std::vector<NoteId> {};
+    ids.reserve(notes.size());
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        ids.push_back(generate_note_id());
+    }
+
+    const auto commit = version() + 1;
+    const auto timestamp = now();
+    auto pending = std::vector<Pending>(notes.size());
+    // Touches nothing but its own slot, apart from the blob store, which has its own lock.
+    const auto prepare = [&](std::size_t i) {
+        const auto& note = notes[i];
+        auto& slot = pending[i];
+        slot.next = std::make_unique<NoteVersion>();
+        slot.next->begin = commit;
+        slot.next->note = NoteRecord {
+            .id = ids[i],
+            .title = note.title.value_or(std::string {}),
+            .content = note.content.value_or(std::string {}),
+            .tags = note.tags.value_or(std::vector<std::string> {}),
+            .created = timestamp,
+            .updated = timestamp,
+        };
+        seal(*slot.next);
+        if (bulk_loading()) {
+            return;
+        }
+        const auto record = view_of(static_cast<NoteOrdinal>(first + i), *slot.next);
+        slot.title = TrigramIndex::diff({}, record.title);
+        if (contents_) {
+            slot.content = TrigramIndex::diff({}, record.content);
+        }
+        if (terms_) {
+            slot.title_terms = TermIndex::diff(TermIndex::Field::Title, {}, record.title);
+            slot.content_terms = TermIndex::diff(TermIndex::Field::Content, {}, record.content);
+        }
+    };
+
+    const auto configured = options_.write_threads;
+    const auto threads = std::min(
+      notes.size() / PARALLEL_BATCH + 1,
+      configured != 0 ? configured : std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+    if (threads <= 1) {
+        for (std::size_t i = 0; i < notes.size(); ++i) {
+            prepare(i);
+        }
+    } else {
+        auto next_note = std::atomic<std::size_t> { 0 };
+        const auto worker = [&] {
+            for (auto i = next_note.fetch_add(1, std::memory_order_relaxed); i < notes.size();
+                 i = next_note.fetch_add(1, std::memory_order_relaxed)) {
+                prepare(i);
+            }
+        };
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            auto& slot = pending[i];
+            const auto ordinal = static_cast<NoteOrdinal>(first + i);
+            const auto record = view_of(ordinal, *slot.next);
+            versions_.append(slot.next.release());
+            ids_.insert_or_assign(ids[i], ordinal);
+            live_.set(ordinal);
+            birth_versions_.push_back(commit);
+
+            // Not worked out during a bulk load.
+            if (!slot.title) {
+                continue;
+            }
+            titles_.apply(ordinal, *slot.title);
+            if (slot.content) {
+                contents_->apply(ordinal, *slot.content);
+            }
+            if (slot.title_terms) {
+                terms_->apply(ordinal, *slot.title_terms);
+                terms_->apply(ordinal, *slot.content_terms);
+            }
+            tags_.add(ordinal, record.tags);
+            created_.insert(ordinal, timestamp);
+            updated_.insert(ordinal, timestamp);
+        }
+        committed_.store(commit, std::memory_order_release);
+    }
+    size_.fetch_add(notes.size(), std::memory_order_relaxed);
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        after_write(static_cast<NoteOrdinal>(first + i));
+    }
+    return ids;
+}
+
+void NoteStore::begin_bulk_load() {
+    auto writer = std::scoped_lock { write_mutex_ };
+    bulk_loading_.store(true, std::memory_order_relaxed);
+}
+
+auto NoteStore::end_bulk_load() -> std::size_t {
+    // Compaction works on the indexes about to be replaced, and would purge the new ones of tombstones they never held.
+    auto compacting = std::scoped_lock { compact_mutex_ };
+    auto writer = std::scoped_lock { write_mutex_ };
+    if (!bulk_loading()) {
+        return 0;
+    }
+    const auto indexed = build_indexes();
+    bulk_loading_.store(false, std::memory_order_relaxed);
+    return indexed;
+}
+
+auto NoteStore::update(const data::UpdateNote& update) -> Result<void> {
+    auto writer = std::unique_lock { write_mutex_ };
+    const auto ordinal = current_ordinal(update.id());
+    if (ordinal == INVALID_ORDINAL) {
+        return fail(ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(update.id())));
+    }
+
+    auto next = successor(ordinal);
+    auto& record = next->note;
+    if (auto title = update.title()) {
+        record.title = std::move(*title);
+    }
+    if (auto content = update.content()) {
+        record.content = std::move(*content);
+        next->body.reset();
+        next->packed.reset();
+    }
+    if (auto tags = update.tags()) {
+        record.tags = std::move(*tags);
+    }
+    supersede(ordinal, std::move(next));
+    writer.unlock();
+    changed(update.id());
+    return {};
+}
+
+auto NoteStore::edit(const NoteEdit& edit) -> Result<void> {
+    auto writer = std::unique_lock { write_mutex_ };
+    const auto ordinal = current_ordinal(edit.id);
+    if (ordinal == INVALID_ORDINAL) {
+        return fail(ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(edit.id)));
+    }
+
+    auto next = successor(ordinal);
+    if (!edit.content.empty()) {
+        unshare(*next);
+    }
+    if (auto applied = apply_edit(next->note, edit); !applied) {
+        return applied;
+    }
+    supersede(ordinal, std::move(next));
+    writer.unlock();
+    changed(edit.id);
+    return {};
+}
+
+auto NoteStore::edit_many(std::span<const NoteEdit> edits) -> BatchResult {
+    struct Target {
+        NoteOrdinal ordinal = INVALID_ORDINAL;
+        std::vector<std::size_t> edits;
+        std::unique_ptr<NoteVersion> next;
+        bool changed = false;
+        std::optional<TrigramIndex::Delta> title;
+        std::optional<TrigramIndex::Delta> content;
+        std::optional<TermIndex::Delta> title_terms;
+        std::optional<TermIndex::Delta> content_terms;
+    };
+
+    auto writer = std::unique_lock { write_mutex_ };
+    auto result = BatchResult {};
+    result.results.resize(edits.size());
+
+    // Group the edits by note, keeping their order within each note.
+    auto targets = std::vector<Target> {};
+    auto target_of = phmap::flat_hash_map<NoteOrdinal, std::size_t> {};
+    for (std::size_t i = 0; i < edits.size(); ++i) {
+        const auto ordinal = current_ordinal(edits[i].id);
+        if (ordinal == INVALID_ORDINAL) {
+            result.results[i] =
+              fail(ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(edits[i].id)));
+            continue;
+        }
+        const auto [it, inserted] = target_of.try_emplace(ordinal, targets.size());
+        if (inserted) {
+            targets.emplace_back().ordinal = ordinal;
+        }
+        targets[it->second].edits.push_back(i);
+    }
+
+    const auto timestamp = now();
+    // Only reads what the writer lock keeps still, and writes nothing but its own target and result slots.
+    const auto prepare = [&](Target& target) {
+        // Keeps the content of cold notes read below alive.
+        const auto reading = snapshot();
+        target.next = successor(target.ordinal);
+        auto& record = target.next->note;
+        for (const auto i : target.edits) {
+            if (!edits[i].content.empty()) {
+                unshare(*target.next);
+            }
+            result.results[i] = apply_edit(record, edits[i]);
+            target.changed = target.changed || result.results[i].has_value();
+        }
+        if (!target.changed) {
+            return;
+        }
+        record.updated = timestamp;
+        seal(*target.next);
+        if (bulk_loading()) {
+            return;
+        }
+        const auto& previous = *target.next->older.load(std::memory_order_relaxed);
+        const auto before = view_of(target.ordinal, previous, &reading);
+        const auto after = view_of(target.ordinal, *target.next, &reading);
+        if (after.title != before.title) {
+            target.title = TrigramIndex::diff(before.title, after.title);
+            if (terms_) {
+                target.title_terms = TermIndex::diff(TermIndex::Field::Title, before.title, after.title);
+            }
+        }
+        if (content_changed(*target.next, previous, after, before)) {
+            if (contents_) {
+                target.content = TrigramIndex::diff(before.content, after.content);
+            }
+            if (terms_) {
+                target.content_terms = TermIndex::diff(TermIndex::Field::Content, before.content, after.content);
+            }
+        }
+    };
+
+    const auto configured = options_.write_threads;
+    const auto threads = std::min(
+      targets.size() / PARALLEL_BATCH + 1,
+      configured != 0 ? configured : std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+    if (threads <= 1) {
+        std::ranges::for_each(targets, prepare);
+    } else {
+        auto next_target = std::atomic<std::size_t> { 0 };
+        const auto worker = [&] {
+            for (auto i = next_target.fetch_add(1, std::memory_order_relaxed); i < targets.size();
+                 i = next_target.fetch_add(1, std::memory_order_relaxed)) {
+                prepare(targets[i]);
+            }
+        };
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    std::erase_if(targets, [](const Target& target) { return !target.changed; });
+    result.version = version();
+    if (targets.empty()) {
+        return result;
+    }
+    const auto commit = result.version + 1;
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        for (auto& target : targets) {
+            const auto before = view_of(target.ordinal, *target.next->older.load(std::memory_order_relaxed));
+            const auto& record = target.next->note;
+            if (target.title) {
+                titles_.apply(target.ordinal, *target.title);
+            }
+            if (target.content) {
+                contents_->apply(target.ordinal, *target.content);
+            }
+            if (target.title_terms) {
+                terms_->apply(target.ordinal, *target.title_terms);
+            }
+            if (target.content_terms) {
+                terms_->apply(target.ordinal, *target.content_terms);
+            }
+            if (!bulk_loading()) {
+                if (TagList { record.tags } != before.tags) {
+                    tags_.update(target.ordinal, before.tags, record.tags);
+                }
+                updated_.update(target.ordinal, timestamp);
+            }
+            versions_.publish(target.ordinal, target.next.release());
+        }
+        committed_.store(commit, std::memory_order_release);
+    }
+    for (const auto& target : targets) {
+        chained(target.ordinal);
+        after_write(target.ordinal);
+    }
+    writer.unlock();
+    for (const auto& target : targets) {
+        changed(edits[target.edits.front()].id);
+    }
+    result.applied = static_cast<std::size_t>(std::ranges::count_if(result.results, [](const auto& one) {
+        return one.has_value();
+    }));
+    result.version = commit;
+    return result;
+}
+
+auto NoteStore::remove(NoteId id) -> Result<void> {
+    auto writer = std::unique_lock { write_mutex_ };
+    const auto ordinal = current_ordinal(id);
+    if (ordinal == INVALID_ORDINAL) {
+        return fail(ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(id)));
+    }
+
+    auto next = tombstone(ordinal, id);
+    const auto commit = next->begin;
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        bury(ordinal, std::move(next));
+        committed_.store(commit, std::memory_order_release);
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    chained(ordinal);
+    after_write(ordinal);
+    buried(1);
+    writer.unlock();
+    changed(id);
+    return {};
+}
+
+auto NoteStore::remove_many(std::span<const NoteId> ids) -> BatchResult {
+    auto writer = std::unique_lock { write_mutex_ };
+    auto result = BatchResult {};
+    result.results.resize(ids.size());
+    result.version = version();
+
+    auto doomed = std::vector<std::pair<NoteOrdinal, std::unique_ptr<NoteVersion>>> {};
+    auto seen = phmap::flat_hash_set<NoteOrdinal> {};
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        const auto ordinal = current_ordinal(ids[i]);
+        if (ordinal == INVALID_ORDINAL || !seen.insert(ordinal).second) {
+            result.results[i] =
+              fail(ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(ids[i])));
+            continue;
+        }
+        doomed.emplace_back(ordinal, tombstone(ordinal, ids[i]));
+    }
+    if (doomed.empty()) {
+        return result;
+    }
+
+    const auto commit = result.version + 1;
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        for (auto& [ordinal, next] : doomed) {
+            bury(ordinal, std::move(next));
+        }
+        committed_.store(commit, std::memory_order_release);
+    }
+    size_.fetch_sub(doomed.size(), std::memory_order_relaxed);
+    for (const auto& [ordinal, next] : doomed) {
+        chained(ordinal);
+        after_write(ordinal);
+    }
+    buried(doomed.size());
+    writer.unlock();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (result.results[i]) {
+            changed(ids[i]);
+        }
+    }
+    result.applied = doomed.size();
+    result.version = commit;
+    return result;
+}
+
+auto NoteStore::snapshot() const -> Snapshot {
+    return Snapshot { epochs_.pin(committed_) };
+}
+
+auto NoteStore::snapshot(const Snapshot& at) const -> Snapshot {
+    return Snapshot { epochs_.pin_at(at.version()) };
+}
+
+auto NoteStore::get(NoteId id) const -> std::optional<NoteRecord> {
+    const auto view = snapshot();
+    const auto note = get(id, view);
+    return note ? std::optional { note->to_record() } : std::nullopt;
+}
+
+auto NoteStore::get(NoteId id, const Snapshot& snapshot) const -> std::optional<NoteView> {
+    auto ordinal = INVALID_ORDINAL;
+    {
+        auto lock = read_lock();
+        auto it = ids_.find(id);
+        if (it == ids_.end()) {
+            return std::nullopt;
+        }
+        ordinal = it->second;
+    }
+    return at(ordinal, snapshot);
+}
+
+auto NoteStore::at(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<NoteView> {
+    const auto* version = versions_.visible(ordinal, snapshot.version());
+    if (version == nullptr) {
+        return std::nullopt;
+    }
+    // Only stored when it changes, so that notes read over and over do not keep writing to a shared cache line.
+    const auto pass = pass_.load(std::memory_order_relaxed);
+    if (version->touched.load(std::memory_order_relaxed) != pass) {
+        version->touched.store(pass, std::memory_order_relaxed);
+    }
+    if (version->spilled != nullptr) {
+        request_promotion(ordinal);
+    }
+    return view_of(ordinal, *version, &snapshot);
+}
+
+auto NoteStore::peek(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<NoteView> {
+    const auto* version = versions_.visible(ordinal, snapshot.version());
+    return version != nullptr ? std::optional { view_of(ordinal, *version, &snapshot) } : std::nullopt;
+}
+
+auto NoteStore::revision(NoteOrdinal ordinal, const Snapshot& snapshot) const -> std::optional<CommitVersion> {
+    const auto* version = versions_.visible(ordinal, snapshot.version());
+    return version != nullptr ? std::optional { version->begin } : std::nullopt;
+}
+
+auto NoteStore::ordinal_of(NoteId id) const -> NoteOrdinal {
+    auto lock = read_lock();
+    auto it = ids_.find(id);
+    return it != ids_.end() && live_.test(it->second) ? it->second : INVALID_ORDINAL;
+}
+
+auto NoteStore::search(const SearchQuery& query) const -> SearchResult {
+    const auto planner = QueryPlanner { *this };
+    return planner.execute(query, planner.plan(query));
+}
+
+auto NoteStore::count(const SearchQuery& query) const -> std::size_t {
+    const auto planner = QueryPlanner { *this };
+    auto plan = planner.plan(query);
+    return planner.matches(query, plan).count();
+}
+
+auto NoteStore::facets(const SearchQuery& query, std::size_t limit) const -> FacetCounts {
+    const auto planner = QueryPlanner { *this };
+    auto plan = planner.plan(query);
+    const auto matches = planner.matches(query, plan);
+    const auto configured = options_.scan_threads;
+    const auto threads = configured != 0 ? configured : std::max(1U, std::thread::hardware_concurrency());
+    auto lock = read_lock();
+    return FacetCounts { plan.returned, tags_.facets(matches, limit, threads) };
+}
+
+auto NoteStore::list(const ListQuery& query) const -> ListResult {
+    auto result = ListResult {};
+    auto lock = read_lock();
+    // Taken under the lock, the snapshot sees exactly the notes the created index holds.
+    result.snapshot = snapshot();
+    const auto version = query.cursor ? query.cursor->version : result.snapshot.version();
+    const auto horizon = ordinal_horizon(version);
+    const auto want = query.limit == 0 ? std::numeric_limits<std::size_t>::max() : query.limit + 1;
+
+    const auto range = query.cursor ? created_.from(DateIndex::Key {
+                         Timestamp { Timestamp::duration { query.cursor->sort_key } }, query.cursor->ordinal + 1 })
+                                    : created_.all();
+    range.for_each([&](NoteOrdinal ordinal) {
+        if (ordinal < horizon && !tombstones_.test(ordinal)) {
+            result.ordinals.push_back(ordinal);
+        }
+        return result.ordinals.size() < want;
+    });
+
+    if (query.limit != 0 && result.ordinals.size() > query.limit) {
+        result.ordinals.resize(query.limit);
+        const auto last = result.ordinals.back();
+        result.next = Cursor { version, created_.timestamp_of(last)->time_since_epoch().count(), last };
+    }
+    return result;
+}
+
+auto NoteStore::take_dirty_chunks() -> DirtyChunks {
+    auto writer = std::scoped_lock { write_mutex_ };
+    return DirtyChunks { snapshot(), std::exchange(dirty_chunks_, Bitmap {}) };
+}
+
+auto NoteStore::collect_garbage() -> std::size_t {
+    auto writer = std::scoped_lock { write_mutex_ };
+    return collect();
+}
+
+auto NoteStore::compact(std::stop_token stop) -> std::size_t {
+    auto compacting = std::scoped_lock { compact_mutex_ };
+    auto dead = Bitmap {};
+    auto title_trigrams = std::vector<TrigramIndex::Trigram> {};
+    auto content_trigrams = std::vector<TrigramIndex::Trigram> {};
+    auto terms = std::vector<TermIndex::Term> {};
+    {
+        auto lock = read_lock();
+        if (tombstones_.empty()) {
+            return 0;
+        }
+        // Tombstones added from here on are left for the next pass. Nothing but dead notes is purged, and those are
+        // never written to again, so the keys listed now are the only ones that can hold them.
+        dead = tombstones_;
+        title_trigrams = titles_.trigrams();
+        if (contents_) {
+            content_trigrams = contents_->trigrams();
+        }
+        if (terms_) {
+            terms = terms_->terms();
+        }
+    }
+
+    const auto slice = std::max<std::size_t>(options_.compaction_slice, 1);
+    // Each slice gets the exclusive lock to itself, then leaves it to searches and writers for a while.
+    const auto in_slices = [&](std::size_t size, const auto& purge) {
+        for (std::size_t begin = 0; begin < size; begin += slice) {
+            {
+                auto lock = std::unique_lock { index_mutex_ };
+                purge(begin, std::min(size, begin + slice));
+            }
+            if (stop.stop_requested()) {
+                return false;
+            }
+            std::this_thread::sleep_for(options_.compaction_pause);
+        }
+        return true;
+    };
+    const auto postings = [&](auto& index, auto keys) {
+        return in_slices(keys.size(), [&](std::size_t begin, std::size_t end) {
+            index.purge(keys.subspan(begin, end - begin), dead);
+        });
+    };
+    auto ordinals = std::vector<NoteOrdinal> {};
+    dead.for_each([&](NoteOrdinal ordinal) { ordinals.push_back(ordinal); });
+    const auto dates = [&] {
+        return in_slices(ordinals.size(), [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                created_.erase(ordinals[i]);
+                updated_.erase(ordinals[i]);
+            }
+        });
+    };
+    if (!postings(titles_, std::span { title_trigrams })
+        || (contents_ && !postings(*contents_, std::span { content_trigrams }))
+        || (terms_ && !postings(*terms_, std::span { terms })) || !dates()) {
+        return 0;
+    }
+
+    {
+        auto lock = std::unique_lock { index_mutex_ };
+        tags_.purge(dead);
+        titles_.forget(dead);
+        if (contents_) {
+            contents_->forget(dead);
+        }
+        if (terms_) {
+            terms_->forget(dead);
+        }
+        tombstones_.subtract(dead);
+    }
+    const auto purged = ordinals.size();
+    tombstone_count_.fetch_sub(purged, std::memory_order_relaxed);
+    return purged;
+}
+
+auto NoteStore::compress_cold(std::stop_token stop) -> std::size_t {
+    struct Cold {
+        NoteOrdinal ordinal = INVALID_ORDINAL;
+        NoteVersion* head = nullptr;
+        std::size_t block = 0;
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+    };
+
+    auto compressing = std::scoped_lock { compress_mutex_ };
+    // Reads and writes from here on count towards the new pass, which `spill_cold` goes by too.
+    const auto pass = pass_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (options_.cold_after == 0) {
+        return 0;
+    }
+    const auto is_cold = [&](const NoteVersion& version) {
+        const auto untouched = pass - version.touched.load(std::memory_order_relaxed);
+        // Notes about to be spilled are not worth compressing first.
+        return untouched >= options_.cold_after && (!cold_ || untouched < options_.spill_after);
+    };
+
+    // Held throughout, so that none of the heads found below can be freed, and so reused, before they are swapped.
+    auto view = snapshot();
+    const auto block_size =
+      std::clamp<std::size_t>(options_.compression_block, 1, std::numeric_limits<std::uint32_t>::max());
+    auto cold = std::vector<Cold> {};
+    auto raw = std::vector<std::string> {};
+    // Notes sharing a blob share its place in a block too.
+    auto placed = phmap::flat_hash_map<const Blob*, std::pair<std::size_t, std::uint32_t>> {};
+    const auto end = end_ordinal();
+    for (NoteOrdinal ordinal = 0; ordinal < end; ++ordinal) {
+        auto* head = versions_.head(ordinal);
+        // Tombstones, base versions and notes already compressed hold no blob.
+        if (head == nullptr || !head->body || !is_cold(*head)) {
+            continue;
+        }
+        const auto& text = head->body->text;
+        if (text.size() < options_.compression_min_bytes || text.size() > block_size) {
+            continue;
+        }
+        auto [it, added] = placed.try_emplace(head->body.get());
+        if (added) {
+            if (raw.empty() || raw.back().size() + text.size() > block_size) {
+                raw.emplace_back();
+            }
+            it->second = { raw.size() - 1, static_cast<std::uint32_t>(raw.back().size()) };
+            raw.back().append(text);
+        }
+        cold.push_back(Cold {
+          ordinal, head, it->second.first, it->second.second, static_cast<std::uint32_t>(text.size()) });
+    }
+    if (cold.empty()) {
+        return 0;
+    }
+
+    auto blocks = std::vector<std::shared_ptr<const PackedBlock>> {};
+    blocks.reserve(raw.size());
+    for (auto& text : raw) {
+        if (stop.stop_requested()) {
+            return 0;
+        }
+        auto data = lz::compress(text, options_.compression_effort);
+        // A block that does not shrink is left as it is.
+        if (data.size() >= text.size()) {
+            blocks.emplace_back();
+            continue;
+        }
+        packed_bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+        blocks.emplace_back(
+          new PackedBlock { next_block_++, std::move(data), text.size() }, [this](const PackedBlock* block) {
+              packed_bytes_.fetch_sub(block->data.size(), std::memory_order_relaxed);
+              delete block;
+          });
+        text = std::string {};
+    }
+
+    auto writer = std::scoped_lock { write_mutex_ };
+    auto compressed = std::size_t { 0 };
+    for (const auto& one : cold) {
+        // Skipped if the note has been written to, or read, since it was found cold.
+        if (!blocks[one.block] || versions_.head(one.ordinal) != one.head || !is_cold(*one.head)) {
+            continue;
+        }
+        auto next = std::make_unique<NoteVersion>();
+        next->note = one.head->note;
+        next->packed = blocks[one.block];
+        next->packed_offset = one.offset;
+        next->packed_length = one.length;
+        next->touched.store(one.head->touched.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        replace_head(one.ordinal, one.head, std::move(next));
+        ++compressed;
+    }
+    // Let go of the pin first, or it would hold back the heads just retired.
+    view = Snapshot {};
+    version_count_.fetch_sub(epochs_.reclaim(), std::memory_order_relaxed);
+    return compressed;
+}
+
+auto NoteStore::spill_cold(std::stop_token stop) -> Result<std::size_t> {
+    struct Frozen {
+        NoteOrdinal ordinal = INVALID_ORDINAL;
+        NoteVersion* head = nullptr;
+    };
+
+    if (!cold_) {
+        return 0;
+    }
+    auto spilling = std::scoped_lock { compress_mutex_ };
+    const auto pass = pass_.load(std::memory_order_relaxed);
+    const auto is_frozen = [&](const NoteVersion& version) {
+        return pass - version.touched.load(std::memory_order_relaxed) >= options_.spill_after;
+    };
+
+    auto spilled = std::size_t { 0 };
+    const auto end = end_ordinal();
+    auto ordinal = NoteOrdinal { 0 };
+    while (ordinal < end && !stop.stop_requested()) {
+        // Held until the segment's notes are swapped, so that none of its heads can be freed, and so reused, before.
+        auto view = snapshot();
+        auto frozen = std::vector<Frozen> {};
+        auto notes = std::vector<NoteView> {};
+        auto bytes = std::size_t { 0 };
+        for (; ordinal < end && bytes < SPILL_SEGMENT; ++ordinal) {
+            auto* head = versions_.head(ordinal);
+            // Base versions are already read from a mapping.
+            if (head == nullptr || head->deleted || head->base || head->spilled != nullptr || !is_frozen(*head)) {
+                continue;
+            }
+            frozen.push_back(Frozen { ordinal, head });
+            notes.push_back(view_of(ordinal, *head, &view));
+            bytes += notes.back().title.size() + notes.back().content.size();
+        }
+        if (frozen.empty()) {
+            continue;
+        }
+        auto records = cold_->spill(notes);
+        if (!records) {
+            return cpp::fail(std::move(records).error());
+        }
+
+        auto writer = std::scoped_lock { write_mutex_ };
+        for (std::size_t i = 0; i < frozen.size(); ++i) {
+            const auto& one = frozen[i];
+            // Skipped if the note has been written to, or read, since it was found cold; its record is left unused.
+            if (versions_.head(one.ordinal) != one.head || !is_frozen(*one.head)) {
+                continue;
+            }
+            auto next = std::make_unique<NoteVersion>();
+            next->note.id = one.head->note.id;
+            next->note.created = one.head->note.created;
+            next->note.updated = one.head->note.updated;
+            next->spilled = (*records)[i];
+            next->touched.store(one.head->touched.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            replace_head(one.ordinal, one.head, std::move(next));
+            ++spilled;
+        }
+        // Let go of the pin first, or it would hold back the heads just retired.
+        notes.clear();
+        view = Snapshot {};
+        version_count_.fetch_sub(epochs_.reclaim(), std::memory_order_relaxed);
+    }
+    return spilled;
+}
+
+auto NoteStore::promote() -> std::size_t {
+    auto ordinals = std::vector<NoteOrdinal> {};
+    {
+        auto lock = std::scoped_lock { promotion_mutex_ };
+        ordinals.assign(promotions_.begin(), promotions_.end());
+        promotions_.clear();
+        promotions_due_.store(false, std::memory_order_relaxed);
+    }
+    if (ordinals.empty()) {
+        return 0;
+    }
+
+    auto writer = std::scoped_lock { write_mutex_ };
+    auto promoted = std::size_t { 0 };
+    for (const auto ordinal : ordinals) {
+        auto* head = versions_.head(ordinal);
+        // Written to (and so copied back) since it was read, or read through a version that was already superseded.
+        if (head == nullptr || head->spilled == nullptr) {
+            continue;
+        }
+        auto next = std::make_unique<NoteVersion>();
+        next->note = view_of(ordinal, *head).to_record();
+        seal(*next);
+        replace_head(ordinal, head, std::move(next));
+        ++promoted;
+    }
+    version_count_.fetch_sub(epochs_.reclaim(), std::memory_order_relaxed);
+    return promoted;
+}
+
+auto NoteStore::ordinal_horizon(CommitVersion version) const -> NoteOrdinal {
+    const auto it = std::ranges::upper_bound(birth_versions_, version);
+    return static_cast<NoteOrdinal>(std::distance(birth_versions_.begin(), it));
+}
+
+auto NoteStore::successor(NoteOrdinal ordinal) const -> std::unique_ptr<NoteVersion> {
+    auto* previous = versions_.head(ordinal);
+    auto next = std::make_unique<NoteVersion>();
+    next->begin = version() + 1;
+    const auto mapped = previous->base || previous->spilled != nullptr;
+    next->note = mapped ? view_of(ordinal, *previous).to_record() : previous->note;
+    // The blob or block is shared rather than copied, until an edit to the content calls for `unshare`.
+    next->body = previous->body;
+    next->packed = previous->packed;
+    next->packed_offset = previous->packed_offset;
+    next->packed_length = previous->packed_length;
+    next->older.store(previous, std::memory_order_relaxed);
+    return next;
+}
+
+void NoteStore::supersede(NoteOrdinal ordinal, std::unique_ptr<NoteVersion> next) {
+    next->note.updated = now();
+    seal(*next);
+    const auto& previous = *next->older.load(std::memory_order_relaxed);
+    {
+        // Keeps the content of cold notes read below alive.
+        const auto reading = snapshot();
+        const auto before = view_of(ordinal, previous, &reading);
+        const auto after = view_of(ordinal, *next, &reading);
+        auto lock = std::unique_lock { index_mutex_ };
+        if (!bulk_loading()) {
+            if (after.title != before.title) {
+                titles_.update(ordinal, before.title, after.title);
+            }
+            if (after.title != before.title && terms_) {
+                terms_->update(ordinal, TermIndex::Field::Title, before.title, after.title);
+            }
+            if (content_changed(*next, previous, after, before)) {
+                if (contents_) {
+                    contents_->update(ordinal, before.content, after.content);
+                }
+                if (terms_) {
+                    terms_->update(ordinal, TermIndex::Field::Content, before.content, after.content);
+                }
+            }
+            if (after.tags != before.tags) {
+                tags_.update(ordinal, before.tags, next->note.tags);
+            }
+            updated_.update(ordinal, after.updated);
+        }
+        const auto commit = next->begin;
+        versions_.publish(ordinal, next.release());
+        committed_.store(commit, std::memory_order_release);
+    }
+    chained(ordinal);
+    after_write(ordinal);
+}
+
+void NoteStore::seal(NoteVersion& version) {
+    version.touched.store(pass_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (!version.body && !version.packed && !version.note.content.empty()) {
+        version.body = blobs_.intern(std::exchange(version.note.content, std::string {}));
+    }
+}
+
+void NoteStore::replace_head(NoteOrdinal ordinal, NoteVersion* head, std::unique_ptr<NoteVersion> copy) {
+    copy->begin = head->begin;
+    copy->older.store(head->older.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    versions_.publish(ordinal, copy.release());
+    // Readers may still be looking at the old head, but see nothing different in the copy.
+    epochs_.retire_one(head, version());
+    version_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NoteStore::request_promotion(NoteOrdinal ordinal) const {
+    {
+        auto lock = std::scoped_lock { promotion_mutex_ };
+        if (!promotions_.insert(ordinal).second) {
+            return;
+        }
+        promotions_due_.store(true, std::memory_order_relaxed);
+    }
+    auto lock = std::scoped_lock { maintenance_mutex_ };
+    maintenance_wake_.notify_one();
+}
+
+void NoteStore::unshare(NoteVersion& version) const {
+    if (version.body || version.packed) {
+        const auto reading = snapshot();
+        version.note.content = view_of(INVALID_ORDINAL, version, &reading).content;
+        version.body.reset();
+        version.packed.reset();
+    }
+}
+
+auto NoteStore::tombstone(NoteOrdinal ordinal, NoteId id) const -> std::unique_ptr<NoteVersion> {
+    auto next = std::make_unique<NoteVersion>();
+    next->begin = version() + 1;
+    next->deleted = true;
+    next->note.id = id;
+    next->older.store(versions_.head(ordinal), std::memory_order_relaxed);
+    return next;
+}
+
+void NoteStore::bury(NoteOrdinal ordinal, std::unique_ptr<NoteVersion> tombstone) {
+    live_.reset(ordinal);
+    tombstones_.set(ordinal);
+    versions_.publish(ordinal, tombstone.release());
+}
+
+void NoteStore::buried(std::size_t count) {
+    const auto pending = tombstone_count_.fetch_add(count, std::memory_order_relaxed) + count;
+    if (options_.compaction_threshold != 0 && pending >= options_.compaction_threshold) {
+        // Taken so the maintenance thread cannot miss the notification between testing the count and going to sleep.
+        auto lock = std::scoped_lock { maintenance_mutex_ };
+        maintenance_wake_.notify_one();
+    }
+}
+
+void NoteStore::maintain(std::stop_token stop) {
+    const auto interval = options_.compression_interval;
+    const auto compressing = (options_.cold_after != 0 || cold_) && interval.count() != 0;
+    const auto compaction_due = [&] {
+        return options_.compaction_threshold != 0 && tombstone_count() >= options_.compaction_threshold;
+    };
+    const auto due = [&] { return compaction_due() || promotions_due_.load(std::memory_order_relaxed); };
+    auto next_pass = std::chrono::steady_clock::now() + interval;
+    while (true) {
+        {
+            auto lock = std::unique_lock { maintenance_mutex_ };
+            if (compressing) {
+                maintenance_wake_.wait_until(lock, stop, next_pass, due);
+            } else {
+                maintenance_wake_.wait(lock, stop, due);
+            }
+            if (stop.stop_requested()) {
+                return;
+            }
+        }
+        promote();
+        if (compaction_due()) {
+            compact(stop);
+        }
+        if (compressing && std::chrono::steady_clock::now() >= next_pass) {
+            compress_cold(stop);
+            // A segment that cannot be written leaves its notes in memory, for the next pass to try again.
+            (void) spill_cold(stop);
+            next_pass = std::chrono::steady_clock::now() + interval;
+        }
+    }
+}
+
+auto NoteStore::apply_edit(NoteRecord& record, const NoteEdit& edit) -> Result<void> {
+    // Each `apply_edits` leaves its text alone when it fails; the title and tags are copied so the whole edit can be
+    // undone, and the content, the one field that may be large, goes last so it never has to be.
+    auto title = record.title;
+    if (auto applied = apply_edits(title, edit.title); !applied) {
+        return applied;
+    }
+    auto tags = record.tags;
+    if (auto applied = apply_tag_edits(tags, edit.tags); !applied) {
+        return applied;
+    }
+    if (auto applied = apply_edits(record.content, edit.content); !applied) {
+        return applied;
+    }
+    record.title = std::move(title);
+    record.tags = std::move(tags);
+    return {};
+}
+
+auto NoteStore::current_ordinal(NoteId id) const -> NoteOrdinal {
+    auto it = ids_.find(id);
+    return it != ids_.end() && live_.test(it->second) ? it->second : INVALID_ORDINAL;
+}
+
+auto NoteStore::view_of(NoteOrdinal ordinal, const NoteVersion& version, const Snapshot* reading) const -> NoteView {
+    if (version.base) {
+        return checkpoint_->note(ordinal);
+    }
+    if (version.spilled != nullptr) {
+        const auto record = ColdTier::read(version.spilled);
+        return NoteView {
+            .id = version.note.id,
+            .title = record.title,
+            .content = record.content,
+            .tags = record.tags,
+            .created = version.note.created,
+            .updated = version.note.updated,
+        };
+    }
+    auto view = version.note.view();
+    if (version.body) {
+        view.content = version.body->text;
+    } else if (version.packed && reading != nullptr) {
+        const auto block = reading->hold(blocks_.read(*version.packed));
+        view.content = block.substr(version.packed_offset, version.packed_length);
+    }
+    return view;
+}
+
+void NoteStore::chained(NoteOrdinal ordinal) {
+    if (!chained_.test(ordinal)) {
+        chained_.set(ordinal);
+        chains_.push_back(ordinal);
+    }
+}
+
+auto NoteStore::build_indexes() -> std::size_t {
+    // Notes read per snapshot, so that the blocks decompressed for cold notes are let go of as the build goes.
+    constexpr auto CHUNK = NoteOrdinal { 4096 };
+
+    const auto latest = snapshot();
+    const auto end = ordinal_horizon(latest.version());
+    const auto configured = options_.write_threads;
+    const auto threads = std::min<std::size_t>(
+      end / PARALLEL_BATCH + 1,
+      configured != 0 ? configured : std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+
+    struct Part {
+        TrigramIndex::Builder titles;
+        std::optional<TrigramIndex::Builder> contents;
+        std::optional<TermIndex::Builder> terms;
+        TagIndex::Builder tags;
+        std::vector<DateIndex::Key> created;
+        std::vector<DateIndex::Key> updated;
+        std::size_t notes = 0;
+    };
+    auto parts = std::vector<Part> {};
+    parts.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        auto& part = parts.emplace_back();
+        part.titles = TrigramIndex::Builder { threads };
+        if (contents_) {
+            part.contents.emplace(threads);
+        }
+        if (terms_) {
+            part.terms.emplace(threads);
+        }
+    }
+    const auto read = [&](std::size_t index) {
+        auto& part = parts[index];
+        const auto first = static_cast<NoteOrdinal>(std::uint64_t { end } * index / threads);
+        const auto last = static_cast<NoteOrdinal>(std::uint64_t { end } * (index + 1) / threads);
+        for (auto from = first; from < last;) {
+            const auto chunk = snapshot(latest);
+            const auto to = from + std::min(CHUNK, last - from);
+            for (auto ordinal = from; ordinal < to; ++ordinal) {
+                const auto note = live_.test(ordinal) ? peek(ordinal, chunk) : std::nullopt;
+                if (!note) {
+                    continue;
+                }
+                part.titles.add(ordinal, note->title);
+                if (part.contents) {
+                    part.contents->add(ordinal, note->content);
+                }
+                if (part.terms) {
+                    part.terms->add(ordinal, note->title, note->content);
+                }
+                part.tags.add(ordinal, note->tags);
+                part.created.emplace_back(note->created, ordinal);
+                part.updated.emplace_back(note->updated, ordinal);
+                ++part.notes;
+            }
+            from = to;
+        }
+    };
+    {
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            pool.emplace_back(read, i);
+        }
+    }
+
+    auto title_parts = std::vector<TrigramIndex::Builder> {};
+    auto content_parts = std::vector<TrigramIndex::Builder> {};
+    auto term_parts = std::vector<TermIndex::Builder> {};
+    auto tag_parts = std::vector<TagIndex::Builder> {};
+    auto created = std::vector<DateIndex::Key> {};
+    auto updated = std::vector<DateIndex::Key> {};
+    for (auto& part : parts) {
+        title_parts.push_back(std::move(part.titles));
+        if (part.contents) {
+            content_parts.push_back(std::move(*part.contents));
+        }
+        if (part.terms) {
+            term_parts.push_back(std::move(*part.terms));
+        }
+        tag_parts.push_back(std::move(part.tags));
+        created.insert(created.end(), part.created.begin(), part.created.end());
+        updated.insert(updated.end(), part.updated.begin(), part.updated.end());
+        part.created = {};
+        part.updated = {};
+    }
+    auto indexed = std::size_t { 0 };
+    for (const auto& part : parts) {
+        indexed += part.notes;
+    }
+
+    // Each index is built on a thread of its own; the trigram and term indexes sort their shards on more besides.
+    auto titles = TrigramIndex {};
+    auto contents = std::optional<TrigramIndex> {};
+    auto terms = std::optional<TermIndex> {};
+    auto tags = TagIndex {};
+    auto created_index = DateIndex {};
+    auto updated_index = DateIndex {};
+    {
+        auto pool = std::vector<std::jthread> {};
+        pool.emplace_back([&] { titles = TrigramIndex::build(title_parts, threads); });
+        if (contents_) {
+            pool.emplace_back([&] { contents = TrigramIndex::build(content_parts, threads); });
+        }
+        if (terms_) {
+            pool.emplace_back([&] { terms = TermIndex::build(term_parts, threads); });
+        }
+        pool.emplace_back([&] { tags = TagIndex::build(tag_parts); });
+        pool.emplace_back([&] { created_index = DateIndex::build(std::move(created)); });
+        pool.emplace_back([&] { updated_index = DateIndex::build(std::move(updated)); });
+    }
+
+    {
+        // Swapped rather than moved in, so that the old indexes are freed once searches can have the new ones.
+        auto lock = std::unique_lock { index_mutex_ };
+        std::swap(titles_, titles);
+        std::swap(contents_, contents);
+        std::swap(terms_, terms);
+        std::swap(tags_, tags);
+        std::swap(created_, created_index);
+        std::swap(updated_, updated_index);
+        // No index holds a removed note any more, so there is nothing left to compact.
+        tombstones_ = Bitmap {};
+    }
+    tombstone_count_.store(0, std::memory_order_relaxed);
+    return indexed;
+}
+
+void NoteStore::after_write(NoteOrdinal ordinal) {
+    dirty_chunks_.set(static_cast<NoteOrdinal>(ordinal / Checkpoint::CHUNK_NOTES));
+    version_count_.fetch_add(1, std::memory_order_relaxed);
+    if (++writes_since_collect_ >= GC_INTERVAL) {
+        collect();
+    }
+}
+
+void NoteStore::changed(NoteId id) const {
+    if (options_.on_change) {
+        options_.on_change(id);
+    }
+}
+
+auto NoteStore::collect() -> std::size_t {
+    writes_since_collect_ = 0;
+    const auto latest = version();
+    // No snapshot older than this exists or can still be taken, so nothing needs a version superseded before it.
+    const auto horizon = std::min(latest, epochs_.oldest_pin());
+
+    auto dead = std::vector<NoteOrdinal> {};
+    std::erase_if(chains_, [&](NoteOrdinal ordinal) {
+        auto* head = versions_.head(ordinal);
+        auto* keep = head;
+        while (keep != nullptr && keep->begin > horizon) {
+            keep = keep->older.load(std::memory_order_relaxed);
+        }
+        if (keep == nullptr) {
+            return false;
+        }
+        epochs_.retire(keep->older.exchange(nullptr, std::memory_order_seq_cst), latest);
+        if (keep != head) {
+            return false;
+        }
+        if (head->deleted) {
+            dead.push_back(ordinal);
+        }
+        chained_.reset(ordinal);
+        return true;
+    });
+
+    if (!dead.empty()) {
+        auto lock = std::unique_lock { index_mutex_ };
+        for (auto ordinal : dead) {
+            auto* tombstone = versions_.head(ordinal);
+            auto it = ids_.find(tombstone->note.id);
+            if (it != ids_.end() && it->second == ordinal) {
+                ids_.erase(it);
+            }
+            versions_.publish(ordinal, nullptr);
+            epochs_.retire(tombstone, latest);
+        }
+    }
+
+    const auto freed = epochs_.reclaim();
+    version_count_.fetch_sub(freed, std::memory_order_relaxed);
+    return freed;
+}
+
+auto NoteStore::now() const -> Timestamp {
+    if (options_.clock) {
+        return options_.clock();
+    }
+    return system_now();
+}
+
+}  // namespace pg::store
@@ -0,0 +1,201 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <pg/store/PageToken.hpp>
+
+namespace pg::store {
+namespace {
+
+constexpr std::uint8_t FORMAT = 1;
+constexpr std::string_view ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+auto get_varint(std::span<const std::uint8_t>& in) -> std::optional<std::uint64_t> {
+    auto value = std::uint64_t { 0 };
+    for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        const auto byte = in.front();
+        in = in.subspan(1);
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+auto zigzag(std::int64_t value) -> std::uint64_t {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+auto unzigzag(std::uint64_t value) -> std::int64_t {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+auto to_base64url(std::span<const std::uint8_t> bytes) -> std::string {
+    auto out = std::string {};
+    out.reserve((bytes.size() * 4 + 2) / 3);
+    auto bits = std::uint32_t { 0 };
+    auto pending = 0;
+    for (auto byte : bytes) {
+        bits = (bits << 8) | byte;
+        pending += 8;
+        while (pending >= 6) {
+            pending -= 6;
+            out.push_back(ALPHABET[(bits >> pending) & 0x3F]);
+        }
+    }
+    if (pending > 0) {
+        out.push_back(ALPHABET[(bits << (6 - pending)) & 0x3F]);
+    }
+    return out;
+}
+
+auto from_base64url(std::string_view text) -> std::optional<std::vector<std::uint8_t>> {
+    constexpr auto table = [] {
+        auto table = std::array<std::int8_t, 256> {};
+        table.fill(-1);
+        for (std::size_t i = 0; i < ALPHABET.size(); ++i) {
+            table[static_cast<unsigned char>(ALPHABET[i])] = static_cast<std::int8_t>(i);
+        }
+        return table;
+    }();
+
+    auto out = std::vector<std::uint8_t> {};
+    out.reserve(text.size() * 3 / 4);
+    auto bits = std::uint32_t { 0 };
+    auto pending = 0;
+    for (auto c : text) {
+        const auto value = table[static_cast<unsigned char>(c)];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        bits = (bits << 6) | static_cast<std::uint32_t>(value);
+        pending += 6;
+        if (pending >= 8) {
+            pending -= 8;
+            out.push_back(static_cast<std::uint8_t>(bits >> pending));
+        }
+    }
+    // Whatever is left over must be the zero padding `to_base64url` adds, and less than a character's worth.
+    if (pending >= 6 || (bits & ((1U << pending) - 1)) != 0) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+auto malformed() {
+    return fail(ErrorCode::InvalidArgument, "malformed page token");
+}
+
+}  // namespace
+
+auto encode_page_token(PageKind kind, const Cursor& cursor, std::uint32_t fingerprint) -> std::string {
+    auto bytes = std::vector<std::uint8_t> { FORMAT, static_cast<std::uint8_t>(kind) };
+    put_varint(bytes, cursor.version);
+    put_varint(bytes, zigzag(cursor.sort_key));
+    put_varint(bytes, cursor.ordinal);
+    if (cursor.ranking) {
+        put_varint(bytes, cursor.ranking->notes);
+        put_varint(bytes, cursor.ranking->title_words);
+        put_varint(bytes, cursor.ranking->content_words);
+        put_varint(bytes, cursor.ranking->frequencies.size());
+        for (auto frequency : cursor.ranking->frequencies) {
+            put_varint(bytes, frequency);
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        bytes.push_back(static_cast<std::uint8_t>(fingerprint >> (8 * i)));
+    }
+    return to_base64url(bytes);
+}
+
+auto decode_page_token(std::string_view token, PageKind kind, std::uint32_t fingerprint) -> Result<Cursor> {
+    const auto bytes = from_base64url(token);
+    if (!bytes || bytes->size() < 2 || (*bytes)[0] != FORMAT) {
+        return malformed();
+    }
+    if ((*bytes)[1] != static_cast<std::uint8_t>(kind)) {
+        return fail(ErrorCode::InvalidArgument, "page token was issued for a different request");
+    }
+
+    auto in = std::span<const std::uint8_t> { *bytes }.subspan(2);
+    const auto version = get_varint(in);
+    const auto sort_key = get_varint(in);
+    const auto ordinal = get_varint(in);
+    if (!version || !sort_key || !ordinal || *ordinal >= INVALID_ORDINAL || in.size() < 4) {
+        return malformed();
+    }
+    // Only ranked searches' tokens carry anything between the ordinal and the fingerprint.
+    auto ranking = std::optional<RankingStats> {};
+    if (in.size() > 4) {
+        const auto notes = get_varint(in);
+        const auto title_words = get_varint(in);
+        const auto content_words = get_varint(in);
+        const auto terms = get_varint(in);
+        // Every frequency takes a byte at least.
+        if (!notes || !title_words || !content_words || !terms || *terms > in.size()) {
+            return malformed();
+        }
+        ranking = RankingStats { *notes, *title_words, *content_words, {} };
+        for (std::uint64_t i = 0; i < *terms; ++i) {
+            const auto frequency = get_varint(in);
+            if (!frequency) {
+                return malformed();
+            }
+            ranking->frequencies.push_back(*frequency);
+        }
+    }
+    if (in.size() != 4) {
+        return malformed();
+    }
+    auto stored = std::uint32_t { 0 };
+    for (int i = 0; i < 4; ++i) {
+        stored |= static_cast<std::uint32_t>(in[static_cast<std::size_t>(i)]) << (8 * i);
+    }
+    if (stored != fingerprint) {
+        return fail(ErrorCode::InvalidArgument, "page token was issued for a different query");
+    }
+    return Cursor {
+        .version = *version,
+        .sort_key = unzigzag(*sort_key),
+        .ordinal = static_cast<NoteOrdinal>(*ordinal),
+        .ranking = std::move(ranking),
+    };
+}
+
+auto fingerprint_of(const SearchQuery& query) -> std::uint32_t {
+    // FNV-1a over the rendered predicates, which capture field, kind, text and case sensitivity.
+    auto hash = std::uint32_t { 2166136261U };
+    const auto mix = [&](std::string_view text) {
+        for (auto c : text) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+        }
+    };
+    for (const auto& predicate : query.predicates) {
+        mix(predicate.describe());
+        mix("\n");
+    }
+    // Ordinal order leaves the hash as it always was.
+    if (query.order != SearchOrder::Ordinal) {
+        mix(to_string(query.order));
+    }
+    return hash;
+}
+
+}  // namespace pg::store
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+#include <pg/store/PatternSet.hpp>
+
+namespace pg::store {
+
+auto PatternSet::compile(std::span<const std::string_view> patterns) -> Result<PatternSet> {
+    auto set = PatternSet {};
+    for (const auto pattern : patterns) {
+        if (pattern.empty()) {
+            return fail(ErrorCode::InvalidArgument, "search text must not be empty");
+        }
+        for (const auto byte : pattern) {
+            auto& cls = set.classes_of_[static_cast<unsigned char>(byte)];
+            if (cls == 0) {
+                cls = static_cast<std::uint16_t>(set.classes_++);
+            }
+        }
+    }
+    const auto classes = set.classes_;
+
+    // Build the trie, with `NONE` for missing edges, and remember which pattern ends at each state.
+    auto own = std::vector<std::uint32_t> { NONE };
+    set.states_.emplace_back();
+    set.transitions_.assign(classes, NONE);
+    for (const auto pattern : patterns) {
+        auto state = ROOT;
+        for (const auto byte : pattern) {
+            const auto cls = set.classes_of_[static_cast<unsigned char>(byte)];
+            const auto edge = static_cast<std::size_t>(state) * classes + cls;
+            if (set.transitions_[edge] == NONE) {
+                set.transitions_[edge] = static_cast<State>(set.states_.size());
+                set.states_.push_back(StateInfo { set.states_[state].depth + 1, NONE });
+                set.transitions_.resize(set.transitions_.size() + classes, NONE);
+                own.push_back(NONE);
+            }
+            state = set.transitions_[edge];
+        }
+        if (own[state] == NONE) {
+            own[state] = static_cast<std::uint32_t>(set.lengths_.size());
+        }
+        set.lengths_.push_back(static_cast<std::uint32_t>(pattern.size()));
+    }
+
+    // Breadth first, fill in the failure links, then turn every missing edge into the edge its failure state takes,
+    // which makes the automaton a DFA. A state's output is its own pattern, or else its failure state's output.
+    auto fail_of = std::vector<State>(set.states_.size(), ROOT);
+    auto queue = std::deque<State> {};
+    for (std::size_t c = 0; c < classes; ++c) {
+        auto& edge = set.transitions_[c];
+        if (edge == NONE) {
+            edge = ROOT;
+        } else {
+            set.states_[edge].output = own[edge];
+            queue.push_back(edge);
+        }
+    }
+    while (!queue.empty()) {
+        const auto state = queue.front();
+        queue.pop_front();
+        const auto base = static_cast<std::size_t>(state) * classes;
+        const auto fallback = static_cast<std::size_t>(fail_of[state]) * classes;
+        for (std::size_t c = 0; c < classes; ++c) {
+            const auto child = set.transitions_[base + c];
+            if (child == NONE) {
+                set.transitions_[base + c] = set.transitions_[fallback + c];
+                continue;
+            }
+            fail_of[child] = set.transitions_[fallback + c];
+            set.states_[child].output = own[child] != NONE ? own[child] : set.states_[fail_of[child]].output;
+            queue.push_back(child);
+        }
+    }
+    return set;
+}
+
+auto PatternSet::matches(std::string_view text) const -> std::vector<Match> {
+    auto found = std::vector<Match> {};
+    for_each_match(text, [&](const Match& match) { found.push_back(match); });
+    return found;
+}
+
+auto PatternSet::replace(std::string_view text, std::span<const std::string_view> replacements) const
+  -> std::string {
+    assert(replacements.size() == size());
+    auto out = std::string {};
+    out.reserve(text.size());
+    auto from = std::size_t { 0 };
+    for_each_match(text, [&](const Match& match) {
+        out.append(text.substr(from, match.start - from));
+        out.append(replacements[match.pattern]);
+        from = match.start + match.length;
+    });
+    out.append(text.substr(from));
+    return out;
+}
+
+auto PatternCache::get(std::span<const std::string_view> patterns) -> Result<std::shared_ptr<const PatternSet>> {
+    // Size-prefix every pattern so that no two lists share a key.
+    auto key = std::string {};
+    for (const auto pattern : patterns) {
+        const auto size = static_cast<std::uint32_t>(pattern.size());
+        key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        key.append(pattern);
+    }
+
+    if (auto cached = cache_.find(key)) {
+        return std::move(*cached);
+    }
+    auto compiled = PatternSet::compile(patterns);
+    if (!compiled) {
+        return cpp::fail(compiled.error());
+    }
+    return cache_.insert(std::move(key), std::make_shared<const PatternSet>(std::move(*compiled)));
+}
+
+}  // namespace pg::store
@@ -0,0 +1,162 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cassert>
+#include <utility>
+
+#include <pg/store/PieceTable.hpp>
+
+namespace pg::store {
+
+PieceTable::PieceTable(std::string_view original): original_(original) {
+    if (!original_.empty()) {
+        root_ = make(Buffer::Original, 0, original_.size(), next_priority());
+    }
+}
+
+auto PieceTable::size() const noexcept -> std::size_t {
+    return total(root_);
+}
+
+auto PieceTable::pieces() const noexcept -> std::size_t {
+    return root_ == NIL ? 0 : nodes_[root_].count;
+}
+
+void PieceTable::insert(std::size_t position, std::string_view text) {
+    assert(position <= size());
+    if (text.empty()) {
+        return;
+    }
+    const auto offset = added_.size();
+    added_.append(text);
+    auto left = NIL;
+    auto right = NIL;
+    split(root_, position, left, right);
+    const auto piece = make(Buffer::Added, offset, text.size(), next_priority());
+    root_ = merge(merge(left, piece), right);
+}
+
+void PieceTable::erase(std::size_t start, std::size_t end) {
+    assert(start <= end && end <= size());
+    if (start == end) {
+        return;
+    }
+    auto head = NIL;
+    auto tail = NIL;
+    split(root_, end, head, tail);
+    auto kept = NIL;
+    auto erased = NIL;
+    split(head, start, kept, erased);
+    root_ = merge(kept, tail);
+}
+
+void PieceTable::assign(std::string text) {
+    owned_ = std::move(text);
+    owns_ = true;
+    original_ = {};
+    added_.clear();
+    nodes_.clear();
+    root_ = owned_.empty() ? NIL : make(Buffer::Original, 0, owned_.size(), next_priority());
+}
+
+auto PieceTable::str() const -> std::string {
+    auto out = std::string {};
+    out.reserve(size());
+    auto stack = std::vector<Index> {};
+    auto node = root_;
+    while (node != NIL || !stack.empty()) {
+        while (node != NIL) {
+            stack.push_back(node);
+            node = nodes_[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        out.append(text_of(nodes_[node]));
+        node = nodes_[node].right;
+    }
+    return out;
+}
+
+auto PieceTable::text_of(const Node& node) const noexcept -> std::string_view {
+    const auto buffer =
+      node.buffer == Buffer::Added ? std::string_view { added_ } : owns_ ? std::string_view { owned_ } : original_;
+    return buffer.substr(node.offset, node.length);
+}
+
+auto PieceTable::make(Buffer buffer, std::size_t offset, std::size_t length, std::uint32_t priority) -> Index {
+    nodes_.push_back(Node { buffer, offset, length, length, 1, priority });
+    return static_cast<Index>(nodes_.size() - 1);
+}
+
+auto PieceTable::next_priority() noexcept -> std::uint32_t {
+    // xorshift32: only the spread matters, not the quality.
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+void PieceTable::update(Index node) noexcept {
+    auto& n = nodes_[node];
+    n.total = n.length + total(n.left) + total(n.right);
+    n.count = 1 + (n.left == NIL ? 0 : nodes_[n.left].count) + (n.right == NIL ? 0 : nodes_[n.right].count);
+}
+
+void PieceTable::split(Index node, std::size_t position, Index& left, Index& right) {
+    if (node == NIL) {
+        left = NIL;
+        right = NIL;
+        return;
+    }
+    // `make` may grow `nodes_`, so no reference into it is held across a call.
+    const auto before = total(nodes_[node].left);
+    const auto length = nodes_[node].length;
+    if (position <= before) {
+        auto inner = NIL;
+        split(nodes_[node].left, position, left, inner);
+        nodes_[node].left = inner;
+        right = node;
+    } else if (position >= before + length) {
+        auto inner = NIL;
+        split(nodes_[node].right, position - before - length, inner, right);
+        nodes_[node].right = inner;
+        left = node;
+    } else {
+        // Cut the piece in two. The tail takes the head's priority, which keeps the heap order: everything under it
+        // came from under the head.
+        const auto cut = position - before;
+        const auto tail =
+          make(nodes_[node].buffer, nodes_[node].offset + cut, length - cut, nodes_[node].priority);
+        nodes_[tail].right = nodes_[node].right;
+        nodes_[node].right = NIL;
+        nodes_[node].length = cut;
+        update(tail);
+        left = node;
+        right = tail;
+    }
+    update(node);
+}
+
+auto PieceTable::merge(Index left, Index right) -> Index {
+    if (left == NIL) {
+        return right;
+    }
+    if (right == NIL) {
+        return left;
+    }
+    if (nodes_[left].priority > nodes_[right].priority) {
+        const auto merged = merge(nodes_[left].right, right);
+        nodes_[left].right = merged;
+        update(left);
+        return left;
+    }
+    const auto merged = merge(left, nodes_[right].left);
+    nodes_[right].left = merged;
+    update(right);
+    return right;
+}
+
+}  // namespace pg::store
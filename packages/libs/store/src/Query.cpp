@@ -0,0 +1,120 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <pg/store/Query.hpp>
+#include <pg/util/text_search.hpp>
+
+namespace pg::store {
+namespace {
+
+auto format_timestamp(Timestamp timestamp) -> std::string {
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(timestamp);
+    return fmt::format("{:%Y-%m-%dT%H:%M:%S}Z", fmt::gmtime(std::chrono::system_clock::to_time_t(seconds)));
+}
+
+}  // namespace
+
+auto TextPredicate::test(std::string_view value) const -> bool {
+    namespace kernels = pg::util::text;
+    switch (kind) {
+        case TextMatchKind::Matches: return kernels::equals(value, text, case_sensitive);
+        case TextMatchKind::Contains: return kernels::contains(value, text, case_sensitive);
+        case TextMatchKind::StartsWith: return kernels::starts_with(value, text, case_sensitive);
+        case TextMatchKind::EndsWith: return kernels::ends_with(value, text, case_sensitive);
+    }
+    return false;
+}
+
+auto DatePredicate::test(Timestamp value) const -> bool {
+    switch (kind) {
+        case DateMatchKind::Before: return value < start;
+        case DateMatchKind::After: return value > start;
+        case DateMatchKind::InRange: return start <= value && value <= end;
+        case DateMatchKind::NotInRange: return value < start || value > end;
+    }
+    return false;
+}
+
+auto Predicate::test(const NoteView& note) const -> bool {
+    switch (field) {
+        case NoteField::Title: return text().test(note.title);
+        case NoteField::Content: return text().test(note.content);
+        case NoteField::Tag:
+            return std::ranges::any_of(note.tags, [this](std::string_view tag) { return text().test(tag); });
+        case NoteField::Created: return date().test(note.created);
+        case NoteField::Updated: return date().test(note.updated);
+    }
+    return false;
+}
+
+auto Predicate::describe() const -> std::string {
+    if (const auto* text = std::get_if<TextPredicate>(&match)) {
+        return fmt::format(
+          "{} {} \"{}\"{}",
+          to_string(field),
+          to_string(text->kind),
+          text->text,
+          text->case_sensitive ? "" : " (ci)");
+    }
+    const auto& date = std::get<DatePredicate>(match);
+    if (date.kind == DateMatchKind::Before || date.kind == DateMatchKind::After) {
+        return fmt::format("{} {} {}", to_string(field), to_string(date.kind), format_timestamp(date.start));
+    }
+    return fmt::format(
+      "{} {} [{}, {}]",
+      to_string(field),
+      to_string(date.kind),
+      format_timestamp(date.start),
+      format_timestamp(date.end));
+}
+
+auto to_string(NoteField field) -> std::string_view {
+    switch (field) {
+        case NoteField::Title: return "title";
+        case NoteField::Content: return "content";
+        case NoteField::Tag: return "tag";
+        case NoteField::Created: return "created";
+        case NoteField::Updated: return "updated";
+    }
+    return "?";
+}
+
+auto to_string(TextMatchKind kind) -> std::string_view {
+    switch (kind) {
+        case TextMatchKind::Matches: return "matches";
+        case TextMatchKind::Contains: return "contains";
+        case TextMatchKind::StartsWith: return "starts with";
+        case TextMatchKind::EndsWith: return "ends with";
+    }
+    return "?";
+}
+
+auto to_string(SearchOrder order) -> std::string_view {
+    switch (order) {
+        case SearchOrder::Ordinal: return "ordinal";
+        case SearchOrder::Relevance: return "relevance";
+    }
+    return "?";
+}
+
+auto to_string(DateMatchKind kind) -> std::string_view {
+    switch (kind) {
+        case DateMatchKind::Before: return "before";
+        case DateMatchKind::After: return "after";
+        case DateMatchKind::InRange: return "in";
+        case DateMatchKind::NotInRange: return "not in";
+    }
+    return "?";
+}
+
+}  // namespace pg::store
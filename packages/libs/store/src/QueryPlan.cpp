@@ -0,0 +1,99 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include <pg/store/QueryPlan.hpp>
+
+namespace pg::store {
+namespace {
+
+auto micros(std::chrono::nanoseconds duration) -> double {
+    return static_cast<double>(duration.count()) / 1000.0;
+}
+
+}  // namespace
+
+auto QueryPlan::explain() const -> std::string {
+    auto out = std::string {};
+    auto it = std::back_inserter(out);
+
+    fmt::format_to(it, "plan of {} step(s) over {} notes, ", steps.size(), universe);
+    if (limit == 0) {
+        fmt::format_to(it, "no limit\n");
+    } else {
+        fmt::format_to(it, "limit {}\n", limit);
+    }
+    if (steps.empty()) {
+        fmt::format_to(it, "  every note matches\n");
+    } else {
+        fmt::format_to(
+          it,
+          "  {:>2}  {:<9}  {:<16}  {:>9}  {:>9}  {:>9}  {:>11}  {}\n",
+          "#",
+          "mode",
+          "access",
+          "estimate",
+          "rows in",
+          "rows out",
+          "time",
+          "predicate");
+    }
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        const auto& step = steps[i];
+        fmt::format_to(
+          it,
+          "  {:>2}  {:<9}  {:<16}  {:>9}  {:>9}  {:>9}  {:>9.1f}us  {}{}\n",
+          i + 1,
+          to_string(step.mode),
+          to_string(step.path),
+          step.estimate,
+          step.mode == StepMode::Drive ? std::string { "-" } : fmt::format("{}", step.rows_in),
+          step.rows_out,
+          micros(step.elapsed),
+          step.label,
+          step.recheck ? " (recheck)" : "");
+    }
+    if (parallel_scan) {
+        fmt::format_to(it, "  no index applies: scanned on {} thread(s), filter times summed over threads\n", threads);
+    }
+    if (ranked) {
+        fmt::format_to(it, "  ranked by relevance: {} note(s) scored in full\n", scored);
+    }
+    fmt::format_to(
+      it,
+      "returned {} note(s){}; planning {:.1f}us, execution {:.1f}us\n",
+      returned,
+      stopped_early ? ", stopped early" : "",
+      micros(planning),
+      micros(execution));
+    return out;
+}
+
+auto to_string(AccessPath path) -> std::string_view {
+    switch (path) {
+        case AccessPath::TagIndex: return "tag index";
+        case AccessPath::TitleTrigrams: return "title trigrams";
+        case AccessPath::ContentTrigrams: return "content trigrams";
+        case AccessPath::CreatedIndex: return "created index";
+        case AccessPath::UpdatedIndex: return "updated index";
+        case AccessPath::Scan: return "scan";
+    }
+    return "?";
+}
+
+auto to_string(StepMode mode) -> std::string_view {
+    switch (mode) {
+        case StepMode::Drive: return "drive";
+        case StepMode::Intersect: return "intersect";
+        case StepMode::Filter: return "filter";
+    }
+    return "?";
+}
+
+}  // namespace pg::store
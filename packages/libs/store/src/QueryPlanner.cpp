@@ -0,0 +1,600 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+
+#include <pg/store/QueryPlanner.hpp>
+
+namespace pg::store {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Assumed fraction of notes matched by a predicate no index can estimate.
+constexpr double DEFAULT_SELECTIVITY = 0.25;
+/// Assumed fraction of notes matched by an exact `TextMatchesQuery` no index can estimate.
+constexpr double MATCHES_SELECTIVITY = 0.01;
+/// Assumed fraction of trigram candidates that survive the recheck.
+constexpr double RECHECK_SELECTIVITY = 0.8;
+
+/**
+ * Relative cost of testing one note against a predicate on `field`. Content is typically far longer than the other
+ * columns, timestamps are a single comparison.
+ */
+auto filter_cost(NoteField field) -> double {
+    switch (field) {
+        case NoteField::Title: return 4.0;
+        case NoteField::Content: return 32.0;
+        case NoteField::Tag: return 4.0;
+        case NoteField::Created:
+        case NoteField::Updated: return 1.0;
+    }
+    return 1.0;
+}
+
+/**
+ * What the planner knows about one predicate before deciding where it goes in the plan.
+ */
+struct Analysis {
+    std::size_t predicate;
+    AccessPath path;
+    std::size_t estimate;
+    /// Estimated cost of producing the predicate's bitmap from its index.
+    double index_cost;
+    bool recheck;
+};
+
+auto date_index(const NoteStore& store, NoteField field) -> const DateIndex& {
+    return field == NoteField::Created ? store.created() : store.updated();
+}
+
+auto date_estimate(const DateIndex& index, const DatePredicate& date) -> std::size_t {
+    constexpr auto tick = Timestamp::duration { 1 };
+    switch (date.kind) {
+        // Nothing is before the earliest timestamp or after the latest, and stepping past either would overflow.
+        case DateMatchKind::Before:
+            return date.start == Timestamp::min() ? 0 : index.estimate(Timestamp::min(), date.start - tick);
+        case DateMatchKind::After:
+            return date.start == Timestamp::max() ? 0 : index.estimate(date.start + tick, Timestamp::max());
+        case DateMatchKind::InRange: return index.estimate(date.start, date.end);
+        case DateMatchKind::NotInRange: return index.size() - index.estimate(date.start, date.end);
+    }
+    return index.size();
+}
+
+auto analyse(const NoteStore& store, const SearchQuery& query, std::size_t i) -> Analysis {
+    const auto& predicate = query.predicates[i];
+    const auto universe = store.size();
+    const auto words = static_cast<double>(store.end_ordinal()) / static_cast<double>(Bitmap::WORD_BITS);
+
+    const auto scan = [&] {
+        auto selectivity = DEFAULT_SELECTIVITY;
+        if (const auto* text = std::get_if<TextPredicate>(&predicate.match)) {
+            selectivity = text->kind == TextMatchKind::Matches ? MATCHES_SELECTIVITY : DEFAULT_SELECTIVITY;
+        }
+        return Analysis {
+            .predicate = i,
+            .path = AccessPath::Scan,
+            .estimate = static_cast<std::size_t>(selectivity * static_cast<double>(universe)),
+            .index_cost = std::numeric_limits<double>::infinity(),
+            .recheck = false,
+        };
+    };
+    const auto trigrams = [&](const TrigramIndex& index, AccessPath path) {
+        const auto estimate = index.estimate(predicate.text().text);
+        if (!estimate) {
+            return scan();
+        }
+        return Analysis {
+            .predicate = i,
+            .path = path,
+            .estimate = std::min(*estimate, universe),
+            .index_cost = 2.0 * static_cast<double>(*estimate) + words,
+            .recheck = true,
+        };
+    };
+
+    switch (predicate.field) {
+        case NoteField::Title: return trigrams(store.titles(), AccessPath::TitleTrigrams);
+        case NoteField::Content:
+            return store.contents() != nullptr ? trigrams(*store.contents(), AccessPath::ContentTrigrams) : scan();
+        case NoteField::Tag: {
+            const auto& text = predicate.text();
+            const auto exact = text.kind == TextMatchKind::Matches && text.case_sensitive;
+            const auto tags = static_cast<double>(store.tags().size());
+            const auto dictionary = exact ? 0.0 : tags * filter_cost(NoteField::Tag);
+            return Analysis {
+                .predicate = i,
+                .path = AccessPath::TagIndex,
+                .estimate = std::min(store.tags().estimate(text), universe),
+                .index_cost = dictionary + words,
+                .recheck = false,
+            };
+        }
+        case NoteField::Created:
+        case NoteField::Updated: {
+            const auto estimate = date_estimate(date_index(store, predicate.field), predicate.date());
+            return Analysis {
+                .predicate = i,
+                .path = predicate.field == NoteField::Created ? AccessPath::CreatedIndex : AccessPath::UpdatedIndex,
+                .estimate = estimate,
+                .index_cost = 2.0 * static_cast<double>(estimate) + words,
+                .recheck = false,
+            };
+        }
+    }
+    return scan();
+}
+
+auto make_step(const SearchQuery& query, const Analysis& analysis, StepMode mode) -> PlanStep {
+    return PlanStep {
+        .predicate = analysis.predicate,
+        .mode = mode,
+        .path = mode == StepMode::Filter ? AccessPath::Scan : analysis.path,
+        .estimate = analysis.estimate,
+        .recheck = false,
+        .label = query.predicates[analysis.predicate].describe(),
+    };
+}
+
+/**
+ * The words a relevance ranking scores notes by: those of every title and content predicate, which are the ones
+ * `TermIndex` indexes.
+ */
+auto ranking_text(const SearchQuery& query) -> std::string {
+    auto text = std::string {};
+    for (const auto& predicate : query.predicates) {
+        if (predicate.field == NoteField::Title || predicate.field == NoteField::Content) {
+            text.append(predicate.text().text).push_back(' ');
+        }
+    }
+    return text;
+}
+
+/**
+ * Every predicate of `query`, one per line: what a ranking is cached by.
+ */
+auto describe_predicates(const SearchQuery& query) -> std::string {
+    auto text = std::string {};
+    for (const auto& predicate : query.predicates) {
+        text.append(predicate.describe()).push_back('\n');
+    }
+    return text;
+}
+
+auto filter_steps(QueryPlan& plan) -> std::vector<PlanStep*> {
+    auto filters = std::vector<PlanStep*> {};
+    for (auto& step : plan.steps) {
+        if (step.mode == StepMode::Filter) {
+            filters.push_back(&step);
+        }
+    }
+    return filters;
+}
+
+}  // namespace
+
+auto QueryPlanner::plan(const SearchQuery& query) const -> QueryPlan {
+    const auto started = Clock::now();
+    const auto lock = store_.read_lock();
+    auto plan = QueryPlan {};
+    plan.universe = store_.size();
+    plan.limit = query.limit;
+
+    auto indexed = std::vector<Analysis> {};
+    auto filters = std::vector<PlanStep> {};
+    for (std::size_t i = 0; i < query.predicates.size(); ++i) {
+        auto analysis = analyse(store_, query, i);
+        if (analysis.path == AccessPath::Scan) {
+            filters.push_back(make_step(query, analysis, StepMode::Filter));
+        } else {
+            indexed.push_back(analysis);
+        }
+    }
+    std::ranges::sort(indexed, [](const Analysis& lhs, const Analysis& rhs) {
+        return std::pair { lhs.estimate, lhs.index_cost } < std::pair { rhs.estimate, rhs.index_cost };
+    });
+
+    // Most selective index drives; the others are intersected only while building their bitmap is cheaper than
+    // testing the rows that are left, estimated assuming predicates are independent.
+    const auto universe = static_cast<double>(std::max<std::size_t>(plan.universe, 1));
+    auto rows = universe;
+    for (const auto& analysis : indexed) {
+        const auto field = query.predicates[analysis.predicate].field;
+        const auto drive = plan.steps.empty();
+        if (!drive && analysis.index_cost >= rows * filter_cost(field)) {
+            filters.push_back(make_step(query, analysis, StepMode::Filter));
+            continue;
+        }
+        plan.steps.push_back(make_step(query, analysis, drive ? StepMode::Drive : StepMode::Intersect));
+        const auto estimate = static_cast<double>(analysis.estimate);
+        rows = drive ? estimate : rows * estimate / universe;
+        if (analysis.recheck) {
+            auto recheck = make_step(query, analysis, StepMode::Filter);
+            recheck.recheck = true;
+            filters.push_back(std::move(recheck));
+        }
+    }
+
+    // Cheapest filter per rejected row first.
+    const auto rank = [&](const PlanStep& step) {
+        const auto selectivity = step.recheck ? RECHECK_SELECTIVITY : static_cast<double>(step.estimate) / universe;
+        return filter_cost(query.predicates[step.predicate].field) / std::max(1e-6, 1.0 - selectivity);
+    };
+    std::ranges::stable_sort(filters, [&](const PlanStep& lhs, const PlanStep& rhs) { return rank(lhs) < rank(rhs); });
+
+    plan.ranked = query.order == SearchOrder::Relevance && store_.terms() != nullptr
+               && !TermIndex::terms_of(ranking_text(query)).empty();
+    if (plan.steps.empty() && !filters.empty() && !plan.ranked) {
+        const auto configured = store_.options().scan_threads;
+        const auto threads = configured != 0 ? configured : std::max(1U, std::thread::hardware_concurrency());
+        const auto chunks = (static_cast<std::size_t>(store_.end_ordinal()) + SCAN_CHUNK - 1) / SCAN_CHUNK;
+        plan.parallel_scan = true;
+        plan.threads = std::clamp<std::size_t>(chunks, 1, threads);
+    }
+    std::ranges::move(filters, std::back_inserter(plan.steps));
+
+    plan.planning = Clock::now() - started;
+    return plan;
+}
+
+auto QueryPlanner::execute(const SearchQuery& query, QueryPlan plan) const -> SearchResult {
+    const auto started = Clock::now();
+    auto result = SearchResult {};
+    auto lock = store_.read_lock();
+    // Taken under the lock, the snapshot sees exactly the version the indexes describe.
+    result.snapshot = store_.snapshot();
+    const auto version = query.cursor ? query.cursor->version : result.snapshot.version();
+    const auto window = Window {
+        // Ranked pages resume by score, not ordinal.
+        .begin = query.cursor && !plan.ranked ? query.cursor->ordinal + 1 : 0,
+        .end = store_.ordinal_horizon(version),
+        // One extra match tells us whether another page exists.
+        .want = query.limit == 0 ? std::numeric_limits<std::size_t>::max() : query.limit + 1,
+    };
+
+    const auto candidates = lookup(query, plan);
+    auto ranking = std::optional<RankingStats> {};
+    if (plan.ranked) {
+        ranking = rank(query, plan, candidates, window, result);
+        lock.unlock();
+    } else {
+        lock.unlock();
+        if (plan.parallel_scan) {
+            scan(query, result.snapshot, plan, candidates, window, result.ordinals);
+        } else {
+            stream(query, result.snapshot, plan, candidates, window, result.ordinals);
+        }
+    }
+
+    if (result.ordinals.size() > query.limit && query.limit != 0) {
+        result.truncated = true;
+        result.ordinals.resize(query.limit);
+        const auto sort_key = plan.ranked ? std::bit_cast<std::int64_t>(result.scores[query.limit - 1]) : 0;
+        if (plan.ranked) {
+            result.scores.resize(query.limit);
+        }
+        result.next = Cursor {
+            .version = version,
+            .sort_key = sort_key,
+            .ordinal = result.ordinals.back(),
+            .ranking = std::move(ranking),
+        };
+    }
+    plan.returned = result.ordinals.size();
+    plan.execution = Clock::now() - started;
+    result.plan = std::move(plan);
+    return result;
+}
+
+auto QueryPlanner::matches(const SearchQuery& query, QueryPlan& plan) const -> Bitmap {
+    auto lock = store_.read_lock();
+    const auto snapshot = store_.snapshot();
+    auto matches = lookup(query, plan);
+    lock.unlock();
+
+    const auto steps = filter_steps(plan);
+    for (auto* step : steps) {
+        const auto started = Clock::now();
+        const auto& predicate = query.predicates[step->predicate];
+        step->rows_in = matches.count();
+        matches.retain([&](NoteOrdinal ordinal) {
+            const auto note = store_.peek(ordinal, snapshot);
+            return note && predicate.test(*note);
+        });
+        step->rows_out = matches.count();
+        step->elapsed = Clock::now() - started;
+    }
+    plan.returned = matches.count();
+    return matches;
+}
+
+auto QueryPlanner::lookup(const SearchQuery& query, QueryPlan& plan) const -> Bitmap {
+    auto candidates = std::optional<Bitmap> {};
+    for (auto& step : plan.steps) {
+        if (step.mode == StepMode::Filter) {
+            continue;
+        }
+        const auto step_started = Clock::now();
+        auto bitmap = index_lookup(query.predicates[step.predicate]);
+        if (step.mode == StepMode::Drive) {
+            candidates = std::move(bitmap);
+        } else {
+            step.rows_in = candidates->count();
+            *candidates &= bitmap;
+        }
+        step.rows_out = candidates->count();
+        step.elapsed = Clock::now() - step_started;
+    }
+    if (!candidates) {
+        return store_.live();
+    }
+    // Removed notes stay in the indexes until they are compacted away.
+    candidates->subtract(store_.tombstones());
+    return std::move(*candidates);
+}
+
+auto QueryPlanner::index_lookup(const Predicate& predicate) const -> Bitmap {
+    switch (predicate.field) {
+        case NoteField::Title: return store_.titles().candidates(predicate.text().text).value_or(store_.live());
+        case NoteField::Content: return store_.contents()->candidates(predicate.text().text).value_or(store_.live());
+        case NoteField::Tag: return store_.tags().lookup(predicate.text());
+        case NoteField::Created:
+        case NoteField::Updated: {
+            const auto& index = date_index(store_, predicate.field);
+            const auto& date = predicate.date();
+            switch (date.kind) {
+                case DateMatchKind::Before: return index.before(date.start).to_bitmap();
+                case DateMatchKind::After: return index.after(date.start).to_bitmap();
+                case DateMatchKind::InRange: return index.between(date.start, date.end).to_bitmap();
+                case DateMatchKind::NotInRange: {
+                    auto [low, high] = index.not_between(date.start, date.end);
+                    auto bitmap = low.to_bitmap();
+                    high.collect(bitmap);
+                    return bitmap;
+                }
+            }
+        }
+    }
+    return store_.live();
+}
+
+void QueryPlanner::filter(
+  const SearchQuery& query,
+  const Snapshot& snapshot,
+  std::span<const PlanStep* const> filters,
+  std::vector<NoteOrdinal>& batch,
+  std::span<StepStats> stats) const {
+    for (std::size_t i = 0; i < filters.size() && !batch.empty(); ++i) {
+        const auto started = Clock::now();
+        const auto& predicate = query.predicates[filters[i]->predicate];
+        stats[i].rows_in += batch.size();
+        std::erase_if(batch, [&](NoteOrdinal ordinal) {
+            const auto note = store_.peek(ordinal, snapshot);
+            return !note || !predicate.test(*note);
+        });
+        stats[i].rows_out += batch.size();
+        stats[i].elapsed += Clock::now() - started;
+    }
+}
+
+auto QueryPlanner::rank(
+  const SearchQuery& query,
+  QueryPlan& plan,
+  const Bitmap& candidates,
+  Window window,
+  SearchResult& result) const -> RankingStats {
+    const auto& index = *store_.terms();
+    const auto terms = TermIndex::terms_of(ranking_text(query));
+    const auto steps = filter_steps(plan);
+    const auto filters = std::vector<const PlanStep*> { steps.begin(), steps.end() };
+    auto stats = std::vector<StepStats>(filters.size());
+
+    auto batch = std::vector<NoteOrdinal> {};
+    const auto matches = [&](NoteOrdinal ordinal) {
+        if (ordinal >= window.end || !candidates.test(ordinal)) {
+            return false;
+        }
+        batch.assign(1, ordinal);
+        filter(query, result.snapshot, filters, batch, stats);
+        return !batch.empty();
+    };
+    // Later pages score against what the first one did, so that every note keeps its place in the ranking.
+    const auto& cursor = query.cursor;
+    auto ranking_stats = cursor && cursor->ranking ? *cursor->ranking : index.stats(terms);
+    // Scores are positive and finite, so their bits order the same way they do.
+    const auto last = cursor ? std::bit_cast<double>(cursor->sort_key) : 0.0;
+    const auto after_cursor = [&](const ScoredNote& note) {
+        return !cursor || (note.score != last ? note.score < last : note.ordinal > cursor->ordinal);
+    };
+    const auto zero_tier = cursor && last == 0.0;
+
+    if (!zero_tier) {
+        // The ranking is cached by how deep it goes, and made twice as deep whenever a page runs past its end, so
+        // paging through it scores each note a handful of times at most rather than once per page before it.
+        auto& cache = store_.rankings();
+        const auto key = describe_predicates(query);
+        const auto version = cursor ? cursor->version : result.snapshot.version();
+        auto entry = cursor ? cache.find(key, version) : nullptr;
+        auto depth = std::size_t { 0 };
+        while (true) {
+            if (entry) {
+                // Notes removed or edited since the ranking was cached may no longer match, so each is tested again.
+                const auto& notes = entry->notes;
+                const auto from = std::ranges::partition_point(notes, std::not_fn(after_cursor));
+                auto page = std::vector<const ScoredNote*> {};
+                for (auto it = from; it != notes.end() && page.size() < window.want; ++it) {
+                    if (matches(it->ordinal)) {
+                        page.push_back(&*it);
+                    }
+                }
+                if (page.size() == window.want || entry->complete) {
+                    for (const auto* note : page) {
+                        result.ordinals.push_back(note->ordinal);
+                        result.scores.push_back(note->score);
+                    }
+                    break;
+                }
+                depth = notes.size();
+            }
+            const auto k = std::max(window.want, depth * 2);
+            auto top = index.top(terms, k, store_.options().ranking, ranking_stats, [&](const ScoredNote& note) {
+                return matches(note.ordinal);
+            });
+            plan.scored += top.scored;
+            const auto complete = top.notes.size() < k;
+            entry = std::make_shared<const RankingCache::Ranking>(
+              RankingCache::Ranking { std::move(top.notes), complete });
+            cache.insert(key, version, entry);
+        }
+    }
+
+    // Matches that use none of the words score zero, and tie, so they follow in ordinal order.
+    auto next = candidates.next(zero_tier ? cursor->ordinal + 1 : 0);
+    for (; next < window.end && result.ordinals.size() < window.want; next = candidates.next(next + 1)) {
+        if (!index.contains_any(next, terms) && matches(next)) {
+            result.ordinals.push_back(next);
+            result.scores.push_back(0.0);
+        }
+    }
+    plan.stopped_early = next < window.end;
+
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        steps[i]->rows_in = stats[i].rows_in;
+        steps[i]->rows_out = stats[i].rows_out;
+        steps[i]->elapsed = stats[i].elapsed;
+    }
+    return ranking_stats;
+}
+
+void QueryPlanner::stream(
+  const SearchQuery& query,
+  const Snapshot& snapshot,
+  QueryPlan& plan,
+  const Bitmap& candidates,
+  Window window,
+  std::vector<NoteOrdinal>& out) const {
+    const auto steps = filter_steps(plan);
+    const auto filters = std::vector<const PlanStep*> { steps.begin(), steps.end() };
+    auto stats = std::vector<StepStats>(filters.size());
+
+    auto batch = std::vector<NoteOrdinal> {};
+    batch.reserve(BATCH_SIZE);
+    auto next = candidates.next(window.begin);
+    while (next < window.end && out.size() < window.want) {
+        batch.clear();
+        for (; next < window.end && batch.size() < BATCH_SIZE; next = candidates.next(next + 1)) {
+            batch.push_back(next);
+        }
+        filter(query, snapshot, filters, batch, stats);
+        const auto take = std::min(batch.size(), window.want - out.size());
+        out.insert(out.end(), batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(take));
+    }
+    plan.stopped_early = next < window.end;
+
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        steps[i]->rows_in = stats[i].rows_in;
+        steps[i]->rows_out = stats[i].rows_out;
+        steps[i]->elapsed = stats[i].elapsed;
+    }
+}
+
+void QueryPlanner::scan(
+  const SearchQuery& query,
+  const Snapshot& snapshot,
+  QueryPlan& plan,
+  const Bitmap& candidates,
+  Window window,
+  std::vector<NoteOrdinal>& out) const {
+    const auto steps = filter_steps(plan);
+    const auto filters = std::vector<const PlanStep*> { steps.begin(), steps.end() };
+    const auto first_chunk = static_cast<std::size_t>(window.begin) / SCAN_CHUNK;
+    const auto end = static_cast<std::size_t>(window.end);
+    const auto chunks = window.begin < window.end ? (end + SCAN_CHUNK - 1) / SCAN_CHUNK - first_chunk : 0;
+
+    // Chunks are claimed in ascending order. Once the completed prefix of chunks holds a full page, no more are
+    // claimed: later matches could never make it onto the page.
+    auto results = std::vector<std::vector<NoteOrdinal>>(chunks);
+    auto done = std::vector<bool>(chunks, false);
+    auto totals = std::vector<StepStats>(filters.size());
+    auto mutex = std::mutex {};
+    auto prefix = std::size_t { 0 };
+    auto prefix_rows = std::size_t { 0 };
+    auto stop = std::atomic<bool> { false };
+    auto next_chunk = std::atomic<std::size_t> { 0 };
+
+    const auto worker = [&] {
+        auto stats = std::vector<StepStats>(filters.size());
+        while (!stop.load(std::memory_order_relaxed)) {
+            const auto chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks) {
+                break;
+            }
+            auto& batch = results[chunk];
+            const auto first = std::max<std::size_t>(window.begin, (first_chunk + chunk) * SCAN_CHUNK);
+            const auto last = static_cast<NoteOrdinal>(std::min(end, (first_chunk + chunk + 1) * SCAN_CHUNK));
+            for (auto ordinal = candidates.next(static_cast<NoteOrdinal>(first)); ordinal < last;
+                 ordinal = candidates.next(ordinal + 1)) {
+                batch.push_back(ordinal);
+            }
+            filter(query, snapshot, filters, batch, stats);
+
+            auto lock = std::scoped_lock { mutex };
+            done[chunk] = true;
+            while (prefix < chunks && done[prefix]) {
+                prefix_rows += results[prefix].size();
+                ++prefix;
+            }
+            if (prefix_rows >= window.want) {
+                stop.store(true, std::memory_order_relaxed);
+            }
+        }
+        auto lock = std::scoped_lock { mutex };
+        for (std::size_t i = 0; i < stats.size(); ++i) {
+            totals[i].rows_in += stats[i].rows_in;
+            totals[i].rows_out += stats[i].rows_out;
+            totals[i].elapsed += stats[i].elapsed;
+        }
+    };
+
+    if (plan.threads <= 1) {
+        worker();
+    } else {
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(plan.threads);
+        for (std::size_t i = 0; i < plan.threads; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    for (std::size_t chunk = 0; chunk < prefix && out.size() < window.want; ++chunk) {
+        const auto take = std::min(results[chunk].size(), window.want - out.size());
+        out.insert(out.end(), results[chunk].begin(), results[chunk].begin() + static_cast<std::ptrdiff_t>(take));
+    }
+    plan.stopped_early = prefix < chunks;
+
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        steps[i]->rows_in = totals[i].rows_in;
+        steps[i]->rows_out = totals[i].rows_out;
+        steps[i]->elapsed = totals[i].elapsed;
+    }
+}
+
+}  // namespace pg::store
@@ -0,0 +1,30 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <pg/store/RankingCache.hpp>
+
+namespace pg::store {
+
+RankingCache::RankingCache(std::size_t capacity): cache_ { std::max<std::size_t>(capacity, 1) } { }
+
+auto RankingCache::find(std::string_view query, CommitVersion version) -> Entry {
+    return cache_.find(key_of(query, version)).value_or(nullptr);
+}
+
+void RankingCache::insert(std::string_view query, CommitVersion version, Entry ranking) {
+    cache_.assign(key_of(query, version), std::move(ranking));
+}
+
+auto RankingCache::key_of(std::string_view query, CommitVersion version) -> std::string {
+    return fmt::format("{}@{}", version, query);
+}
+
+}  // namespace pg::store
@@ -0,0 +1,137 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <pg/store/Messages.hpp>
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/ResponseCache.hpp>
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace pg::store {
+
+ResponseCache::ResponseCache(std::size_t capacity, std::size_t shards) {
+    shards = std::max<std::size_t>(shards, 1);
+    shard_capacity_ = capacity / shards;
+    shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+auto ResponseCache::find(NoteId id, CommitVersion version) -> Buffer {
+    auto& shard = shard_of(id);
+    auto lock = std::scoped_lock { shard.mutex };
+    const auto it = shard.slots_of.find(id);
+    if (it == shard.slots_of.end() || shard.slots[it->second].version != version) {
+        ++shard.misses;
+        return nullptr;
+    }
+    auto& slot = shard.slots[it->second];
+    slot.referenced = true;
+    ++shard.hits;
+    return slot.response;
+}
+
+void ResponseCache::insert(NoteId id, CommitVersion version, Buffer response) {
+    const auto size = response->size();
+    if (size > shard_capacity_) {
+        return;
+    }
+    auto& shard = shard_of(id);
+    auto lock = std::scoped_lock { shard.mutex };
+    if (const auto it = shard.slots_of.find(id); it != shard.slots_of.end()) {
+        // Another thread may have encoded the same version, or an older one, concurrently; the newest state wins.
+        auto& slot = shard.slots[it->second];
+        if (slot.version > version) {
+            return;
+        }
+        shard.bytes -= slot.response->size();
+        remove(shard, it->second);
+    }
+    while (!shard.slots.empty() && shard.bytes + size > shard_capacity_) {
+        shard.hand %= shard.slots.size();
+        auto& slot = shard.slots[shard.hand];
+        if (slot.referenced) {
+            slot.referenced = false;
+            ++shard.hand;
+            continue;
+        }
+        shard.bytes -= slot.response->size();
+        // The last slot moves under the hand, and is looked at next.
+        remove(shard, shard.hand);
+    }
+    shard.bytes += size;
+    shard.slots_of.emplace(id, shard.slots.size());
+    shard.slots.push_back(Slot { id, version, std::move(response), false });
+}
+
+void ResponseCache::erase(NoteId id) {
+    auto& shard = shard_of(id);
+    auto lock = std::scoped_lock { shard.mutex };
+    if (const auto it = shard.slots_of.find(id); it != shard.slots_of.end()) {
+        shard.bytes -= shard.slots[it->second].response->size();
+        remove(shard, it->second);
+    }
+}
+
+auto ResponseCache::stats() const -> Stats {
+    auto stats = Stats {};
+    for (const auto& shard : shards_) {
+        auto lock = std::scoped_lock { shard->mutex };
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.bytes += shard->bytes;
+        stats.entries += shard->slots.size();
+    }
+    return stats;
+}
+
+auto ResponseCache::shard_of(const NoteId& id) -> Shard& {
+    // The high bits, since each shard's map buckets by the low ones.
+    return *shards_[(NoteIdHash {}(id) >> 32) % shards_.size()];
+}
+
+void ResponseCache::remove(Shard& shard, std::size_t slot) {
+    shard.slots_of.erase(shard.slots[slot].id);
+    if (slot + 1 != shard.slots.size()) {
+        shard.slots[slot] = std::move(shard.slots.back());
+        shard.slots_of[shard.slots[slot].id] = slot;
+    }
+    shard.slots.pop_back();
+}
+
+auto serve_get_note(const NoteStore& store, ResponseCache& cache, std::span<const std::uint8_t> request)
+  -> ResponseCache::Buffer {
+    const auto encode_error = [](const StoreError& error) {
+        return std::make_shared<const std::vector<std::uint8_t>>(messages::encode_get_response(error));
+    };
+    const auto id = messages::decode_get_request(request);
+    if (!id) {
+        return encode_error(id.error());
+    }
+    const auto ordinal = store.ordinal_of(*id);
+    const auto snapshot = store.snapshot();
+    const auto revision = ordinal != INVALID_ORDINAL ? store.revision(ordinal, snapshot) : std::nullopt;
+    if (!revision) {
+        cache.erase(*id);
+        return encode_error(
+          StoreError { ErrorCode::NotFound, fmt::format("note {} not found", boost::uuids::to_string(*id)) });
+    }
+    if (auto cached = cache.find(*id, *revision)) {
+        return cached;
+    }
+    const auto note = store.at(ordinal, snapshot);
+    auto response = std::make_shared<const std::vector<std::uint8_t>>(messages::encode_get_response(*note));
+    cache.insert(*id, *revision, response);
+    return response;
+}
+
+}  // namespace pg::store
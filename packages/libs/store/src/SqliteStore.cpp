@@ -0,0 +1,508 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/IdGenerator.hpp>
+#include <pg/store/SqliteStore.hpp>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <parallel_hashmap/phmap.h>
+#include <sqlite_orm/sqlite_orm.h>
+
+namespace pg::store {
+namespace {
+
+using namespace sqlite_orm;
+
+/// Rows `SqliteStore::search` reads per statement, and tags it loads per query.
+constexpr int SEARCH_BATCH = 256;
+
+struct NoteRow {
+    std::string id;
+    std::string title;
+    std::string content;
+    std::int64_t created = 0;
+    std::int64_t updated = 0;
+};
+
+struct TagRow {
+    std::string note_id;
+    std::int64_t position = 0;
+    std::string tag;
+};
+
+auto make_schema(const std::string& path) {
+    return make_storage(
+      path,
+      make_index("notes_created_id", &NoteRow::created, &NoteRow::id),
+      make_index("notes_updated_id", &NoteRow::updated, &NoteRow::id),
+      make_index("note_tags_tag", &TagRow::tag),
+      make_table(
+        "notes",
+        make_column("id", &NoteRow::id, primary_key()),
+        make_column("title", &NoteRow::title),
+        make_column("content", &NoteRow::content),
+        make_column("created", &NoteRow::created),
+        make_column("updated", &NoteRow::updated)),
+      make_table(
+        "note_tags",
+        make_column("note_id", &TagRow::note_id),
+        make_column("position", &TagRow::position),
+        make_column("tag", &TagRow::tag),
+        primary_key(&TagRow::note_id, &TagRow::position)));
+}
+
+using Storage = decltype(make_schema({}));
+
+// Every statement the store runs, with placeholder arguments rebound on each use through `sqlite_orm::get<N>`.
+
+auto prepare_select_note(Storage& storage) {
+    return storage.prepare(get_all<NoteRow>(where(c(&NoteRow::id) == std::string {})));
+}
+
+auto prepare_select_tags(Storage& storage) {
+    return storage.prepare(get_all<TagRow>(where(c(&TagRow::note_id) == std::string {}), order_by(&TagRow::position)));
+}
+
+auto prepare_put_note(Storage& storage) {
+    return storage.prepare(replace(NoteRow {}));
+}
+
+auto prepare_put_tag(Storage& storage) {
+    return storage.prepare(replace(TagRow {}));
+}
+
+auto prepare_remove_note(Storage& storage) {
+    return storage.prepare(remove<NoteRow>(std::string {}));
+}
+
+auto prepare_remove_tags(Storage& storage) {
+    return storage.prepare(remove_all<TagRow>(where(c(&TagRow::note_id) == std::string {})));
+}
+
+// The search statements read one batch of rows past a `(date, id)` key at a time, in the order of the index on those
+// two columns, so SQLite both seeks to the key and returns the rows without sorting them. The last two placeholders
+// before the limit are that key's date and its id. Every statement pages along `created` but `select_by_updated`, whose
+// range is over `updated`.
+
+auto past_key(std::int64_t NoteRow::*date) {
+    return greater_than(std::make_tuple(date, &NoteRow::id), std::make_tuple(std::int64_t {}, std::string {}));
+}
+
+auto key_order(std::int64_t NoteRow::*date) {
+    return multi_order_by(order_by(date), order_by(&NoteRow::id));
+}
+
+auto prepare_select_by_tag(Storage& storage) {
+    return storage.prepare(get_all<NoteRow>(
+      where(
+        in(&NoteRow::id, select(&TagRow::note_id, where(c(&TagRow::tag) == std::string {})))
+        and past_key(&NoteRow::created)),
+      key_order(&NoteRow::created),
+      limit(SEARCH_BATCH)));
+}
+
+auto prepare_select_by_created(Storage& storage) {
+    return storage.prepare(get_all<NoteRow>(
+      where(
+        c(&NoteRow::created) >= std::int64_t {} and c(&NoteRow::created) <= std::int64_t {}
+        and past_key(&NoteRow::created)),
+      key_order(&NoteRow::created),
+      limit(SEARCH_BATCH)));
+}
+
+auto prepare_select_by_updated(Storage& storage) {
+    return storage.prepare(get_all<NoteRow>(
+      where(
+        c(&NoteRow::updated) >= std::int64_t {} and c(&NoteRow::updated) <= std::int64_t {}
+        and past_key(&NoteRow::updated)),
+      key_order(&NoteRow::updated),
+      limit(SEARCH_BATCH)));
+}
+
+auto prepare_select_all(Storage& storage) {
+    return storage.prepare(get_all<NoteRow>(
+      where(past_key(&NoteRow::created)), key_order(&NoteRow::created), limit(SEARCH_BATCH)));
+}
+
+template <typename Prepare>
+using Statement = std::optional<decltype(std::declval<Prepare>()(std::declval<Storage&>()))>;
+
+auto nanoseconds(Timestamp timestamp) noexcept -> std::int64_t {
+    return timestamp.time_since_epoch().count();
+}
+
+auto to_timestamp(std::int64_t nanoseconds) noexcept -> Timestamp {
+    return Timestamp { Timestamp::duration { nanoseconds } };
+}
+
+/**
+ * @brief Run `fn`, turning whatever `sqlite_orm` throws into `ErrorCode::Internal`, and a row whose id does not parse
+ * into `ErrorCode::DataLoss`.
+ */
+template <typename Fn>
+auto guarded(Fn&& fn) -> decltype(fn()) {
+    try {
+        return fn();
+    } catch (const std::system_error& error) {
+        return fail(ErrorCode::Internal, fmt::format("sqlite: {}", error.what()));
+    } catch (const std::runtime_error& error) {
+        return fail(ErrorCode::DataLoss, fmt::format("sqlite: {}", error.what()));
+    }
+}
+
+/**
+ * @brief The inclusive `[min, max]` range of nanoseconds a date predicate can hold for, if it is one range.
+ */
+auto date_range(const DatePredicate& date) -> std::optional<std::pair<std::int64_t, std::int64_t>> {
+    constexpr auto min = std::numeric_limits<std::int64_t>::min();
+    constexpr auto max = std::numeric_limits<std::int64_t>::max();
+    const auto start = nanoseconds(date.start);
+    switch (date.kind) {
+        case DateMatchKind::Before: return start == min ? std::pair { max, min } : std::pair { min, start - 1 };
+        case DateMatchKind::After: return start == max ? std::pair { max, min } : std::pair { start + 1, max };
+        case DateMatchKind::InRange: return std::pair { start, nanoseconds(date.end) };
+        case DateMatchKind::NotInRange: return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+/**
+ * @brief The connection and its prepared statements, kept out of the header along with `sqlite_orm`.
+ */
+struct SqliteStore::Database {
+    explicit Database(const std::filesystem::path& path): storage { make_schema(path.string()) } {
+        // Prepared statements need the connection to stay open between calls.
+        storage.open_forever();
+        storage.sync_schema();
+        select_note.emplace(prepare_select_note(storage));
+        select_tags.emplace(prepare_select_tags(storage));
+        put_note.emplace(prepare_put_note(storage));
+        put_tag.emplace(prepare_put_tag(storage));
+        remove_note.emplace(prepare_remove_note(storage));
+        remove_tags.emplace(prepare_remove_tags(storage));
+        select_by_tag.emplace(prepare_select_by_tag(storage));
+        select_by_created.emplace(prepare_select_by_created(storage));
+        select_by_updated.emplace(prepare_select_by_updated(storage));
+        select_all.emplace(prepare_select_all(storage));
+    }
+
+    auto find(const std::string& id) -> std::optional<NoteRow> {
+        sqlite_orm::get<0>(*select_note) = id;
+        auto rows = storage.execute(*select_note);
+        return rows.empty() ? std::nullopt : std::optional { std::move(rows.front()) };
+    }
+
+    auto tags_of(const std::string& id) -> std::vector<std::string> {
+        sqlite_orm::get<0>(*select_tags) = id;
+        auto tags = std::vector<std::string> {};
+        for (auto& row : storage.execute(*select_tags)) {
+            tags.push_back(std::move(row.tag));
+        }
+        return tags;
+    }
+
+    /**
+     * @brief The tags of each of `rows`, in order, loaded in one query. Not prepared, since the number of ids varies.
+     */
+    auto tags_of(const std::vector<NoteRow>& rows) -> std::vector<std::vector<std::string>> {
+        auto tags = std::vector<std::vector<std::string>>(rows.size());
+        if (rows.empty()) {
+            return tags;
+        }
+        auto ids = std::vector<std::string> {};
+        auto slots = phmap::flat_hash_map<std::string_view, std::size_t> {};
+        ids.reserve(rows.size());
+        slots.reserve(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            ids.push_back(rows[i].id);
+            slots.emplace(rows[i].id, i);
+        }
+        auto found = storage.get_all<TagRow>(
+          where(in(&TagRow::note_id, ids)), multi_order_by(order_by(&TagRow::note_id), order_by(&TagRow::position)));
+        for (auto& row : found) {
+            tags[slots.at(std::string_view { row.note_id })].push_back(std::move(row.tag));
+        }
+        return tags;
+    }
+
+    /**
+     * @brief Read the rows of a search statement past `key` and update `key` to the last of them.
+     * @tparam First The index of the statement's first key placeholder
+     * @param date The column the statement pages along
+     */
+    template <std::size_t First, typename Statement>
+    auto next_batch(Statement& statement, std::int64_t NoteRow::*date, std::pair<std::int64_t, std::string>& key)
+      -> std::vector<NoteRow> {
+        sqlite_orm::get<First>(statement) = key.first;
+        sqlite_orm::get<First + 1>(statement) = key.second;
+        auto rows = storage.execute(statement);
+        if (!rows.empty()) {
+            key = { rows.back().*date, rows.back().id };
+        }
+        return rows;
+    }
+
+    void put(const NoteRow& note) {
+        sqlite_orm::get<0>(*put_note) = note;
+        storage.execute(*put_note);
+    }
+
+    void put_tags(const std::string& id, const std::vector<std::string>& tags) {
+        sqlite_orm::get<0>(*remove_tags) = id;
+        storage.execute(*remove_tags);
+        for (std::size_t i = 0; i < tags.size(); ++i) {
+            sqlite_orm::get<0>(*put_tag) = TagRow { id, static_cast<std::int64_t>(i), tags[i] };
+            storage.execute(*put_tag);
+        }
+    }
+
+    auto record_of(NoteRow row) -> NoteRecord {
+        auto tags = tags_of(row.id);
+        return record_of(std::move(row), std::move(tags));
+    }
+
+    static auto record_of(NoteRow row, std::vector<std::string> tags) -> NoteRecord {
+        auto parse_id = boost::uuids::string_generator {};
+        return NoteRecord {
+            .id = parse_id(row.id),
+            .title = std::move(row.title),
+            .content = std::move(row.content),
+            .tags = std::move(tags),
+            .created = to_timestamp(row.created),
+            .updated = to_timestamp(row.updated),
+        };
+    }
+
+    /**
+     * @brief Run `fn` in a transaction, committed if it succeeds and rolled back otherwise.
+     */
+    template <typename Fn>
+    auto transaction(Fn&& fn) -> decltype(fn()) {
+        storage.begin_transaction();
+        try {
+            auto result = fn();
+            if (result) {
+                storage.commit();
+            } else {
+                storage.rollback();
+            }
+            return result;
+        } catch (...) {
+            storage.rollback();
+            throw;
+        }
+    }
+
+    Storage storage;
+    Statement<decltype(&prepare_select_note)> select_note;
+    Statement<decltype(&prepare_select_tags)> select_tags;
+    Statement<decltype(&prepare_put_note)> put_note;
+    Statement<decltype(&prepare_put_tag)> put_tag;
+    Statement<decltype(&prepare_remove_note)> remove_note;
+    Statement<decltype(&prepare_remove_tags)> remove_tags;
+    Statement<decltype(&prepare_select_by_tag)> select_by_tag;
+    Statement<decltype(&prepare_select_by_created)> select_by_created;
+    Statement<decltype(&prepare_select_by_updated)> select_by_updated;
+    Statement<decltype(&prepare_select_all)> select_all;
+};
+
+auto SqliteStore::open(const std::filesystem::path& path, SqliteOptions options)
+  -> Result<std::unique_ptr<SqliteStore>> {
+    return guarded([&]() -> Result<std::unique_ptr<SqliteStore>> {
+        auto database = std::make_unique<Database>(path);
+        database->storage.pragma.journal_mode(journal_mode::WAL);
+        // 2 is FULL, 1 is NORMAL: with the WAL journal, NORMAL only syncs at checkpoints.
+        database->storage.pragma.synchronous(options.sync ? 2 : 1);
+        return std::unique_ptr<SqliteStore> { new SqliteStore { std::move(database), std::move(options) } };
+    });
+}
+
+SqliteStore::SqliteStore(std::unique_ptr<Database> database, SqliteOptions options)
+    : options_ { std::move(options) }, database_ { std::move(database) } { }
+
+SqliteStore::~SqliteStore() = default;
+
+auto SqliteStore::create(std::span<const data::CreateNote> notes) -> Result<std::vector<NoteId>> {
+    auto lock = std::scoped_lock { mutex_ };
+    auto& db = *database_;
+    return guarded([&] {
+        return db.transaction([&]() -> Result<std::vector<NoteId>> {
+            const auto timestamp = nanoseconds(now());
+            auto ids = std::vector<NoteId> {};
+            ids.reserve(notes.size());
+            for (const auto& note : notes) {
+                // Time-ordered, so new rows land at the end of the primary key index.
+                const auto id = generate_note_id();
+                const auto key = boost::uuids::to_string(id);
+                db.put(NoteRow {
+                  key,
+                  note.title.value_or(std::string {}),
+                  note.content.value_or(std::string {}),
+                  timestamp,
+                  timestamp,
+                });
+                if (note.tags && !note.tags->empty()) {
+                    db.put_tags(key, *note.tags);
+                }
+                ids.push_back(id);
+            }
+            return ids;
+        });
+    });
+}
+
+auto SqliteStore::update(std::span<const data::UpdateNote> updates) -> Result<void> {
+    auto lock = std::scoped_lock { mutex_ };
+    auto& db = *database_;
+    return guarded([&] {
+        return db.transaction([&]() -> Result<void> {
+            const auto timestamp = nanoseconds(now());
+            for (const auto& update : updates) {
+                const auto key = boost::uuids::to_string(update.id());
+                auto row = db.find(key);
+                if (!row) {
+                    return fail(ErrorCode::NotFound, fmt::format("note {} not found", key));
+                }
+                if (auto title = update.title()) {
+                    row->title = std::move(*title);
+                }
+                if (auto content = update.content()) {
+                    row->content = std::move(*content);
+                }
+                row->updated = timestamp;
+                db.put(*row);
+                if (auto tags = update.tags()) {
+                    db.put_tags(key, *tags);
+                }
+            }
+            return {};
+        });
+    });
+}
+
+auto SqliteStore::remove(std::span<const NoteId> ids) -> Result<void> {
+    auto lock = std::scoped_lock { mutex_ };
+    auto& db = *database_;
+    return guarded([&] {
+        return db.transaction([&]() -> Result<void> {
+            for (const auto& id : ids) {
+                const auto key = boost::uuids::to_string(id);
+                sqlite_orm::get<0>(*db.remove_note) = key;
+                db.storage.execute(*db.remove_note);
+                if (db.storage.changes() == 0) {
+                    return fail(ErrorCode::NotFound, fmt::format("note {} not found", key));
+                }
+                sqlite_orm::get<0>(*db.remove_tags) = key;
+                db.storage.execute(*db.remove_tags);
+            }
+            return {};
+        });
+    });
+}
+
+auto SqliteStore::get(NoteId id) const -> Result<std::optional<NoteRecord>> {
+    auto lock = std::scoped_lock { mutex_ };
+    auto& db = *database_;
+    return guarded([&]() -> Result<std::optional<NoteRecord>> {
+        auto row = db.find(boost::uuids::to_string(id));
+        if (!row) {
+            return std::nullopt;
+        }
+        return db.record_of(std::move(*row));
+    });
+}
+
+auto SqliteStore::search(const SearchQuery& query) const -> Result<std::vector<NoteRecord>> {
+    if (query.cursor) {
+        return fail(ErrorCode::InvalidArgument, "the SQLite store does not page through search results");
+    }
+    auto lock = std::scoped_lock { mutex_ };
+    auto& db = *database_;
+    return guarded([&]() -> Result<std::vector<NoteRecord>> {
+        // Reads the candidates a batch at a time, so a search stops reading once its page is full.
+        const auto scan = [&]<std::size_t First>(
+                            auto& statement, std::integral_constant<std::size_t, First>, std::int64_t NoteRow::*date) {
+            auto notes = std::vector<NoteRecord> {};
+            // Every row sorts after this: no note has an empty id.
+            auto key = std::pair { std::numeric_limits<std::int64_t>::min(), std::string {} };
+            while (true) {
+                auto rows = db.next_batch<First>(statement, date, key);
+                auto tags = db.tags_of(rows);
+                for (std::size_t i = 0; i < rows.size(); ++i) {
+                    auto note = Database::record_of(std::move(rows[i]), std::move(tags[i]));
+                    const auto view = note.view();
+                    const auto matches = [&](const Predicate& predicate) { return predicate.test(view); };
+                    if (std::ranges::all_of(query.predicates, matches)) {
+                        notes.push_back(std::move(note));
+                        if (query.limit != 0 && notes.size() == query.limit) {
+                            return notes;
+                        }
+                    }
+                }
+                if (rows.size() < static_cast<std::size_t>(SEARCH_BATCH)) {
+                    return notes;
+                }
+            }
+        };
+
+        for (const auto& predicate : query.predicates) {
+            if (predicate.field == NoteField::Tag) {
+                const auto& text = predicate.text();
+                if (text.kind == TextMatchKind::Matches && text.case_sensitive) {
+                    sqlite_orm::get<0>(*db.select_by_tag) = text.text;
+                    return scan(*db.select_by_tag, std::integral_constant<std::size_t, 1> {}, &NoteRow::created);
+                }
+            } else if (predicate.field == NoteField::Created || predicate.field == NoteField::Updated) {
+                const auto range = date_range(predicate.date());
+                if (!range) {
+                    continue;
+                }
+                if (predicate.field == NoteField::Created) {
+                    sqlite_orm::get<0>(*db.select_by_created) = range->first;
+                    sqlite_orm::get<1>(*db.select_by_created) = range->second;
+                    return scan(*db.select_by_created, std::integral_constant<std::size_t, 2> {}, &NoteRow::created);
+                }
+                sqlite_orm::get<0>(*db.select_by_updated) = range->first;
+                sqlite_orm::get<1>(*db.select_by_updated) = range->second;
+                return scan(*db.select_by_updated, std::integral_constant<std::size_t, 2> {}, &NoteRow::updated);
+            }
+        }
+        return scan(*db.select_all, std::integral_constant<std::size_t, 0> {}, &NoteRow::created);
+    });
+}
+
+auto SqliteStore::size() const -> Result<std::size_t> {
+    auto lock = std::scoped_lock { mutex_ };
+    return guarded([&]() -> Result<std::size_t> {
+        return static_cast<std::size_t>(database_->storage.count<NoteRow>());
+    });
+}
+
+auto SqliteStore::now() const -> Timestamp {
+    if (options_.clock) {
+        return options_.clock();
+    }
+    return system_now();
+}
+
+}  // namespace pg::store
@@ -0,0 +1,224 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <pg/store/TagIndex.hpp>
+
+namespace pg::store {
+
+void TagIndex::Builder::add(NoteOrdinal ordinal, const TagList& tags) {
+    for (const auto tag : tags) {
+        auto it = tags_.find(tag);
+        if (it == tags_.end()) {
+            it = tags_.try_emplace(std::string { tag }).first;
+        }
+        // A note may list the same tag twice.
+        if (it->second.empty() || it->second.back() != ordinal) {
+            it->second.push_back(ordinal);
+        }
+    }
+}
+
+auto TagIndex::build(std::span<Builder> parts) -> TagIndex {
+    auto gathered = phmap::flat_hash_map<std::string, std::vector<NoteOrdinal>> {};
+    for (auto& part : parts) {
+        for (auto& [tag, ordinals] : part.tags_) {
+            auto [it, added] = gathered.try_emplace(tag);
+            if (added) {
+                it->second = std::move(ordinals);
+            } else {
+                it->second.insert(it->second.end(), ordinals.begin(), ordinals.end());
+            }
+        }
+        part.tags_ = {};
+    }
+
+    auto index = TagIndex {};
+    index.tags_.reserve(gathered.size());
+    for (auto& [tag, ordinals] : gathered) {
+        std::ranges::sort(ordinals);
+        ordinals.erase(std::unique(ordinals.begin(), ordinals.end()), ordinals.end());
+        index.tags_.try_emplace(tag, Posting { Bitmap::from_ordinals(ordinals), ordinals.size() });
+    }
+    return index;
+}
+
+void TagIndex::add(NoteOrdinal ordinal, const TagList& tags) {
+    for (const auto tag : tags) {
+        auto it = tags_.find(tag);
+        if (it == tags_.end()) {
+            it = tags_.try_emplace(std::string { tag }).first;
+        }
+        auto& posting = it->second;
+        if (!posting.notes.test(ordinal)) {
+            posting.notes.set(ordinal);
+            ++posting.count;
+        }
+    }
+}
+
+void TagIndex::remove(NoteOrdinal ordinal, const TagList& tags) {
+    for (const auto tag : tags) {
+        auto it = tags_.find(tag);
+        if (it == tags_.end() || !it->second.notes.test(ordinal)) {
+            continue;
+        }
+        it->second.notes.reset(ordinal);
+        if (--it->second.count == 0) {
+            tags_.erase(it);
+        }
+    }
+}
+
+void TagIndex::update(NoteOrdinal ordinal, const TagList& before, const TagList& after) {
+    remove(ordinal, before);
+    add(ordinal, after);
+}
+
+void TagIndex::purge(const Bitmap& dead) {
+    for (auto it = tags_.begin(); it != tags_.end();) {
+        auto& posting = it->second;
+        posting.count -= posting.notes.intersect_count(dead);
+        posting.notes.subtract(dead);
+        if (posting.count == 0) {
+            tags_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+auto TagIndex::lookup(const TextPredicate& predicate) const -> Bitmap {
+    if (predicate.kind == TextMatchKind::Matches && predicate.case_sensitive) {
+        const auto* notes = notes_with(predicate.text);
+        return notes != nullptr ? *notes : Bitmap {};
+    }
+    auto result = Bitmap {};
+    for (const auto& [tag, posting] : tags_) {
+        if (predicate.test(tag)) {
+            result |= posting.notes;
+        }
+    }
+    return result;
+}
+
+auto TagIndex::estimate(const TextPredicate& predicate) const -> std::size_t {
+    if (predicate.kind == TextMatchKind::Matches && predicate.case_sensitive) {
+        auto it = tags_.find(predicate.text);
+        return it != tags_.end() ? it->second.count : 0;
+    }
+    auto total = std::size_t { 0 };
+    for (const auto& [tag, posting] : tags_) {
+        if (predicate.test(tag)) {
+            total += posting.count;
+        }
+    }
+    return total;
+}
+
+auto TagIndex::facets(const Bitmap& notes, std::size_t limit, std::size_t threads) const -> std::vector<TagFacet> {
+    struct Candidate {
+        std::string_view tag;
+        const Posting* posting;
+    };
+    struct Counted {
+        std::string_view tag;
+        std::size_t count;
+    };
+
+    if (limit == 0 || notes.empty()) {
+        return {};
+    }
+    auto candidates = std::vector<Candidate> {};
+    candidates.reserve(tags_.size());
+    for (const auto& [tag, posting] : tags_) {
+        candidates.push_back(Candidate { tag, &posting });
+    }
+    // Nor would there be a chunk of them for any thread to count.
+    if (candidates.empty()) {
+        return {};
+    }
+    std::ranges::sort(candidates, [](const Candidate& lhs, const Candidate& rhs) {
+        return lhs.posting->count != rhs.posting->count ? lhs.posting->count > rhs.posting->count : lhs.tag < rhs.tag;
+    });
+
+    // A min-heap on `better`: the front is the worst of the best `limit` so far.
+    const auto better = [](const Counted& lhs, const Counted& rhs) {
+        return lhs.count != rhs.count ? lhs.count > rhs.count : lhs.tag < rhs.tag;
+    };
+    auto next = std::atomic<std::size_t> { 0 };
+    // The highest `limit`th best count any thread has found: no tag carried by fewer notes can make the cut.
+    auto floor = std::atomic<std::size_t> { 1 };
+    auto mutex = std::mutex {};
+    auto counted = std::vector<Counted> {};
+
+    const auto worker = [&] {
+        auto best = std::vector<Counted> {};
+        for (auto begin = next.fetch_add(FACET_CHUNK, std::memory_order_relaxed); begin < candidates.size();
+             begin = next.fetch_add(FACET_CHUNK, std::memory_order_relaxed)) {
+            const auto end = std::min(candidates.size(), begin + FACET_CHUNK);
+            for (auto i = begin; i < end; ++i) {
+                const auto& candidate = candidates[i];
+                if (candidate.posting->count < floor.load(std::memory_order_relaxed)) {
+                    // Every later tag is carried by fewer notes still.
+                    next.store(candidates.size(), std::memory_order_relaxed);
+                    break;
+                }
+                const auto count = notes.intersect_count(candidate.posting->notes);
+                const auto facet = Counted { candidate.tag, count };
+                if (count == 0 || (best.size() == limit && !better(facet, best.front()))) {
+                    continue;
+                }
+                if (best.size() == limit) {
+                    std::ranges::pop_heap(best, better);
+                    best.pop_back();
+                }
+                best.push_back(facet);
+                std::ranges::push_heap(best, better);
+                if (best.size() == limit) {
+                    auto current = floor.load(std::memory_order_relaxed);
+                    while (current < best.front().count
+                           && !floor.compare_exchange_weak(current, best.front().count, std::memory_order_relaxed)) { }
+                }
+            }
+        }
+        auto lock = std::scoped_lock { mutex };
+        counted.insert(counted.end(), best.begin(), best.end());
+    };
+
+    const auto chunks = (candidates.size() + FACET_CHUNK - 1) / FACET_CHUNK;
+    threads = std::clamp<std::size_t>(threads, 1, chunks);
+    if (threads <= 1) {
+        worker();
+    } else {
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    std::ranges::sort(counted, better);
+    counted.resize(std::min(counted.size(), limit));
+    auto facets = std::vector<TagFacet> {};
+    facets.reserve(counted.size());
+    for (const auto& [tag, count] : counted) {
+        facets.push_back(TagFacet { std::string { tag }, count });
+    }
+    return facets;
+}
+
+auto TagIndex::notes_with(std::string_view tag) const -> const Bitmap* {
+    auto it = tags_.find(tag);
+    return it != tags_.end() ? &it->second.notes : nullptr;
+}
+
+}  // namespace pg::store
@@ -0,0 +1,451 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include <pg/store/RadixSort.hpp>
+#include <pg/store/TermIndex.hpp>
+#include <pg/util/text_search.hpp>
+
+namespace pg::store {
+
+namespace {
+    auto is_word(char c) -> bool {
+        const auto byte = static_cast<unsigned char>(c);
+        return (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z')
+            || byte >= 0x80;
+    }
+
+    /**
+     * Call `fn` with the FNV-1a hash of every case-folded word of `text`, in order.
+     */
+    template <typename Fn>
+    void for_each_word(std::string_view text, Fn&& fn) {
+        for (std::size_t i = 0; i < text.size();) {
+            if (!is_word(text[i])) {
+                ++i;
+                continue;
+            }
+            auto hash = std::uint64_t { 14695981039346656037ULL };
+            for (; i < text.size() && is_word(text[i]); ++i) {
+                hash = (hash ^ static_cast<unsigned char>(pg::util::text::fold_ascii(text[i]))) * 1099511628211ULL;
+            }
+            fn(hash);
+        }
+    }
+
+    auto saturate(std::uint32_t count) -> std::uint16_t {
+        return static_cast<std::uint16_t>(std::min<std::uint32_t>(count, std::numeric_limits<std::uint16_t>::max()));
+    }
+}  // namespace
+
+auto TermIndex::terms_of(std::string_view text) -> std::vector<TermCount> {
+    auto hashes = std::vector<Term> {};
+    for_each_word(text, [&](Term term) { hashes.push_back(term); });
+    std::ranges::sort(hashes);
+    auto out = std::vector<TermCount> {};
+    for (auto it = hashes.begin(); it != hashes.end();) {
+        const auto run = std::find_if(it, hashes.end(), [&](Term term) { return term != *it; });
+        out.push_back(TermCount { *it, static_cast<std::uint32_t>(run - it) });
+        it = run;
+    }
+    return out;
+}
+
+TermIndex::Builder::Builder(std::size_t shards): shards_(std::max<std::size_t>(shards, 1)) { }
+
+void TermIndex::Builder::add(NoteOrdinal ordinal, std::string_view title, std::string_view content) {
+    // Unlike `terms_of`, counts nothing: `build` sorts every note's words at once anyway, and counts them as it goes.
+    auto title_length = std::uint32_t { 0 };
+    auto content_length = std::uint32_t { 0 };
+    for_each_word(title, [&](Term term) {
+        shards_[term % shards_.size()].push_back(Entry { term, ordinal, 1, 0 });
+        ++title_length;
+    });
+    for_each_word(content, [&](Term term) {
+        shards_[term % shards_.size()].push_back(Entry { term, ordinal, 0, 1 });
+        ++content_length;
+    });
+    lengths_.emplace_back(ordinal, std::pair { title_length, content_length });
+}
+
+auto TermIndex::build(std::span<Builder> parts, std::size_t threads) -> TermIndex {
+    using Entry = Builder::Entry;
+
+    auto index = TermIndex {};
+    if (parts.empty()) {
+        return index;
+    }
+    const auto shard_count = parts.front().shards_.size();
+    auto shards = std::vector<phmap::flat_hash_map<Term, Postings>>(shard_count);
+    const auto build_shard = [&](std::size_t shard) {
+        auto entries = std::vector<Entry> {};
+        auto size = std::size_t { 0 };
+        for (const auto& part : parts) {
+            size += part.shards_[shard].size();
+        }
+        entries.reserve(size);
+        for (auto& part : parts) {
+            entries.insert(entries.end(), part.shards_[shard].begin(), part.shards_[shard].end());
+            std::vector<Entry> {}.swap(part.shards_[shard]);
+        }
+        // By the low half of each term alone, which is half the passes; the few terms that share one are told apart
+        // below.
+        constexpr auto LOW = [](Term term) { return static_cast<std::uint32_t>(term); };
+        radix_sort(entries, [&](const Entry& entry) { return LOW(entry.term); }, 32);
+
+        auto& postings = shards[shard];
+        for (auto it = entries.begin(); it != entries.end();) {
+            const auto low = LOW(it->term);
+            const auto same =
+              std::find_if(it, entries.end(), [&](const Entry& entry) { return LOW(entry.term) != low; });
+            const auto unlike = [&](const Entry& entry) { return entry.term != it->term; };
+            const auto mixed = std::any_of(it, same, unlike);
+            if (mixed) {
+                std::stable_sort(it, same, [](const Entry& lhs, const Entry& rhs) { return lhs.term < rhs.term; });
+            }
+            const auto term = it->term;
+            const auto run = mixed ? std::find_if(it, same, unlike) : same;
+            // Only out of order if the notes were not added in ordinal order.
+            const auto by_ordinal = [](const Entry& lhs, const Entry& rhs) { return lhs.ordinal < rhs.ordinal; };
+            if (!std::is_sorted(it, run, by_ordinal)) {
+                std::sort(it, run, by_ordinal);
+            }
+            auto& found = postings[term];
+            while (it != run) {
+                const auto ordinal = it->ordinal;
+                auto in_title = std::uint32_t { 0 };
+                auto in_content = std::uint32_t { 0 };
+                for (; it != run && it->ordinal == ordinal; ++it) {
+                    in_title += it->title;
+                    in_content += it->content;
+                }
+                const auto posting = Posting { ordinal, saturate(in_title), saturate(in_content) };
+                found.list.push_back(posting);
+                found.max_title = std::max(found.max_title, posting.title);
+                found.max_content = std::max(found.max_content, posting.content);
+            }
+        }
+    };
+
+    const auto workers = std::clamp<std::size_t>(threads, 1, shard_count);
+    if (workers == 1) {
+        for (std::size_t shard = 0; shard < shard_count; ++shard) {
+            build_shard(shard);
+        }
+    } else {
+        auto next_shard = std::atomic<std::size_t> { 0 };
+        const auto worker = [&] {
+            for (auto shard = next_shard.fetch_add(1, std::memory_order_relaxed); shard < shard_count;
+                 shard = next_shard.fetch_add(1, std::memory_order_relaxed)) {
+                build_shard(shard);
+            }
+        };
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    auto term_count = std::size_t { 0 };
+    for (const auto& postings : shards) {
+        term_count += postings.size();
+    }
+    index.postings_.reserve(term_count);
+    for (auto& postings : shards) {
+        for (auto& [term, found] : postings) {
+            index.postings_.emplace(term, std::move(found));
+        }
+        postings = {};
+    }
+    for (auto& part : parts) {
+        for (const auto& [ordinal, lengths] : part.lengths_) {
+            index.set_length(ordinal, Field::Title, lengths.first);
+            index.set_length(ordinal, Field::Content, lengths.second);
+            index.indexed_.set(ordinal);
+        }
+        part.lengths_ = {};
+    }
+    return index;
+}
+
+void TermIndex::add(NoteOrdinal ordinal, std::string_view title, std::string_view content) {
+    apply(ordinal, diff(Field::Title, {}, title));
+    apply(ordinal, diff(Field::Content, {}, content));
+}
+
+void TermIndex::update(NoteOrdinal ordinal, Field field, std::string_view before, std::string_view after) {
+    apply(ordinal, diff(field, before, after));
+}
+
+auto TermIndex::diff(Field field, std::string_view before, std::string_view after) -> Delta {
+    const auto old_terms = terms_of(before);
+    const auto new_terms = terms_of(after);
+
+    auto delta = Delta { field, {}, 0 };
+    auto old_it = old_terms.begin();
+    for (const auto& now : new_terms) {
+        for (; old_it != old_terms.end() && old_it->term < now.term; ++old_it) {
+            delta.counts.push_back(TermCount { old_it->term, 0 });
+        }
+        const auto same = old_it != old_terms.end() && old_it->term == now.term;
+        if (!same || old_it->count != now.count) {
+            delta.counts.push_back(now);
+        }
+        if (same) {
+            ++old_it;
+        }
+        delta.length += now.count;
+    }
+    for (; old_it != old_terms.end(); ++old_it) {
+        delta.counts.push_back(TermCount { old_it->term, 0 });
+    }
+    return delta;
+}
+
+void TermIndex::apply(NoteOrdinal ordinal, const Delta& delta) {
+    for (const auto& [term, count] : delta.counts) {
+        set_count(term, ordinal, delta.field, count);
+    }
+    set_length(ordinal, delta.field, delta.length);
+    indexed_.set(ordinal);
+}
+
+auto TermIndex::terms() const -> std::vector<Term> {
+    auto result = std::vector<Term> {};
+    result.reserve(postings_.size());
+    for (const auto& [term, postings] : postings_) {
+        result.push_back(term);
+    }
+    return result;
+}
+
+void TermIndex::purge(std::span<const Term> terms, const Bitmap& dead) {
+    for (auto term : terms) {
+        auto found = postings_.find(term);
+        if (found == postings_.end()) {
+            continue;
+        }
+        std::erase_if(found->second.list, [&](const Posting& posting) { return dead.test(posting.ordinal); });
+        if (found->second.list.empty()) {
+            postings_.erase(found);
+        }
+    }
+}
+
+void TermIndex::forget(const Bitmap& dead) {
+    dead.for_each([&](NoteOrdinal ordinal) {
+        set_length(ordinal, Field::Title, 0);
+        set_length(ordinal, Field::Content, 0);
+    });
+    indexed_.subtract(dead);
+}
+
+auto TermIndex::top(
+  std::span<const TermCount> query,
+  std::size_t k,
+  const Bm25& parameters,
+  const std::function<bool(const ScoredNote&)>& accept) const -> Ranking {
+    return top(query, k, parameters, stats(query), accept);
+}
+
+auto TermIndex::top(
+  std::span<const TermCount> query,
+  std::size_t k,
+  const Bm25& parameters,
+  const RankingStats& stats,
+  const std::function<bool(const ScoredNote&)>& accept) const -> Ranking {
+    struct TermCursor {
+        const std::vector<Posting>* list;
+        std::size_t at;
+        double idf;
+        /// The most this term can add to any note's score.
+        double bound;
+
+        [[nodiscard]] auto ordinal() const -> NoteOrdinal {
+            return at < list->size() ? (*list)[at].ordinal : INVALID_ORDINAL;
+        }
+    };
+
+    auto ranking = Ranking {};
+    const auto notes = static_cast<double>(stats.notes);
+    if (k == 0 || query.empty() || notes == 0) {
+        return ranking;
+    }
+    const auto average_title = std::max(1.0, static_cast<double>(stats.title_words) / notes);
+    const auto average_content = std::max(1.0, static_cast<double>(stats.content_words) / notes);
+    const auto weight = [&](double count, double length, double average) {
+        return count * (parameters.k1 + 1)
+             / (count + parameters.k1 * (1 - parameters.b + parameters.b * length / average));
+    };
+
+    auto cursors = std::vector<TermCursor> {};
+    cursors.reserve(query.size());
+    for (std::size_t i = 0; i < query.size(); ++i) {
+        const auto found = postings_.find(query[i].term);
+        if (found == postings_.end()) {
+            continue;
+        }
+        const auto& postings = found->second;
+        const auto frequency = static_cast<double>(
+          i < stats.frequencies.size() ? stats.frequencies[i] : static_cast<std::uint64_t>(postings.list.size()));
+        const auto idf = std::log1p(std::max(0.0, notes - frequency + 0.5) / (frequency + 0.5));
+        // Both weights only grow with the count and shrink with the length, so an empty field is the best case.
+        const auto bound = idf
+                         * (parameters.title_boost * weight(postings.max_title, 0, average_title)
+                            + weight(postings.max_content, 0, average_content));
+        cursors.push_back(TermCursor { &postings.list, 0, idf, bound });
+    }
+
+    // A min-heap on `better`: the front is the worst of the best `k` so far.
+    const auto better = [](const ScoredNote& lhs, const ScoredNote& rhs) {
+        return lhs.score != rhs.score ? lhs.score > rhs.score : lhs.ordinal < rhs.ordinal;
+    };
+    auto& heap = ranking.notes;
+    heap.reserve(std::min(k, indexed_.count()));
+    while (true) {
+        std::ranges::sort(cursors, {}, &TermCursor::ordinal);
+        // Notes come up in ordinal order, so one tying with the front would lose on its ordinal: it has to beat it.
+        const auto threshold = heap.size() < k ? -1.0 : heap.front().score;
+        auto pivot = cursors.size();
+        auto upper = 0.0;
+        for (std::size_t i = 0; i < cursors.size() && cursors[i].ordinal() != INVALID_ORDINAL; ++i) {
+            upper += cursors[i].bound;
+            if (upper > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size()) {
+            break;
+        }
+
+        const auto target = cursors[pivot].ordinal();
+        if (cursors.front().ordinal() != target) {
+            // No note before the pivot's can beat the threshold on the terms before it alone.
+            for (std::size_t i = 0; i < pivot; ++i) {
+                const auto& list = *cursors[i].list;
+                const auto from = list.begin() + static_cast<std::ptrdiff_t>(cursors[i].at);
+                const auto to = std::ranges::lower_bound(from, list.end(), target, {}, &Posting::ordinal);
+                cursors[i].at = static_cast<std::size_t>(to - list.begin());
+            }
+            continue;
+        }
+
+        const auto lengths = target < lengths_.size() ? lengths_[target] : Lengths {};
+        auto note = ScoredNote { target, 0.0 };
+        for (auto& cursor : cursors) {
+            if (cursor.ordinal() != target) {
+                break;
+            }
+            const auto& posting = (*cursor.list)[cursor.at++];
+            note.score += cursor.idf
+                        * (parameters.title_boost * weight(posting.title, lengths.title, average_title)
+                           + weight(posting.content, lengths.content, average_content));
+        }
+        ++ranking.scored;
+        if (heap.size() == k && !better(note, heap.front())) {
+            continue;
+        }
+        ++ranking.tested;
+        if (!accept(note)) {
+            continue;
+        }
+        if (heap.size() == k) {
+            std::ranges::pop_heap(heap, better);
+            heap.pop_back();
+        }
+        heap.push_back(note);
+        std::ranges::push_heap(heap, better);
+    }
+    std::ranges::sort(heap, better);
+    return ranking;
+}
+
+auto TermIndex::stats(std::span<const TermCount> query) const -> RankingStats {
+    auto stats = RankingStats { indexed_.count(), title_words_, content_words_, {} };
+    stats.frequencies.reserve(query.size());
+    for (const auto& [term, count] : query) {
+        const auto found = postings_.find(term);
+        stats.frequencies.push_back(found != postings_.end() ? found->second.list.size() : 0);
+    }
+    return stats;
+}
+
+auto TermIndex::contains_any(NoteOrdinal ordinal, std::span<const TermCount> terms) const -> bool {
+    return std::ranges::any_of(terms, [&](const TermCount& term) {
+        const auto found = postings_.find(term.term);
+        if (found == postings_.end()) {
+            return false;
+        }
+        const auto& list = found->second.list;
+        const auto it = std::ranges::lower_bound(list, ordinal, {}, &Posting::ordinal);
+        return it != list.end() && it->ordinal == ordinal;
+    });
+}
+
+void TermIndex::set_count(Term term, NoteOrdinal ordinal, Field field, std::uint32_t count) {
+    const auto set = [&](Posting& posting, Postings& postings) {
+        if (field == Field::Title) {
+            posting.title = saturate(count);
+            postings.max_title = std::max(postings.max_title, posting.title);
+        } else {
+            posting.content = saturate(count);
+            postings.max_content = std::max(postings.max_content, posting.content);
+        }
+    };
+
+    if (count == 0) {
+        auto found = postings_.find(term);
+        if (found == postings_.end()) {
+            return;
+        }
+        auto& list = found->second.list;
+        auto it = std::ranges::lower_bound(list, ordinal, {}, &Posting::ordinal);
+        if (it == list.end() || it->ordinal != ordinal) {
+            return;
+        }
+        set(*it, found->second);
+        if (it->title == 0 && it->content == 0) {
+            list.erase(it);
+        }
+        if (list.empty()) {
+            postings_.erase(found);
+        }
+        return;
+    }
+
+    auto& postings = postings_[term];
+    auto& list = postings.list;
+    // Ordinals are handed out in increasing order, so new notes are almost always appended.
+    if (list.empty() || list.back().ordinal < ordinal) {
+        set(list.emplace_back(Posting { ordinal, 0, 0 }), postings);
+        return;
+    }
+    auto it = std::ranges::lower_bound(list, ordinal, {}, &Posting::ordinal);
+    if (it == list.end() || it->ordinal != ordinal) {
+        it = list.insert(it, Posting { ordinal, 0, 0 });
+    }
+    set(*it, postings);
+}
+
+void TermIndex::set_length(NoteOrdinal ordinal, Field field, std::uint32_t length) {
+    if (ordinal >= lengths_.size()) {
+        lengths_.resize(static_cast<std::size_t>(ordinal) + 1);
+    }
+    auto& lengths = lengths_[ordinal];
+    auto& current = field == Field::Title ? lengths.title : lengths.content;
+    auto& total = field == Field::Title ? title_words_ : content_words_;
+    total = total - current + length;
+    current = length;
+}
+
+}  // namespace pg::store
@@ -0,0 +1,235 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/PatternSet.hpp>
+#include <pg/store/PieceTable.hpp>
+#include <pg/store/TextEdit.hpp>
+#include <pg/util/text_search.hpp>
+
+namespace pg::store {
+namespace {
+
+namespace kernels = pg::util::text;
+
+template <typename... Fn>
+struct Overloaded: Fn... {
+    using Fn::operator()...;
+};
+template <typename... Fn>
+Overloaded(Fn...) -> Overloaded<Fn...>;
+
+auto out_of_range(std::size_t position, std::size_t size) {
+    return fail(ErrorCode::InvalidArgument, fmt::format("position {} is past the end ({})", position, size));
+}
+
+auto bad_range(std::size_t start, std::size_t end, std::size_t size) {
+    return fail(ErrorCode::InvalidArgument, fmt::format("range [{}, {}) is not within [0, {})", start, end, size));
+}
+
+auto empty_search() {
+    return fail(ErrorCode::InvalidArgument, "search text must not be empty");
+}
+
+auto replace_all(std::string& text, std::string_view search, std::string_view replace) -> Result<void> {
+    if (search.empty()) {
+        return empty_search();
+    }
+    auto at = kernels::find(text, search);
+    if (at == std::string_view::npos) {
+        return {};
+    }
+    auto out = std::string {};
+    out.reserve(text.size());
+    auto from = std::size_t { 0 };
+    while (at != std::string_view::npos) {
+        out.append(text, from, at - from);
+        out.append(replace);
+        from = at + search.size();
+        const auto next = kernels::find(std::string_view { text }.substr(from), search);
+        at = next == std::string_view::npos ? next : from + next;
+    }
+    out.append(text, from);
+    text = std::move(out);
+    return {};
+}
+
+/// Replace every match of `searches[i]` in `table` with `replacements[i]`, in one pass over the text.
+auto replace_each(
+  PieceTable& table,
+  std::span<const std::string_view> searches,
+  std::span<const std::string_view> replacements) -> Result<void> {
+    if (searches.empty()) {
+        return {};
+    }
+    auto set = pattern_cache().get(searches);
+    if (!set) {
+        return cpp::fail(std::move(set).error());
+    }
+    table.assign((*set)->replace(table.str(), replacements));
+    return {};
+}
+
+}  // namespace
+
+auto pattern_cache() -> PatternCache& {
+    static auto cache = PatternCache {};
+    return cache;
+}
+
+auto apply_edits(std::string& text, std::span<const TextEdit> edits) -> Result<void> {
+    if (edits.empty()) {
+        return {};
+    }
+    auto table = PieceTable { text };
+    // Searches have to read the whole text anyway, so they flatten it, rewrite the copy and start the table over.
+    const auto rewrite = [&](auto&& edit) -> Result<void> {
+        auto flat = table.str();
+        if (auto edited = edit(flat); !edited) {
+            return edited;
+        }
+        table.assign(std::move(flat));
+        return {};
+    };
+
+    for (const auto& edit : edits) {
+        auto result = std::visit(
+          Overloaded {
+            [&](const AppendText& op) -> Result<void> {
+                table.append(op.text);
+                return {};
+            },
+            [&](const PrependText& op) -> Result<void> {
+                table.prepend(op.text);
+                return {};
+            },
+            [&](const InsertText& op) -> Result<void> {
+                if (op.position > table.size()) {
+                    return out_of_range(op.position, table.size());
+                }
+                table.insert(op.position, op.text);
+                return {};
+            },
+            [&](const RemoveTextRange& op) -> Result<void> {
+                if (op.start > op.end || op.end > table.size()) {
+                    return bad_range(op.start, op.end, table.size());
+                }
+                table.erase(op.start, op.end);
+                return {};
+            },
+            [&](const ReplaceText& op) -> Result<void> {
+                return rewrite([&](std::string& flat) { return replace_all(flat, op.search, op.replace); });
+            },
+            [&](const ReplaceTextMultiple& op) -> Result<void> {
+                auto searches = std::vector<std::string_view> {};
+                auto replacements = std::vector<std::string_view> {};
+                for (const auto& pair : op.pairs) {
+                    searches.emplace_back(pair.search);
+                    replacements.emplace_back(pair.replace);
+                }
+                return replace_each(table, searches, replacements);
+            },
+            [&](const RemoveText& op) -> Result<void> {
+                return rewrite([&](std::string& flat) { return replace_all(flat, op.removal, {}); });
+            },
+            [&](const RemoveTextMultiple& op) -> Result<void> {
+                const auto searches = std::vector<std::string_view> { op.removals.begin(), op.removals.end() };
+                const auto replacements = std::vector<std::string_view>(searches.size());
+                return replace_each(table, searches, replacements);
+            },
+          },
+          edit);
+        if (!result) {
+            return result;
+        }
+    }
+    text = table.str();
+    return {};
+}
+
+auto apply_tag_edits(std::vector<std::string>& tags, std::span<const TextEdit> edits) -> Result<void> {
+    const auto rename = [&](const ReplaceText& pair) -> Result<void> {
+        if (pair.search.empty()) {
+            return empty_search();
+        }
+        std::ranges::replace(tags, pair.search, pair.replace);
+        return {};
+    };
+    const auto drop = [&](const std::string& removal) -> Result<void> {
+        if (removal.empty()) {
+            return empty_search();
+        }
+        std::erase(tags, removal);
+        return {};
+    };
+
+    for (const auto& edit : edits) {
+        auto result = std::visit(
+          Overloaded {
+            [&](const AppendText& op) -> Result<void> {
+                tags.push_back(op.text);
+                return {};
+            },
+            [&](const PrependText& op) -> Result<void> {
+                tags.insert(tags.begin(), op.text);
+                return {};
+            },
+            [&](const InsertText& op) -> Result<void> {
+                if (op.position > tags.size()) {
+                    return out_of_range(op.position, tags.size());
+                }
+                tags.insert(tags.begin() + static_cast<std::ptrdiff_t>(op.position), op.text);
+                return {};
+            },
+            [&](const RemoveTextRange& op) -> Result<void> {
+                if (op.start > op.end || op.end > tags.size()) {
+                    return bad_range(op.start, op.end, tags.size());
+                }
+                tags.erase(
+                  tags.begin() + static_cast<std::ptrdiff_t>(op.start),
+                  tags.begin() + static_cast<std::ptrdiff_t>(op.end));
+                return {};
+            },
+            [&](const ReplaceText& op) -> Result<void> { return rename(op); },
+            [&](const ReplaceTextMultiple& op) -> Result<void> {
+                if (std::ranges::any_of(op.pairs, [](const auto& pair) { return pair.search.empty(); })) {
+                    return empty_search();
+                }
+                // One pass, like text: each tag is renamed by the first pair naming it, and never renamed again.
+                for (auto& tag : tags) {
+                    const auto pair = std::ranges::find(op.pairs, tag, &ReplaceText::search);
+                    if (pair != op.pairs.end()) {
+                        tag = pair->replace;
+                    }
+                }
+                return {};
+            },
+            [&](const RemoveText& op) -> Result<void> { return drop(op.removal); },
+            [&](const RemoveTextMultiple& op) -> Result<void> {
+                if (std::ranges::any_of(op.removals, [](const auto& removal) { return removal.empty(); })) {
+                    return empty_search();
+                }
+                std::erase_if(
+                  tags, [&](const auto& tag) { return std::ranges::find(op.removals, tag) != op.removals.end(); });
+                return {};
+            },
+          },
+          edit);
+        if (!result) {
+            return result;
+        }
+    }
+    return {};
+}
+
+}  // namespace pg::store
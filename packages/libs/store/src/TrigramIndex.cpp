@@ -0,0 +1,340 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+#include <pg/store/RadixSort.hpp>
+#include <pg/store/TrigramIndex.hpp>
+
+namespace pg::store {
+
+namespace {
+    /// Trigrams are three folded bytes.
+    constexpr auto TRIGRAMS = std::size_t { 1 } << 24;
+
+    auto fold(char c) -> std::uint32_t {
+        return static_cast<unsigned char>(pg::util::text::fold_ascii(c));
+    }
+
+    /**
+     * Call `visit` with every trigram of `text`, in the order they occur, repeats included.
+     */
+    template <typename Visit>
+    void for_each_trigram(std::string_view text, Visit visit) {
+        if (text.size() < 3) {
+            return;
+        }
+        auto window = (fold(text[0]) << 8) | fold(text[1]);
+        for (std::size_t i = 2; i < text.size(); ++i) {
+            window = ((window << 8) | fold(text[i])) & 0xFFFFFFU;
+            visit(window);
+        }
+    }
+}  // namespace
+
+auto TrigramIndex::trigrams_of(std::string_view text) -> std::vector<Trigram> {
+    auto out = std::vector<Trigram> {};
+    out.reserve(text.size() >= 3 ? text.size() - 2 : 0);
+    for_each_trigram(text, [&](Trigram trigram) { out.push_back(trigram); });
+    std::ranges::sort(out);
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+TrigramIndex::Builder::Builder(std::size_t shards): shards_(std::max<std::size_t>(shards, 1)) { }
+
+void TrigramIndex::Builder::add(NoteOrdinal ordinal, std::string_view text) {
+    // Unlike `trigrams_of`, sorts nothing: `build` sorts every note's postings at once anyway.
+    if (seen_.empty()) {
+        seen_.resize(TRIGRAMS / 64);
+    }
+    note_.resize(std::max<std::size_t>(note_.size(), text.size()));
+    auto distinct = std::size_t { 0 };
+    for_each_trigram(text, [&](Trigram trigram) {
+        // Without a branch on whether the trigram is new, which no predictor could guess.
+        auto& word = seen_[trigram / 64];
+        const auto bit = std::uint64_t { 1 } << (trigram % 64);
+        note_[distinct] = trigram;
+        distinct += (word & bit) == 0 ? 1 : 0;
+        word |= bit;
+    });
+    for (std::size_t i = 0; i < distinct; ++i) {
+        const auto trigram = note_[i];
+        seen_[trigram / 64] = 0;
+        shards_[trigram % shards_.size()].push_back((std::uint64_t { trigram } << 32) | ordinal);
+    }
+    counts_.emplace_back(ordinal, static_cast<std::uint32_t>(distinct));
+}
+
+auto TrigramIndex::build(std::span<Builder> parts, std::size_t threads) -> TrigramIndex {
+    auto index = TrigramIndex {};
+    if (parts.empty()) {
+        return index;
+    }
+    const auto shard_count = parts.front().shards_.size();
+    auto shards = std::vector<phmap::flat_hash_map<Trigram, Postings>>(shard_count);
+    const auto build_shard = [&](std::size_t shard) {
+        auto keys = std::vector<std::uint64_t> {};
+        auto size = std::size_t { 0 };
+        for (const auto& part : parts) {
+            size += part.shards_[shard].size();
+        }
+        keys.reserve(size);
+        for (auto& part : parts) {
+            keys.insert(keys.end(), part.shards_[shard].begin(), part.shards_[shard].end());
+            std::vector<std::uint64_t> {}.swap(part.shards_[shard]);
+        }
+        radix_sort(keys, [](std::uint64_t key) { return key >> 32; }, 24);
+
+        auto& postings = shards[shard];
+        for (auto it = keys.begin(); it != keys.end();) {
+            const auto trigram = *it >> 32;
+            const auto run = std::find_if(it, keys.end(), [&](std::uint64_t key) { return key >> 32 != trigram; });
+            // Only out of order if the notes were not added in ordinal order.
+            if (!std::is_sorted(it, run)) {
+                std::sort(it, run);
+            }
+            auto& list = postings[static_cast<Trigram>(trigram)];
+            list.reserve(static_cast<std::size_t>(run - it));
+            for (; it != run; ++it) {
+                list.push_back(static_cast<NoteOrdinal>(*it));
+            }
+        }
+    };
+
+    const auto workers = std::clamp<std::size_t>(threads, 1, shard_count);
+    if (workers == 1) {
+        for (std::size_t shard = 0; shard < shard_count; ++shard) {
+            build_shard(shard);
+        }
+    } else {
+        auto next_shard = std::atomic<std::size_t> { 0 };
+        const auto worker = [&] {
+            for (auto shard = next_shard.fetch_add(1, std::memory_order_relaxed); shard < shard_count;
+                 shard = next_shard.fetch_add(1, std::memory_order_relaxed)) {
+                build_shard(shard);
+            }
+        };
+        auto pool = std::vector<std::jthread> {};
+        pool.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+
+    auto trigram_count = std::size_t { 0 };
+    for (const auto& postings : shards) {
+        trigram_count += postings.size();
+    }
+    index.postings_.reserve(trigram_count);
+    for (auto& postings : shards) {
+        for (auto& [trigram, list] : postings) {
+            index.postings_.emplace(trigram, std::move(list));
+        }
+        postings = {};
+    }
+    for (auto& part : parts) {
+        for (const auto& [ordinal, count] : part.counts_) {
+            index.set_trigram_count(ordinal, count);
+            index.indexed_.set(ordinal);
+        }
+        part.counts_ = {};
+    }
+    return index;
+}
+
+void TrigramIndex::add(NoteOrdinal ordinal, std::string_view text) {
+    const auto trigrams = trigrams_of(text);
+    for (auto trigram : trigrams) {
+        insert_posting(trigram, ordinal);
+    }
+    set_trigram_count(ordinal, trigrams.size());
+    indexed_.set(ordinal);
+}
+
+void TrigramIndex::remove(NoteOrdinal ordinal, std::string_view text) {
+    for (auto trigram : trigrams_of(text)) {
+        erase_posting(trigram, ordinal);
+    }
+    set_trigram_count(ordinal, 0);
+    indexed_.reset(ordinal);
+}
+
+void TrigramIndex::update(NoteOrdinal ordinal, std::string_view before, std::string_view after) {
+    apply(ordinal, diff(before, after));
+}
+
+auto TrigramIndex::diff(std::string_view before, std::string_view after) -> Delta {
+    const auto old_trigrams = trigrams_of(before);
+    const auto new_trigrams = trigrams_of(after);
+
+    auto delta = Delta {};
+    std::ranges::set_difference(old_trigrams, new_trigrams, std::back_inserter(delta.removed));
+    std::ranges::set_difference(new_trigrams, old_trigrams, std::back_inserter(delta.added));
+    delta.count = new_trigrams.size();
+    return delta;
+}
+
+void TrigramIndex::apply(NoteOrdinal ordinal, const Delta& delta) {
+    for (auto trigram : delta.removed) {
+        erase_posting(trigram, ordinal);
+    }
+    for (auto trigram : delta.added) {
+        insert_posting(trigram, ordinal);
+    }
+    set_trigram_count(ordinal, delta.count);
+    indexed_.set(ordinal);
+}
+
+auto TrigramIndex::trigrams() const -> std::vector<Trigram> {
+    auto result = std::vector<Trigram> {};
+    result.reserve(postings_.size());
+    for (const auto& [trigram, list] : postings_) {
+        result.push_back(trigram);
+    }
+    return result;
+}
+
+void TrigramIndex::purge(std::span<const Trigram> trigrams, const Bitmap& dead) {
+    for (auto trigram : trigrams) {
+        auto found = postings_.find(trigram);
+        if (found == postings_.end()) {
+            continue;
+        }
+        std::erase_if(found->second, [&](NoteOrdinal ordinal) { return dead.test(ordinal); });
+        if (found->second.empty()) {
+            postings_.erase(found);
+        }
+    }
+}
+
+void TrigramIndex::forget(const Bitmap& dead) {
+    dead.for_each([&](NoteOrdinal ordinal) {
+        if (ordinal < trigram_counts_.size()) {
+            trigram_counts_[ordinal] = 0;
+        }
+    });
+    indexed_.subtract(dead);
+}
+
+auto TrigramIndex::candidates(std::string_view fragment) const -> std::optional<Bitmap> {
+    const auto trigrams = trigrams_of(fragment);
+    if (trigrams.empty()) {
+        return std::nullopt;
+    }
+
+    auto lists = std::vector<const Postings*> {};
+    lists.reserve(trigrams.size());
+    for (auto trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        if (it == postings_.end()) {
+            return Bitmap {};
+        }
+        lists.push_back(&it->second);
+    }
+    // Intersect smallest first so the working set only ever shrinks.
+    std::ranges::sort(lists, {}, [](const Postings* list) { return list->size(); });
+
+    auto working = *lists.front();
+    auto scratch = Postings {};
+    for (auto it = std::next(lists.begin()); it != lists.end() && !working.empty(); ++it) {
+        scratch.clear();
+        std::ranges::set_intersection(working, **it, std::back_inserter(scratch));
+        std::swap(working, scratch);
+    }
+    return Bitmap::from_ordinals(working);
+}
+
+auto TrigramIndex::estimate(std::string_view fragment) const -> std::optional<std::size_t> {
+    const auto trigrams = trigrams_of(fragment);
+    if (trigrams.empty()) {
+        return std::nullopt;
+    }
+    auto smallest = std::numeric_limits<std::size_t>::max();
+    for (auto trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        smallest = std::min(smallest, it != postings_.end() ? it->second.size() : 0);
+    }
+    return smallest;
+}
+
+auto TrigramIndex::fuzzy(std::string_view query, double min_score, std::size_t limit) const
+  -> std::vector<FuzzyMatch> {
+    const auto trigrams = trigrams_of(query);
+    if (trigrams.empty() || limit == 0) {
+        return {};
+    }
+
+    auto shared = phmap::flat_hash_map<NoteOrdinal, std::uint32_t> {};
+    for (auto trigram : trigrams) {
+        if (auto it = postings_.find(trigram); it != postings_.end()) {
+            for (auto ordinal : it->second) {
+                ++shared[ordinal];
+            }
+        }
+    }
+
+    auto matches = std::vector<FuzzyMatch> {};
+    const auto query_count = static_cast<double>(trigrams.size());
+    for (const auto& [ordinal, count] : shared) {
+        const auto note_count = static_cast<double>(trigram_counts_[ordinal]);
+        const auto score = static_cast<double>(count) / (query_count + note_count - static_cast<double>(count));
+        if (score >= min_score) {
+            matches.push_back(FuzzyMatch { ordinal, score });
+        }
+    }
+
+    const auto by_score = [](const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+        return lhs.score != rhs.score ? lhs.score > rhs.score : lhs.ordinal < rhs.ordinal;
+    };
+    if (matches.size() > limit) {
+        std::ranges::partial_sort(matches, matches.begin() + static_cast<std::ptrdiff_t>(limit), by_score);
+        matches.resize(limit);
+    } else {
+        std::ranges::sort(matches, by_score);
+    }
+    return matches;
+}
+
+void TrigramIndex::insert_posting(Trigram trigram, NoteOrdinal ordinal) {
+    auto& list = postings_[trigram];
+    if (list.empty() || list.back() < ordinal) {
+        list.push_back(ordinal);
+        return;
+    }
+    auto it = std::ranges::lower_bound(list, ordinal);
+    if (it == list.end() || *it != ordinal) {
+        list.insert(it, ordinal);
+    }
+}
+
+void TrigramIndex::erase_posting(Trigram trigram, NoteOrdinal ordinal) {
+    auto found = postings_.find(trigram);
+    if (found == postings_.end()) {
+        return;
+    }
+    auto& list = found->second;
+    auto it = std::ranges::lower_bound(list, ordinal);
+    if (it != list.end() && *it == ordinal) {
+        list.erase(it);
+    }
+    if (list.empty()) {
+        postings_.erase(found);
+    }
+}
+
+void TrigramIndex::set_trigram_count(NoteOrdinal ordinal, std::size_t count) {
+    if (ordinal >= trigram_counts_.size()) {
+        trigram_counts_.resize(static_cast<std::size_t>(ordinal) + 1, 0);
+    }
+    trigram_counts_[ordinal] = static_cast<std::uint32_t>(count);
+}
+
+}  // namespace pg::store
@@ -0,0 +1,305 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <pg/store/Crc32c.hpp>
+#include <pg/store/Endian.hpp>
+#include <pg/store/Wal.hpp>
+
+namespace pg::store {
+namespace {
+
+/// Bytes of a frame covered by its length and checksum, besides the payload: kind, version and timestamp.
+constexpr std::size_t FRAME_FIXED = WriteAheadLog::FRAME_HEADER - 8;
+/// Replay reads the log in blocks of at least this size.
+constexpr std::size_t READ_BLOCK = std::size_t { 1 } << 20;
+
+auto valid_kind(std::uint8_t kind) -> bool {
+    return kind >= static_cast<std::uint8_t>(FrameKind::Create)
+        && kind <= static_cast<std::uint8_t>(FrameKind::DeleteMany);
+}
+
+/**
+ * Sequential reader over the log that fetches whole blocks, so replay costs one read per block rather than two per
+ * frame.
+ */
+class BlockReader {
+  public:
+    BlockReader(const File& file, std::uint64_t size): file_ { file }, size_ { size } { }
+
+    /**
+     * The `length` bytes at `offset`, or an empty span if the file ends first. Valid until the next call.
+     */
+    auto bytes(std::uint64_t offset, std::size_t length) -> Result<std::span<const std::uint8_t>> {
+        if (offset + length > size_) {
+            return std::span<const std::uint8_t> {};
+        }
+        if (offset < start_ || offset + length > start_ + block_.size()) {
+            const auto wanted = std::min<std::uint64_t>(std::max(length, READ_BLOCK), size_ - offset);
+            block_.resize(static_cast<std::size_t>(wanted));
+            auto read = file_.read_at(offset, block_);
+            if (!read) {
+                return cpp::fail(read.error());
+            }
+            block_.resize(*read);
+            start_ = offset;
+            if (block_.size() < length) {
+                return std::span<const std::uint8_t> {};
+            }
+        }
+        return std::span<const std::uint8_t> { block_ }.subspan(static_cast<std::size_t>(offset - start_), length);
+    }
+
+  private:
+    const File& file_;
+    std::uint64_t size_;
+    std::uint64_t start_ = 0;
+    std::vector<std::uint8_t> block_;
+};
+
+}  // namespace
+
+auto WriteAheadLog::open(const std::filesystem::path& path, WalOptions options)
+  -> Result<std::unique_ptr<WriteAheadLog>> {
+    auto file = File::open(path, File::Mode::Append);
+    if (!file) {
+        return cpp::fail(file.error());
+    }
+    auto size = file->size();
+    if (!size) {
+        return cpp::fail(size.error());
+    }
+    if (*size == 0) {
+        if (auto written = file->write(MAGIC); !written) {
+            return cpp::fail(written.error());
+        }
+        if (auto synced = file->sync(); !synced) {
+            return cpp::fail(synced.error());
+        }
+        if (auto synced = sync_directory(path); !synced) {
+            return cpp::fail(synced.error());
+        }
+        *size = MAGIC.size();
+    } else {
+        auto reader = File::open(path, File::Mode::Read);
+        if (!reader) {
+            return cpp::fail(reader.error());
+        }
+        auto magic = std::array<std::uint8_t, MAGIC.size()> {};
+        auto read = reader->read_at(0, magic);
+        if (!read) {
+            return cpp::fail(read.error());
+        }
+        if (*read != magic.size() || magic != MAGIC) {
+            return fail(ErrorCode::DataLoss, fmt::format("{} is not a write-ahead log", path.string()));
+        }
+    }
+    return std::unique_ptr<WriteAheadLog> { new WriteAheadLog { std::move(*file), *size, options } };
+}
+
+WriteAheadLog::WriteAheadLog(File file, Lsn end, WalOptions options)
+    : file_ { std::move(file) },
+      options_ { options },
+      appended_ { end },
+      durable_ { end },
+      flusher_ { [this](std::stop_token stop) { run(std::move(stop)); } } { }
+
+WriteAheadLog::~WriteAheadLog() {
+    flusher_.request_stop();
+    flusher_.join();
+}
+
+auto WriteAheadLog::append(const WalFrame& frame) -> Lsn {
+    // Everything but the copy into the batch happens outside the lock.
+    auto header = std::array<std::uint8_t, FRAME_HEADER> {};
+    store_le(header.data(), FRAME_FIXED + frame.payload.size(), 4);
+    header[8] = static_cast<std::uint8_t>(frame.kind);
+    store_le(header.data() + 9, frame.version, 8);
+    store_le(header.data() + 17, static_cast<std::uint64_t>(frame.timestamp.time_since_epoch().count()), 8);
+    const auto crc = crc32c(frame.payload, crc32c(std::span { header }.subspan(8)));
+    store_le(header.data() + 4, crc, 4);
+
+    auto lock = std::scoped_lock { mutex_ };
+    batch_.insert(batch_.end(), header.begin(), header.end());
+    batch_.insert(batch_.end(), frame.payload.begin(), frame.payload.end());
+    appended_ += header.size() + frame.payload.size();
+    if (batch_commits_++ == 0) {
+        batch_opened_ = std::chrono::steady_clock::now();
+        work_.notify_one();
+    } else if (batch_commits_ >= options_.max_batch_commits || batch_.size() >= options_.max_batch_bytes) {
+        work_.notify_one();
+    }
+    return appended_;
+}
+
+auto WriteAheadLog::wait(Lsn lsn) -> Result<void> {
+    auto lock = std::unique_lock { mutex_ };
+    durable_cv_.wait(lock, [&] { return durable_ >= lsn || failure_.has_value(); });
+    if (durable_ >= lsn) {
+        return {};
+    }
+    return cpp::fail(*failure_);
+}
+
+auto WriteAheadLog::stats() const -> WalStats {
+    auto lock = std::scoped_lock { mutex_ };
+    return stats_;
+}
+
+void WriteAheadLog::run(std::stop_token stop) {
+    auto writing = std::vector<std::uint8_t> {};
+    auto lock = std::unique_lock { mutex_ };
+    while (true) {
+        work_.wait(lock, stop, [&] { return batch_commits_ > 0; });
+        if (batch_commits_ == 0) {
+            return;
+        }
+        // Keep the batch open for more commits, unless it fills up first or we are shutting down.
+        if (options_.max_delay.count() > 0) {
+            work_.wait_until(lock, stop, batch_opened_ + options_.max_delay, [&] {
+                return batch_commits_ >= options_.max_batch_commits || batch_.size() >= options_.max_batch_bytes;
+            });
+        }
+
+        std::swap(writing, batch_);
+        const auto commits = std::exchange(batch_commits_, 0);
+        const auto end = appended_;
+        const auto failed = failure_.has_value();
+        lock.unlock();
+
+        auto written = Result<void> {};
+        if (!failed) {
+            written = file_.write(writing);
+            if (written && options_.sync) {
+                written = file_.sync();
+            }
+        }
+
+        lock.lock();
+        if (!written && !failure_) {
+            failure_ = written.error();
+        }
+        if (!failure_) {
+            durable_ = end;
+            stats_.commits += commits;
+            stats_.batches += 1;
+            stats_.bytes += writing.size();
+            stats_.largest_batch = std::max<std::uint64_t>(stats_.largest_batch, commits);
+        }
+        writing.clear();
+        durable_cv_.notify_all();
+    }
+}
+
+auto read_wal(const std::filesystem::path& path, const std::function<Result<bool>(const WalFrame&)>& visit)
+  -> Result<ReplayStats> {
+    auto stats = ReplayStats {};
+    if (!std::filesystem::exists(path)) {
+        return stats;
+    }
+    auto file = File::open(path, File::Mode::Read);
+    if (!file) {
+        return cpp::fail(file.error());
+    }
+    auto size = file->size();
+    if (!size) {
+        return cpp::fail(size.error());
+    }
+
+    auto reader = BlockReader { *file, *size };
+    auto offset = std::uint64_t { 0 };
+    auto magic = reader.bytes(0, WriteAheadLog::MAGIC.size());
+    if (!magic) {
+        return cpp::fail(magic.error());
+    }
+    if (!magic->empty()) {
+        if (!std::ranges::equal(*magic, WriteAheadLog::MAGIC)) {
+            return fail(ErrorCode::DataLoss, fmt::format("{} is not a write-ahead log", path.string()));
+        }
+        offset = WriteAheadLog::MAGIC.size();
+    }
+
+    while (offset > 0) {
+        auto prefix = reader.bytes(offset, 8);
+        if (!prefix) {
+            return cpp::fail(prefix.error());
+        }
+        if (prefix->empty()) {
+            break;
+        }
+        const auto length = static_cast<std::size_t>(load_le(prefix->data(), 4));
+        const auto crc = static_cast<std::uint32_t>(load_le(prefix->data() + 4, 4));
+        if (length < FRAME_FIXED) {
+            break;
+        }
+        auto body = reader.bytes(offset + 8, length);
+        if (!body) {
+            return cpp::fail(body.error());
+        }
+        if (body->empty() || crc32c(*body) != crc) {
+            break;
+        }
+        if (!valid_kind((*body)[0])) {
+            return fail(
+              ErrorCode::DataLoss,
+              fmt::format("{}: frame at offset {} has unknown kind {}", path.string(), offset, (*body)[0]));
+        }
+
+        const auto frame = WalFrame {
+            .kind = static_cast<FrameKind>((*body)[0]),
+            .version = load_le(body->data() + 1, 8),
+            .timestamp = Timestamp { Timestamp::duration { static_cast<std::int64_t>(load_le(body->data() + 9, 8)) } },
+            .payload = body->subspan(FRAME_FIXED),
+        };
+        auto more = visit(frame);
+        if (!more) {
+            return cpp::fail(std::move(more).error());
+        }
+        offset += 8 + length;
+        ++stats.frames;
+        if (!*more) {
+            stats.valid_bytes = offset;
+            return stats;
+        }
+    }
+
+    stats.valid_bytes = offset;
+    stats.discarded_bytes = *size - offset;
+    return stats;
+}
+
+auto replay_wal(const std::filesystem::path& path, const std::function<Result<void>(const WalFrame&)>& apply)
+  -> Result<ReplayStats> {
+    auto stats = read_wal(path, [&](const WalFrame& frame) -> Result<bool> {
+        if (auto applied = apply(frame); !applied) {
+            return cpp::fail(std::move(applied).error());
+        }
+        return true;
+    });
+    if (!stats) {
+        return stats;
+    }
+    if (stats->discarded_bytes > 0) {
+        auto writer = File::open(path, File::Mode::Append);
+        if (!writer) {
+            return cpp::fail(writer.error());
+        }
+        if (auto truncated = writer->truncate(stats->valid_bytes); !truncated) {
+            return cpp::fail(truncated.error());
+        }
+        if (auto synced = writer->sync(); !synced) {
+            return cpp::fail(synced.error());
+        }
+    }
+    return stats;
+}
+
+}  // namespace pg::store
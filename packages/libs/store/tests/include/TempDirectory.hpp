@@ -0,0 +1,62 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include <pg/store/Common.hpp>
+
+#include <gtest/gtest.h>
+
+namespace pg::store::test {
+
+/**
+ * A directory under the system temporary directory, named after `prefix`, the running test and the time, created on
+ * construction and removed with everything in it on destruction.
+ */
+class TempDirectory {
+  public:
+    explicit TempDirectory(std::string_view prefix)
+        : path_ { std::filesystem::temp_directory_path()
+                  / fmt::format("pg-{}-{}-{}",
+                                prefix,
+                                ::testing::UnitTest::GetInstance()->current_test_info()->name(),
+                                std::chrono::steady_clock::now().time_since_epoch().count()) } {
+        std::filesystem::create_directories(path_);
+    }
+    ~TempDirectory() {
+        auto error = std::error_code {};
+        std::filesystem::remove_all(path_, error);
+    }
+
+    TempDirectory(const TempDirectory&) = delete;
+    auto operator=(const TempDirectory&) -> TempDirectory& = delete;
+
+    [[nodiscard]] auto path() const noexcept -> const std::filesystem::path& { return path_; }
+    [[nodiscard]] auto operator/(const std::filesystem::path& name) const -> std::filesystem::path {
+        return path_ / name;
+    }
+
+  private:
+    std::filesystem::path path_;
+};
+
+/**
+ * A store clock reading one second later on every call, starting at second 1. Copies share the count.
+ */
+inline auto ticking_clock() -> std::function<Timestamp()> {
+    return [tick = std::make_shared<int>(0)] { return Timestamp { std::chrono::seconds { ++*tick } }; };
+}
+
+}  // namespace pg::store::test
@@ -0,0 +1,67 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Bitmap.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::Bitmap;
+using pg::store::NoteOrdinal;
+
+TEST(BitmapTests, SetTestReset) {
+    auto bitmap = Bitmap {};
+    EXPECT_TRUE(bitmap.empty());
+    bitmap.set(3);
+    bitmap.set(64);
+    bitmap.set(200);
+    EXPECT_TRUE(bitmap.test(3));
+    EXPECT_TRUE(bitmap.test(64));
+    EXPECT_FALSE(bitmap.test(65));
+    EXPECT_FALSE(bitmap.test(100000));
+    EXPECT_EQ(bitmap.count(), 3);
+    bitmap.reset(64);
+    EXPECT_EQ(bitmap.to_ordinals(), (std::vector<NoteOrdinal> { 3, 200 }));
+}
+
+TEST(BitmapTests, FilledRespectsSize) {
+    auto bitmap = Bitmap::filled(70);
+    EXPECT_EQ(bitmap.count(), 70);
+    EXPECT_TRUE(bitmap.test(69));
+    EXPECT_FALSE(bitmap.test(70));
+}
+
+TEST(BitmapTests, SetOperationsAcrossSizes) {
+    auto small = Bitmap::from_ordinals(std::vector<NoteOrdinal> { 1, 2, 3 });
+    auto large = Bitmap::from_ordinals(std::vector<NoteOrdinal> { 2, 3, 500 });
+
+    EXPECT_EQ((small & large).to_ordinals(), (std::vector<NoteOrdinal> { 2, 3 }));
+    EXPECT_EQ((small | large).to_ordinals(), (std::vector<NoteOrdinal> { 1, 2, 3, 500 }));
+    EXPECT_EQ(small.intersect_count(large), 2);
+
+    auto diff = large;
+    diff.subtract(small);
+    EXPECT_EQ(diff.to_ordinals(), (std::vector<NoteOrdinal> { 500 }));
+    EXPECT_EQ(Bitmap::from_ordinals(std::vector<NoteOrdinal> { 2, 3 }), small & large);
+}
+
+TEST(BitmapTests, NextAndRetain) {
+    auto bitmap = Bitmap::from_ordinals(std::vector<NoteOrdinal> { 5, 63, 64, 130 });
+    EXPECT_EQ(bitmap.next(0), 5);
+    EXPECT_EQ(bitmap.next(6), 63);
+    EXPECT_EQ(bitmap.next(65), 130);
+    EXPECT_EQ(bitmap.next(131), Bitmap::npos);
+
+    bitmap.retain([](NoteOrdinal ordinal) { return ordinal % 2 == 0; });
+    EXPECT_EQ(bitmap.to_ordinals(), (std::vector<NoteOrdinal> { 64, 130 }));
+}
+
+}  // namespace
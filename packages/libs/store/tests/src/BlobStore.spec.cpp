@@ -0,0 +1,52 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <string>
+#include <utility>
+
+#include <pg/store/BlobStore.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::BlobStore;
+using pg::store::ContentHash;
+using pg::store::hash_content;
+
+TEST(BlobStoreTests, HashMatchesMurmurHash3) {
+    EXPECT_EQ(hash_content(""), (ContentHash { 0, 0 }));
+    EXPECT_EQ(hash_content("hello"), (ContentHash { 0xCBD8A7B341BD9B02ULL, 0x5B1E906A48AE1D19ULL }));
+    EXPECT_EQ(
+      hash_content("The quick brown fox jumps over the lazy dog"),
+      (ContentHash { 0xE34BBC7BBC071B6CULL, 0x7A433CA9C49A9347ULL }));
+}
+
+TEST(BlobStoreTests, EqualBodiesShareOneBlobUntilTheLastGoes) {
+    auto store = BlobStore {};
+    auto first = store.intern("meeting notes template");
+    auto second = store.intern("meeting notes template");
+    auto other = store.intern("something else");
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, other);
+    EXPECT_EQ(store.size(), 2);
+    EXPECT_EQ(store.bytes(), 36);
+    EXPECT_EQ(store.hits(), 1);
+
+    first.reset();
+    EXPECT_EQ(store.size(), 2);
+    second.reset();
+    EXPECT_EQ(store.size(), 1);
+    EXPECT_EQ(store.bytes(), 14);
+
+    // Interned afresh once the old blob is gone.
+    auto again = store.intern("meeting notes template");
+    EXPECT_EQ(again->text, "meeting notes template");
+    EXPECT_EQ(store.size(), 2);
+}
+
+}  // namespace
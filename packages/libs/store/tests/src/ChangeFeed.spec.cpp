@@ -0,0 +1,113 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <pg/store/ChangeFeed.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::store::ChangeEvent;
+using pg::store::ChangeFeed;
+using pg::store::CommitVersion;
+using pg::store::ErrorCode;
+using pg::store::fail;
+using pg::store::FrameKind;
+
+auto event(CommitVersion sequence) -> ChangeFeed::Event {
+    const auto payload = std::vector<std::uint8_t> { static_cast<std::uint8_t>(sequence) };
+    return std::make_shared<const ChangeEvent>(ChangeEvent { sequence, FrameKind::Update, {}, payload });
+}
+
+auto no_backfill(CommitVersion /*from*/, std::size_t /*max*/) -> pg::store::Result<std::vector<ChangeFeed::Event>> {
+    return fail(ErrorCode::FailedPrecondition, "nothing is kept outside the ring");
+}
+
+TEST(ChangeFeedTests, SubscribersReadAtTheirOwnPace) {
+    auto feed = ChangeFeed { 8, 10 };
+    auto fast = feed.subscribe(10, no_backfill);
+    auto slow = feed.subscribe(10, no_backfill);
+    for (CommitVersion sequence = 11; sequence <= 15; ++sequence) {
+        feed.publish(event(sequence));
+    }
+
+    auto events = fast->poll();
+    ASSERT_TRUE(events.has_value());
+    ASSERT_EQ(events->size(), 5);
+    EXPECT_EQ(events->front()->sequence, 11);
+    EXPECT_EQ(events->back()->payload, std::vector<std::uint8_t> { 15 });
+    EXPECT_TRUE(fast->poll()->empty());
+
+    events = slow->poll(2);
+    ASSERT_EQ(events->size(), 2);
+    EXPECT_EQ(events->back()->sequence, 12);
+    EXPECT_EQ(slow->next(), 13);
+
+    const auto stats = feed.subscribers();
+    ASSERT_EQ(stats.size(), 2);
+    EXPECT_EQ(stats[0].id, fast->id());
+    EXPECT_EQ(stats[0].lag, 0);
+    EXPECT_EQ(stats[1].lag, 3);
+    EXPECT_EQ(slow->lag(), 3);
+
+    fast.reset();
+    ASSERT_EQ(feed.subscribers().size(), 1);
+    EXPECT_EQ(feed.subscribers()[0].id, slow->id());
+}
+
+TEST(ChangeFeedTests, SubscribersBehindTheRingAreBackfilled) {
+    auto feed = ChangeFeed { 4, 0 };
+    auto asked = std::vector<CommitVersion> {};
+    auto subscription = feed.subscribe(0, [&](CommitVersion from, std::size_t max) {
+        asked.push_back(from);
+        auto events = std::vector<ChangeFeed::Event> {};
+        for (auto sequence = from; sequence < from + max && sequence <= 6; ++sequence) {
+            events.push_back(event(sequence));
+        }
+        return pg::store::Result<std::vector<ChangeFeed::Event>> { std::move(events) };
+    });
+    // Publishing never waits for the subscriber, which is left behind by the ring.
+    for (CommitVersion sequence = 1; sequence <= 10; ++sequence) {
+        feed.publish(event(sequence));
+    }
+    EXPECT_EQ(subscription->lag(), 10);
+
+    auto events = subscription->poll();
+    ASSERT_TRUE(events.has_value());
+    ASSERT_EQ(events->size(), 6);
+    EXPECT_EQ(events->back()->sequence, 6);
+    events = subscription->poll();
+    ASSERT_EQ(events->size(), 4);
+    EXPECT_EQ(events->front()->sequence, 7);
+    EXPECT_EQ(asked, std::vector<CommitVersion> { 1 });
+
+    auto lost = feed.subscribe(0, no_backfill);
+    EXPECT_EQ(lost->poll().error().code, ErrorCode::FailedPrecondition);
+    EXPECT_EQ(lost->next(), 1);
+}
+
+TEST(ChangeFeedTests, WaitingSubscribersWakeOnPublish) {
+    auto feed = ChangeFeed { 4, 0 };
+    auto subscription = feed.subscribe(0, no_backfill);
+    EXPECT_FALSE(subscription->wait(1ms));
+
+    auto publisher = std::jthread { [&] { feed.publish(event(1)); } };
+    EXPECT_TRUE(subscription->wait(10s));
+    EXPECT_EQ(subscription->poll()->size(), 1);
+
+    auto stop = std::stop_source {};
+    stop.request_stop();
+    EXPECT_FALSE(subscription->wait(10s, stop.get_token()));
+}
+
+}  // namespace
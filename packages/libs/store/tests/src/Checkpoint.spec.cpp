@@ -0,0 +1,206 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::Checkpoint;
+using pg::store::CheckpointWriter;
+using pg::store::ErrorCode;
+using pg::store::NoteField;
+using pg::store::NoteId;
+using pg::store::NoteStore;
+using pg::store::Predicate;
+using pg::store::SearchQuery;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+using pg::store::Timestamp;
+using pg::store::test::TempDirectory;
+using pg::store::test::ticking_clock;
+
+class CheckpointTests: public ::testing::Test {
+  protected:
+    CheckpointTests() {
+        for (int i = 0; i < 100; ++i) {
+            auto tags = std::vector<std::string> { "common" };
+            if (i % 10 == 0) {
+                tags.emplace_back("rare");
+            }
+            ids_.push_back(*source_.create(CreateNote { fmt::format("Note {}", i), "body text", std::move(tags) }));
+        }
+        (void) source_.remove(ids_[3]);
+    }
+
+    auto load(CheckpointWriter& writer, NoteStore& source) -> std::unique_ptr<NoteStore> {
+        auto written = writer.write(source, source.take_dirty_chunks());
+        EXPECT_TRUE(written.has_value());
+        auto checkpoint = Checkpoint::open(directory_.path());
+        EXPECT_TRUE(checkpoint.has_value());
+        if (!checkpoint) {
+            return nullptr;
+        }
+        auto store = NoteStore::load(std::move(*checkpoint));
+        EXPECT_TRUE(store.has_value());
+        return store ? std::move(*store) : nullptr;
+    }
+
+    auto load() -> std::unique_ptr<NoteStore> {
+        auto writer = CheckpointWriter { directory_.path() };
+        return load(writer, source_);
+    }
+
+    auto chunk_files() const -> std::size_t {
+        return static_cast<std::size_t>(std::ranges::count_if(
+          std::filesystem::directory_iterator { directory_.path() },
+          [](const auto& entry) { return entry.path().filename().string().starts_with("chunk-"); }));
+    }
+
+    NoteStore source_ { pg::store::StoreOptions { .clock = ticking_clock() } };
+    std::vector<NoteId> ids_;
+    TempDirectory directory_ { "checkpoint" };
+};
+
+TEST_F(CheckpointTests, LoadedStoreMatchesTheSource) {
+    auto store = load();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->version(), source_.version());
+    EXPECT_EQ(store->size(), 99);
+    EXPECT_EQ(store->version_count(), 0);
+
+    for (const auto& id : ids_) {
+        const auto expected = source_.get(id);
+        const auto loaded = store->get(id);
+        ASSERT_EQ(loaded.has_value(), expected.has_value());
+        if (expected) {
+            EXPECT_EQ(loaded->title, expected->title);
+            EXPECT_EQ(loaded->content, expected->content);
+            EXPECT_EQ(loaded->tags, expected->tags);
+            EXPECT_EQ(loaded->created, expected->created);
+            EXPECT_EQ(loaded->updated, expected->updated);
+        }
+    }
+
+    const auto rare = SearchQuery {
+        { Predicate { NoteField::Tag, TextPredicate { TextMatchKind::Matches, "rare", true } } },
+        0,
+    };
+    EXPECT_EQ(store->search(rare).ordinals.size(), 10);
+}
+
+TEST_F(CheckpointTests, EmptyBodiesPackedNextToOthersRoundTrip) {
+    // Were an empty body packed into a block, it would start where the next one does.
+    auto source = NoteStore { pg::store::StoreOptions {
+      .compaction_threshold = 0, .cold_after = 1, .compression_interval = 0ms, .compression_min_bytes = 0 } };
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 20; ++i) {
+        const auto content = i % 2 == 0 ? std::string {} : fmt::format("body {}", i);
+        ids.push_back(*source.create(CreateNote { fmt::format("Note {}", i), content, std::nullopt }));
+    }
+    auto compressed = source.compress_cold();
+    compressed += source.compress_cold();
+    ASSERT_GE(compressed, 10);
+
+    auto writer = CheckpointWriter { directory_.path() };
+    auto store = load(writer, source);
+    ASSERT_NE(store, nullptr);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        EXPECT_EQ(store->get(ids[i])->content, i % 2 == 0 ? "" : fmt::format("body {}", i)) << i;
+    }
+}
+
+TEST_F(CheckpointTests, OnlyModifiedNotesAreCopiedOutOfTheMapping) {
+    auto store = load();
+    ASSERT_NE(store, nullptr);
+    const auto before = store->snapshot();
+    ASSERT_TRUE(store->update(UpdateNote { ids_[5], "renamed", std::nullopt, std::nullopt }));
+    ASSERT_TRUE(store->remove(ids_[6]));
+    EXPECT_EQ(store->version_count(), 2);
+
+    EXPECT_EQ(store->get(ids_[5], before)->title, "Note 5");
+    EXPECT_EQ(store->get(ids_[5])->title, "renamed");
+    EXPECT_EQ(store->get(ids_[5])->content, "body text");
+    EXPECT_TRUE(store->get(ids_[6], before).has_value());
+    EXPECT_FALSE(store->get(ids_[6]).has_value());
+
+    // Collection cuts chains down to the shared base version, which it never frees.
+    store->collect_garbage();
+    EXPECT_EQ(store->get(ids_[5], before)->title, "Note 5");
+}
+
+TEST_F(CheckpointTests, IncrementalCheckpointsRewriteOnlyDirtyChunks) {
+    for (std::size_t i = ids_.size(); i < 2 * Checkpoint::CHUNK_NOTES + 10; ++i) {
+        ids_.push_back(*source_.create(CreateNote { fmt::format("Note {}", i), "body text", std::nullopt }));
+    }
+    auto writer = CheckpointWriter { directory_.path() };
+    auto written = writer.write(source_, source_.take_dirty_chunks());
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(written->chunks_written, 3);
+    EXPECT_EQ(written->chunks_reused, 0);
+    EXPECT_EQ(written->notes, ids_.size() - 1);
+
+    const auto renamed = ids_[Checkpoint::CHUNK_NOTES + 1];
+    ASSERT_TRUE(source_.update(UpdateNote { renamed, "renamed", std::nullopt, std::nullopt }));
+    auto store = load(writer, source_);
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(writer.chunks()[0].version, writer.chunks()[2].version);
+    EXPECT_GT(writer.chunks()[1].version, writer.chunks()[0].version);
+    // The chunk that was rewritten replaced its previous file.
+    EXPECT_EQ(chunk_files(), 3);
+    EXPECT_EQ(store->size(), ids_.size() - 1);
+    EXPECT_EQ(store->get(renamed)->title, "renamed");
+
+    // A store loaded from the checkpoint keeps each note in its chunk, so it can carry on incrementally.
+    ASSERT_TRUE(store->remove(ids_[0]));
+    auto next = CheckpointWriter { directory_.path(), store->checkpoint() };
+    written = next.write(*store, store->take_dirty_chunks());
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(written->chunks_written, 1);
+    EXPECT_EQ(written->chunks_reused, 2);
+    EXPECT_EQ(written->notes, ids_.size() - 2);
+
+    const auto reloaded = Checkpoint::open(directory_.path());
+    ASSERT_TRUE(reloaded.has_value());
+    EXPECT_EQ((*reloaded)->note_count(), ids_.size() - 2);
+    EXPECT_EQ((*reloaded)->size(), store->end_ordinal());
+    EXPECT_FALSE((*reloaded)->contains(Checkpoint::CHUNK_NOTES - 1));
+    EXPECT_EQ((*reloaded)->id(Checkpoint::CHUNK_NOTES), ids_[Checkpoint::CHUNK_NOTES]);
+}
+
+TEST_F(CheckpointTests, CorruptFilesAreRejected) {
+    auto writer = CheckpointWriter { directory_.path() };
+    ASSERT_TRUE(writer.write(source_, source_.take_dirty_chunks()).has_value());
+    const auto chunk = Checkpoint::chunk_path(directory_.path(), writer.chunks()[0]);
+    std::filesystem::resize_file(chunk, std::filesystem::file_size(chunk) - 16);
+    auto checkpoint = Checkpoint::open(directory_.path());
+    ASSERT_FALSE(checkpoint.has_value());
+    EXPECT_EQ(checkpoint.error().code, ErrorCode::DataLoss);
+
+    const auto manifest = directory_ / Checkpoint::MANIFEST_FILE;
+    std::filesystem::resize_file(manifest, std::filesystem::file_size(manifest) - 1);
+    checkpoint = Checkpoint::open(directory_.path());
+    ASSERT_FALSE(checkpoint.has_value());
+    EXPECT_EQ(checkpoint.error().code, ErrorCode::DataLoss);
+}
+
+}  // namespace
@@ -0,0 +1,111 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/DateIndex.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::store::DateIndex;
+using pg::store::NoteOrdinal;
+using pg::store::Timestamp;
+
+auto at(std::chrono::seconds offset) -> Timestamp {
+    return Timestamp { offset };
+}
+
+auto ordinals(const DateIndex::Range& range) -> std::vector<NoteOrdinal> {
+    auto out = std::vector<NoteOrdinal> {};
+    range.for_each([&](NoteOrdinal ordinal) {
+        out.push_back(ordinal);
+        return true;
+    });
+    return out;
+}
+
+class DateIndexTests: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Inserted out of order on purpose, two notes share t=20.
+        index_.insert(0, at(30s));
+        index_.insert(1, at(10s));
+        index_.insert(2, at(20s));
+        index_.insert(3, at(40s));
+        index_.insert(4, at(20s));
+    }
+
+    DateIndex index_;
+};
+
+TEST_F(DateIndexTests, RangesAreSortedStreams) {
+    EXPECT_EQ(ordinals(index_.all()), (std::vector<NoteOrdinal> { 1, 2, 4, 0, 3 }));
+    EXPECT_EQ(ordinals(index_.before(at(20s))), (std::vector<NoteOrdinal> { 1 }));
+    EXPECT_EQ(ordinals(index_.after(at(20s))), (std::vector<NoteOrdinal> { 0, 3 }));
+    EXPECT_EQ(ordinals(index_.between(at(20s), at(30s))), (std::vector<NoteOrdinal> { 2, 4, 0 }));
+    EXPECT_TRUE(index_.between(at(30s), at(20s)).empty());
+}
+
+TEST_F(DateIndexTests, NotBetweenIsTheComplement) {
+    auto [low, high] = index_.not_between(at(15s), at(35s));
+    auto bitmap = low.to_bitmap();
+    high.collect(bitmap);
+    EXPECT_EQ(bitmap.to_ordinals(), (std::vector<NoteOrdinal> { 1, 3 }));
+    EXPECT_EQ(low.count() + high.count() + index_.between(at(15s), at(35s)).count(), index_.size());
+}
+
+TEST_F(DateIndexTests, UpdatesMoveNotes) {
+    index_.update(1, at(50s));
+    EXPECT_EQ(index_.timestamp_of(1), at(50s));
+    EXPECT_EQ(ordinals(index_.after(at(40s))), (std::vector<NoteOrdinal> { 1 }));
+    EXPECT_EQ(index_.size(), 5);
+
+    index_.erase(3);
+    EXPECT_FALSE(index_.timestamp_of(3).has_value());
+    EXPECT_EQ(index_.bounds()->second, at(50s));
+    EXPECT_EQ(index_.size(), 4);
+}
+
+TEST_F(DateIndexTests, BatchedUpdates) {
+    auto updates = std::vector<std::pair<NoteOrdinal, Timestamp>> { { 2, at(70s) }, { 0, at(60s) }, { 4, at(60s) } };
+    index_.update(updates);
+    EXPECT_EQ(ordinals(index_.all()), (std::vector<NoteOrdinal> { 1, 3, 0, 4, 2 }));
+}
+
+TEST(DateIndexExtremesTests, IndexesEveryTimestamp) {
+    auto index = DateIndex {};
+    index.insert(0, Timestamp::min());
+    index.insert(1, Timestamp::max());
+    EXPECT_EQ(index.timestamp_of(0), Timestamp::min());
+    EXPECT_EQ(index.size(), 2);
+
+    // Moving a note to the oldest timestamp there is keeps it indexed.
+    index.update(1, Timestamp::min());
+    EXPECT_EQ(index.timestamp_of(1), Timestamp::min());
+    EXPECT_EQ(index.size(), 2);
+    index.update(1, Timestamp::max());
+
+    // The span between the two overflows a signed count.
+    EXPECT_EQ(index.estimate(Timestamp::min(), Timestamp::max()), 2);
+    EXPECT_EQ(index.estimate(Timestamp {}, Timestamp::max()), 1);
+
+    index.erase(0);
+    EXPECT_FALSE(index.timestamp_of(0).has_value());
+    EXPECT_EQ(ordinals(index.all()), (std::vector<NoteOrdinal> { 1 }));
+}
+
+TEST_F(DateIndexTests, ResumeFromKey) {
+    EXPECT_EQ(ordinals(index_.from({ at(20s), 3 })), (std::vector<NoteOrdinal> { 4, 0, 3 }));
+}
+
+}  // namespace
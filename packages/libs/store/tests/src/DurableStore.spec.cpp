@@ -0,0 +1,256 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/DurableStore.hpp>
+#include <pg/store/Messages.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::data::CreateNote;
+using pg::store::AppendText;
+using pg::store::DurableOptions;
+using pg::store::DurableStore;
+using pg::store::ErrorCode;
+using pg::store::FrameKind;
+using pg::store::InsertText;
+using pg::store::NoteEdit;
+using pg::store::RemoveText;
+using pg::store::ReplaceText;
+using pg::store::Timestamp;
+using pg::store::messages::CreateRequest;
+using pg::store::messages::decode_delete_request;
+using pg::store::messages::encode_create_request;
+using pg::store::messages::encode_delete_notes_request;
+using pg::store::messages::encode_delete_request;
+using pg::store::messages::encode_update_notes_request;
+using pg::store::messages::encode_update_request;
+using pg::store::test::TempDirectory;
+using pg::store::test::ticking_clock;
+
+class DurableStoreTests: public ::testing::Test {
+  protected:
+    auto open(DurableOptions options = {}) -> std::unique_ptr<DurableStore> {
+        options.store.clock = clock_;
+        auto store = DurableStore::open(directory_.path(), std::move(options));
+        EXPECT_TRUE(store.has_value());
+        return store ? std::move(*store) : nullptr;
+    }
+
+    TempDirectory directory_ { "durable" };
+    std::function<Timestamp()> clock_ = ticking_clock();
+};
+
+TEST_F(DurableStoreTests, ReopeningReplaysEveryAcknowledgedMutation) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    auto kept = store->create(encode_create_request(
+      CreateRequest { CreateNote { "Shopping", "milk", std::vector<std::string> { "home" } }, std::nullopt }));
+    auto dropped = store->create(encode_create_request(CreateRequest { CreateNote { "Old", "", std::nullopt }, {} }));
+    ASSERT_TRUE(kept.has_value());
+    ASSERT_TRUE(dropped.has_value());
+    ASSERT_TRUE(store
+                  ->update(encode_update_request(NoteEdit {
+                    *kept,
+                    { AppendText { " list" } },
+                    { InsertText { 0, "oat " }, ReplaceText { "milk", "milk, eggs" } },
+                    { RemoveText { "home" }, AppendText { "errands" } },
+                  }))
+                  .has_value());
+    ASSERT_TRUE(store->remove(encode_delete_request(*dropped)).has_value());
+
+    // Rejected mutations are not logged.
+    EXPECT_EQ(store->remove(encode_delete_request(*dropped)).error().code, ErrorCode::NotFound);
+    EXPECT_EQ(
+      store->update(encode_update_request(NoteEdit { *kept, { InsertText { 99, "x" } }, {}, {} })).error().code,
+      ErrorCode::InvalidArgument);
+
+    const auto before = *store->store().get(*kept);
+    const auto version = store->store().version();
+    EXPECT_EQ(store->log()->stats().commits, 4);
+    store.reset();
+
+    store = open();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->replayed().frames, 4);
+    EXPECT_EQ(store->store().version(), version);
+    EXPECT_EQ(store->store().size(), 1);
+    EXPECT_FALSE(store->store().get(*dropped).has_value());
+
+    const auto after = store->store().get(*kept);
+    ASSERT_TRUE(after.has_value());
+    EXPECT_EQ(after->title, "Shopping list");
+    EXPECT_EQ(after->content, "oat milk, eggs");
+    EXPECT_EQ(after->tags, std::vector<std::string> { "errands" });
+    EXPECT_EQ(after->created, before.created);
+    EXPECT_EQ(after->updated, before.updated);
+}
+
+TEST_F(DurableStoreTests, ReopeningLoadsTheCheckpointAndReplaysOnlyWhatFollows) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    auto ids = std::vector<pg::store::NoteId> {};
+    for (int i = 0; i < 50; ++i) {
+        const auto note = CreateNote { fmt::format("note {}", i), "body", std::vector<std::string> { "bulk" } };
+        ids.push_back(*store->create(encode_create_request(CreateRequest { note, std::nullopt })));
+    }
+    ASSERT_TRUE(store->remove(encode_delete_request(ids[7])).has_value());
+    const auto written = store->checkpoint();
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(written->notes, 49);
+
+    // The log files the checkpoint covers are gone.
+    EXPECT_EQ(store->log_files().size(), 1);
+    EXPECT_EQ(written->chunks_written, 1);
+
+    ASSERT_TRUE(store->update(encode_update_request(NoteEdit { ids[0], { AppendText { "!" } }, {}, {} })).has_value());
+    const auto version = store->store().version();
+    store.reset();
+
+    store = open();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->replayed().frames, 1);
+    ASSERT_NE(store->store().checkpoint(), nullptr);
+    EXPECT_EQ(store->store().checkpoint()->size(), 49);
+    EXPECT_EQ(store->store().version(), version);
+    EXPECT_EQ(store->store().size(), 49);
+    // Only the update was applied on top of the checkpoint; everything else is still read from the mapping.
+    EXPECT_EQ(store->store().version_count(), 1);
+    EXPECT_EQ(store->store().get(ids[0])->title, "note 0!");
+    EXPECT_EQ(store->store().get(ids[49])->tags, std::vector<std::string> { "bulk" });
+    EXPECT_FALSE(store->store().get(ids[7]).has_value());
+}
+
+TEST_F(DurableStoreTests, ChangeSubscribersBehindTheFeedCatchUpFromTheLog) {
+    auto options = DurableOptions {};
+    options.change_feed_capacity = 4;
+    auto store = open(std::move(options));
+    ASSERT_NE(store, nullptr);
+    const auto follower = store->subscribe(0);
+    ASSERT_TRUE(follower.has_value());
+
+    auto ids = std::vector<pg::store::NoteId> {};
+    for (int i = 0; i < 10; ++i) {
+        const auto note = CreateNote { fmt::format("note {}", i), "", std::nullopt };
+        ids.push_back(*store->create(encode_create_request(CreateRequest { note, std::nullopt })));
+    }
+    ASSERT_TRUE(store->remove(encode_delete_request(ids[3])).has_value());
+    EXPECT_EQ((*follower)->lag(), 11);
+    ASSERT_EQ(store->changes()->subscribers().size(), 1);
+    EXPECT_EQ(store->changes()->subscribers()[0].lag, 11);
+
+    // Only the last four are still in the ring; the rest are read back from the log.
+    auto events = (*follower)->poll(8);
+    ASSERT_TRUE(events.has_value());
+    ASSERT_EQ(events->size(), 8);
+    for (std::size_t i = 0; i < events->size(); ++i) {
+        EXPECT_EQ((*events)[i]->sequence, i + 1);
+        EXPECT_EQ((*events)[i]->kind, FrameKind::Create);
+    }
+    events = (*follower)->poll();
+    ASSERT_TRUE(events.has_value());
+    ASSERT_EQ(events->size(), 3);
+    EXPECT_EQ(events->back()->sequence, 11);
+    EXPECT_EQ(events->back()->kind, FrameKind::Delete);
+    EXPECT_EQ(*decode_delete_request(events->back()->payload), ids[3]);
+    EXPECT_EQ((*follower)->lag(), 0);
+    EXPECT_TRUE((*follower)->poll()->empty());
+
+    // Once a checkpoint deletes the log files, what they held is gone for good.
+    ASSERT_TRUE(store->checkpoint().has_value());
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(store->update(encode_update_request(NoteEdit { ids[0], { AppendText { "!" } }, {}, {} })));
+    }
+    const auto late = store->subscribe(0);
+    ASSERT_TRUE(late.has_value());
+    EXPECT_EQ((*late)->poll().error().code, ErrorCode::FailedPrecondition);
+    const auto after_checkpoint = store->subscribe(11);
+    ASSERT_TRUE(after_checkpoint.has_value());
+    EXPECT_EQ((*after_checkpoint)->poll()->size(), 5);
+    EXPECT_EQ((*follower)->poll()->size(), 5);
+}
+
+TEST_F(DurableStoreTests, BatchedUpdatesAreLoggedAndReplayedAsOneFrame) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    auto ids = std::vector<pg::store::NoteId> {};
+    for (int i = 0; i < 3; ++i) {
+        const auto note = CreateNote { fmt::format("note {}", i), "body", std::nullopt };
+        ids.push_back(*store->create(encode_create_request(CreateRequest { note, std::nullopt })));
+    }
+    const auto edits = std::vector<NoteEdit> {
+        NoteEdit { ids[0], { AppendText { "!" } }, {}, {} },
+        NoteEdit { ids[1], { InsertText { 99, "?" } }, {}, {} },
+        NoteEdit { ids[2], {}, { ReplaceText { "body", "text" } }, {} },
+    };
+    const auto batch = store->update_many(encode_update_notes_request(edits));
+    ASSERT_TRUE(batch.has_value());
+    EXPECT_EQ(batch->applied, 2);
+    EXPECT_EQ(batch->results[1].error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(store->log()->stats().commits, 4);
+    const auto version = store->store().version();
+    store.reset();
+
+    store = open();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->replayed().frames, 4);
+    EXPECT_EQ(store->store().version(), version);
+    EXPECT_EQ(store->store().get(ids[0])->title, "note 0!");
+    EXPECT_EQ(store->store().get(ids[1])->title, "note 1");
+    EXPECT_EQ(store->store().get(ids[2])->content, "text");
+}
+
+TEST_F(DurableStoreTests, BatchedDeletesAreLoggedAndReplayedAsOneFrame) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    auto ids = std::vector<pg::store::NoteId> {};
+    for (int i = 0; i < 4; ++i) {
+        const auto note = CreateNote { fmt::format("note {}", i), "body", std::nullopt };
+        ids.push_back(*store->create(encode_create_request(CreateRequest { note, std::nullopt })));
+    }
+    const auto targets = std::vector<pg::store::NoteId> { ids[0], ids[2], ids[0] };
+    const auto batch = store->remove_many(encode_delete_notes_request(targets));
+    ASSERT_TRUE(batch.has_value());
+    EXPECT_EQ(batch->applied, 2);
+    EXPECT_EQ(batch->results[2].error().code, ErrorCode::NotFound);
+    EXPECT_EQ(store->log()->stats().commits, 5);
+    const auto version = store->store().version();
+    store.reset();
+
+    store = open();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->replayed().frames, 5);
+    EXPECT_EQ(store->store().version(), version);
+    EXPECT_EQ(store->store().size(), 2);
+    EXPECT_FALSE(store->store().get(ids[0]).has_value());
+    EXPECT_TRUE(store->store().get(ids[1]).has_value());
+    EXPECT_FALSE(store->store().get(ids[2]).has_value());
+}
+
+TEST_F(DurableStoreTests, MalformedRequestsAreRejected) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    const auto garbage = std::vector<std::uint8_t> { 1, 2, 3 };
+    EXPECT_EQ(store->create(garbage).error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(store->update(garbage).error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(store->remove(garbage).error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(store->log()->stats().commits, 0);
+}
+
+}  // namespace
@@ -0,0 +1,173 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Export.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/Import.hpp>
+#include <pg/store/Messages.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::export_notes;
+using pg::store::ExportFormat;
+using pg::store::ExportOptions;
+using pg::store::File;
+using pg::store::import_json_lines;
+using pg::store::NoteId;
+using pg::store::NoteRecord;
+using pg::store::NoteStore;
+using pg::store::test::TempDirectory;
+
+class ExportTests: public ::testing::Test {
+  protected:
+    ExportTests() {
+        for (int i = 0; i < 2000; ++i) {
+            auto note = CreateNote { fmt::format("Note {}", i), fmt::format("body \"{}\"\n", i), std::nullopt };
+            if (i % 3 == 0) {
+                note.tags = std::vector<std::string> { "exported", fmt::format("n{}", i % 7) };
+            }
+            ids_.push_back(*store_.create(note));
+        }
+        for (int i = 0; i < 2000; i += 10) {
+            EXPECT_TRUE(store_.remove(ids_[static_cast<std::size_t>(i)]));
+        }
+        EXPECT_TRUE(store_.update(UpdateNote { ids_[1], "Renamed", std::nullopt, std::nullopt }));
+    }
+
+    /**
+     * Every note still in the store, in the order they were created.
+     */
+    [[nodiscard]] auto expected() const -> std::vector<NoteRecord> {
+        auto out = std::vector<NoteRecord> {};
+        for (const auto id : ids_) {
+            if (auto note = store_.get(id)) {
+                out.push_back(std::move(*note));
+            }
+        }
+        return out;
+    }
+
+    [[nodiscard]] auto path(int i) const -> std::filesystem::path { return directory_ / fmt::format("out-{}", i); }
+
+    static auto read(const std::filesystem::path& path) -> std::string {
+        auto in = std::ifstream { path, std::ios::binary };
+        return std::string { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+    }
+
+    TempDirectory directory_ { "export" };
+    NoteStore store_;
+    std::vector<NoteId> ids_;
+};
+
+TEST_F(ExportTests, JsonLinesImportBack) {
+    auto out = File::open(path(0), File::Mode::Truncate);
+    ASSERT_TRUE(out.has_value());
+    const auto stats = export_notes(store_, *out, ExportOptions { .chunk_bytes = 4096 });
+    ASSERT_TRUE(stats.has_value()) << stats.error().message;
+    EXPECT_EQ(stats->notes, 1800);
+    EXPECT_EQ(stats->version, store_.version());
+    EXPECT_EQ(stats->bytes, std::filesystem::file_size(path(0)));
+    EXPECT_GT(stats->bytes_per_second(), 0.0);
+
+    // Importing keeps what the notes say, not who they are or when they were written.
+    const auto now = pg::store::Timestamp { std::chrono::hours { 1 } };
+    auto imported = NoteStore { pg::store::StoreOptions { .clock = [now] { return now; } } };
+    const auto loaded = import_json_lines(imported, path(0));
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message;
+    ASSERT_EQ(imported.size(), 1800);
+    const auto notes = expected();
+    const auto snapshot = imported.snapshot();
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        const auto note = imported.at(static_cast<pg::store::NoteOrdinal>(i), snapshot);
+        ASSERT_TRUE(note.has_value());
+        EXPECT_EQ(note->title, notes[i].title);
+        EXPECT_EQ(note->content, notes[i].content);
+        EXPECT_EQ(note->tags.to_vector(), notes[i].tags);
+        EXPECT_NE(note->id, notes[i].id);
+        EXPECT_FALSE(imported.get(notes[i].id).has_value());
+        EXPECT_EQ(note->created, now);
+        EXPECT_EQ(note->updated, now);
+    }
+}
+
+TEST_F(ExportTests, NoteObjectChunksDecodeBack) {
+    auto out = File::open(path(0), File::Mode::Truncate);
+    ASSERT_TRUE(out.has_value());
+    const auto stats = export_notes(
+      store_, *out, ExportOptions { .format = ExportFormat::NoteObjects, .chunk_bytes = 4096 });
+    ASSERT_TRUE(stats.has_value()) << stats.error().message;
+    EXPECT_EQ(stats->notes, 1800);
+
+    const auto bytes = read(path(0));
+    const auto* data = reinterpret_cast<const std::uint8_t*>(bytes.data());
+    auto decoded = std::vector<NoteRecord> {};
+    auto chunks = std::size_t { 0 };
+    for (std::size_t at = 0; at < bytes.size(); ++chunks) {
+        ASSERT_LE(at + 4, bytes.size());
+        auto length = std::uint32_t { 0 };
+        std::memcpy(&length, data + at, sizeof(length));
+        auto notes = pg::store::messages::decode_note_storage({ data + at, 4 + std::size_t { length } });
+        ASSERT_TRUE(notes.has_value()) << notes.error().message;
+        decoded.insert(decoded.end(), notes->begin(), notes->end());
+        at += 4 + std::size_t { length };
+    }
+    EXPECT_GT(chunks, 1);
+    const auto notes = expected();
+    ASSERT_EQ(decoded.size(), notes.size());
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        EXPECT_EQ(decoded[i].id, notes[i].id);
+        EXPECT_EQ(decoded[i].title, notes[i].title);
+        EXPECT_EQ(decoded[i].content, notes[i].content);
+        EXPECT_EQ(decoded[i].tags, notes[i].tags);
+        EXPECT_EQ(decoded[i].created, notes[i].created);
+        EXPECT_EQ(decoded[i].updated, notes[i].updated);
+    }
+}
+
+TEST_F(ExportTests, ShardsSplitTheNotesInOrder) {
+    auto single = File::open(path(0), File::Mode::Truncate);
+    ASSERT_TRUE(single.has_value());
+    ASSERT_TRUE(export_notes(store_, *single, ExportOptions { .chunk_bytes = 1000 }).has_value());
+
+    auto shards = std::vector<File> {};
+    for (int i = 1; i <= 4; ++i) {
+        auto shard = File::open(path(i), File::Mode::Truncate);
+        ASSERT_TRUE(shard.has_value());
+        shards.push_back(std::move(*shard));
+    }
+    const auto stats = export_notes(store_, shards, ExportOptions { .chunk_bytes = 1000 });
+    ASSERT_TRUE(stats.has_value()) << stats.error().message;
+    EXPECT_EQ(stats->notes, 1800);
+
+    auto joined = std::string {};
+    for (int i = 1; i <= 4; ++i) {
+        const auto shard = read(path(i));
+        EXPECT_FALSE(shard.empty());
+        joined += shard;
+    }
+    EXPECT_EQ(joined, read(path(0)));
+}
+
+}  // namespace
@@ -0,0 +1,82 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <pg/store/IdGenerator.hpp>
+
+#include <boost/uuid/uuid_io.hpp>
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::store::IdGenerator;
+using pg::store::NoteId;
+using pg::store::NoteIdHash;
+
+TEST(IdGeneratorTests, IdsAreVersion7AndCarryTheirTime) {
+    auto generate = IdGenerator { 1 };
+    const auto now = IdGenerator::Clock::time_point { 1'700'000'000'123ms };
+    const auto id = generate(now);
+
+    // The timestamp in hex, then the version digit.
+    EXPECT_EQ(boost::uuids::to_string(id).substr(0, 15), "018bcfe5-687b-7");
+    EXPECT_EQ(id.variant(), NoteId::variant_rfc_4122);
+    EXPECT_EQ(IdGenerator::time_of(id), now);
+}
+
+TEST(IdGeneratorTests, IdsIncreaseEvenWhenTheClockDoesNot) {
+    auto generate = IdGenerator { 2 };
+    const auto start = IdGenerator::Clock::time_point { 1'700'000'000'000ms };
+    auto ids = std::vector<NoteId> {};
+    // Enough ids in one millisecond to exhaust the sequence number, then a clock that steps back.
+    for (int i = 0; i < 10'000; ++i) {
+        ids.push_back(generate(start));
+    }
+    ids.push_back(generate(start - 1s));
+    ids.push_back(generate(start + 1h));
+
+    EXPECT_TRUE(std::ranges::is_sorted(ids));
+    EXPECT_EQ(std::ranges::adjacent_find(ids), ids.end());
+    EXPECT_GT(IdGenerator::time_of(ids[ids.size() - 2]), start);
+    EXPECT_EQ(IdGenerator::time_of(ids.back()), start + 1h);
+}
+
+TEST(IdGeneratorTests, ThreadsGenerateDistinctIds) {
+    constexpr std::size_t THREADS = 4;
+    constexpr std::size_t PER_THREAD = 5'000;
+    auto generated = std::vector<std::vector<NoteId>>(THREADS);
+    {
+        auto pool = std::vector<std::jthread> {};
+        for (auto& ids : generated) {
+            pool.emplace_back([&ids] {
+                for (std::size_t i = 0; i < PER_THREAD; ++i) {
+                    ids.push_back(pg::store::generate_note_id());
+                }
+            });
+        }
+    }
+
+    auto all = std::set<NoteId> {};
+    auto hashes = std::set<std::size_t> {};
+    for (const auto& ids : generated) {
+        EXPECT_TRUE(std::ranges::is_sorted(ids));
+        for (const auto& id : ids) {
+            all.insert(id);
+            hashes.insert(NoteIdHash {}(id));
+        }
+    }
+    EXPECT_EQ(all.size(), THREADS * PER_THREAD);
+    EXPECT_EQ(hashes.size(), THREADS * PER_THREAD);
+}
+
+}  // namespace
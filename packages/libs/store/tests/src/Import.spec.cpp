@@ -0,0 +1,187 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Checkpoint.hpp>
+#include <pg/store/Import.hpp>
+#include <pg/store/NoteStore.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using pg::store::Checkpoint;
+using pg::store::ErrorCode;
+using pg::store::import_json_lines;
+using pg::store::ImportOptions;
+using pg::store::ImportStats;
+using pg::store::NoteField;
+using pg::store::NoteStore;
+using pg::store::Predicate;
+using pg::store::SearchQuery;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+using pg::store::test::TempDirectory;
+
+/**
+ * Line `i` of the test input: note `i`, in one of a few shapes.
+ */
+auto line(int i) -> std::string {
+    switch (i % 4) {
+        case 0: return fmt::format(R"({{"title":"Note {}","content":"body {}","tags":["imported","x"]}})", i, i);
+        case 1: return fmt::format(R"({{ "content" : "only a body, \"quoted\" {}","tags":null,"x":[{{}}]}})", i);
+        case 2: return fmt::format(R"({{"tags":["imported"],"title":"Note {}","id":{}}})", i, i);
+        default: return fmt::format(R"({{"title":"Note {}","content":"café {}"}})", i, i);
+    }
+}
+
+class ImportTests: public ::testing::Test {
+  protected:
+    /**
+     * Write lines `[0, count)` to the input, with `bad` (if any) in place of line `bad_at`.
+     */
+    void write_input(int count, int bad_at = -1, const std::string& bad = {}) const {
+        auto out = std::ofstream { input(), std::ios::binary | std::ios::trunc };
+        for (int i = 0; i < count; ++i) {
+            out << (i == bad_at ? bad : line(i)) << (i % 100 == 50 ? "\n\n" : "\n");
+        }
+    }
+
+    [[nodiscard]] auto input() const -> std::filesystem::path { return directory_ / "notes.jsonl"; }
+    [[nodiscard]] auto checkpoints() const -> std::filesystem::path { return directory_ / "checkpoint"; }
+
+    static auto count(const NoteStore& store, NoteField field, TextMatchKind kind, std::string value) -> std::size_t {
+        return store.count(SearchQuery { { Predicate { field, TextPredicate { kind, std::move(value), false } } }, 0 });
+    }
+
+    TempDirectory directory_ { "import" };
+};
+
+TEST_F(ImportTests, ImportsEveryLineInParallel) {
+    write_input(5000);
+    auto store = NoteStore {};
+    auto reports = std::size_t { 0 };
+    const auto stats = import_json_lines(
+      store,
+      input(),
+      ImportOptions { .threads = 4, .chunk_bytes = 4096 },
+      [&](const ImportStats& /*stats*/) { ++reports; });
+    ASSERT_TRUE(stats.has_value()) << stats.error().message;
+    EXPECT_EQ(stats->notes, 5000);
+    EXPECT_EQ(stats->offset, std::filesystem::file_size(input()));
+    EXPECT_EQ(stats->checkpoints, 0);
+    EXPECT_GT(reports, 10);
+    EXPECT_GT(stats->notes_per_second(), 0.0);
+    EXPECT_GT(stats->indexing.count(), 0);
+    EXPECT_FALSE(store.bulk_loading());
+    EXPECT_EQ(store.size(), 5000);
+
+    // Notes go in in input order.
+    const auto snapshot = store.snapshot();
+    EXPECT_EQ(store.at(1234, snapshot)->title, "Note 1234");
+    EXPECT_EQ(store.at(4321, snapshot)->content, "only a body, \"quoted\" 4321");
+    EXPECT_EQ(store.at(4321, snapshot)->title, "");
+    EXPECT_EQ(store.at(4323, snapshot)->content, "café 4323");
+    EXPECT_EQ(count(store, NoteField::Tag, TextMatchKind::Matches, "imported"), 2500);
+    EXPECT_EQ(count(store, NoteField::Content, TextMatchKind::Matches, "body 4000"), 1);
+}
+
+TEST_F(ImportTests, InvalidLinesStopTheImportOrAreSkipped) {
+    const auto bad = std::vector<std::string> {
+        R"({"title": 5})",
+        R"({"tags": "one"})",
+        R"({"tags": ["one", 2]})",
+        R"(["not", "an", "object"])",
+        R"({"title": "unterminated)",
+        R"({"title": "two"} {})",
+    };
+    for (const auto& line : bad) {
+        write_input(300, 123, line);
+        auto store = NoteStore {};
+        const auto stopped = import_json_lines(store, input(), ImportOptions { .threads = 2, .chunk_bytes = 512 });
+        ASSERT_TRUE(stopped.has_error()) << line;
+        EXPECT_EQ(stopped.error().code, ErrorCode::InvalidArgument);
+        EXPECT_NE(stopped.error().message.find("line at offset"), std::string::npos) << stopped.error().message;
+        EXPECT_EQ(store.size(), 123) << line;
+
+        auto skipping = NoteStore {};
+        const auto skipped = import_json_lines(skipping, input(), ImportOptions { .skip_invalid = true });
+        ASSERT_TRUE(skipped.has_value()) << line;
+        EXPECT_EQ(skipped->skipped, 1);
+        EXPECT_EQ(skipping.size(), 299);
+    }
+}
+
+TEST_F(ImportTests, ResumesFromTheLastCheckpoint) {
+    write_input(3000, 2000, "{ broken");
+    const auto options = ImportOptions { .threads = 3, .chunk_bytes = 2048, .checkpoint_directory = checkpoints(),
+                                         .checkpoint_bytes = 16 * 1024 };
+    {
+        auto store = NoteStore {};
+        const auto stopped = import_json_lines(store, input(), options);
+        ASSERT_TRUE(stopped.has_error());
+        EXPECT_EQ(store.size(), 2000);
+    }
+
+    // As if the process had died at the invalid line and the input had been fixed since.
+    write_input(3000);
+    auto checkpoint = Checkpoint::open(checkpoints());
+    ASSERT_TRUE(checkpoint.has_value());
+    auto store = NoteStore::load(std::move(*checkpoint));
+    ASSERT_TRUE(store.has_value());
+    EXPECT_EQ((*store)->size(), 2000);
+
+    const auto resumed = import_json_lines(**store, input(), options);
+    ASSERT_TRUE(resumed.has_value()) << resumed.error().message;
+    EXPECT_GT(resumed->resumed_from, 0);
+    EXPECT_EQ(resumed->notes, 1000);
+    EXPECT_EQ((*store)->size(), 3000);
+    EXPECT_EQ(count(**store, NoteField::Title, TextMatchKind::Matches, "note 2000"), 1);
+    EXPECT_EQ(count(**store, NoteField::Title, TextMatchKind::Matches, "note 1999"), 1);
+    EXPECT_EQ(count(**store, NoteField::Title, TextMatchKind::Matches, "note 1998"), 1);
+
+    // A finished import has nothing left to do; a store that moved on since has no entry to resume from.
+    const auto again = import_json_lines(**store, input(), options);
+    ASSERT_TRUE(again.has_value());
+    EXPECT_EQ(again->notes, 0);
+    (void) (*store)->create({});
+    const auto moved = import_json_lines(**store, input(), options);
+    ASSERT_TRUE(moved.has_error());
+    EXPECT_EQ(moved.error().code, ErrorCode::FailedPrecondition);
+}
+
+TEST_F(ImportTests, CheckpointsALoadedStoreIntoAnotherDirectory) {
+    write_input(3000);
+    const auto options = ImportOptions { .threads = 2, .checkpoint_directory = checkpoints() };
+    {
+        auto store = NoteStore {};
+        ASSERT_TRUE(import_json_lines(store, input(), options).has_value());
+    }
+    auto checkpoint = Checkpoint::open(checkpoints());
+    ASSERT_TRUE(checkpoint.has_value());
+    auto store = NoteStore::load(std::move(*checkpoint));
+    ASSERT_TRUE(store.has_value());
+
+    // None of the chunks loaded from the first directory are in the second one, so they all have to be written there.
+    const auto elsewhere = directory_ / "elsewhere";
+    const auto imported = import_json_lines(**store, input(), { .threads = 2, .checkpoint_directory = elsewhere });
+    ASSERT_TRUE(imported.has_value()) << imported.error().message;
+    EXPECT_EQ(imported->notes, 3000);
+    auto moved = Checkpoint::open(elsewhere);
+    ASSERT_TRUE(moved.has_value()) << moved.error().message;
+    EXPECT_EQ((*moved)->note_count(), 6000);
+}
+
+}  // namespace
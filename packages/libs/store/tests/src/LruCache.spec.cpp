@@ -0,0 +1,51 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <string>
+
+#include <pg/store/LruCache.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::LruCache;
+
+TEST(LruCacheTests, EvictsTheLeastRecentlyUsedUntilTheWeightFits) {
+    auto cache = LruCache<int, std::string> { 10 };
+    EXPECT_EQ(cache.insert(1, "one", 4), "one");
+    EXPECT_EQ(cache.insert(2, "two", 4), "two");
+    EXPECT_EQ(cache.find(1), "one");
+    EXPECT_EQ(cache.weight(), 8);
+
+    // 2 is now the least recently used, so it goes first, and 1, read since, outlives 3.
+    EXPECT_EQ(cache.insert(3, "three", 6), "three");
+    EXPECT_FALSE(cache.find(2).has_value());
+    EXPECT_EQ(cache.find(1), "one");
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.insert(4, "four", 5), "four");
+    EXPECT_FALSE(cache.find(3).has_value());
+    EXPECT_EQ(cache.weight(), 9);
+    EXPECT_EQ(cache.hits(), 2);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(LruCacheTests, InsertKeepsTheFirstValueAndNothingTooHeavy) {
+    auto cache = LruCache<int, std::string> { 10 };
+    EXPECT_EQ(cache.insert(1, "first"), "first");
+    EXPECT_EQ(cache.insert(1, "second"), "first");
+    EXPECT_EQ(cache.insert(2, "heavy", 11), "heavy");
+    EXPECT_FALSE(cache.find(2).has_value());
+    EXPECT_EQ(cache.size(), 1);
+    cache.assign(1, "replaced");
+    EXPECT_EQ(cache.find(1), "replaced");
+
+    auto none = LruCache<int, std::string> { 0 };
+    EXPECT_EQ(none.insert(1, "uncached"), "uncached");
+    EXPECT_EQ(none.size(), 0);
+}
+
+}  // namespace
@@ -0,0 +1,51 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <pg/store/Lz.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+namespace lz = pg::store::lz;
+
+TEST(LzTests, RoundTrips) {
+    auto rng = std::mt19937 { 42 };
+    auto random = std::string(100'000, '\0');
+    for (auto& c : random) {
+        c = static_cast<char>(rng());
+    }
+    auto prose = std::string {};
+    while (prose.size() < 200'000) {
+        prose += "the quick brown fox jumps over the lazy dog " + std::to_string(rng() % 1000) + "\n";
+    }
+    const auto inputs = std::vector<std::string> {
+        "", "a", "twelve bytes", "abcabcabcabcabcabcabc", std::string(70'000, 'z'), random, prose,
+    };
+    for (const auto& input : inputs) {
+        const auto packed = lz::compress(input);
+        EXPECT_LE(packed.size(), lz::bound(input.size()));
+        EXPECT_EQ(lz::decompress(packed, input.size()), input);
+    }
+    EXPECT_LT(lz::compress(prose).size(), prose.size() / 3);
+    EXPECT_LT(lz::compress(std::string(70'000, 'z')).size(), 400);
+}
+
+TEST(LzTests, RejectsMalformedBlocks) {
+    const auto input = std::string { "abcabcabcabcabcabcabcabcabc and then some" };
+    const auto packed = lz::compress(input);
+    EXPECT_EQ(lz::decompress(packed, input.size() + 1), std::nullopt);
+    EXPECT_EQ(lz::decompress(packed, input.size() - 1), std::nullopt);
+    EXPECT_EQ(lz::decompress(packed.substr(0, packed.size() - 3), input.size()), std::nullopt);
+    // An offset reaching back before the start of the output.
+    EXPECT_EQ(lz::decompress(std::string { "\x10" "a" "\x05\x00" "\x00", 5 }, 5), std::nullopt);
+}
+
+}  // namespace
@@ -0,0 +1,76 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <vector>
+
+#include <pg/store/Mvcc.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::CommitVersion;
+using pg::store::EpochManager;
+using pg::store::NoteOrdinal;
+using pg::store::NoteVersion;
+using pg::store::VersionTable;
+
+auto make_version(CommitVersion begin, const char* title, NoteVersion* older = nullptr, bool deleted = false)
+  -> NoteVersion* {
+    auto* version = new NoteVersion {};
+    version->note.title = title;
+    version->begin = begin;
+    version->deleted = deleted;
+    version->older.store(older);
+    return version;
+}
+
+TEST(VersionTableTests, SnapshotsSeeTheNewestVersionAtOrBeforeThem) {
+    auto table = VersionTable {};
+    table.append(make_version(2, "first"));
+    table.publish(0, make_version(5, "second", table.head(0)));
+    table.publish(0, make_version(9, "gone", table.head(0), true));
+
+    EXPECT_EQ(table.visible(0, 1), nullptr);
+    EXPECT_EQ(table.visible(0, 2)->note.title, "first");
+    EXPECT_EQ(table.visible(0, 4)->note.title, "first");
+    EXPECT_EQ(table.visible(0, 5)->note.title, "second");
+    EXPECT_EQ(table.visible(0, 9), nullptr);
+    EXPECT_EQ(table.visible(1, 9), nullptr);
+}
+
+TEST(VersionTableTests, GrowsAcrossSegmentsWithoutMovingSlots) {
+    auto table = VersionTable {};
+    for (std::size_t i = 0; i < VersionTable::SEGMENT_SIZE + 3; ++i) {
+        table.append(make_version(1, "note"));
+    }
+    EXPECT_EQ(table.size(), VersionTable::SEGMENT_SIZE + 3);
+    EXPECT_NE(table.visible(static_cast<NoteOrdinal>(VersionTable::SEGMENT_SIZE + 2), 1), nullptr);
+    EXPECT_EQ(table.head(static_cast<NoteOrdinal>(VersionTable::SEGMENT_SIZE + 3)), nullptr);
+}
+
+TEST(EpochManagerTests, RetiredChainsOutliveOlderPins) {
+    auto committed = std::atomic<CommitVersion> { 4 };
+    auto epochs = EpochManager {};
+    EXPECT_EQ(epochs.oldest_pin(), EpochManager::IDLE);
+
+    auto old_reader = epochs.pin(committed);
+    EXPECT_EQ(old_reader.version(), 4);
+    committed = 7;
+    auto new_reader = epochs.pin(committed);
+    EXPECT_EQ(epochs.oldest_pin(), 4);
+
+    epochs.retire(make_version(1, "a", make_version(0, "b")), 6);
+    EXPECT_EQ(epochs.reclaim(), 0);
+
+    old_reader = {};
+    EXPECT_EQ(epochs.oldest_pin(), 7);
+    EXPECT_EQ(epochs.reclaim(), 2);
+    EXPECT_EQ(epochs.retired(), 0);
+}
+
+}  // namespace
@@ -0,0 +1,607 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::AppendText;
+using pg::store::ErrorCode;
+using pg::store::InsertText;
+using pg::store::NoteEdit;
+using pg::store::NoteField;
+using pg::store::NoteOrdinal;
+using pg::store::NoteId;
+using pg::store::NoteStore;
+using pg::store::Predicate;
+using pg::store::PrependText;
+using pg::store::SearchQuery;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+using pg::store::Timestamp;
+
+auto text(NoteField field, TextMatchKind kind, std::string value) -> Predicate {
+    return Predicate { field, TextPredicate { kind, std::move(value), false } };
+}
+
+class NoteStoreTests: public ::testing::Test {
+  protected:
+    NoteStoreTests()
+        : store_ { pg::store::StoreOptions {
+          .clock = [tick = std::make_shared<int>(0)] { return Timestamp { std::chrono::seconds { ++*tick } }; } } } { }
+
+    auto search(std::vector<Predicate> predicates) const -> std::vector<NoteOrdinal> {
+        return store_.search(SearchQuery { std::move(predicates), 0 }).ordinals;
+    }
+
+    NoteStore store_;
+};
+
+TEST_F(NoteStoreTests, CreateStampsAndIndexes) {
+    auto id = store_.create(CreateNote { "Shopping", "milk, eggs", std::vector<std::string> { "home" } });
+    ASSERT_TRUE(id.has_value());
+
+    const auto note = store_.get(*id);
+    ASSERT_TRUE(note.has_value());
+    EXPECT_EQ(note->title, "Shopping");
+    EXPECT_EQ(note->created, Timestamp { 1s });
+    EXPECT_EQ(note->updated, note->created);
+    EXPECT_EQ(store_.size(), 1);
+    EXPECT_EQ(search({ text(NoteField::Tag, TextMatchKind::Matches, "HOME") }), (std::vector<NoteOrdinal> { 0 }));
+}
+
+TEST_F(NoteStoreTests, CreateRejectsDuplicateIds) {
+    auto id = store_.create(CreateNote {});
+    ASSERT_TRUE(id.has_value());
+    auto again = store_.create(CreateNote {}, *id);
+    ASSERT_TRUE(again.has_error());
+    EXPECT_EQ(again.error().code, ErrorCode::AlreadyExists);
+}
+
+TEST_F(NoteStoreTests, CreateManyCommitsTheBatchAtOneVersion) {
+    (void) store_.create(CreateNote { "First", "before the batch", std::nullopt });
+    const auto before = store_.version();
+    const auto snapshot = store_.snapshot();
+
+    auto notes = std::vector<CreateNote> {};
+    for (int i = 0; i < 200; ++i) {
+        notes.emplace_back(
+          fmt::format("Bulk {}", i),
+          fmt::format("loaded body {}", i),
+          i % 2 == 0 ? std::optional { std::vector<std::string> { "even" } } : std::nullopt);
+    }
+    const auto ids = store_.create_many(notes);
+    ASSERT_TRUE(ids.has_value());
+    ASSERT_EQ(ids->size(), notes.size());
+    EXPECT_EQ(store_.version(), before + 1);
+    EXPECT_EQ(store_.size(), 201);
+
+    const auto note = store_.get((*ids)[17]);
+    ASSERT_TRUE(note.has_value());
+    EXPECT_EQ(note->title, "Bulk 17");
+    EXPECT_EQ(note->content, "loaded body 17");
+    EXPECT_EQ(note->created, store_.get(ids->front())->created);
+    EXPECT_FALSE(store_.get(ids->front(), snapshot).has_value());
+    EXPECT_EQ(search({ text(NoteField::Tag, TextMatchKind::Matches, "even") }).size(), 100);
+    EXPECT_EQ(
+      search({ text(NoteField::Content, TextMatchKind::Contains, "body 123") }), (std::vector<NoteOrdinal> { 124 }));
+    EXPECT_EQ(search({ text(NoteField::Title, TextMatchKind::Matches, "bulk 5") }), (std::vector<NoteOrdinal> { 6 }));
+}
+
+TEST_F(NoteStoreTests, UpdateReplacesOnlyGivenFields) {
+    auto id = *store_.create(CreateNote { "Draft", "first version", std::vector<std::string> { "wip" } });
+    ASSERT_TRUE(store_.update(UpdateNote { id, "Final", std::nullopt, std::vector<std::string> { "done" } }));
+
+    const auto note = store_.get(id);
+    ASSERT_TRUE(note.has_value());
+    EXPECT_EQ(note->title, "Final");
+    EXPECT_EQ(note->content, "first version");
+    EXPECT_EQ(note->updated, Timestamp { 2s });
+    EXPECT_TRUE(search({ text(NoteField::Title, TextMatchKind::Contains, "draft") }).empty());
+    EXPECT_TRUE(search({ text(NoteField::Tag, TextMatchKind::Matches, "wip") }).empty());
+    EXPECT_EQ(search({ text(NoteField::Tag, TextMatchKind::Matches, "done") }).size(), 1);
+}
+
+TEST_F(NoteStoreTests, RemoveLeavesAHole) {
+    auto first = *store_.create(CreateNote { "one", "", std::nullopt });
+    auto second = *store_.create(CreateNote { "two", "", std::nullopt });
+    ASSERT_TRUE(store_.remove(first));
+
+    EXPECT_FALSE(store_.get(first).has_value());
+    EXPECT_EQ(store_.ordinal_of(second), 1);
+    EXPECT_EQ(store_.size(), 1);
+    EXPECT_EQ(store_.end_ordinal(), 2);
+    EXPECT_EQ(search({}), (std::vector<NoteOrdinal> { 1 }));
+
+    auto missing = store_.remove(first);
+    ASSERT_TRUE(missing.has_error());
+    EXPECT_EQ(missing.error().code, ErrorCode::NotFound);
+    EXPECT_EQ(store_.update(UpdateNote { first }).error().code, ErrorCode::NotFound);
+}
+
+TEST_F(NoteStoreTests, ListPagesAreStableUnderWrites) {
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 10; ++i) {
+        ids.push_back(*store_.create(CreateNote { fmt::format("note {}", i), "", std::nullopt }));
+    }
+
+    auto first = store_.list(pg::store::ListQuery { 4, std::nullopt });
+    EXPECT_EQ(first.ordinals, (std::vector<NoteOrdinal> { 0, 1, 2, 3 }));
+    ASSERT_TRUE(first.next.has_value());
+
+    // Removing an already returned note and adding new ones must neither shift nor extend the listing.
+    ASSERT_TRUE(store_.remove(ids[1]));
+    ASSERT_TRUE(store_.create(CreateNote {}));
+    ASSERT_TRUE(store_.remove(ids[5]));
+
+    auto second = store_.list(pg::store::ListQuery { 4, first.next });
+    EXPECT_EQ(second.ordinals, (std::vector<NoteOrdinal> { 4, 6, 7, 8 }));
+    auto third = store_.list(pg::store::ListQuery { 4, second.next });
+    EXPECT_EQ(third.ordinals, (std::vector<NoteOrdinal> { 9 }));
+    EXPECT_FALSE(third.next.has_value());
+}
+
+TEST_F(NoteStoreTests, SnapshotsSeeTheVersionTheyWereTakenAt) {
+    auto kept = *store_.create(CreateNote { "old title", "old body", std::vector<std::string> { "a" } });
+    auto dropped = *store_.create(CreateNote { "doomed", "", std::nullopt });
+    const auto before = store_.snapshot();
+
+    ASSERT_TRUE(store_.update(UpdateNote { kept, "new title", std::nullopt, std::nullopt }));
+    ASSERT_TRUE(store_.remove(dropped));
+    auto added = *store_.create(CreateNote { "newcomer", "", std::nullopt });
+    const auto after = store_.snapshot();
+
+    EXPECT_EQ(store_.get(kept, before)->title, "old title");
+    EXPECT_EQ(store_.get(kept, after)->title, "new title");
+    ASSERT_TRUE(store_.get(dropped, before).has_value());
+    EXPECT_FALSE(store_.get(dropped, after).has_value());
+    EXPECT_FALSE(store_.get(added, before).has_value());
+    EXPECT_EQ(after.version(), before.version() + 3);
+
+    // Collection must leave everything a live snapshot can see alone.
+    store_.collect_garbage();
+    EXPECT_EQ(store_.get(kept, before)->title, "old title");
+    EXPECT_EQ(store_.get(dropped, before)->title, "doomed");
+}
+
+TEST_F(NoteStoreTests, GarbageCollectionReclaimsUnreachableVersions) {
+    auto id = *store_.create(CreateNote { "v0", "", std::nullopt });
+    auto doomed = *store_.create(CreateNote {});
+    {
+        const auto pinned = store_.snapshot();
+        for (int i = 1; i <= 10; ++i) {
+            ASSERT_TRUE(store_.update(UpdateNote { id, fmt::format("v{}", i), std::nullopt, std::nullopt }));
+        }
+        ASSERT_TRUE(store_.remove(doomed));
+        store_.collect_garbage();
+        EXPECT_EQ(store_.version_count(), 13);
+        EXPECT_EQ(store_.get(id, pinned)->title, "v0");
+    }
+
+    // With nothing pinned, what the pass cuts can be freed straight away.
+    EXPECT_EQ(store_.collect_garbage(), 12);
+    EXPECT_EQ(store_.version_count(), 1);
+    EXPECT_EQ(store_.get(id)->title, "v10");
+    EXPECT_EQ(store_.ordinal_of(doomed), pg::store::INVALID_ORDINAL);
+    EXPECT_TRUE(store_.create(CreateNote {}, doomed).has_value());
+}
+
+TEST_F(NoteStoreTests, ReadersNeverSeeTornWrites) {
+    // Every version of the note has the same number in its title, content and tag; a reader that mixed two versions
+    // would see them disagree.
+    const auto id = *store_.create(CreateNote { "0", "0", std::vector<std::string> { "0" } });
+    auto done = std::atomic<bool> { false };
+    auto writer = std::jthread { [&] {
+        for (int i = 1; i <= 2000; ++i) {
+            const auto text = std::to_string(i);
+            EXPECT_TRUE(store_.update(UpdateNote { id, text, text, std::vector<std::string> { text } }));
+        }
+        done = true;
+    } };
+
+    auto reads = 0;
+    while (!done || reads == 0) {
+        const auto snapshot = store_.snapshot();
+        const auto note = store_.get(id, snapshot);
+        ASSERT_TRUE(note.has_value());
+        ASSERT_EQ(note->title, note->content);
+        ASSERT_EQ(note->tags.to_vector(), std::vector<std::string> { std::string { note->title } });
+
+        const auto matches = store_.search(SearchQuery {
+          { Predicate { NoteField::Tag, TextPredicate { TextMatchKind::Matches, std::string { note->title }, true } } },
+          0 });
+        // The search reads at its own, possibly newer, snapshot; whatever it returns must agree with it.
+        for (auto ordinal : matches.ordinals) {
+            ASSERT_EQ(store_.at(ordinal, matches.snapshot)->tags.front(), store_.at(ordinal, matches.snapshot)->title);
+        }
+        ++reads;
+    }
+    writer.join();
+    EXPECT_EQ(store_.get(id)->title, "2000");
+}
+
+TEST_F(NoteStoreTests, EditManyCommitsTheBatchAtOneVersion) {
+    const auto a = *store_.create(CreateNote { "A", "alpha", std::nullopt });
+    const auto b = *store_.create(CreateNote { "B", "beta", std::nullopt });
+    const auto c = *store_.create(CreateNote { "C", "gamma", std::nullopt });
+    const auto before = store_.version();
+    const auto snapshot = store_.snapshot();
+
+    const auto edits = std::vector<NoteEdit> {
+        NoteEdit { a, {}, { AppendText { " one" } }, {} },
+        NoteEdit { b, {}, { InsertText { 99, "?" } }, {} },
+        NoteEdit { NoteId {}, {}, { AppendText { "lost" } }, {} },
+        NoteEdit { a, { AppendText { "!" } }, { AppendText { " two" } }, { AppendText { "edited" } } },
+        NoteEdit { c, {}, { PrependText { "> " } }, {} },
+        NoteEdit { b, {}, { AppendText { " ok" } }, {} },
+    };
+    const auto batch = store_.edit_many(edits);
+    ASSERT_EQ(batch.results.size(), edits.size());
+    EXPECT_TRUE(batch.results[0].has_value());
+    EXPECT_EQ(batch.results[1].error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(batch.results[2].error().code, ErrorCode::NotFound);
+    EXPECT_TRUE(batch.results[3].has_value());
+    EXPECT_EQ(batch.applied, 4);
+    EXPECT_EQ(batch.version, before + 1);
+    EXPECT_EQ(store_.version(), before + 1);
+
+    EXPECT_EQ(store_.get(a)->content, "alpha one two");
+    EXPECT_EQ(store_.get(a)->title, "A!");
+    EXPECT_EQ(store_.get(b)->content, "beta ok");
+    EXPECT_EQ(store_.get(c)->content, "> gamma");
+    EXPECT_EQ(store_.get(c)->updated, store_.get(a)->updated);
+    EXPECT_EQ(store_.get(b, snapshot)->content, "beta");
+    EXPECT_EQ(search({ text(NoteField::Content, TextMatchKind::Contains, "one two") }).size(), 1);
+    EXPECT_EQ(search({ text(NoteField::Tag, TextMatchKind::Matches, "edited") }).size(), 1);
+
+    const auto none = store_.edit_many(std::vector<NoteEdit> { NoteEdit { NoteId {}, {}, {}, {} } });
+    EXPECT_EQ(none.applied, 0);
+    EXPECT_EQ(none.version, before + 1);
+}
+
+TEST_F(NoteStoreTests, EqualBodiesAreStoredOnce) {
+    const auto body = std::string(4096, 'x');
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 10; ++i) {
+        ids.push_back(*store_.create(CreateNote { fmt::format("copy {}", i), body, std::nullopt }));
+    }
+    EXPECT_EQ(store_.blobs().size(), 1);
+    EXPECT_EQ(store_.blobs().bytes(), body.size());
+
+    // Title edits keep sharing the body; a content edit copies it.
+    ASSERT_TRUE(store_.update(UpdateNote { ids[0], "renamed", std::nullopt, std::nullopt }));
+    EXPECT_EQ(store_.blobs().size(), 1);
+    ASSERT_TRUE(store_.edit(NoteEdit { ids[1], {}, { AppendText { "y" } }, {} }));
+    EXPECT_EQ(store_.blobs().size(), 2);
+    EXPECT_EQ(store_.get(ids[1])->content, body + "y");
+    EXPECT_EQ(store_.get(ids[2])->content, body);
+    EXPECT_EQ(search({ text(NoteField::Content, TextMatchKind::Contains, "xxy") }), (std::vector<NoteOrdinal> { 1 }));
+
+    // Editing it back finds the shared blob again, and the copy goes once nothing can see it.
+    ASSERT_TRUE(store_.update(UpdateNote { ids[1], std::nullopt, body, std::nullopt }));
+    store_.collect_garbage();
+    store_.collect_garbage();
+    EXPECT_EQ(store_.blobs().size(), 1);
+    EXPECT_TRUE(search({ text(NoteField::Content, TextMatchKind::Contains, "xxy") }).empty());
+}
+
+TEST(NoteStoreChangeTests, OnChangeMayWriteToTheStore) {
+    NoteStore* store = nullptr;
+    auto changes = std::vector<NoteId> {};
+    auto log = std::optional<NoteId> {};
+    auto options = pg::store::StoreOptions {};
+    options.on_change = [&](NoteId id) {
+        changes.push_back(id);
+        // Runs once the writer lock is released, so the write below does not deadlock.
+        if (log && id != *log) {
+            const auto count = fmt::format("{}", changes.size());
+            ASSERT_TRUE(store->update(UpdateNote { *log, std::nullopt, count, std::nullopt }));
+        }
+    };
+    auto owned = NoteStore { std::move(options) };
+    store = &owned;
+    const auto id = *store->create(CreateNote { "note", "", std::nullopt });
+    log = *store->create(CreateNote { "log", "", std::nullopt });
+
+    ASSERT_TRUE(store->update(UpdateNote { id, "renamed", std::nullopt, std::nullopt }));
+    ASSERT_TRUE(store->remove(id));
+    EXPECT_EQ(changes, (std::vector<NoteId> { id, *log, id, *log }));
+    EXPECT_EQ(store->get(*log)->content, "3");
+}
+
+TEST(NoteStoreBatchTests, ParallelBatchesMatchOneEditAtATime) {
+    auto parallel = NoteStore { pg::store::StoreOptions { .write_threads = 4 } };
+    auto serial = NoteStore {};
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 500; ++i) {
+        const auto note = CreateNote { fmt::format("Note {}", i), fmt::format("body {}", i), std::nullopt };
+        ids.push_back(*parallel.create(note));
+        ASSERT_TRUE(serial.create(note, ids.back()));
+    }
+
+    auto edits = std::vector<NoteEdit> {};
+    for (int round = 0; round < 3; ++round) {
+        for (std::size_t i = 0; i < ids.size(); i += 1 + round) {
+            edits.push_back(NoteEdit { ids[i], {}, { AppendText { fmt::format(" r{}", round) } }, {} });
+        }
+    }
+    const auto batch = parallel.edit_many(edits);
+    EXPECT_EQ(batch.applied, edits.size());
+    for (const auto& edit : edits) {
+        ASSERT_TRUE(serial.edit(edit));
+    }
+    for (const auto id : ids) {
+        ASSERT_EQ(parallel.get(id)->content, serial.get(id)->content);
+    }
+    const auto query = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "r1 r2") }, 0 };
+    EXPECT_EQ(parallel.search(query).ordinals, serial.search(query).ordinals);
+}
+
+TEST(NoteStoreBulkLoadTests, BuiltIndexesMatchIncrementalOnes) {
+    const auto options = [] {
+        return pg::store::StoreOptions {
+            .write_threads = 4,
+            .compaction_threshold = 0,
+            .clock = [tick = std::make_shared<int>(0)] { return Timestamp { std::chrono::seconds { ++*tick } }; },
+        };
+    };
+    auto bulk = NoteStore { options() };
+    auto incremental = NoteStore { options() };
+    // The same writes go to both stores, so their notes are at the same ordinals with the same timestamps.
+    auto ids = std::vector<std::vector<NoteId>>(2);
+    const auto both = [&](auto write) {
+        write(bulk, ids[0]);
+        write(incremental, ids[1]);
+    };
+    both([](NoteStore& store, std::vector<NoteId>& written) {
+        for (int i = 0; i < 100; ++i) {
+            written.push_back(*store.create(CreateNote { fmt::format("Before {}", i), "loaded early", std::nullopt }));
+        }
+        ASSERT_TRUE(store.remove(written[3]));
+    });
+
+    bulk.begin_bulk_load();
+    EXPECT_TRUE(bulk.bulk_loading());
+    auto notes = std::vector<CreateNote> {};
+    for (int i = 0; i < 3000; ++i) {
+        notes.emplace_back(
+          fmt::format("Bulk {} {}", i, i % 3 == 0 ? "meeting" : "plan"),
+          fmt::format("loaded body {} {}", i, std::string(static_cast<std::size_t>(i % 4), 'x')),
+          std::vector<std::string> { fmt::format("mod-{}", i % 10), i % 2 == 0 ? "even" : "odd" });
+    }
+    both([&](NoteStore& store, std::vector<NoteId>& written) {
+        for (std::size_t first = 0; first < notes.size(); first += 1000) {
+            const auto created = store.create_many(std::span { notes }.subspan(first, 1000));
+            ASSERT_TRUE(created.has_value());
+            written.insert(written.end(), created->begin(), created->end());
+        }
+        ASSERT_TRUE(store.update(UpdateNote { written[0], "Renamed meeting", std::nullopt, std::nullopt }));
+        ASSERT_TRUE(store.remove(written[150]));
+        ASSERT_TRUE(store.remove(written[5]));
+        auto edits = std::vector<NoteEdit> {};
+        for (std::size_t i = 200; i < 2000; i += 7) {
+            edits.push_back(NoteEdit { written[i], {}, { AppendText { " edited" } }, {} });
+        }
+        EXPECT_EQ(store.edit_many(edits).applied, edits.size());
+    });
+
+    // Until the load ends, searches go by the indexes as they were, but never return what was removed since.
+    const auto early = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "early") }, 0 };
+    EXPECT_EQ(bulk.count(early), 98);
+    EXPECT_EQ(bulk.count(SearchQuery { { text(NoteField::Tag, TextMatchKind::Matches, "even") }, 0 }), 0);
+    EXPECT_EQ(bulk.get(ids[0][2000])->title, "Bulk 1900 plan");
+
+    EXPECT_EQ(bulk.end_bulk_load(), bulk.size());
+    EXPECT_FALSE(bulk.bulk_loading());
+    EXPECT_EQ(bulk.end_bulk_load(), 0);
+    EXPECT_EQ(bulk.tombstone_count(), 0);
+    EXPECT_TRUE(bulk.tombstones().empty());
+    both([](NoteStore& store, std::vector<NoteId>& written) {
+        written.push_back(*store.create(CreateNote { "After", "indexed as written", std::nullopt }));
+    });
+
+    const auto after = pg::store::DatePredicate { pg::store::DateMatchKind::After, Timestamp { 3000s }, {} };
+    const auto queries = std::vector<SearchQuery> {
+        early,
+        SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "edited") }, 0 },
+        SearchQuery { { text(NoteField::Title, TextMatchKind::Matches, "meeting") }, 0 },
+        SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "body 12") }, 0 },
+        SearchQuery { { text(NoteField::Title, TextMatchKind::Contains, "after") }, 0 },
+        SearchQuery { { text(NoteField::Tag, TextMatchKind::Matches, "mod-3") }, 0 },
+        SearchQuery { { Predicate { NoteField::Updated, after } }, 0 },
+        SearchQuery { .predicates = { text(NoteField::Content, TextMatchKind::Matches, "loaded xxx") },
+                      .limit = 50,
+                      .order = pg::store::SearchOrder::Relevance },
+    };
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        EXPECT_EQ(bulk.search(queries[i]).ordinals, incremental.search(queries[i]).ordinals) << "query " << i;
+        EXPECT_EQ(bulk.count(queries[i]), incremental.count(queries[i])) << "query " << i;
+        EXPECT_EQ(bulk.facets(queries[i], 5).tags, incremental.facets(queries[i], 5).tags) << "query " << i;
+    }
+    const auto list = pg::store::ListQuery { .limit = 5000 };
+    EXPECT_EQ(bulk.list(list).ordinals, incremental.list(list).ordinals);
+}
+
+TEST(NoteStoreCompactionTests, TombstonesAreMaskedUntilCompacted) {
+    auto store = NoteStore { pg::store::StoreOptions { .compaction_threshold = 0, .compaction_slice = 2 } };
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 6; ++i) {
+        const auto tags = std::vector<std::string> { i % 2 == 0 ? "even" : "odd" };
+        ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), "shared body", tags }));
+    }
+
+    const auto doomed = std::vector<NoteId> { ids[0], ids[2], ids[4], ids[2] };
+    const auto batch = store.remove_many(doomed);
+    EXPECT_EQ(batch.applied, 3);
+    EXPECT_EQ(batch.version, 7);
+    EXPECT_EQ(batch.results[3].error().code, ErrorCode::NotFound);
+    EXPECT_EQ(store.size(), 3);
+    EXPECT_EQ(store.tombstone_count(), 3);
+
+    // Still indexed, but never returned.
+    const auto by_body = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "shared") }, 0 };
+    const auto even = SearchQuery { { text(NoteField::Tag, TextMatchKind::Matches, "even") }, 0 };
+    EXPECT_TRUE(store.titles().indexed().test(0));
+    EXPECT_EQ(store.search(by_body).ordinals, (std::vector<NoteOrdinal> { 1, 3, 5 }));
+    EXPECT_TRUE(store.search(even).ordinals.empty());
+    EXPECT_EQ(store.list(pg::store::ListQuery {}).ordinals, (std::vector<NoteOrdinal> { 1, 3, 5 }));
+
+    EXPECT_EQ(store.compact(), 3);
+    EXPECT_EQ(store.tombstone_count(), 0);
+    EXPECT_TRUE(store.tombstones().empty());
+    EXPECT_FALSE(store.titles().indexed().test(0));
+    EXPECT_EQ(store.tags().notes_with("even"), nullptr);
+    EXPECT_EQ(store.created().all().to_bitmap().count(), 3);
+    EXPECT_EQ(store.search(by_body).ordinals, (std::vector<NoteOrdinal> { 1, 3, 5 }));
+    EXPECT_EQ(store.compact(), 0);
+}
+
+TEST(NoteStoreCompactionTests, CompactorWakesOnceThresholdIsCrossed) {
+    auto store = NoteStore { pg::store::StoreOptions { .compaction_threshold = 8, .compaction_pause = 0us } };
+    auto ids = std::vector<NoteId> {};
+    for (int i = 0; i < 16; ++i) {
+        ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), "", std::nullopt }));
+    }
+    for (int i = 0; i < 7; ++i) {
+        ASSERT_TRUE(store.remove(ids[i]));
+    }
+    EXPECT_EQ(store.tombstone_count(), 7);
+
+    ASSERT_TRUE(store.remove(ids[7]));
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (store.tombstone_count() != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(store.tombstone_count(), 0);
+    const auto lock = store.read_lock();
+    EXPECT_EQ(store.titles().indexed().count(), 8);
+}
+
+TEST(NoteStoreCompressionTests, ColdNotesAreCompressedAndReadTransparently) {
+    auto store = NoteStore { pg::store::StoreOptions {
+      .compaction_threshold = 0, .cold_after = 2, .compression_interval = 0ms, .compression_min_bytes = 16 } };
+    auto ids = std::vector<NoteId> {};
+    auto bodies = std::vector<std::string> {};
+    for (int i = 0; i < 40; ++i) {
+        bodies.push_back(fmt::format("note {} says the same thing every other note says, at length", i));
+        ids.push_back(*store.create(CreateNote { fmt::format("Note {}", i), bodies.back(), std::nullopt }));
+    }
+    EXPECT_EQ(store.compress_cold(), 0);
+    EXPECT_EQ(store.get(ids[0])->content, bodies[0]);
+
+    // Every note but the one just read has now gone two passes untouched.
+    {
+        const auto before = store.snapshot();
+        const auto old_view = store.peek(1, before);
+        EXPECT_EQ(store.compress_cold(), 39);
+        EXPECT_EQ(old_view->content, bodies[1]);
+    }
+    // The heads swapped out, and their blobs, go once nothing can see them.
+    EXPECT_EQ(store.version_count(), 79);
+    store.collect_garbage();
+    EXPECT_EQ(store.version_count(), 40);
+    EXPECT_EQ(store.blobs().size(), 1);
+    EXPECT_EQ(store.version(), 40);
+    for (int i = 0; i < 40; ++i) {
+        EXPECT_EQ(store.get(ids[i])->content, bodies[i]);
+    }
+    EXPECT_EQ(store.block_cache().misses(), 1);
+    EXPECT_EQ(
+      store.search(SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "note 17 says") }, 0 }).ordinals,
+      (std::vector<NoteOrdinal> { 17 }));
+
+    // A title change leaves the content compressed; a content edit gives the note its own copy again.
+    ASSERT_TRUE(store.update(UpdateNote { ids[2], "renamed", std::nullopt, std::nullopt }));
+    ASSERT_TRUE(store.edit(NoteEdit { ids[3], {}, { AppendText { "!" } }, {} }));
+    EXPECT_EQ(store.get(ids[2])->content, bodies[2]);
+    EXPECT_EQ(store.get(ids[3])->content, bodies[3] + "!");
+    EXPECT_EQ(store.blobs().size(), 2);
+    EXPECT_EQ(
+      store.search(SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "length!") }, 0 }).ordinals,
+      (std::vector<NoteOrdinal> { 3 }));
+
+    store.collect_garbage();
+    EXPECT_EQ(store.version_count(), 40);
+}
+
+TEST(NoteStoreSpillTests, ColdNotesAreSpilledAndPromotedOnRead) {
+    const auto directory = std::filesystem::temp_directory_path()
+                         / fmt::format("pg-spill-{}", std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        auto store = NoteStore { pg::store::StoreOptions {
+          .compaction_threshold = 0,
+          .cold_after = 1,
+          .compression_interval = 0ms,
+          .compression_min_bytes = 16,
+          .spill_directory = directory,
+          .spill_after = 2,
+        } };
+        auto ids = std::vector<NoteId> {};
+        auto bodies = std::vector<std::string> {};
+        for (int i = 0; i < 20; ++i) {
+            bodies.push_back(fmt::format("body {} of a note that is left alone long enough to be spilled", i));
+            ids.push_back(*store.create(
+              CreateNote { fmt::format("Note {}", i), bodies.back(), { { "common", fmt::format("n{}", i) } } }));
+        }
+        // Compressed after one untouched pass, spilled after two.
+        EXPECT_EQ(store.compress_cold(), 20);
+        EXPECT_EQ(store.spill_cold().value_or(0), 0);
+        EXPECT_EQ(store.compress_cold(), 0);
+        EXPECT_EQ(store.spill_cold().value_or(0), 20);
+        store.collect_garbage();
+        EXPECT_EQ(store.version_count(), 20);
+        EXPECT_EQ(store.blobs().size(), 0);
+        EXPECT_EQ(store.packed_bytes(), 0);
+        EXPECT_GT(store.cold_tier()->bytes(), 0);
+        // Segments are removed as soon as they are mapped.
+        EXPECT_TRUE(std::filesystem::is_empty(directory));
+
+        // Searches filter against the spilled records without promoting anything.
+        EXPECT_EQ(
+          store.search(SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "body 7 of") }, 0 }).ordinals,
+          (std::vector<NoteOrdinal> { 7 }));
+        EXPECT_EQ(store.blobs().size(), 0);
+
+        const auto note = store.get(ids[0]);
+        ASSERT_TRUE(note.has_value());
+        EXPECT_EQ(note->title, "Note 0");
+        EXPECT_EQ(note->content, bodies[0]);
+        EXPECT_EQ(note->tags, (std::vector<std::string> { "common", "n0" }));
+        // The read asked the maintenance thread to copy the note back to the heap, interning its body again.
+        for (int i = 0; i < 1000 && store.blobs().size() == 0; ++i) {
+            std::this_thread::sleep_for(1ms);
+        }
+        EXPECT_EQ(store.blobs().size(), 1);
+
+        // Writing to a spilled note copies it back as well.
+        ASSERT_TRUE(store.update(UpdateNote { ids[1], "renamed", std::nullopt, std::nullopt }));
+        EXPECT_EQ(store.get(ids[1])->title, "renamed");
+        EXPECT_EQ(store.get(ids[1])->content, bodies[1]);
+        EXPECT_EQ(store.get(ids[1])->tags, (std::vector<std::string> { "common", "n1" }));
+        ASSERT_TRUE(store.remove(ids[2]));
+        EXPECT_EQ(store.size(), 19);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+}  // namespace
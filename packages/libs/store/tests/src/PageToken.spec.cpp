@@ -0,0 +1,61 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <string>
+
+#include <fmt/format.h>
+
+#include <pg/store/PageToken.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::Cursor;
+using pg::store::decode_page_token;
+using pg::store::encode_page_token;
+using pg::store::ErrorCode;
+using pg::store::PageKind;
+using pg::store::RankingStats;
+
+TEST(PageTokenTests, RoundTrips) {
+    const auto cursors = { Cursor { 0, 0, 0 },
+                           Cursor { 42, -1, 7 },
+                           Cursor { 1ULL << 40, 1'660'000'000'123'456'789, 4'000'000'000 } };
+    for (const auto& cursor : cursors) {
+        const auto token = encode_page_token(PageKind::List, cursor, 0xDEADBEEF);
+        EXPECT_LE(token.size(), 35) << token;
+        EXPECT_EQ(token.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"),
+                  std::string::npos);
+        auto decoded = decode_page_token(token, PageKind::List, 0xDEADBEEF);
+        ASSERT_TRUE(decoded.has_value()) << decoded.error().message;
+        EXPECT_EQ(*decoded, cursor);
+    }
+}
+
+TEST(PageTokenTests, RoundTripsRankingStats) {
+    auto cursor = Cursor { 5, 4'600'000'000'000'000'000, 12 };
+    cursor.ranking = RankingStats { 1000, 3500, 250'000, { 3, 0, 999 } };
+    const auto token = encode_page_token(PageKind::Search, cursor, 77);
+    auto decoded = decode_page_token(token, PageKind::Search, 77);
+    ASSERT_TRUE(decoded.has_value()) << decoded.error().message;
+    EXPECT_EQ(*decoded, cursor);
+
+    // A token cut short in its statistics is no token.
+    EXPECT_TRUE(decode_page_token(token.substr(0, token.size() - 8), PageKind::Search, 77).has_error());
+}
+
+TEST(PageTokenTests, RejectsForeignAndDamagedTokens) {
+    const auto token = encode_page_token(PageKind::Search, Cursor { 3, 0, 9 }, 1234);
+    EXPECT_EQ(decode_page_token(token, PageKind::List, 1234).error().code, ErrorCode::InvalidArgument);
+    EXPECT_EQ(decode_page_token(token, PageKind::Search, 4321).error().code, ErrorCode::InvalidArgument);
+    EXPECT_TRUE(decode_page_token(token.substr(0, token.size() - 2), PageKind::Search, 1234).has_error());
+    EXPECT_TRUE(decode_page_token(token + "A", PageKind::Search, 1234).has_error());
+    EXPECT_TRUE(decode_page_token("not a token!", PageKind::Search, 1234).has_error());
+    EXPECT_TRUE(decode_page_token("", PageKind::Search, 1234).has_error());
+}
+
+}  // namespace
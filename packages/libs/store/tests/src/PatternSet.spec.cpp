@@ -0,0 +1,122 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pg/store/PatternSet.hpp>
+#include <pg/store/TextEdit.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::PatternSet;
+using Match = pg::store::PatternSet::Match;
+
+/// Leftmost-longest, non-overlapping matches, found the slow way.
+auto reference(std::string_view text, const std::vector<std::string_view>& patterns) -> std::vector<Match> {
+    auto found = std::vector<Match> {};
+    auto at = std::size_t { 0 };
+    while (at < text.size()) {
+        auto best = Match {};
+        auto any = false;
+        for (std::size_t p = 0; p < patterns.size(); ++p) {
+            if (text.substr(at).starts_with(patterns[p]) && (!any || patterns[p].size() > best.length)) {
+                best = Match { at, patterns[p].size(), p };
+                any = true;
+            }
+        }
+        if (any) {
+            found.push_back(best);
+            at += best.length;
+        } else {
+            ++at;
+        }
+    }
+    return found;
+}
+
+TEST(PatternSetTests, MatchesAreLeftmostLongestWithoutOverlaps) {
+    const auto patterns = std::vector<std::string_view> { "he", "she", "his", "hers", "he" };
+    const auto set = PatternSet::compile(patterns);
+    ASSERT_TRUE(set);
+    EXPECT_EQ(set->size(), 5);
+
+    // "ushers": "she" starts before "he" and "hers", so it wins and they are dropped.
+    EXPECT_EQ(set->matches("ushers"), (std::vector<Match> { { 1, 3, 1 } }));
+    // "hers" and "he" both start at 0; the longer one wins. The duplicate "he" reports its first index.
+    EXPECT_EQ(set->matches("hers he"), (std::vector<Match> { { 0, 4, 3 }, { 5, 2, 0 } }));
+    EXPECT_TRUE(set->matches("nothing to see").empty());
+
+    const auto replacements = std::vector<std::string_view> { "HE", "SHE", "HIS", "HERS", "unused" };
+    EXPECT_EQ(set->replace("she said his was hers", replacements), "SHE said HIS was HERS");
+}
+
+TEST(PatternSetTests, MatchesReferenceOnRandomText) {
+    auto rng = std::mt19937 { 3 };
+    const auto random_string = [&](std::size_t min, std::size_t max) {
+        auto text = std::string(std::uniform_int_distribution<std::size_t> { min, max }(rng), ' ');
+        for (auto& c : text) {
+            c = static_cast<char>('a' + rng() % 3);
+        }
+        return text;
+    };
+    for (int round = 0; round < 200; ++round) {
+        auto owned = std::vector<std::string> {};
+        for (int i = 0; i < 6; ++i) {
+            owned.push_back(random_string(1, 4));
+        }
+        const auto patterns = std::vector<std::string_view> { owned.begin(), owned.end() };
+        const auto text = random_string(0, 200);
+        const auto set = PatternSet::compile(patterns);
+        ASSERT_TRUE(set);
+        ASSERT_EQ(set->matches(text), reference(text, patterns)) << text;
+    }
+}
+
+TEST(PatternSetTests, EditsMatchEveryPatternInOnePass) {
+    // One pass: "a" becomes "b", but that "b" is not then turned into "c".
+    auto text = std::string { "abc abcd" };
+    const auto edits = std::vector<pg::store::TextEdit> {
+        pg::store::ReplaceTextMultiple { { { "a", "b" }, { "b", "c" }, { "abcd", "[all]" } } },
+        pg::store::RemoveTextMultiple { { "c", "]" } },
+    };
+    ASSERT_TRUE(pg::store::apply_edits(text, edits));
+    EXPECT_EQ(text, "b [all");
+
+    auto tags = std::vector<std::string> { "a", "b", "c" };
+    ASSERT_TRUE(pg::store::apply_tag_edits(tags, edits));
+    EXPECT_EQ(tags, (std::vector<std::string> { "b" }));
+
+    const auto empty = std::vector<pg::store::TextEdit> { pg::store::RemoveTextMultiple { { "x", "" } } };
+    EXPECT_FALSE(pg::store::apply_edits(text, empty));
+    EXPECT_FALSE(pg::store::apply_tag_edits(tags, empty));
+}
+
+TEST(PatternSetTests, CacheCompilesEachListOnce) {
+    auto cache = pg::store::PatternCache { 2 };
+    const auto first = std::vector<std::string_view> { "ab", "c" };
+    const auto second = std::vector<std::string_view> { "a", "bc" };
+    const auto third = std::vector<std::string_view> { "x" };
+
+    const auto set = cache.get(first);
+    ASSERT_TRUE(set);
+    EXPECT_EQ(*cache.get(first), *set);
+    EXPECT_NE(*cache.get(second), *set);
+    EXPECT_EQ(cache.hits(), 1);
+
+    // `first` is the least recently used, so `third` evicts it.
+    ASSERT_TRUE(cache.get(third));
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_NE(*cache.get(first), *set);
+    EXPECT_FALSE(cache.get(std::vector<std::string_view> { "" }));
+}
+
+}  // namespace
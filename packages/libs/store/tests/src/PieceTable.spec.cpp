@@ -0,0 +1,93 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/PieceTable.hpp>
+#include <pg/store/TextEdit.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::AppendText;
+using pg::store::InsertText;
+using pg::store::PieceTable;
+using pg::store::RemoveTextRange;
+using pg::store::ReplaceText;
+using pg::store::TextEdit;
+
+TEST(PieceTableTests, EditsSplitPiecesWithoutCopying) {
+    const auto original = std::string { "hello world" };
+    auto table = PieceTable { original };
+    EXPECT_EQ(table.pieces(), 1);
+
+    table.insert(5, ",");
+    table.append("!");
+    table.prepend(">> ");
+    EXPECT_EQ(table.str(), ">> hello, world!");
+    EXPECT_EQ(table.size(), 16);
+
+    table.erase(3, 9);
+    EXPECT_EQ(table.str(), ">>  world!");
+    table.erase(0, table.size());
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.pieces(), 0);
+
+    table.assign("fresh");
+    table.insert(0, "a ");
+    EXPECT_EQ(table.str(), "a fresh");
+    EXPECT_EQ(table.pieces(), 2);
+}
+
+TEST(PieceTableTests, MatchesStringUnderRandomEdits) {
+    auto rng = std::mt19937 { 7 };
+    auto expected = std::string(1000, 'x');
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        expected[i] = static_cast<char>('a' + i % 26);
+    }
+    const auto original = expected;
+    auto table = PieceTable { original };
+
+    for (int i = 0; i < 2000; ++i) {
+        const auto at = std::uniform_int_distribution<std::size_t> { 0, expected.size() }(rng);
+        if (rng() % 3 != 0 || expected.empty()) {
+            const auto text = fmt::format("<{}>", i);
+            expected.insert(at, text);
+            table.insert(at, text);
+        } else {
+            const auto end = std::min(expected.size(), at + rng() % 20);
+            const auto start = std::min(at, end);
+            expected.erase(start, end - start);
+            table.erase(start, end);
+        }
+        ASSERT_EQ(table.size(), expected.size());
+    }
+    EXPECT_EQ(table.str(), expected);
+}
+
+TEST(PieceTableTests, FailedEditListsLeaveTextUnchanged) {
+    auto text = std::string { "one two three" };
+    const auto edits = std::vector<TextEdit> {
+        InsertText { 3, "," },
+        ReplaceText { "two", "2" },
+        AppendText { "." },
+        RemoveTextRange { 0, 4 },
+    };
+    ASSERT_TRUE(pg::store::apply_edits(text, edits));
+    EXPECT_EQ(text, " 2 three.");
+
+    const auto bad = std::vector<TextEdit> { AppendText { "!" }, InsertText { 100, "?" } };
+    EXPECT_FALSE(pg::store::apply_edits(text, bad));
+    EXPECT_EQ(text, " 2 three.");
+}
+
+}  // namespace
@@ -0,0 +1,426 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/QueryPlanner.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::AccessPath;
+using pg::store::DateMatchKind;
+using pg::store::DatePredicate;
+using pg::store::NoteField;
+using pg::store::NoteId;
+using pg::store::NoteOrdinal;
+using pg::store::NoteStore;
+using pg::store::Predicate;
+using pg::store::QueryPlanner;
+using pg::store::SearchOrder;
+using pg::store::SearchQuery;
+using pg::store::StepMode;
+using pg::store::StoreOptions;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+using pg::store::Timestamp;
+
+auto text(NoteField field, TextMatchKind kind, std::string value, bool case_sensitive = false) -> Predicate {
+    return Predicate { field, TextPredicate { kind, std::move(value), case_sensitive } };
+}
+
+auto created(DateMatchKind kind, int start, int end = 0) -> Predicate {
+    return Predicate { NoteField::Created,
+                       DatePredicate { kind, Timestamp { std::chrono::seconds { start } },
+                                       Timestamp { std::chrono::seconds { end } } } };
+}
+
+/**
+ * Note `i` is created at second `i`, tagged "common" and, for every 100th note, "rare".
+ */
+auto make_store(std::size_t count, StoreOptions options = {}) -> std::unique_ptr<NoteStore> {
+    options.clock = [tick = std::make_shared<int>(0)] { return Timestamp { std::chrono::seconds { (*tick)++ } }; };
+    auto store = std::make_unique<NoteStore>(std::move(options));
+    for (std::size_t i = 0; i < count; ++i) {
+        auto tags = std::vector<std::string> { "common", fmt::format("group-{}", i % 7) };
+        if (i % 100 == 0) {
+            tags.emplace_back("rare");
+        }
+        auto id = store->create(CreateNote {
+          fmt::format("Note {}", i),
+          fmt::format("Body of note number {} with some filler text", i),
+          std::move(tags),
+        });
+        EXPECT_TRUE(id.has_value());
+    }
+    return store;
+}
+
+auto brute_force(const NoteStore& store, const std::vector<Predicate>& predicates) -> std::vector<NoteOrdinal> {
+    auto out = std::vector<NoteOrdinal> {};
+    const auto snapshot = store.snapshot();
+    for (NoteOrdinal i = 0; i < store.end_ordinal(); ++i) {
+        const auto note = store.at(i, snapshot);
+        if (note
+            && std::ranges::all_of(predicates, [&](const Predicate& predicate) { return predicate.test(*note); })) {
+            out.push_back(i);
+        }
+    }
+    return out;
+}
+
+TEST(QueryPlannerTests, MostSelectiveIndexDrives) {
+    auto store = make_store(2000);
+    auto query = SearchQuery {
+        { text(NoteField::Tag, TextMatchKind::Matches, "common", true),
+          text(NoteField::Tag, TextMatchKind::Matches, "rare", true) },
+        0,
+    };
+    auto result = store->search(query);
+    ASSERT_FALSE(result.plan.steps.empty());
+    EXPECT_EQ(result.plan.steps.front().mode, StepMode::Drive);
+    EXPECT_EQ(result.plan.steps.front().predicate, 1);
+    EXPECT_EQ(result.plan.steps.front().estimate, 20);
+    EXPECT_FALSE(result.plan.parallel_scan);
+    EXPECT_EQ(result.ordinals, brute_force(*store, query.predicates));
+}
+
+TEST(QueryPlannerTests, MatchesBruteForce) {
+    auto store = make_store(2000);
+    const auto queries = std::vector<std::vector<Predicate>> {
+        { text(NoteField::Title, TextMatchKind::EndsWith, "99") },
+        { text(NoteField::Title, TextMatchKind::StartsWith, "note 1"), created(DateMatchKind::After, 1500) },
+        { text(NoteField::Content, TextMatchKind::Contains, "number 12"),
+          text(NoteField::Tag, TextMatchKind::Contains, "group-3") },
+        { text(NoteField::Tag, TextMatchKind::Matches, "RARE"), created(DateMatchKind::NotInRange, 200, 1700) },
+        { created(DateMatchKind::InRange, 10, 20), text(NoteField::Title, TextMatchKind::Matches, "note 15") },
+        { created(DateMatchKind::Before, 50), text(NoteField::Title, TextMatchKind::Contains, "4") },
+        { text(NoteField::Title, TextMatchKind::Matches, "Note 7", true) },
+    };
+    for (const auto& predicates : queries) {
+        auto result = store->search(SearchQuery { predicates, 0 });
+        EXPECT_EQ(result.ordinals, brute_force(*store, predicates)) << result.plan.explain();
+        EXPECT_FALSE(result.truncated);
+    }
+}
+
+TEST(QueryPlannerTests, NothingIsBeforeOrAfterTheEndsOfTime) {
+    auto store = make_store(200);
+    const auto at = [](DateMatchKind kind, Timestamp start) {
+        return Predicate { NoteField::Created, DatePredicate { kind, start, Timestamp {} } };
+    };
+    for (const auto& predicate :
+         { at(DateMatchKind::Before, Timestamp::min()), at(DateMatchKind::After, Timestamp::max()) }) {
+        auto result = store->search(SearchQuery { { predicate }, 0 });
+        ASSERT_FALSE(result.plan.steps.empty());
+        EXPECT_EQ(result.plan.steps.front().estimate, 0) << result.plan.explain();
+        EXPECT_TRUE(result.ordinals.empty());
+    }
+}
+
+TEST(QueryPlannerTests, StopsOnceThePageIsFull) {
+    auto store = make_store(2000);
+    // "No" is too short for the trigram index, so it becomes a filter over the tag bitmap.
+    auto predicates = std::vector<Predicate> { text(NoteField::Tag, TextMatchKind::Matches, "common"),
+                                               text(NoteField::Title, TextMatchKind::StartsWith, "No") };
+    auto result = store->search(SearchQuery { predicates, 10 });
+
+    EXPECT_EQ(result.ordinals.size(), 10);
+    EXPECT_TRUE(result.truncated);
+    EXPECT_TRUE(result.plan.stopped_early);
+    const auto& filter = result.plan.steps.back();
+    ASSERT_EQ(filter.mode, StepMode::Filter);
+    EXPECT_LE(filter.rows_in, QueryPlanner::BATCH_SIZE);
+
+    auto all = brute_force(*store, predicates);
+    all.resize(10);
+    EXPECT_EQ(result.ordinals, all);
+}
+
+TEST(QueryPlannerTests, ScansInParallelWhenNoIndexApplies) {
+    auto options = StoreOptions { .index_content = false, .scan_threads = 4, .clock = {} };
+    auto store = make_store(3 * QueryPlanner::SCAN_CHUNK, std::move(options));
+    auto predicates = std::vector<Predicate> { text(NoteField::Content, TextMatchKind::Contains, "number 77") };
+
+    auto result = store->search(SearchQuery { predicates, 0 });
+    EXPECT_TRUE(result.plan.parallel_scan);
+    EXPECT_EQ(result.plan.threads, 3);
+    EXPECT_EQ(result.ordinals, brute_force(*store, predicates));
+
+    auto page = store->search(SearchQuery { predicates, 5 });
+    auto expected = brute_force(*store, predicates);
+    expected.resize(5);
+    EXPECT_EQ(page.ordinals, expected);
+    EXPECT_TRUE(page.truncated);
+}
+
+TEST(QueryPlannerTests, PagesResumeAfterTheCursor) {
+    auto store = make_store(1000);
+    auto predicates = std::vector<Predicate> { text(NoteField::Tag, TextMatchKind::Matches, "group-2") };
+    auto expected = brute_force(*store, predicates);
+
+    auto seen = std::vector<NoteOrdinal> {};
+    auto query = SearchQuery { predicates, 25 };
+    while (true) {
+        auto page = store->search(query);
+        seen.insert(seen.end(), page.ordinals.begin(), page.ordinals.end());
+        if (!page.next) {
+            break;
+        }
+        // Notes created mid-pagination belong to a later snapshot and must not show up.
+        ASSERT_TRUE(store->create(CreateNote { "late", "", std::vector<std::string> { "group-2" } }));
+        query.cursor = page.next;
+    }
+    EXPECT_EQ(seen, expected);
+}
+
+TEST(QueryPlannerTests, RelevanceRanksTheBestMatchesFirst) {
+    auto store = std::make_unique<NoteStore>(StoreOptions { .compaction_threshold = 0 });
+    const auto notes = std::vector<std::pair<std::string, std::string>> {
+        { "Weekly sync", "the meeting ran long and we talked about many things besides the agenda" },
+        { "Groceries", "milk and eggs" },
+        { "Meeting notes", "meeting about the next meeting" },
+        { "Ideas", "a meeting" },
+        { "Standup", "meeting meeting" },
+    };
+    for (const auto& [title, content] : notes) {
+        ASSERT_TRUE(store->create(CreateNote { title, content, std::nullopt }));
+    }
+
+    auto query = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "meeting") }, 2 };
+    query.order = SearchOrder::Relevance;
+    const auto first = store->search(query);
+    EXPECT_TRUE(first.plan.ranked);
+    EXPECT_EQ(first.ordinals, (std::vector<NoteOrdinal> { 2, 4 }));
+    ASSERT_EQ(first.scores.size(), 2);
+    EXPECT_GT(first.scores[0], first.scores[1]);
+    ASSERT_TRUE(first.next.has_value());
+    EXPECT_NE(first.plan.explain().find("ranked by relevance"), std::string::npos);
+
+    query.cursor = first.next;
+    const auto second = store->search(query);
+    EXPECT_EQ(second.ordinals, (std::vector<NoteOrdinal> { 3, 0 }));
+    EXPECT_FALSE(second.next.has_value());
+
+    // Without the term index, the same matches come back in ordinal order.
+    auto unranked = std::make_unique<NoteStore>(StoreOptions { .index_terms = false, .compaction_threshold = 0 });
+    for (const auto& [title, content] : notes) {
+        ASSERT_TRUE(unranked->create(CreateNote { title, content, std::nullopt }));
+    }
+    query.cursor.reset();
+    query.limit = 0;
+    const auto plain = unranked->search(query);
+    EXPECT_FALSE(plain.plan.ranked);
+    EXPECT_EQ(plain.ordinals, (std::vector<NoteOrdinal> { 0, 2, 3, 4 }));
+}
+
+TEST(QueryPlannerTests, RankedPagesResumeAfterTheCursor) {
+    auto store = make_store(300);
+    // "ote" is no word, so only "1" scores: note 1 uses it, every other match follows with a score of zero.
+    auto query = SearchQuery { { text(NoteField::Title, TextMatchKind::Contains, "ote 1") }, 0 };
+    query.order = SearchOrder::Relevance;
+    const auto all = store->search(query);
+    ASSERT_TRUE(all.plan.ranked);
+    ASSERT_GE(all.ordinals.size(), 2);
+    EXPECT_EQ(all.ordinals.front(), 1);
+    EXPECT_GT(all.scores.front(), 0.0);
+    EXPECT_EQ(all.scores[1], 0.0);
+    auto sorted = all.ordinals;
+    std::ranges::sort(sorted);
+    EXPECT_EQ(sorted, brute_force(*store, query.predicates));
+
+    auto seen = std::vector<NoteOrdinal> {};
+    query.limit = 7;
+    while (true) {
+        auto page = store->search(query);
+        seen.insert(seen.end(), page.ordinals.begin(), page.ordinals.end());
+        if (!page.next) {
+            break;
+        }
+        query.cursor = page.next;
+    }
+    EXPECT_EQ(seen, all.ordinals);
+}
+
+TEST(QueryPlannerTests, RankedPagesScoreAgainstTheFirstPage) {
+    auto store = std::make_unique<NoteStore>(StoreOptions { .compaction_threshold = 0 });
+    // Every note uses both words, which score the same until "beta" becomes the more common of the two.
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(store->create(CreateNote { "", "alpha beta beta beta", std::nullopt }));
+    }
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(store->create(CreateNote { "", "alpha alpha alpha beta", std::nullopt }));
+    }
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(store->create(CreateNote { "", "gamma", std::nullopt }));
+    }
+
+    auto query = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "alpha beta") }, 0 };
+    query.order = SearchOrder::Relevance;
+    const auto all = store->search(query);
+    ASSERT_EQ(all.ordinals.size(), 10);
+
+    auto seen = std::vector<NoteOrdinal> {};
+    query.limit = 3;
+    while (true) {
+        auto page = store->search(query);
+        seen.insert(seen.end(), page.ordinals.begin(), page.ordinals.end());
+        if (!page.next) {
+            break;
+        }
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_TRUE(store->create(CreateNote { "", "beta", std::nullopt }));
+        }
+        query.cursor = page.next;
+    }
+    EXPECT_EQ(seen, all.ordinals);
+}
+
+TEST(QueryPlannerTests, LaterRankedPagesResumeFromTheCachedRanking) {
+    auto store = std::make_unique<NoteStore>(StoreOptions { .compaction_threshold = 0 });
+    for (std::size_t i = 0; i < 400; ++i) {
+        auto content = std::string {};
+        for (std::size_t word = 0; word <= i % 7; ++word) {
+            content += "meeting ";
+        }
+        content += std::string(i % 13, 'x');
+        ASSERT_TRUE(store->create(CreateNote { fmt::format("Note {}", i), content, std::nullopt }));
+    }
+
+    auto query = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "meeting") }, 0 };
+    query.order = SearchOrder::Relevance;
+    const auto all = store->search(query);
+
+    auto seen = std::vector<NoteOrdinal> {};
+    auto scoring = std::size_t { 0 };
+    auto pages = std::size_t { 0 };
+    query.limit = 10;
+    while (true) {
+        auto page = store->search(query);
+        seen.insert(seen.end(), page.ordinals.begin(), page.ordinals.end());
+        scoring += page.plan.scored != 0 ? 1 : 0;
+        ++pages;
+        if (!page.next) {
+            break;
+        }
+        query.cursor = page.next;
+    }
+    EXPECT_EQ(seen, all.ordinals);
+    EXPECT_EQ(pages, 40);
+    // Only pages running past the end of the cached ranking score anything, and each of those doubles it.
+    EXPECT_LE(scoring, 7);
+}
+
+TEST(QueryPlannerTests, CachedRankingsAreFilteredAgain) {
+    auto store = std::make_unique<NoteStore>(StoreOptions { .compaction_threshold = 0 });
+    auto ids = std::vector<NoteId> {};
+    for (std::size_t i = 0; i < 400; ++i) {
+        const auto content = std::string(i % 11 + 1, 'x') + " meeting";
+        ids.push_back(*store->create(CreateNote { fmt::format("Note {}", i), content, std::nullopt }));
+    }
+
+    // "0" is too short for the trigram index, so the title predicate is only ever a filter.
+    auto query = SearchQuery { { text(NoteField::Content, TextMatchKind::Contains, "meeting"),
+                                 text(NoteField::Title, TextMatchKind::EndsWith, "0") },
+                               0 };
+    query.order = SearchOrder::Relevance;
+    auto expected = store->search(query).ordinals;
+    ASSERT_EQ(expected.size(), 40);
+
+    // After every page, the match two places past it is renamed out of the results, by then usually into a cached
+    // ranking deep enough to serve the next page.
+    auto seen = std::vector<NoteOrdinal> {};
+    query.limit = 3;
+    while (true) {
+        auto page = store->search(query);
+        seen.insert(seen.end(), page.ordinals.begin(), page.ordinals.end());
+        if (!page.next) {
+            break;
+        }
+        if (seen.size() + 1 < expected.size()) {
+            const auto renamed = expected[seen.size() + 1];
+            ASSERT_TRUE(store->update(UpdateNote { ids[renamed], "Renamed", std::nullopt, std::nullopt }));
+            expected.erase(expected.begin() + static_cast<std::ptrdiff_t>(seen.size() + 1));
+        }
+        query.cursor = page.next;
+    }
+    EXPECT_EQ(seen, expected);
+}
+
+TEST(QueryPlannerTests, FacetsOfUntaggedNotesAreEmpty) {
+    auto store = std::make_unique<NoteStore>(StoreOptions { .scan_threads = 4, .compaction_threshold = 0 });
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(store->create(CreateNote { fmt::format("Note {}", i), "untagged", std::nullopt }));
+    }
+    const auto facets = store->facets(SearchQuery {}, 5);
+    EXPECT_EQ(facets.matches, 10);
+    EXPECT_TRUE(facets.tags.empty());
+}
+
+TEST(QueryPlannerTests, CountsAndFacetsMatchBruteForce) {
+    auto store = make_store(2000, StoreOptions { .scan_threads = 4 });
+    const auto queries = std::vector<std::vector<Predicate>> {
+        {},
+        { text(NoteField::Tag, TextMatchKind::Matches, "group-3") },
+        { text(NoteField::Title, TextMatchKind::EndsWith, "0"), created(DateMatchKind::Before, 1200) },
+        { text(NoteField::Content, TextMatchKind::Contains, "number 1") },
+    };
+    for (const auto& predicates : queries) {
+        const auto expected = brute_force(*store, predicates);
+        const auto query = SearchQuery { predicates, 1 };
+        EXPECT_EQ(store->count(query), expected.size());
+
+        auto counts = std::map<std::string, std::size_t, std::less<>> {};
+        const auto snapshot = store->snapshot();
+        for (auto ordinal : expected) {
+            const auto note = store->at(ordinal, snapshot);
+            for (auto tag : note->tags) {
+                ++counts[std::string { tag }];
+            }
+        }
+        auto best = std::vector<std::pair<std::string, std::size_t>> { counts.begin(), counts.end() };
+        std::ranges::stable_sort(best, std::greater {}, &std::pair<std::string, std::size_t>::second);
+        best.resize(std::min<std::size_t>(best.size(), 3));
+
+        const auto facets = store->facets(query, 3);
+        EXPECT_EQ(facets.matches, expected.size());
+        ASSERT_EQ(facets.tags.size(), best.size());
+        for (std::size_t i = 0; i < best.size(); ++i) {
+            EXPECT_EQ(facets.tags[i].tag, best[i].first);
+            EXPECT_EQ(facets.tags[i].count, best[i].second);
+        }
+    }
+}
+
+TEST(QueryPlannerTests, ExplainShowsEveryStep) {
+    auto store = make_store(500);
+    auto result = store->search(SearchQuery {
+      { text(NoteField::Tag, TextMatchKind::Matches, "rare", true),
+        text(NoteField::Title, TextMatchKind::Contains, "note") },
+      50,
+    });
+    const auto explain = result.plan.explain();
+    EXPECT_NE(explain.find("drive"), std::string::npos) << explain;
+    EXPECT_NE(explain.find("tag index"), std::string::npos) << explain;
+    EXPECT_NE(explain.find("title contains \"note\""), std::string::npos) << explain;
+    EXPECT_NE(explain.find("returned 5 note(s)"), std::string::npos) << explain;
+    EXPECT_EQ(result.plan.steps.front().path, AccessPath::TagIndex);
+}
+
+}  // namespace
@@ -0,0 +1,50 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <pg/store/RadixSort.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::radix_sort;
+
+TEST(RadixSortTests, MatchesAStableSortOnTheKeyBits) {
+    auto random = std::mt19937_64 { 7 };
+    for (const auto bits : { 8U, 24U, 40U, 64U }) {
+        auto items = std::vector<std::pair<std::uint64_t, int>> {};
+        for (int i = 0; i < 20000; ++i) {
+            // Few distinct keys, so that stability is put to the test.
+            items.emplace_back(random() % 512 * 0x0101010101010101ULL, i);
+        }
+        const auto key_of = [bits](const std::pair<std::uint64_t, int>& item) {
+            return bits == 64 ? item.first : item.first & ((std::uint64_t { 1 } << bits) - 1);
+        };
+        auto expected = items;
+        std::ranges::stable_sort(expected, [&](const auto& lhs, const auto& rhs) { return key_of(lhs) < key_of(rhs); });
+
+        radix_sort(items, [](const std::pair<std::uint64_t, int>& item) { return item.first; }, bits);
+        EXPECT_EQ(items, expected) << bits << " bits";
+    }
+}
+
+TEST(RadixSortTests, SkipsDigitsEveryItemShares) {
+    auto items = std::vector<std::uint64_t> { 0x500000003, 0x500000001, 0x500000002 };
+    radix_sort(items, [](std::uint64_t item) { return item; }, 64);
+    EXPECT_EQ(items, (std::vector<std::uint64_t> { 0x500000001, 0x500000002, 0x500000003 }));
+
+    auto empty = std::vector<std::uint64_t> {};
+    radix_sort(empty, [](std::uint64_t item) { return item; }, 64);
+    EXPECT_TRUE(empty.empty());
+}
+
+}  // namespace
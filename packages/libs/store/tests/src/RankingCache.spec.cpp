@@ -0,0 +1,50 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <memory>
+
+#include <pg/store/RankingCache.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::RankingCache;
+using pg::store::ScoredNote;
+
+auto ranking(double score) -> RankingCache::Entry {
+    return std::make_shared<const RankingCache::Ranking>(RankingCache::Ranking { { ScoredNote { 1, score } }, true });
+}
+
+TEST(RankingCacheTests, HitsOnlyForTheQueryAndVersionCached) {
+    auto cache = RankingCache {};
+    const auto entry = ranking(2.0);
+    EXPECT_EQ(cache.find("title contains \"a\"\n", 3), nullptr);
+    cache.insert("title contains \"a\"\n", 3, entry);
+    EXPECT_EQ(cache.find("title contains \"a\"\n", 3), entry);
+    EXPECT_EQ(cache.find("title contains \"a\"\n", 4), nullptr);
+    EXPECT_EQ(cache.find("title contains \"b\"\n", 3), nullptr);
+
+    // A deeper ranking of the same query replaces the one cached.
+    const auto deeper = ranking(1.0);
+    cache.insert("title contains \"a\"\n", 3, deeper);
+    EXPECT_EQ(cache.find("title contains \"a\"\n", 3), deeper);
+    EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(RankingCacheTests, EvictsTheLeastRecentlyUsed) {
+    auto cache = RankingCache { 2 };
+    cache.insert("a", 1, ranking(1.0));
+    cache.insert("b", 1, ranking(1.0));
+    EXPECT_NE(cache.find("a", 1), nullptr);
+    cache.insert("c", 1, ranking(1.0));
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_NE(cache.find("a", 1), nullptr);
+    EXPECT_EQ(cache.find("b", 1), nullptr);
+    EXPECT_NE(cache.find("c", 1), nullptr);
+}
+
+}  // namespace
@@ -0,0 +1,138 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <pg/store/IdGenerator.hpp>
+#include <pg/store/Messages.hpp>
+#include <pg/store/NoteStore.hpp>
+#include <pg/store/ResponseCache.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::ErrorCode;
+using pg::store::generate_note_id;
+using pg::store::NoteId;
+using pg::store::NoteStore;
+using pg::store::ResponseCache;
+using pg::store::serve_get_note;
+using pg::store::messages::decode_get_response;
+using pg::store::messages::encode_get_request;
+
+auto buffer(std::size_t size) -> ResponseCache::Buffer {
+    return std::make_shared<const std::vector<std::uint8_t>>(size, std::uint8_t { 0 });
+}
+
+TEST(ResponseCacheTests, HitsOnlyForTheVersionCached) {
+    auto cache = ResponseCache { 1024, 1 };
+    const auto id = generate_note_id();
+    const auto response = buffer(100);
+
+    EXPECT_EQ(cache.find(id, 1), nullptr);
+    cache.insert(id, 1, response);
+    // Handed out as is, without a copy.
+    EXPECT_EQ(cache.find(id, 1), response);
+    EXPECT_EQ(cache.find(id, 2), nullptr);
+
+    // A newer version replaces the older one, which an update racing a slower reader cannot bring back.
+    cache.insert(id, 2, buffer(50));
+    cache.insert(id, 1, response);
+    EXPECT_EQ(cache.find(id, 1), nullptr);
+    EXPECT_NE(cache.find(id, 2), nullptr);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_EQ(stats.bytes, 50);
+    EXPECT_DOUBLE_EQ(stats.hit_rate(), 0.4);
+
+    cache.erase(id);
+    EXPECT_EQ(cache.stats().entries, 0);
+    EXPECT_EQ(cache.stats().bytes, 0);
+}
+
+TEST(ResponseCacheTests, EvictsEntriesNotReferencedSinceTheLastSweep) {
+    auto cache = ResponseCache { 300, 1 };
+    const auto ids = std::vector { generate_note_id(), generate_note_id(), generate_note_id(), generate_note_id() };
+    for (std::size_t i = 0; i < 3; ++i) {
+        cache.insert(ids[i], 1, buffer(100));
+    }
+    ASSERT_NE(cache.find(ids[0], 1), nullptr);
+
+    cache.insert(ids[3], 1, buffer(100));
+    EXPECT_NE(cache.find(ids[0], 1), nullptr);
+    EXPECT_EQ(cache.find(ids[1], 1), nullptr);
+    EXPECT_NE(cache.find(ids[2], 1), nullptr);
+    EXPECT_NE(cache.find(ids[3], 1), nullptr);
+    EXPECT_EQ(cache.stats().bytes, 300);
+
+    // Too large for the shard.
+    cache.insert(ids[1], 1, buffer(301));
+    EXPECT_EQ(cache.find(ids[1], 1), nullptr);
+}
+
+TEST(ResponseCacheTests, ServesGetNoteUntilTheNoteChanges) {
+    auto store = NoteStore { pg::store::StoreOptions { .compaction_threshold = 0 } };
+    auto cache = ResponseCache { 1 << 20 };
+    const auto id = *store.create(CreateNote { "Shopping", "milk, eggs", std::vector<std::string> { "home" } });
+    const auto request = encode_get_request(id);
+
+    const auto first = serve_get_note(store, cache, request);
+    EXPECT_EQ(serve_get_note(store, cache, request), first);
+    const auto note = decode_get_response(*first);
+    ASSERT_TRUE(note.has_value());
+    EXPECT_EQ(note->id, id);
+    EXPECT_EQ(note->title, "Shopping");
+    EXPECT_EQ(note->content, "milk, eggs");
+    EXPECT_EQ(note->tags, std::vector<std::string> { "home" });
+
+    ASSERT_TRUE(store.update(UpdateNote { id, "Groceries", std::nullopt, std::nullopt }));
+    const auto updated = serve_get_note(store, cache, request);
+    EXPECT_NE(updated, first);
+    EXPECT_EQ(decode_get_response(*updated)->title, "Groceries");
+    EXPECT_EQ(cache.stats().entries, 1);
+
+    ASSERT_TRUE(store.remove(id));
+    const auto missing = decode_get_response(*serve_get_note(store, cache, request));
+    ASSERT_FALSE(missing.has_value());
+    EXPECT_EQ(missing.error().code, ErrorCode::NotFound);
+    EXPECT_EQ(cache.stats().entries, 0);
+    EXPECT_EQ(cache.stats().hits, 1);
+}
+
+TEST(ResponseCacheTests, DropsANoteAsSoonAsTheStoreChangesIt) {
+    auto cache = ResponseCache { 1 << 20 };
+    auto store = NoteStore { pg::store::StoreOptions {
+      .compaction_threshold = 0, .on_change = [&cache](NoteId id) { cache.erase(id); } } };
+    const auto first = *store.create(CreateNote { "Shopping", "milk", std::vector<std::string> {} });
+    const auto second = *store.create(CreateNote { "Chores", "dishes", std::vector<std::string> {} });
+    const auto warm = [&] {
+        for (const auto id : { first, second }) {
+            (void) serve_get_note(store, cache, encode_get_request(id));
+        }
+    };
+
+    warm();
+    EXPECT_EQ(cache.stats().entries, 2);
+    ASSERT_TRUE(store.update(UpdateNote { first, "Groceries", std::nullopt, std::nullopt }));
+    EXPECT_EQ(cache.stats().entries, 1);
+    (void) serve_get_note(store, cache, encode_get_request(second));
+    EXPECT_EQ(cache.stats().hits, 1);
+
+    warm();
+    const auto ids = std::vector<NoteId> { first, second };
+    EXPECT_EQ(store.remove_many(ids).applied, 2);
+    EXPECT_EQ(cache.stats().entries, 0);
+}
+
+}  // namespace
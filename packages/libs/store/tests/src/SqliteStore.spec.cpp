@@ -0,0 +1,182 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/SqliteStore.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::data::CreateNote;
+using pg::data::UpdateNote;
+using pg::store::DateMatchKind;
+using pg::store::DatePredicate;
+using pg::store::ErrorCode;
+using pg::store::NoteField;
+using pg::store::NoteId;
+using pg::store::Predicate;
+using pg::store::SearchQuery;
+using pg::store::SqliteOptions;
+using pg::store::SqliteStore;
+using pg::store::TextMatchKind;
+using pg::store::TextPredicate;
+using pg::store::Timestamp;
+using pg::store::test::TempDirectory;
+using pg::store::test::ticking_clock;
+
+class SqliteStoreTests: public ::testing::Test {
+  protected:
+    auto open() -> std::unique_ptr<SqliteStore> {
+        auto options = SqliteOptions {};
+        options.clock = clock_;
+        auto store = SqliteStore::open(directory_ / "notes.db", std::move(options));
+        EXPECT_TRUE(store.has_value());
+        return store ? std::move(*store) : nullptr;
+    }
+
+    TempDirectory directory_ { "sqlite" };
+    std::function<Timestamp()> clock_ = ticking_clock();
+};
+
+TEST_F(SqliteStoreTests, BatchesPersistAcrossReopening) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    const auto notes = std::vector<CreateNote> {
+        CreateNote { "Shopping", "milk", std::vector<std::string> { "home", "errands" } },
+        CreateNote { "Work", "standup", std::nullopt },
+        CreateNote { "Old", "", std::nullopt },
+    };
+    const auto ids = store->create(notes);
+    ASSERT_TRUE(ids.has_value());
+    ASSERT_EQ(ids->size(), 3);
+
+    const auto updates = std::vector<UpdateNote> {
+        UpdateNote { (*ids)[0], "Shopping list", std::nullopt, std::vector<std::string> { "errands" } },
+        UpdateNote { (*ids)[1], std::nullopt, "retro", std::nullopt },
+    };
+    ASSERT_TRUE(store->update(updates).has_value());
+    ASSERT_TRUE(store->remove(std::vector<NoteId> { (*ids)[2] }).has_value());
+    store.reset();
+
+    store = open();
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(*store->size(), 2);
+    const auto shopping = *store->get((*ids)[0]);
+    ASSERT_TRUE(shopping.has_value());
+    EXPECT_EQ(shopping->title, "Shopping list");
+    EXPECT_EQ(shopping->content, "milk");
+    EXPECT_EQ(shopping->tags, std::vector<std::string> { "errands" });
+    EXPECT_EQ(shopping->created, Timestamp { 1s });
+    EXPECT_EQ(shopping->updated, Timestamp { 2s });
+    EXPECT_EQ((*store->get((*ids)[1]))->content, "retro");
+    EXPECT_FALSE(store->get((*ids)[2])->has_value());
+}
+
+TEST_F(SqliteStoreTests, FailedBatchesChangeNothing) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    const auto ids = store->create(std::vector<CreateNote> { CreateNote { "Kept", "", std::nullopt } });
+    ASSERT_TRUE(ids.has_value());
+
+    const auto missing = NoteId {};
+    const auto updates = std::vector<UpdateNote> {
+        UpdateNote { ids->front(), "Changed", std::nullopt, std::nullopt },
+        UpdateNote { missing, "Nowhere", std::nullopt, std::nullopt },
+    };
+    EXPECT_EQ(store->update(updates).error().code, ErrorCode::NotFound);
+    EXPECT_EQ(store->remove(std::vector<NoteId> { ids->front(), missing }).error().code, ErrorCode::NotFound);
+    EXPECT_EQ((*store->get(ids->front()))->title, "Kept");
+    EXPECT_EQ(*store->size(), 1);
+}
+
+TEST_F(SqliteStoreTests, SearchTestsEveryPredicateOnTopOfTheIndexedOne) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    auto notes = std::vector<CreateNote> {};
+    for (int i = 0; i < 20; ++i) {
+        auto tags = std::vector<std::string> { i % 2 == 0 ? "even" : "odd" };
+        notes.emplace_back(fmt::format("Note {}", i), "", std::move(tags));
+    }
+    // One note per batch, so each gets its own timestamp.
+    for (const auto& note : notes) {
+        ASSERT_TRUE(store->create(std::vector<CreateNote> { note }).has_value());
+    }
+
+    const auto even = Predicate { NoteField::Tag, TextPredicate { TextMatchKind::Matches, "even", true } };
+    const auto teens = Predicate { NoteField::Title, TextPredicate { TextMatchKind::StartsWith, "Note 1", true } };
+    auto found = store->search(SearchQuery { { even, teens }, 0, std::nullopt });
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->size(), 5);
+    EXPECT_EQ(found->front().title, "Note 10");
+
+    const auto early = Predicate { NoteField::Created, DatePredicate { DateMatchKind::Before, Timestamp { 4s }, {} } };
+    found = store->search(SearchQuery { { early }, 0, std::nullopt });
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(found->size(), 3);
+    EXPECT_EQ(found->back().title, "Note 2");
+
+    found = store->search(SearchQuery { {}, 4, std::nullopt });
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->size(), 4);
+}
+
+TEST_F(SqliteStoreTests, SearchReadsPastTheFirstBatch) {
+    auto store = open();
+    ASSERT_NE(store, nullptr);
+    // One batch, so every note shares a timestamp and only the id orders them.
+    auto notes = std::vector<CreateNote> {};
+    for (int i = 0; i < 600; ++i) {
+        auto tags = std::vector<std::string> { i % 2 == 0 ? "even" : "odd", fmt::format("n{}", i) };
+        notes.emplace_back(fmt::format("Note {}", i), "", std::move(tags));
+    }
+    ASSERT_TRUE(store->create(notes).has_value());
+
+    auto all = store->search(SearchQuery { {}, 0, std::nullopt });
+    ASSERT_TRUE(all.has_value());
+    ASSERT_EQ(all->size(), 600);
+    auto titles = std::set<std::string> {};
+    for (const auto& note : *all) {
+        ASSERT_EQ(note.tags.size(), 2);
+        EXPECT_EQ(note.title, fmt::format("Note {}", note.tags[1].substr(1)));
+        titles.insert(note.title);
+    }
+    EXPECT_EQ(titles.size(), 600);
+
+    const auto even = Predicate { NoteField::Tag, TextPredicate { TextMatchKind::Matches, "even", true } };
+    const auto found = store->search(SearchQuery { { even }, 0, std::nullopt });
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->size(), 300);
+    const auto page = store->search(SearchQuery { { even }, 10, std::nullopt });
+    ASSERT_TRUE(page.has_value());
+    ASSERT_EQ(page->size(), 10);
+    EXPECT_EQ(page->back().id, (*found)[9].id);
+
+    // Pages along `updated` rather than `created`.
+    const auto recent = Predicate { NoteField::Updated, DatePredicate { DateMatchKind::After, Timestamp {}, {} } };
+    const auto updated = store->search(SearchQuery { { recent }, 0, std::nullopt });
+    ASSERT_TRUE(updated.has_value());
+    ASSERT_EQ(updated->size(), 600);
+    auto ids = std::set<NoteId> {};
+    for (const auto& note : *updated) {
+        ids.insert(note.id);
+    }
+    EXPECT_EQ(ids.size(), 600);
+}
+
+}  // namespace
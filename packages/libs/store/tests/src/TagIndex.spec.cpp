@@ -0,0 +1,106 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/TagIndex.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::Bitmap;
+using pg::store::NoteOrdinal;
+using pg::store::TagFacet;
+using pg::store::TagIndex;
+
+constexpr auto EVERYTHING = std::numeric_limits<std::size_t>::max();
+
+/**
+ * Every facet of `notes`, counted one note at a time, most first and ties by tag.
+ */
+auto brute_force(const TagIndex& index, const Bitmap& notes) -> std::vector<TagFacet> {
+    auto out = std::vector<TagFacet> {};
+    index.for_each([&](std::string_view tag, const Bitmap& tagged, std::size_t /*count*/) {
+        auto count = std::size_t { 0 };
+        notes.for_each([&](NoteOrdinal ordinal) { count += tagged.test(ordinal) ? 1 : 0; });
+        if (count > 0) {
+            out.push_back(TagFacet { std::string { tag }, count });
+        }
+    });
+    std::ranges::sort(out, [](const TagFacet& lhs, const TagFacet& rhs) {
+        return lhs.count != rhs.count ? lhs.count > rhs.count : lhs.tag < rhs.tag;
+    });
+    return out;
+}
+
+TEST(TagIndexTests, FacetsCountTheTagsOfASet) {
+    auto index = TagIndex {};
+    index.add(0, std::vector<std::string> { "work", "urgent" });
+    index.add(1, std::vector<std::string> { "work" });
+    index.add(2, std::vector<std::string> { "home", "urgent" });
+    index.add(3, std::vector<std::string> { "home" });
+    index.add(4, std::vector<std::string> { "archive" });
+
+    auto notes = Bitmap {};
+    notes.set(0);
+    notes.set(2);
+    notes.set(3);
+    EXPECT_EQ(
+      index.facets(notes, EVERYTHING),
+      (std::vector<TagFacet> { { "home", 2 }, { "urgent", 2 }, { "work", 1 } }));
+    EXPECT_EQ(index.facets(notes, 1), (std::vector<TagFacet> { { "home", 2 } }));
+    EXPECT_TRUE(index.facets(notes, 0).empty());
+    EXPECT_TRUE(index.facets(Bitmap {}, EVERYTHING).empty());
+}
+
+TEST(TagIndexTests, ParallelFacetsMatchBruteForce) {
+    auto index = TagIndex {};
+    for (NoteOrdinal i = 0; i < 5000; ++i) {
+        auto tags = std::vector<std::string> { fmt::format("mod-{}", i % 500), fmt::format("bucket-{}", i / 1000) };
+        if (i % 3 == 0) {
+            tags.emplace_back("third");
+        }
+        index.add(i, tags);
+    }
+    auto notes = Bitmap {};
+    for (NoteOrdinal i = 0; i < 5000; i += 7) {
+        notes.set(i);
+    }
+
+    const auto expected = brute_force(index, notes);
+    for (const auto limit : { std::size_t { 1 }, std::size_t { 10 }, std::size_t { 200 }, EVERYTHING }) {
+        auto top = expected;
+        top.resize(std::min(limit, top.size()));
+        for (const auto threads : { std::size_t { 1 }, std::size_t { 4 } }) {
+            EXPECT_EQ(index.facets(notes, limit, threads), top) << "limit " << limit << ", threads " << threads;
+        }
+    }
+}
+
+TEST(TagIndexTests, BuildMatchesAddingOneAtATime) {
+    auto added = TagIndex {};
+    auto parts = std::vector<TagIndex::Builder>(3);
+    auto notes = Bitmap {};
+    for (NoteOrdinal i = 0; i < 3000; ++i) {
+        const auto tags = std::vector<std::string> { fmt::format("mod-{}", i % 50), i % 2 == 0 ? "even" : "odd" };
+        added.add(i, tags);
+        parts[i / 1000].add(i, tags);
+        notes.set(i);
+    }
+
+    const auto built = TagIndex::build(parts);
+    EXPECT_EQ(built.facets(notes, EVERYTHING), added.facets(notes, EVERYTHING));
+    EXPECT_EQ(brute_force(built, notes), brute_force(added, notes));
+}
+
+}  // namespace
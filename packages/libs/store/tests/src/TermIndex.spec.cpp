@@ -0,0 +1,177 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/TermIndex.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::Bitmap;
+using pg::store::Bm25;
+using pg::store::NoteOrdinal;
+using pg::store::ScoredNote;
+using pg::store::TermIndex;
+
+constexpr auto EVERYTHING = std::numeric_limits<std::size_t>::max();
+
+auto accept_all(const ScoredNote& /*note*/) -> bool {
+    return true;
+}
+
+auto ordinals_of(const TermIndex::Ranking& ranking) -> std::vector<NoteOrdinal> {
+    auto out = std::vector<NoteOrdinal> {};
+    for (const auto& note : ranking.notes) {
+        out.push_back(note.ordinal);
+    }
+    return out;
+}
+
+TEST(TermIndexTests, TermsAreFoldedWordsWithCounts) {
+    const auto terms = TermIndex::terms_of("Meeting, meeting; MEETING notes-2022 café");
+    ASSERT_EQ(terms.size(), 4);
+    EXPECT_EQ(TermIndex::terms_of("meeting").front().term, TermIndex::terms_of("Meeting").front().term);
+    auto counts = std::vector<std::uint32_t> {};
+    for (const auto& term : terms) {
+        counts.push_back(term.count);
+    }
+    std::ranges::sort(counts);
+    EXPECT_EQ(counts, (std::vector<std::uint32_t> { 1, 1, 1, 3 }));
+}
+
+TEST(TermIndexTests, ScoresFavourRepeatedTitleWordsInShortNotes) {
+    auto index = TermIndex {};
+    index.add(0, "Groceries", "milk and eggs");
+    index.add(1, "Weekly sync", "the meeting ran long and we talked about many things besides the agenda");
+    index.add(2, "Meeting notes", "meeting about the next meeting");
+    index.add(3, "Ideas", "a meeting");
+    index.add(4, "Standup", "meeting meeting");
+
+    const auto ranking = index.top(TermIndex::terms_of("meeting"), EVERYTHING, Bm25 {}, accept_all);
+    EXPECT_EQ(ordinals_of(ranking), (std::vector<NoteOrdinal> { 2, 4, 3, 1 }));
+    for (std::size_t i = 1; i < ranking.notes.size(); ++i) {
+        EXPECT_GE(ranking.notes[i - 1].score, ranking.notes[i].score);
+    }
+
+    // Without the boost, the title counts for no more than the content.
+    const auto flat = index.top(TermIndex::terms_of("meeting"), 1, Bm25 { .title_boost = 0.0 }, accept_all);
+    EXPECT_EQ(ordinals_of(flat), (std::vector<NoteOrdinal> { 4 }));
+}
+
+TEST(TermIndexTests, TopKMatchesAFullRankingWhileSkippingNotes) {
+    auto index = TermIndex {};
+    for (NoteOrdinal i = 0; i < 2000; ++i) {
+        const auto title = i % 50 == 0 ? fmt::format("rare topic {}", i) : fmt::format("note {}", i);
+        auto content = std::string {};
+        for (NoteOrdinal word = 0; word < 5 + i % 13; ++word) {
+            content += word % 3 == 0 ? "common " : "filler ";
+        }
+        if (i % 7 == 0) {
+            content += "topic ";
+        }
+        index.add(i, title, content);
+    }
+
+    const auto query = TermIndex::terms_of("rare topic common");
+    const auto full = index.top(query, EVERYTHING, Bm25 {}, accept_all);
+    const auto top = index.top(query, 10, Bm25 {}, accept_all);
+    const auto ranked = ordinals_of(full);
+    ASSERT_EQ(top.notes.size(), 10);
+    EXPECT_EQ(ordinals_of(top), std::vector<NoteOrdinal>(ranked.begin(), ranked.begin() + 10));
+    EXPECT_LT(top.scored, full.scored / 4);
+
+    // Turning notes down lets the next best in.
+    const auto odd = index.top(query, 10, Bm25 {}, [](const ScoredNote& note) { return note.ordinal % 2 == 1; });
+    auto expected = std::vector<NoteOrdinal> {};
+    for (const auto ordinal : ranked) {
+        if (ordinal % 2 == 1 && expected.size() < 10) {
+            expected.push_back(ordinal);
+        }
+    }
+    EXPECT_EQ(ordinals_of(odd), expected);
+}
+
+TEST(TermIndexTests, BuildMatchesAddingOneAtATime) {
+    auto added = TermIndex {};
+    auto parts = std::vector<TermIndex::Builder>(3, TermIndex::Builder { 4 });
+    for (NoteOrdinal i = 0; i < 500; ++i) {
+        const auto title = fmt::format("alpha {}", i % 11 == 0 ? "beta beta" : "gamma");
+        const auto content = fmt::format("delta {} {}", i % 5, std::string(i % 3, 'x'));
+        added.add(i, title, content);
+        parts[i % parts.size()].add(i, title, content);
+    }
+
+    const auto built = TermIndex::build(parts, 2);
+    EXPECT_EQ(built.term_count(), added.term_count());
+    EXPECT_EQ(built.indexed().to_ordinals(), added.indexed().to_ordinals());
+    for (const auto* query : { "alpha", "beta", "gamma delta", "delta 3", "xx", "missing" }) {
+        const auto expected = added.top(TermIndex::terms_of(query), 20, Bm25 {}, accept_all);
+        const auto actual = built.top(TermIndex::terms_of(query), 20, Bm25 {}, accept_all);
+        ASSERT_EQ(ordinals_of(actual), ordinals_of(expected)) << query;
+        for (std::size_t i = 0; i < actual.notes.size(); ++i) {
+            EXPECT_DOUBLE_EQ(actual.notes[i].score, expected.notes[i].score) << query;
+        }
+    }
+}
+
+TEST(TermIndexTests, BuildTellsApartTermsWhoseHashesShareTheLowHalf) {
+    // Both hash to ...bb0e95b4, which is all `build` sorts by.
+    auto added = TermIndex {};
+    auto parts = std::vector<TermIndex::Builder>(2);
+    for (NoteOrdinal i = 0; i < 40; ++i) {
+        const auto content = std::string { i % 3 == 0 ? "w122881 w714990" : i % 2 == 0 ? "w714990" : "w122881" };
+        added.add(i, "", content);
+        parts[i % parts.size()].add(i, "", content);
+    }
+
+    const auto built = TermIndex::build(parts, 1);
+    EXPECT_EQ(built.term_count(), added.term_count());
+    for (const auto* query : { "w122881", "w714990" }) {
+        const auto expected = added.top(TermIndex::terms_of(query), 40, Bm25 {}, accept_all);
+        const auto actual = built.top(TermIndex::terms_of(query), 40, Bm25 {}, accept_all);
+        EXPECT_EQ(ordinals_of(actual), ordinals_of(expected)) << query;
+    }
+}
+
+TEST(TermIndexTests, UpdatesAndPurgesMatchARebuild) {
+    auto index = TermIndex {};
+    index.add(0, "alpha", "beta beta gamma");
+    index.add(1, "beta", "alpha");
+    index.add(2, "gamma", "gamma gamma beta");
+    index.update(0, TermIndex::Field::Content, "beta beta gamma", "beta delta");
+    index.update(1, TermIndex::Field::Title, "beta", "delta delta");
+    EXPECT_TRUE(index.contains_any(0, TermIndex::terms_of("delta")));
+    EXPECT_FALSE(index.contains_any(1, TermIndex::terms_of("beta")));
+
+    auto dead = Bitmap {};
+    dead.set(2);
+    index.purge(index.terms(), dead);
+    index.forget(dead);
+
+    auto rebuilt = TermIndex {};
+    rebuilt.add(0, "alpha", "beta delta");
+    rebuilt.add(1, "delta delta", "alpha");
+    EXPECT_EQ(index.term_count(), rebuilt.term_count());
+    EXPECT_EQ(index.indexed().to_ordinals(), rebuilt.indexed().to_ordinals());
+    for (const auto* query : { "alpha", "beta", "delta", "gamma", "alpha delta" }) {
+        const auto expected = rebuilt.top(TermIndex::terms_of(query), EVERYTHING, Bm25 {}, accept_all);
+        const auto actual = index.top(TermIndex::terms_of(query), EVERYTHING, Bm25 {}, accept_all);
+        ASSERT_EQ(ordinals_of(actual), ordinals_of(expected)) << query;
+        for (std::size_t i = 0; i < actual.notes.size(); ++i) {
+            EXPECT_DOUBLE_EQ(actual.notes[i].score, expected.notes[i].score) << query;
+        }
+    }
+}
+
+}  // namespace
@@ -0,0 +1,107 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/TrigramIndex.hpp>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using pg::store::NoteOrdinal;
+using pg::store::TrigramIndex;
+
+class TrigramIndexTests: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        titles_ = { "Weekly Meeting Notes", "Grocery list", "Project roadmap", "meeting with Bob", "Ideas" };
+        for (NoteOrdinal i = 0; i < titles_.size(); ++i) {
+            index_.add(i, titles_[i]);
+        }
+    }
+
+    [[nodiscard]] auto find(std::string_view fragment, bool case_sensitive) const -> std::vector<NoteOrdinal> {
+        return index_.find(fragment, case_sensitive, [this](NoteOrdinal i) { return titles_[i]; }).to_ordinals();
+    }
+
+    std::vector<std::string> titles_;
+    TrigramIndex index_;
+};
+
+TEST_F(TrigramIndexTests, FindsFragmentsInsideWords) {
+    EXPECT_EQ(find("eetin", false), (std::vector<NoteOrdinal> { 0, 3 }));
+    EXPECT_EQ(find("admap", false), (std::vector<NoteOrdinal> { 2 }));
+    EXPECT_TRUE(find("zzz", false).empty());
+}
+
+TEST_F(TrigramIndexTests, CaseSensitivityIsVerifiedAfterLookup) {
+    EXPECT_EQ(find("Meeting", true), (std::vector<NoteOrdinal> { 0 }));
+    EXPECT_EQ(find("MEETING", false), (std::vector<NoteOrdinal> { 0, 3 }));
+}
+
+TEST_F(TrigramIndexTests, ShortFragmentsFallBackToAllNotes) {
+    EXPECT_FALSE(index_.candidates("de").has_value());
+    EXPECT_EQ(find("de", false), (std::vector<NoteOrdinal> { 4 }));
+}
+
+TEST_F(TrigramIndexTests, CandidatesAreVerified) {
+    // Both trigrams of "xyzq" ("xyz" and "yzq") occur in note 5, but the fragment itself does not.
+    index_.add(5, "xyz yzq");
+    titles_.emplace_back("xyz yzq");
+    auto candidates = index_.candidates("xyzq");
+    ASSERT_TRUE(candidates.has_value());
+    EXPECT_EQ(candidates->to_ordinals(), (std::vector<NoteOrdinal> { 5 }));
+    EXPECT_TRUE(find("xyzq", false).empty());
+}
+
+TEST_F(TrigramIndexTests, IncrementalUpdateMatchesRebuild) {
+    index_.update(1, titles_[1], "Grocery list for the meeting");
+    titles_[1] = "Grocery list for the meeting";
+    index_.remove(4, titles_[4]);
+
+    auto rebuilt = TrigramIndex {};
+    for (NoteOrdinal i = 0; i < 4; ++i) {
+        rebuilt.add(i, titles_[i]);
+    }
+    EXPECT_EQ(find("meeting", false), (std::vector<NoteOrdinal> { 0, 1, 3 }));
+    EXPECT_EQ(index_.trigram_count(), rebuilt.trigram_count());
+    EXPECT_EQ(*index_.candidates("grocery"), *rebuilt.candidates("grocery"));
+    EXPECT_FALSE(index_.indexed().test(4));
+}
+
+TEST_F(TrigramIndexTests, BuildMatchesAddingOneAtATime) {
+    auto texts = std::vector<std::string> {};
+    auto added = TrigramIndex {};
+    auto parts = std::vector<TrigramIndex::Builder>(3, TrigramIndex::Builder { 4 });
+    for (NoteOrdinal i = 0; i < 500; ++i) {
+        texts.push_back(fmt::format("note {} of {} about {}", i, i % 7, titles_[i % titles_.size()]));
+        added.add(i, texts.back());
+        parts[i % parts.size()].add(i, texts.back());
+    }
+
+    const auto built = TrigramIndex::build(parts, 2);
+    EXPECT_EQ(built.trigram_count(), added.trigram_count());
+    EXPECT_EQ(built.indexed().to_ordinals(), added.indexed().to_ordinals());
+    for (const auto* fragment : { "meeting", "note 12", "of 3 ab", "roadmap", "zzz" }) {
+        EXPECT_EQ(*built.candidates(fragment), *added.candidates(fragment)) << fragment;
+    }
+}
+
+TEST_F(TrigramIndexTests, FuzzyToleratesTypos) {
+    auto matches = index_.fuzzy("weekly meetnig", 0.2, 3);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(matches.front().ordinal, 0);
+    for (std::size_t i = 1; i < matches.size(); ++i) {
+        EXPECT_GE(matches[i - 1].score, matches[i].score);
+    }
+    EXPECT_TRUE(index_.fuzzy("xq", 0.0, 3).empty());
+}
+
+}  // namespace
@@ -0,0 +1,228 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pg/store/Crc32c.hpp>
+#include <pg/store/File.hpp>
+#include <pg/store/Wal.hpp>
+
+#include <gtest/gtest.h>
+
+#include "TempDirectory.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using pg::store::crc32c;
+using pg::store::crc32c_hardware;
+using pg::store::crc32c_software;
+using pg::store::File;
+using pg::store::FrameKind;
+using pg::store::replay_wal;
+using pg::store::Result;
+using pg::store::Timestamp;
+using pg::store::WalFrame;
+using pg::store::WalOptions;
+using pg::store::WriteAheadLog;
+using pg::store::test::TempDirectory;
+
+struct Replayed {
+    FrameKind kind;
+    std::uint64_t version;
+    Timestamp timestamp;
+    std::string payload;
+};
+
+class WalTests: public ::testing::Test {
+  protected:
+    auto replay() -> std::vector<Replayed> {
+        auto frames = std::vector<Replayed> {};
+        auto stats = replay_wal(path_, [&](const WalFrame& frame) -> Result<void> {
+            frames.push_back(Replayed {
+              frame.kind,
+              frame.version,
+              frame.timestamp,
+              std::string { frame.payload.begin(), frame.payload.end() },
+            });
+            return {};
+        });
+        EXPECT_TRUE(stats.has_value());
+        return frames;
+    }
+
+    static auto frame(FrameKind kind, std::uint64_t version, const std::string& payload) -> WalFrame {
+        return WalFrame {
+            kind,
+            version,
+            Timestamp { std::chrono::seconds { version } },
+            std::span { reinterpret_cast<const std::uint8_t*>(payload.data()), payload.size() },
+        };
+    }
+
+    TempDirectory directory_ { "wal" };
+    std::filesystem::path path_ = directory_ / "notes.log";
+};
+
+TEST(Crc32cTests, MatchesTheCheckValueAtEveryAlignment) {
+    const auto check = std::string { "123456789" };
+    const auto bytes = [](std::string_view text) {
+        return std::span { reinterpret_cast<const std::uint8_t*>(text.data()), text.size() };
+    };
+    EXPECT_EQ(crc32c(bytes(check)), 0xE3069283U);
+    // Continuing a checksum gives the same result as computing it in one go.
+    EXPECT_EQ(crc32c(bytes(check.substr(4)), crc32c(bytes(check.substr(0, 4)))), 0xE3069283U);
+
+    const auto padded = std::string(7, '.') + check;
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        const auto text = std::string_view { padded }.substr(7 - offset);
+        EXPECT_EQ(crc32c(bytes(text.substr(offset))), 0xE3069283U);
+    }
+}
+
+TEST(Crc32cTests, HardwareAndSoftwareAgree) {
+    auto data = std::vector<std::uint8_t>(4096 + 7);
+    auto state = std::uint32_t { 12345 };
+    for (auto& byte : data) {
+        state = state * 1664525U + 1013904223U;
+        byte = static_cast<std::uint8_t>(state >> 24);
+    }
+    // Every alignment, and lengths on both sides of the 8 byte words both paths work in.
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        for (const std::size_t size : { 0, 1, 7, 8, 9, 63, 64, 1000, 4096 }) {
+            const auto bytes = std::span { data }.subspan(offset, size);
+            EXPECT_EQ(crc32c(bytes), crc32c_software(bytes)) << offset << "+" << size;
+            EXPECT_EQ(crc32c(bytes, 0xDEADBEEFU), crc32c_software(bytes, 0xDEADBEEFU)) << offset << "+" << size;
+        }
+    }
+    RecordProperty("hardware", crc32c_hardware() ? "sse4.2" : "none");
+}
+
+TEST_F(WalTests, ReplaysWhatWasCommitted) {
+    {
+        auto wal = WriteAheadLog::open(path_);
+        ASSERT_TRUE(wal.has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 1, "first")).has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Update, 2, "")).has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Delete, 3, std::string(100'000, 'x'))).has_value());
+    }
+
+    const auto frames = replay();
+    ASSERT_EQ(frames.size(), 3);
+    EXPECT_EQ(frames[0].kind, FrameKind::Create);
+    EXPECT_EQ(frames[0].payload, "first");
+    EXPECT_EQ(frames[1].version, 2);
+    EXPECT_EQ(frames[1].timestamp, Timestamp { 2s });
+    EXPECT_TRUE(frames[1].payload.empty());
+    EXPECT_EQ(frames[2].payload.size(), 100'000);
+
+    // Reopening appends after what is there.
+    {
+        auto wal = WriteAheadLog::open(path_);
+        ASSERT_TRUE(wal.has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 4, "again")).has_value());
+    }
+    EXPECT_EQ(replay().size(), 4);
+}
+
+TEST_F(WalTests, TornTailIsCutOff) {
+    {
+        auto wal = WriteAheadLog::open(path_);
+        ASSERT_TRUE(wal.has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 1, "kept")).has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 2, "torn")).has_value());
+    }
+    const auto full = std::filesystem::file_size(path_);
+    std::filesystem::resize_file(path_, full - 2);
+
+    auto stats = replay_wal(path_, [](const WalFrame&) -> Result<void> { return {}; });
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->frames, 1);
+    EXPECT_GT(stats->discarded_bytes, 0);
+    EXPECT_EQ(std::filesystem::file_size(path_), stats->valid_bytes);
+
+    {
+        auto wal = WriteAheadLog::open(path_);
+        ASSERT_TRUE(wal.has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 2, "rewritten")).has_value());
+    }
+    const auto frames = replay();
+    ASSERT_EQ(frames.size(), 2);
+    EXPECT_EQ(frames[1].payload, "rewritten");
+}
+
+TEST_F(WalTests, CorruptFrameEndsTheLog) {
+    {
+        auto wal = WriteAheadLog::open(path_);
+        ASSERT_TRUE(wal.has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 1, "kept")).has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 2, "flipped")).has_value());
+        ASSERT_TRUE((*wal)->commit(frame(FrameKind::Create, 3, "lost")).has_value());
+    }
+    {
+        auto file = File::open(path_, File::Mode::Read);
+        ASSERT_TRUE(file.has_value());
+        auto bytes = std::vector<std::uint8_t>(std::filesystem::file_size(path_));
+        ASSERT_TRUE(file->read_at(0, bytes).has_value());
+        file->close();
+        const auto text = std::string_view { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+        const auto flipped = text.find("flipped");
+        ASSERT_NE(flipped, std::string_view::npos);
+        bytes[flipped] ^= 0x20;
+        auto writer = File::open(path_, File::Mode::Truncate);
+        ASSERT_TRUE(writer.has_value());
+        ASSERT_TRUE(writer->write(bytes).has_value());
+    }
+
+    const auto frames = replay();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].payload, "kept");
+}
+
+TEST_F(WalTests, ConcurrentCommitsShareSyncs) {
+    constexpr std::size_t THREADS = 8;
+    constexpr std::size_t COMMITS = 50;
+    {
+        auto wal = WriteAheadLog::open(path_, WalOptions { .max_delay = 2ms });
+        ASSERT_TRUE(wal.has_value());
+        {
+            auto committers = std::vector<std::jthread> {};
+            for (std::size_t t = 0; t < THREADS; ++t) {
+                committers.emplace_back([&, t] {
+                    for (std::size_t i = 0; i < COMMITS; ++i) {
+                        const auto payload = fmt::format("{}:{}", t, i);
+                        EXPECT_TRUE((*wal)->commit(frame(FrameKind::Update, i, payload)).has_value());
+                    }
+                });
+            }
+        }
+        const auto stats = (*wal)->stats();
+        EXPECT_EQ(stats.commits, THREADS * COMMITS);
+        EXPECT_LT(stats.batches, stats.commits);
+        EXPECT_GT(stats.largest_batch, 1);
+    }
+
+    // Each committer's frames reach the log in the order it committed them.
+    auto next = std::vector<std::size_t>(THREADS, 0);
+    const auto frames = replay();
+    ASSERT_EQ(frames.size(), THREADS * COMMITS);
+    for (const auto& replayed : frames) {
+        const auto colon = replayed.payload.find(':');
+        const auto thread = std::stoul(replayed.payload.substr(0, colon));
+        EXPECT_EQ(std::stoul(replayed.payload.substr(colon + 1)), next[thread]++);
+    }
+}
+
+}  // namespace
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <pg/util/text_search.hpp>
+
+#include <plf_nanotimer.h>
+
+namespace {
+
+using namespace pg::util::text;
+
+/// Build something that looks like note content: mixed case words, punctuation and line breaks.
+auto make_note_content(std::size_t size, std::mt19937& rng) -> std::string {
+    constexpr std::array WORDS { "meeting", "Notes", "TODO", "follow", "up", "with", "the", "Team", "about",
+                                 "roadmap", "and", "budget", "review", "Ideas:", "draft", "- item", "\n" };
+    auto pick = std::uniform_int_distribution<std::size_t> { 0, WORDS.size() - 1 };
+    auto out = std::string {};
+    out.reserve(size + 16);
+    while (out.size() < size) {
+        out += WORDS[pick(rng)];
+        out += ' ';
+    }
+    out.resize(size);
+    return out;
+}
+
+/// Run `find` until at least `min_bytes` have been scanned and return the throughput in GiB/s.
+auto measure(SimdLevel level, std::string_view hay, std::string_view needle, bool case_sensitive) -> double {
+    constexpr std::size_t MIN_BYTES = std::size_t { 256 } << 20;
+    const auto iterations = std::max<std::size_t>(MIN_BYTES / std::max<std::size_t>(hay.size(), 1), 16);
+
+    volatile std::size_t sink = 0;
+    plf::nanotimer timer;
+    timer.start();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        sink = sink + find(level, hay, needle, case_sensitive);
+    }
+    const auto elapsed_ns = timer.get_elapsed_ns();
+    const auto bytes = static_cast<double>(hay.size()) * static_cast<double>(iterations);
+    return bytes / elapsed_ns * 1e9 / static_cast<double>(1ULL << 30);
+}
+
+}  // namespace
+
+auto main() -> int {
+    constexpr std::array SIZES { std::size_t { 256 }, std::size_t { 4 } << 10, std::size_t { 64 } << 10,
+                                 std::size_t { 1 } << 20 };
+    constexpr std::array LEVELS { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 };
+    // Absent needles force a full scan; the second one shares a common prefix with real words.
+    constexpr std::array NEEDLES { std::string_view { "quarterly" }, std::string_view { "meeting notes xyz" } };
+
+    auto rng = std::mt19937 { 1234 };
+    fmt::print("detected: {}\n", simd_level_name(detected_simd_level()));
+    fmt::print("{:>10} {:>20} {:>8} {:>8} {:>10}\n", "size", "needle", "case", "kernel", "GiB/s");
+    for (auto size : SIZES) {
+        const auto content = make_note_content(size, rng);
+        for (auto needle : NEEDLES) {
+            for (bool case_sensitive : { true, false }) {
+                for (auto level : LEVELS) {
+                    if (static_cast<int>(level) > static_cast<int>(detected_simd_level())) {
+                        continue;
+                    }
+                    fmt::print(
+                      "{:>10} {:>20} {:>8} {:>8} {:>10.2f}\n",
+                      size,
+                      needle,
+                      case_sensitive ? "exact" : "fold",
+                      simd_level_name(level),
+                      measure(level, content, needle, case_sensitive));
+                }
+            }
+        }
+    }
+    return 0;
+}
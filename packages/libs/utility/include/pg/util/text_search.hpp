@@ -0,0 +1,96 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace pg::util::text {
+
+/**
+ * @brief The instruction set tier used by the text search kernels.
+ *
+ * The best tier supported by the running CPU is detected once, on first use, and every call without an explicit
+ * `SimdLevel` dispatches to it.
+ */
+enum class SimdLevel { Scalar, Sse2, Avx2 };
+
+/**
+ * @brief The best `SimdLevel` supported by the running CPU (and compiled into this build).
+ */
+[[nodiscard]] auto detected_simd_level() noexcept -> SimdLevel;
+
+/**
+ * @brief A short, human readable name for `level`.
+ */
+[[nodiscard]] auto simd_level_name(SimdLevel level) noexcept -> std::string_view;
+
+/**
+ * @brief Find the first occurrence of `needle` in `haystack`.
+ *
+ * Semantics match `std::string_view::find`: an empty needle is found at `0`, and `std::string_view::npos` is returned
+ * when there is no match. When `case_sensitive` is **false** ASCII letters are folded before comparing, all other
+ * bytes (including UTF-8 sequences) must match exactly.
+ * @param haystack The text to search
+ * @param needle The text to look for
+ * @param case_sensitive Whether ASCII letters must match case
+ * @return The index of the first match, or `std::string_view::npos`
+ */
+[[nodiscard]] auto find(std::string_view haystack, std::string_view needle, bool case_sensitive = true) noexcept
+  -> std::size_t;
+
+/**
+ * @brief Same as `find`, but forces the given kernel tier. Tiers the CPU does not support fall back to the best one
+ * that it does. Mostly useful for tests and benchmarks.
+ */
+[[nodiscard]] auto find(SimdLevel level, std::string_view haystack, std::string_view needle, bool case_sensitive)
+  noexcept -> std::size_t;
+
+/**
+ * @brief Whether `lhs` and `rhs` are equal, optionally ignoring ASCII case.
+ */
+[[nodiscard]] auto equals(std::string_view lhs, std::string_view rhs, bool case_sensitive = true) noexcept -> bool;
+
+/**
+ * @brief Same as `equals`, but forces the given kernel tier.
+ */
+[[nodiscard]] auto equals(SimdLevel level, std::string_view lhs, std::string_view rhs, bool case_sensitive) noexcept
+  -> bool;
+
+/**
+ * @brief Whether `haystack` contains `needle`. Backs `TextContainsQuery`.
+ */
+[[nodiscard]] inline auto contains(std::string_view haystack, std::string_view needle, bool case_sensitive = true)
+  noexcept -> bool {
+    return find(haystack, needle, case_sensitive) != std::string_view::npos;
+}
+
+/**
+ * @brief Whether `haystack` begins with `prefix`. Backs `TextStartsWithQuery`.
+ */
+[[nodiscard]] inline auto starts_with(std::string_view haystack, std::string_view prefix, bool case_sensitive = true)
+  noexcept -> bool {
+    return haystack.size() >= prefix.size() && equals(haystack.substr(0, prefix.size()), prefix, case_sensitive);
+}
+
+/**
+ * @brief Whether `haystack` ends with `suffix`. Backs `TextEndsWithQuery`.
+ */
+[[nodiscard]] inline auto ends_with(std::string_view haystack, std::string_view suffix, bool case_sensitive = true)
+  noexcept -> bool {
+    return haystack.size() >= suffix.size()
+        && equals(haystack.substr(haystack.size() - suffix.size()), suffix, case_sensitive);
+}
+
+/**
+ * @brief Fold a single ASCII letter to lower case, every other byte is returned unchanged.
+ */
+[[nodiscard]] constexpr auto fold_ascii(char c) noexcept -> char {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+}  // namespace pg::util::text
@@ -0,0 +1,360 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include <pg/util/text_search.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define PG_TEXT_SEARCH_X86 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#        define PG_TARGET(isa)
+#    else
+#        define PG_TARGET(isa) __attribute__((target(isa)))
+#    endif
+#endif
+
+namespace pg::util::text {
+
+namespace {
+    using FindFn = std::size_t (*)(std::string_view, std::string_view) noexcept;
+    using EqualsFn = bool (*)(const char*, const char*, std::size_t) noexcept;
+
+    /// One set of kernels per `SimdLevel`, picked once and then called through a pointer.
+    struct Kernels {
+        FindFn find_cs;
+        FindFn find_ci;
+        EqualsFn equals_ci;
+    };
+
+    constexpr std::uint64_t ONES = 0x0101010101010101ULL;
+    constexpr std::uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+    inline auto load_u64(const char* ptr) noexcept -> std::uint64_t {
+        std::uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    /// Lower-case eight bytes at once. Bytes with the high bit set are never touched.
+    inline auto fold_u64(std::uint64_t x) noexcept -> std::uint64_t {
+        auto heptets = x & ~HIGH_BITS;
+        auto ge_a = heptets + (0x80 - 'A') * ONES;
+        auto gt_z = heptets + (0x80 - 'Z' - 1) * ONES;
+        auto upper = ge_a & ~gt_z & ~x & HIGH_BITS;
+        return x | (upper >> 2);
+    }
+
+    //
+    // Scalar
+    //
+
+    auto scalar_equals_ci(const char* lhs, const char* rhs, std::size_t len) noexcept -> bool {
+        std::size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            if (fold_u64(load_u64(lhs + i)) != fold_u64(load_u64(rhs + i))) {
+                return false;
+            }
+        }
+        for (; i < len; ++i) {
+            if (fold_ascii(lhs[i]) != fold_ascii(rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto scalar_find_cs(std::string_view haystack, std::string_view needle) noexcept -> std::size_t {
+        return haystack.find(needle);
+    }
+
+    auto scalar_find_ci(std::string_view haystack, std::string_view needle) noexcept -> std::size_t {
+        if (needle.empty()) {
+            return 0;
+        }
+        if (needle.size() > haystack.size()) {
+            return std::string_view::npos;
+        }
+        const auto first = fold_ascii(needle.front());
+        const auto last = fold_ascii(needle.back());
+        const auto end = haystack.size() - needle.size();
+        for (std::size_t i = 0; i <= end; ++i) {
+            if (fold_ascii(haystack[i]) == first && fold_ascii(haystack[i + needle.size() - 1]) == last
+                && scalar_equals_ci(haystack.data() + i, needle.data(), needle.size())) {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    constexpr Kernels SCALAR_KERNELS { &scalar_find_cs, &scalar_find_ci, &scalar_equals_ci };
+
+#ifdef PG_TEXT_SEARCH_X86
+    //
+    // SSE2 (16 byte lanes)
+    //
+    // The substring kernels use the "generic SIMD" first/last byte filter: broadcast the first and last byte of the
+    // needle, compare them against two overlapping loads of the haystack and only run a full compare on the positions
+    // where both matched.
+    //
+
+    PG_TARGET("sse2") inline auto fold_128(__m128i v) noexcept -> __m128i {
+        // 'A'..'Z' are the only bytes that land in [-128, -103] after adding (128 - 'A').
+        auto shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 'A')));
+        auto is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+        return _mm_or_si128(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+    }
+
+    PG_TARGET("sse2") auto sse2_equals_ci(const char* lhs, const char* rhs, std::size_t len) noexcept -> bool {
+        std::size_t i = 0;
+        for (; i + 16 <= len; i += 16) {
+            auto a = fold_128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i)));
+            auto b = fold_128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+                return false;
+            }
+        }
+        return scalar_equals_ci(lhs + i, rhs + i, len - i);
+    }
+
+    template <bool CaseSensitive>
+    PG_TARGET("sse2")
+    auto sse2_find(std::string_view haystack, std::string_view needle) noexcept -> std::size_t {
+        if (needle.empty()) {
+            return 0;
+        }
+        if (needle.size() > haystack.size()) {
+            return std::string_view::npos;
+        }
+        const auto* hay = haystack.data();
+        const auto n = haystack.size();
+        const auto m = needle.size();
+        const auto first = _mm_set1_epi8(CaseSensitive ? needle.front() : fold_ascii(needle.front()));
+        const auto last = _mm_set1_epi8(CaseSensitive ? needle.back() : fold_ascii(needle.back()));
+
+        std::size_t i = 0;
+        for (; i + m - 1 + 16 <= n; i += 16) {
+            auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+            auto block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+            if constexpr (!CaseSensitive) {
+                block_first = fold_128(block_first);
+                block_last = fold_128(block_last);
+            }
+            auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(eq));
+            while (mask != 0) {
+                const auto pos = i + static_cast<std::size_t>(std::countr_zero(mask));
+                const bool matched = CaseSensitive ? std::memcmp(hay + pos, needle.data(), m) == 0
+                                                   : sse2_equals_ci(hay + pos, needle.data(), m);
+                if (matched) {
+                    return pos;
+                }
+                mask &= mask - 1;
+            }
+        }
+        auto rest = CaseSensitive ? scalar_find_cs(haystack.substr(i), needle)
+                                  : scalar_find_ci(haystack.substr(i), needle);
+        return rest == std::string_view::npos ? rest : i + rest;
+    }
+
+    constexpr Kernels SSE2_KERNELS { &sse2_find<true>, &sse2_find<false>, &sse2_equals_ci };
+
+    //
+    // AVX2 (32 byte lanes)
+    //
+
+    PG_TARGET("avx2") inline auto fold_256(__m256i v) noexcept -> __m256i {
+        auto shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(128 - 'A')));
+        auto is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+        return _mm256_or_si256(v, _mm256_and_si256(is_upper, _mm256_set1_epi8(0x20)));
+    }
+
+    PG_TARGET("avx2") auto avx2_equals_ci(const char* lhs, const char* rhs, std::size_t len) noexcept -> bool {
+        std::size_t i = 0;
+        for (; i + 32 <= len; i += 32) {
+            auto a = fold_256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i)));
+            auto b = fold_256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i)));
+            if (static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))) != 0xFFFFFFFFU) {
+                return false;
+            }
+        }
+        return sse2_equals_ci(lhs + i, rhs + i, len - i);
+    }
+
+    /// Bit `i` of the result is set when both the first and the last byte of the needle match at `block + i`.
+    template <bool CaseSensitive>
+    PG_TARGET("avx2")
+    inline auto avx2_candidates(const char* block, std::size_t m, __m256i first, __m256i last) noexcept -> __m256i {
+        auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + m - 1));
+        if constexpr (!CaseSensitive) {
+            block_first = fold_256(block_first);
+            block_last = fold_256(block_last);
+        }
+        return _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+    }
+
+    /// Run the full compare for every candidate in `mask`, lowest position first.
+    template <bool CaseSensitive>
+    PG_TARGET("avx2")
+    auto avx2_verify(std::string_view haystack, std::string_view needle, std::size_t at, std::uint64_t mask) noexcept
+      -> std::size_t {
+        while (mask != 0) {
+            const auto pos = at + static_cast<std::size_t>(std::countr_zero(mask));
+            const bool matched = CaseSensitive ? std::memcmp(haystack.data() + pos, needle.data(), needle.size()) == 0
+                                               : avx2_equals_ci(haystack.data() + pos, needle.data(), needle.size());
+            if (matched) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+        return std::string_view::npos;
+    }
+
+    template <bool CaseSensitive>
+    PG_TARGET("avx2")
+    auto avx2_find(std::string_view haystack, std::string_view needle) noexcept -> std::size_t {
+        if (needle.empty()) {
+            return 0;
+        }
+        if (needle.size() > haystack.size()) {
+            return std::string_view::npos;
+        }
+        const auto* hay = haystack.data();
+        const auto n = haystack.size();
+        const auto m = needle.size();
+        const auto first = _mm256_set1_epi8(CaseSensitive ? needle.front() : fold_ascii(needle.front()));
+        const auto last = _mm256_set1_epi8(CaseSensitive ? needle.back() : fold_ascii(needle.back()));
+
+        std::size_t i = 0;
+        // Two blocks per iteration: most blocks have no candidates at all, so one test covers 64 bytes.
+        for (; i + m - 1 + 64 <= n; i += 64) {
+            auto eq_lo = avx2_candidates<CaseSensitive>(hay + i, m, first, last);
+            auto eq_hi = avx2_candidates<CaseSensitive>(hay + i + 32, m, first, last);
+            if (_mm256_testz_si256(_mm256_or_si256(eq_lo, eq_hi), _mm256_or_si256(eq_lo, eq_hi)) != 0) {
+                continue;
+            }
+            const auto mask = static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(eq_lo)))
+                            | static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(eq_hi))) << 32;
+            if (auto pos = avx2_verify<CaseSensitive>(haystack, needle, i, mask); pos != std::string_view::npos) {
+                return pos;
+            }
+        }
+        for (; i + m - 1 + 32 <= n; i += 32) {
+            const auto mask = static_cast<std::uint32_t>(
+              _mm256_movemask_epi8(avx2_candidates<CaseSensitive>(hay + i, m, first, last)));
+            if (auto pos = avx2_verify<CaseSensitive>(haystack, needle, i, mask); pos != std::string_view::npos) {
+                return pos;
+            }
+        }
+        auto rest = sse2_find<CaseSensitive>(haystack.substr(i), needle);
+        return rest == std::string_view::npos ? rest : i + rest;
+    }
+
+    constexpr Kernels AVX2_KERNELS { &avx2_find<true>, &avx2_find<false>, &avx2_equals_ci };
+
+    auto detect() noexcept -> SimdLevel {
+#    if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] = {};
+        __cpuid(info, 0);
+        const int max_leaf = info[0];
+        __cpuid(info, 1);
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+                         && (_xgetbv(0) & 0x6) == 0x6;
+        bool avx2 = false;
+        if (max_leaf >= 7 && os_avx) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#    else
+        __builtin_cpu_init();
+        const bool sse2 = __builtin_cpu_supports("sse2") != 0;
+        const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#    endif
+        if (avx2) {
+            return SimdLevel::Avx2;
+        }
+        return sse2 ? SimdLevel::Sse2 : SimdLevel::Scalar;
+    }
+#else
+    auto detect() noexcept -> SimdLevel {
+        return SimdLevel::Scalar;
+    }
+#endif
+
+    /// Clamp `requested` to what the CPU can actually run, then return the matching kernels.
+    auto kernels_for(SimdLevel requested) noexcept -> const Kernels& {
+        const auto usable = static_cast<int>(requested) <= static_cast<int>(detected_simd_level())
+                            ? requested
+                            : detected_simd_level();
+        switch (usable) {
+#ifdef PG_TEXT_SEARCH_X86
+        case SimdLevel::Avx2: return AVX2_KERNELS;
+        case SimdLevel::Sse2: return SSE2_KERNELS;
+#endif
+        default: return SCALAR_KERNELS;
+        }
+    }
+
+    auto active_kernels() noexcept -> const Kernels& {
+        static const Kernels& kernels = kernels_for(detected_simd_level());
+        return kernels;
+    }
+
+    auto find_with(const Kernels& kernels, std::string_view haystack, std::string_view needle, bool case_sensitive)
+      noexcept -> std::size_t {
+        return case_sensitive ? kernels.find_cs(haystack, needle) : kernels.find_ci(haystack, needle);
+    }
+
+    auto equals_with(const Kernels& kernels, std::string_view lhs, std::string_view rhs, bool case_sensitive) noexcept
+      -> bool {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        if (case_sensitive) {
+            return lhs == rhs;
+        }
+        return kernels.equals_ci(lhs.data(), rhs.data(), lhs.size());
+    }
+}  // namespace
+
+auto detected_simd_level() noexcept -> SimdLevel {
+    static const SimdLevel level = detect();
+    return level;
+}
+
+auto simd_level_name(SimdLevel level) noexcept -> std::string_view {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+auto find(std::string_view haystack, std::string_view needle, bool case_sensitive) noexcept -> std::size_t {
+    return find_with(active_kernels(), haystack, needle, case_sensitive);
+}
+
+auto find(SimdLevel level, std::string_view haystack, std::string_view needle, bool case_sensitive) noexcept
+  -> std::size_t {
+    return find_with(kernels_for(level), haystack, needle, case_sensitive);
+}
+
+auto equals(std::string_view lhs, std::string_view rhs, bool case_sensitive) noexcept -> bool {
+    return equals_with(active_kernels(), lhs, rhs, case_sensitive);
+}
+
+auto equals(SimdLevel level, std::string_view lhs, std::string_view rhs, bool case_sensitive) noexcept -> bool {
+    return equals_with(kernels_for(level), lhs, rhs, case_sensitive);
+}
+
+}  // namespace pg::util::text
@@ -0,0 +1,126 @@
+// Copyright (c) 2022 Tony Barbitta
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <gtest/gtest.h>
+
+#include <pg/util/text_search.hpp>
+
+namespace {
+
+using namespace pg::util::text;
+
+constexpr std::array ALL_LEVELS { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 };
+
+auto to_lower(std::string_view input) -> std::string {
+    auto out = std::string { input };
+    std::ranges::transform(out, out.begin(), [](char c) { return fold_ascii(c); });
+    return out;
+}
+
+/// Random text over a tiny alphabet so that partial matches (and therefore the verify step) are common.
+auto random_text(std::mt19937& rng, std::size_t len, std::string_view alphabet) -> std::string {
+    auto pick = std::uniform_int_distribution<std::size_t> { 0, alphabet.size() - 1 };
+    auto out = std::string(len, '\0');
+    std::ranges::generate(out, [&] { return alphabet[pick(rng)]; });
+    return out;
+}
+
+TEST(TextSearchTests, MatchesStringViewEdgeCases) {
+    for (auto level : ALL_LEVELS) {
+        EXPECT_EQ(find(level, "", "", true), 0);
+        EXPECT_EQ(find(level, "abc", "", true), 0);
+        EXPECT_EQ(find(level, "", "a", true), std::string_view::npos);
+        EXPECT_EQ(find(level, "ab", "abc", true), std::string_view::npos);
+        EXPECT_EQ(find(level, "abc", "abc", true), 0);
+        EXPECT_EQ(find(level, "xxabc", "c", true), 4);
+    }
+}
+
+TEST(TextSearchTests, CaseInsensitiveFind) {
+    const auto text = std::string_view { "The Quick Brown Fox jumps over the lazy dog, again and AGAIN and again." };
+    for (auto level : ALL_LEVELS) {
+        EXPECT_EQ(find(level, text, "quick brown", false), 4);
+        EXPECT_EQ(find(level, text, "quick brown", true), std::string_view::npos);
+        EXPECT_EQ(find(level, text, "LAZY DOG", false), 35);
+        EXPECT_EQ(find(level, text, "AGAIN and again.", false), 55);
+    }
+}
+
+TEST(TextSearchTests, NonAsciiBytesAreNotFolded) {
+    // '\xC1' | 0x20 == '\xE1', which must not be treated as a case pair.
+    for (auto level : ALL_LEVELS) {
+        EXPECT_EQ(find(level, "caf\xC3\xA9 \xC1", "\xE1", false), std::string_view::npos);
+        EXPECT_FALSE(equals(level, "\xC1\xC1", "\xE1\xE1", false));
+        EXPECT_TRUE(equals(level, "[@`{", "[@`{", false));
+        EXPECT_FALSE(equals(level, "[", "{", false));
+    }
+}
+
+TEST(TextSearchTests, PrefixAndSuffix) {
+    EXPECT_TRUE(starts_with("Meeting notes", "MEETING", false));
+    EXPECT_FALSE(starts_with("Meeting notes", "MEETING", true));
+    EXPECT_TRUE(ends_with("Meeting notes", "Notes", false));
+    EXPECT_FALSE(ends_with("notes", "Meeting notes", false));
+    EXPECT_TRUE(contains("Meeting notes", "ting no"));
+}
+
+TEST(TextSearchTests, FuzzAgainstStringViewFind) {
+    auto rng = std::mt19937 { 0x5EED };
+    auto len_dist = std::uniform_int_distribution<std::size_t> { 0, 300 };
+    auto needle_dist = std::uniform_int_distribution<std::size_t> { 0, 40 };
+
+    for (int round = 0; round < 2000; ++round) {
+        const auto alphabet = round % 2 == 0 ? std::string_view { "abAB" } : std::string_view { "aA b\xC3\xA9zZ" };
+        const auto hay = random_text(rng, len_dist(rng), alphabet);
+        auto needle = random_text(rng, needle_dist(rng) % 6, alphabet);
+        if (round % 3 == 0 && !hay.empty()) {
+            // Also look for slices of the haystack itself, so long needles are found too.
+            const auto start = std::uniform_int_distribution<std::size_t> { 0, hay.size() - 1 }(rng);
+            needle = hay.substr(start, needle_dist(rng));
+        }
+
+        const auto expected_cs = std::string_view { hay }.find(needle);
+        const auto expected_ci = std::string_view { to_lower(hay) }.find(to_lower(needle));
+        for (auto level : ALL_LEVELS) {
+            ASSERT_EQ(find(level, hay, needle, true), expected_cs)
+              << fmt::format("[{}] hay='{}' needle='{}'", simd_level_name(level), hay, needle);
+            ASSERT_EQ(find(level, hay, needle, false), expected_ci)
+              << fmt::format("[{}] hay='{}' needle='{}'", simd_level_name(level), hay, needle);
+        }
+    }
+}
+
+TEST(TextSearchTests, FuzzEqualsIgnoreCase) {
+    auto rng = std::mt19937 { 42 };
+    auto len_dist = std::uniform_int_distribution<std::size_t> { 0, 200 };
+    auto all_bytes = std::string(256, '\0');
+    std::ranges::generate(all_bytes, [c = 0]() mutable { return static_cast<char>(c++); });
+
+    for (int round = 0; round < 2000; ++round) {
+        const auto lhs = random_text(rng, len_dist(rng), all_bytes);
+        auto rhs = lhs;
+        auto flip = std::uniform_int_distribution<std::size_t> { 0, std::max<std::size_t>(rhs.size(), 1) - 1 };
+        for (int i = 0; i < 3 && !rhs.empty(); ++i) {
+            auto& c = rhs[flip(rng)];
+            c = static_cast<char>(c ^ 0x20);
+        }
+        const auto expected = to_lower(lhs) == to_lower(rhs);
+        for (auto level : ALL_LEVELS) {
+            ASSERT_EQ(equals(level, lhs, rhs, false), expected) << simd_level_name(level);
+            ASSERT_EQ(equals(level, lhs, rhs, true), lhs == rhs) << simd_level_name(level);
+        }
+    }
+}
+
+}  // namespace